@@ -0,0 +1,341 @@
+#include <Arduino.h>
+#include <SPI.h>
+#include "hardware/gpio.h"
+
+// ============================================================================
+// USER SETTINGS
+// ============================================================================
+
+// Output frequency the array is running at (kHz keeps everything in integers)
+static constexpr uint32_t RF_OUT_KHZ = 10525000;   // 10.525 GHz
+
+// true: RFOUTB (VCO doubler), false: RFOUTA through RF_DIV
+static constexpr bool    USE_RFOUTB = true;
+static constexpr uint8_t RF_DIV     = 1;           // RFOUTA divider (1,2,4..64)
+
+// Linear array geometry, element pitch in micrometres (lambda/2 ~ 14242 um)
+static constexpr uint32_t ELEMENT_SPACING_UM = 14250;
+
+// Demo: step the beam through this range (centidegrees from broadside)
+static constexpr int32_t STEER_START_CDEG = -3000;
+static constexpr int32_t STEER_STOP_CDEG  =  3000;
+static constexpr int32_t STEER_STEP_CDEG  =   500;
+static constexpr uint32_t STEER_DWELL_MS  =  2000;
+
+// Size used for the compute benchmark in setup()
+static constexpr uint8_t MAX_ELEMENTS = 32;
+
+// ============================================================================
+// PIN DEFINITIONS (same wiring as the dual-board sketch)
+// ============================================================================
+static const int A_SCLK = 18;
+static const int A_MOSI = 19;
+static const int A_LE   = 20;
+static const int A_CE   = 17;
+
+static const int B_SCLK = 10;
+static const int B_MOSI = 11;
+static const int B_LE   = 12;
+static const int B_CE   = 13;
+
+static const int A_MISO_UNUSED = 16;
+static const int A_CS_UNUSED   = 21;
+static const int B_MISO_UNUSED = 14;
+static const int B_CS_UNUSED   = 15;
+
+SPIClassRP2040 spiA(spi0, A_MISO_UNUSED, A_CS_UNUSED, A_SCLK, A_MOSI);
+SPIClassRP2040 spiB(spi1, B_MISO_UNUSED, B_CS_UNUSED, B_SCLK, B_MOSI);
+
+SPISettings pllSPI(1000000, MSBFIRST, SPI_MODE0);
+
+// One entry per synthesizer in the array. Element i sits at i * spacing.
+// Boards sharing an SPI bus just need their own LE line.
+struct ArrayElement {
+  SPIClassRP2040 *spi;
+  int pinLE;
+  uint32_t cal_turns;   // per-element phase calibration, Q32 turns at RF out
+};
+
+static ArrayElement elements[] = {
+  { &spiA, A_LE, 0 },
+  { &spiB, B_LE, 0 },
+};
+static constexpr uint8_t ELEMENT_COUNT = sizeof(elements) / sizeof(elements[0]);
+
+// ============================================================================
+// SPI
+// ============================================================================
+static inline void pulseLE(int pinLE) {
+  digitalWrite(pinLE, HIGH);
+  delayMicroseconds(2);
+  digitalWrite(pinLE, LOW);
+  delayMicroseconds(2);
+}
+
+static inline void shiftReg(SPIClassRP2040 &spi, uint32_t reg) {
+  spi.beginTransaction(pllSPI);
+  spi.transfer((reg >> 24) & 0xFF);
+  spi.transfer((reg >> 16) & 0xFF);
+  spi.transfer((reg >>  8) & 0xFF);
+  spi.transfer((reg >>  0) & 0xFF);
+  spi.endTransaction();
+}
+
+static void writeReg(SPIClassRP2040 &spi, int pinLE, uint32_t reg) {
+  shiftReg(spi, reg);
+  pulseLE(pinLE);
+}
+
+// Known-good image from the dual-board sketch (R12..R0)
+static const uint32_t baseRegs[13] = {
+  0x0001040C, // R12
+  0x0061300B, // R11
+  0x00C0000A, // R10
+  0x00000009, // R9
+  0x102D0428, // R8
+  0x12000007, // R7
+  0x35000006, // R6
+  0x00800005, // R5
+  0x00000004, // R4
+  0x00000003, // R3
+  0x00001002, // R2
+  0x00000A41, // R1
+  0x00550000  // R0 LAST
+};
+
+static void programPLL(SPIClassRP2040 &spi, int pinLE) {
+  for (int i = 0; i < 13; i++) {
+    writeReg(spi, pinLE, baseRegs[i]);
+    delay(2);
+  }
+}
+
+// ============================================================================
+// Fixed-point sin/cos (CORDIC, rotation mode)
+// ============================================================================
+//
+// Angles are Q32 turns: 0x00000000 = 0, 0x40000000 = 90 deg, wraps at 360.
+// Results are Q30 (1.0 = 1 << 30). 16 iterations is ~5e-5 absolute error,
+// far below what the 24-bit phase word can resolve after the array scaling.
+
+static constexpr int CORDIC_ITERS = 16;
+
+// atan(2^-i) in Q32 turns
+static const int32_t cordicAtan[CORDIC_ITERS] = {
+  0x20000000, 0x12E4051E, 0x09FB385B, 0x051111D4,
+  0x028B0D43, 0x0145D7E1, 0x00A2F61E, 0x00517C55,
+  0x0028BE53, 0x00145F2F, 0x000A2F98, 0x000517CC,
+  0x00028BE6, 0x000145F3, 0x0000A2FA, 0x0000517D
+};
+
+// 1/K for the iteration count above, Q30
+static constexpr int32_t CORDIC_K_Q30 = 0x26DD3B6A;
+
+static void sinCosQ30(uint32_t angle_turns, int32_t *sin_q30, int32_t *cos_q30) {
+  // Fold into [-90, +90] deg; the other half-plane is the same point negated.
+  int32_t z = (int32_t)angle_turns;
+  bool negate = false;
+  if (z > 0x40000000 || z < -0x40000000) {
+    z = (int32_t)(angle_turns + 0x80000000u);
+    negate = true;
+  }
+
+  int32_t x = CORDIC_K_Q30;
+  int32_t y = 0;
+  for (int i = 0; i < CORDIC_ITERS; i++) {
+    int32_t dx = y >> i;
+    int32_t dy = x >> i;
+    if (z >= 0) { x -= dx; y += dy; z -= cordicAtan[i]; }
+    else        { x += dx; y -= dy; z += cordicAtan[i]; }
+  }
+
+  *sin_q30 = negate ? -y : y;
+  *cos_q30 = negate ? -x : x;
+}
+
+// ============================================================================
+// Steering vector
+// ============================================================================
+//
+// Element i needs phase  -i * (d / lambda) * sin(theta)  turns at RF out.
+// d/lambda only changes with frequency, so it's computed once (Q20) and the
+// per-element work is a single add; phases wrap for free in uint32.
+
+static constexpr uint32_t C_M_PER_S = 299792458u;
+
+// d/lambda = d_um * f_khz / (c * 1000), returned in Q20
+static uint32_t spacingRatioQ20(uint32_t spacing_um, uint32_t f_khz) {
+  uint64_t num = (uint64_t)spacing_um * f_khz;        // < 2^41
+  return (uint32_t)((num << 20) / ((uint64_t)C_M_PER_S * 1000u));
+}
+
+static inline uint32_t cdegToTurns(int32_t cdeg) {
+  return (uint32_t)((int64_t)cdeg * 4294967296LL / 36000);
+}
+
+// Fill phase_turns[0..n) (Q32 turns at RF out) for the given angle.
+static void computeSteering(int32_t angle_cdeg, uint32_t ratio_q20,
+                            const uint32_t *cal_turns, uint32_t *phase_turns,
+                            uint8_t n) {
+  int32_t s, c;
+  sinCosQ30(cdegToTurns(angle_cdeg), &s, &c);
+
+  // Q20 * Q30 = Q50 -> Q32
+  uint32_t step = (uint32_t)(((int64_t)ratio_q20 * s) >> 18);
+
+  uint32_t acc = 0;
+  for (uint8_t i = 0; i < n; i++) {
+    phase_turns[i] = (cal_turns ? cal_turns[i] : 0) - acc;
+    acc += step;
+  }
+}
+
+// ============================================================================
+// Phase words (R3) and synchronized update
+// ============================================================================
+//
+// R3: DB27:4 = 24-bit phase value, DB28 = phase adjust enable.
+// With phase adjust on, each R0 write shifts the output by the R3 value and
+// skips the VCO autocal, so the adjustment is *relative*: we stage the
+// difference from what's currently applied, then latch R0 on every board
+// with one LE edge so all elements move together.
+//
+// The phase value acts on the VCO. RFOUTB doubles the VCO (output phase is
+// 2x), RFOUTA divides it by RF_DIV (output phase is 1/div).
+
+static constexpr uint32_t R3_PHASE_ADJUST = (1u << 28);
+static constexpr uint32_t R0_AUTOCAL      = (1u << 21);
+
+static uint32_t appliedWord[MAX_ELEMENTS];   // 24-bit, what each board has now
+static uint32_t stagedR3[MAX_ELEMENTS];
+static uint32_t stagedWord[MAX_ELEMENTS];
+
+static inline uint32_t outTurnsToPhaseWord(uint32_t out_turns) {
+  uint32_t vco_turns = USE_RFOUTB ? (out_turns >> 1) : (out_turns * RF_DIV);
+  return vco_turns >> 8;   // Q32 -> 24-bit
+}
+
+static void stagePhases(const uint32_t *phase_turns, uint8_t n) {
+  for (uint8_t i = 0; i < n; i++) {
+    uint32_t w = outTurnsToPhaseWord(phase_turns[i]);
+    uint32_t delta = (w - appliedWord[i]) & 0xFFFFFF;
+    stagedWord[i] = w;
+    stagedR3[i] = (baseRegs[9] & ~0x0FFFFFF0u) | R3_PHASE_ADJUST | (delta << 4) | 3u;
+  }
+}
+
+static void applyStagedPhases() {
+  // Each board gets its own R3 (no effect until R0)
+  for (uint8_t i = 0; i < ELEMENT_COUNT; i++) {
+    writeReg(*elements[i].spi, elements[i].pinLE, stagedR3[i]);
+  }
+
+  // Same R0 on every bus, then one LE edge for the whole array
+  uint32_t r0 = baseRegs[12] & ~R0_AUTOCAL;
+  uint32_t leMask = 0;
+  SPIClassRP2040 *shifted[ELEMENT_COUNT];
+  uint8_t nShifted = 0;
+  for (uint8_t i = 0; i < ELEMENT_COUNT; i++) {
+    bool seen = false;
+    for (uint8_t k = 0; k < nShifted; k++) seen |= (shifted[k] == elements[i].spi);
+    if (!seen) {
+      shiftReg(*elements[i].spi, r0);
+      shifted[nShifted++] = elements[i].spi;
+    }
+    leMask |= 1u << elements[i].pinLE;
+  }
+  gpio_set_mask(leMask);
+  delayMicroseconds(2);
+  gpio_clr_mask(leMask);
+
+  for (uint8_t i = 0; i < ELEMENT_COUNT; i++) appliedWord[i] = stagedWord[i];
+}
+
+// Q32 turns -> millidegrees, for printing only
+static inline int32_t turnsToMdeg(uint32_t t) {
+  return (int32_t)(((int64_t)(int32_t)t * 360000) >> 32);
+}
+
+// ============================================================================
+// Benchmark
+// ============================================================================
+static void benchSteering() {
+  static uint32_t phases[MAX_ELEMENTS];
+  static uint32_t cal[MAX_ELEMENTS];
+  const int RUNS = 1000;
+
+  uint32_t ratio = spacingRatioQ20(ELEMENT_SPACING_UM, RF_OUT_KHZ);
+
+  uint32_t t0 = micros();
+  for (int r = 0; r < RUNS; r++) {
+    computeSteering(STEER_START_CDEG + r, ratio, cal, phases, MAX_ELEMENTS);
+    stagePhases(phases, MAX_ELEMENTS);
+  }
+  uint32_t dt = micros() - t0;
+
+  Serial.printf("Steering vector (%u elements, compute+stage): %lu.%02lu us avg\n",
+                MAX_ELEMENTS,
+                (unsigned long)(dt / RUNS),
+                (unsigned long)((dt % RUNS) * 100 / RUNS));
+
+  // stagePhases() touched entries beyond the wired boards; nothing is applied
+  memset(stagedWord, 0, sizeof(stagedWord));
+}
+
+// ============================================================================
+// Arduino setup/loop
+// ============================================================================
+static uint32_t spacingRatio = 0;
+static int32_t  steerCdeg = STEER_START_CDEG;
+
+void setup() {
+  Serial.begin(115200);
+  delay(1000);
+
+  Serial.println("ADF5355 array beam steering (fixed-point phase words)");
+
+  pinMode(A_LE, OUTPUT); pinMode(A_CE, OUTPUT);
+  pinMode(B_LE, OUTPUT); pinMode(B_CE, OUTPUT);
+  digitalWrite(A_LE, LOW); digitalWrite(A_CE, LOW);
+  digitalWrite(B_LE, LOW); digitalWrite(B_CE, LOW);
+
+  spiA.begin();
+  spiB.begin();
+
+  for (uint8_t i = 0; i < ELEMENT_COUNT; i++) {
+    programPLL(*elements[i].spi, elements[i].pinLE);
+  }
+  digitalWrite(A_CE, HIGH);
+  digitalWrite(B_CE, HIGH);
+
+  spacingRatio = spacingRatioQ20(ELEMENT_SPACING_UM, RF_OUT_KHZ);
+  Serial.printf("d/lambda = %lu/1048576\n", (unsigned long)spacingRatio);
+
+  benchSteering();
+}
+
+void loop() {
+  uint32_t cal[ELEMENT_COUNT];
+  uint32_t phases[ELEMENT_COUNT];
+  for (uint8_t i = 0; i < ELEMENT_COUNT; i++) cal[i] = elements[i].cal_turns;
+
+  uint32_t t0 = micros();
+  computeSteering(steerCdeg, spacingRatio, cal, phases, ELEMENT_COUNT);
+  stagePhases(phases, ELEMENT_COUNT);
+  uint32_t t1 = micros();
+  applyStagedPhases();
+  uint32_t t2 = micros();
+
+  Serial.printf("Steer %ld.%02ld deg: compute %lu us, update %lu us\n",
+                (long)(steerCdeg / 100), (long)abs(steerCdeg % 100),
+                (unsigned long)(t1 - t0), (unsigned long)(t2 - t1));
+  for (uint8_t i = 0; i < ELEMENT_COUNT; i++) {
+    Serial.printf("  el%u: %ld mdeg (word 0x%06lX)\n", i,
+                  (long)turnsToMdeg(phases[i]), (unsigned long)appliedWord[i]);
+  }
+
+  steerCdeg += STEER_STEP_CDEG;
+  if (steerCdeg > STEER_STOP_CDEG) steerCdeg = STEER_START_CDEG;
+
+  delay(STEER_DWELL_MS);
+}
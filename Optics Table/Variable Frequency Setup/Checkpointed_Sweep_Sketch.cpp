@@ -0,0 +1,322 @@
+#include <Arduino.h>
+#include <SPI.h>
+#include "hardware/timer.h"
+#include "adf5355_plan.h"
+#include "sweep_engine.h"
+#include "flash_log.h"
+#include "stream_codec.h"
+
+// ============================================================================
+// USER SETTINGS
+// ============================================================================
+
+static constexpr uint32_t PFD_HZ          = 10000000;   // must match R4 in the image
+static constexpr uint32_t CHANNEL_STEP_HZ = 10000;
+static constexpr bool     USE_RFOUTB      = true;
+
+// The long run. Edit freely -- the table id is derived from these, so a
+// changed table never resumes from an old checkpoint.
+static constexpr uint64_t SWEEP_START_HZ = 10000000000ull;
+static constexpr uint64_t SWEEP_STEP_HZ  =       10000ull;
+static constexpr uint32_t SWEEP_POINTS   =       60000;   // results area holds 63488
+static constexpr uint32_t DWELL_US       =        2000;   // lock + detector settle
+
+// Receiver detector output into the ADC, averaged per point
+static const int     RX_ADC_PIN = 26;   // A0
+static constexpr int ADC_AVG    = 8;
+
+// Live results stream ('z' toggles): every point goes out as it's measured,
+// compressed (stream_codec.h, ~4 bytes/point instead of a ~30 byte CSV
+// line). Decode with Host Tools/stream_decode. Partial blocks are flushed
+// after this long so a slow sweep still shows up promptly.
+static constexpr bool     STREAM_AT_BOOT  = false;
+static constexpr uint32_t STREAM_FLUSH_MS = 100;
+
+// ============================================================================
+// PIN DEFINITIONS (board A of the dual-board sketch)
+// ============================================================================
+static const int A_SCLK = 18;
+static const int A_MOSI = 19;
+static const int A_LE   = 20;
+static const int A_CE   = 17;
+
+static const int A_MISO_UNUSED = 16;
+static const int A_CS_UNUSED   = 21;
+
+SPIClassRP2040 spiA(spi0, A_MISO_UNUSED, A_CS_UNUSED, A_SCLK, A_MOSI);
+SPISettings pllSPI(1000000, MSBFIRST, SPI_MODE0);
+
+static constexpr PlanConfig planCfg = { PFD_HZ, CHANNEL_STEP_HZ, USE_RFOUTB };
+
+static_assert((SWEEP_POINTS + RESULTS_PER_PAGE - 1) / RESULTS_PER_PAGE * FLASH_PAGE_SIZE <=
+                  FLASH_RESULTS_SIZE,
+              "sweep doesn't fit in the results area");
+
+// ============================================================================
+// SPI
+// ============================================================================
+static inline void pulseLE(int pinLE) {
+  digitalWrite(pinLE, HIGH);
+  delayMicroseconds(2);
+  digitalWrite(pinLE, LOW);
+  delayMicroseconds(2);
+}
+
+static void writeReg(SPIClassRP2040 &spi, int pinLE, uint32_t reg) {
+  spi.beginTransaction(pllSPI);
+  spi.transfer((reg >> 24) & 0xFF);
+  spi.transfer((reg >> 16) & 0xFF);
+  spi.transfer((reg >>  8) & 0xFF);
+  spi.transfer((reg >>  0) & 0xFF);
+  spi.endTransaction();
+  pulseLE(pinLE);
+}
+
+static const uint32_t baseRegs[13] = {
+  0x0001040C, // R12
+  0x0061300B, // R11
+  0x00C0000A, // R10
+  0x00000009, // R9
+  0x102D0428, // R8
+  0x12000007, // R7
+  0x35000006, // R6
+  0x00800005, // R5
+  0x00000004, // R4
+  0x00000003, // R3
+  0x00001002, // R2
+  0x00000A41, // R1
+  0x00550000  // R0 LAST
+};
+
+static constexpr int IDX_R6 = 12 - 6;
+static constexpr int IDX_R1 = 12 - 1;
+static constexpr int IDX_R0 = 12 - 0;
+
+// ============================================================================
+// Sweep engine hooks
+// ============================================================================
+static uint8_t  lastDiv = 0;
+static uint32_t resultsOff = 0;
+
+static void sweepTune(const PllPlan &p) {
+  if (p.out_div != lastDiv) {
+    writeReg(spiA, A_LE, packR6Div(baseRegs[IDX_R6], p));
+    lastDiv = p.out_div;
+  }
+  writeReg(spiA, A_LE, packR2(p));
+  writeReg(spiA, A_LE, packR1(baseRegs[IDX_R1], p));
+  writeReg(spiA, A_LE, packR0(baseRegs[IDX_R0], p) | ADF_R0_AUTOCAL);
+}
+
+static void sweepSettle(uint32_t us) {
+  if (us >= 1000) delay(us / 1000);
+  delayMicroseconds(us % 1000);
+}
+
+static uint32_t lastSample = 0;
+static uint64_t lastSampleUs = 0;
+
+static uint32_t sweepMeasure() {
+  uint32_t acc = 0;
+  for (int i = 0; i < ADC_AVG; i++) acc += analogRead(RX_ADC_PIN);
+  lastSample = acc;
+  lastSampleUs = time_us_64();
+  return acc;   // sum, not mean -- keeps the extra bits
+}
+
+static uint32_t sweepMicros() {
+  return micros();
+}
+
+static bool sweepStorePage(const ResultPage &page) {
+  return flashResultsAppend(&resultsOff, page);
+}
+
+static void sweepCheckpoint(uint16_t table_id, uint32_t next_index) {
+  flashLogCommit(table_id, next_index, resultsOff);
+}
+
+// ============================================================================
+// Boot paths
+// ============================================================================
+//
+// Cold: wait for the serial monitor, program every register with the usual
+// 2 ms gaps, wipe the log and start at point 0.
+// Warm (valid checkpoint for this table): no waiting, registers back to
+// back, resume at the checkpointed index straight away.
+
+static SweepTable table = {
+  0, SWEEP_START_HZ, SWEEP_STEP_HZ, SWEEP_POINTS, DWELL_US
+};
+static SweepEngine engine;
+
+// Field by field: SweepTable has padding, and padding bytes aren't defined
+static uint16_t tableId() {
+  uint8_t buf[24];
+  memcpy(buf +  0, &table.start_hz, 8);
+  memcpy(buf +  8, &table.step_hz, 8);
+  memcpy(buf + 16, &table.count, 4);
+  memcpy(buf + 20, &table.dwell_us, 4);
+  uint16_t id = crc16(buf, sizeof(buf));
+  return id ? id : 1;
+}
+
+static void programPLL(bool verbose) {
+  for (int i = 0; i < 13; i++) {
+    if (verbose) Serial.printf("Writing R%d = 0x%08lX\n", 12 - i, (unsigned long)baseRegs[i]);
+    writeReg(spiA, A_LE, baseRegs[i]);
+    if (verbose) delay(2);
+  }
+  lastDiv = 0;
+}
+
+static void coldBoot() {
+  delay(1000);
+  Serial.println("Checkpointed sweep: cold boot");
+  programPLL(true);
+  flashLogReset();
+  resultsOff = 0;
+  sweepBegin(engine, planCfg, table, 0);
+}
+
+static void warmBoot(const Checkpoint &cp) {
+  programPLL(false);
+  resultsOff = cp.results_off;
+  sweepBegin(engine, planCfg, table, cp.index);
+}
+
+// ============================================================================
+// Reporting
+// ============================================================================
+static void printStats() {
+  const SweepStats &s = engine.stats;
+  uint32_t pct100 = s.run_us ? (uint32_t)(s.store_us * 10000 / s.run_us) : 0;
+  Serial.printf("Point %lu/%lu | %lu pages, %lu checkpoints, %lu erases | "
+                "checkpoint overhead %lu.%02lu%% (max %lu us) | %lu plan failures\n",
+                (unsigned long)engine.index, (unsigned long)table.count,
+                (unsigned long)s.pages, (unsigned long)s.checkpoints,
+                (unsigned long)flashLogStats.erases,
+                (unsigned long)(pct100 / 100), (unsigned long)(pct100 % 100),
+                (unsigned long)flashLogStats.max_commit_us,
+                (unsigned long)s.plan_fail);
+}
+
+// CSV dump of the results area: index,freq_hz,adc_sum. Pages written again
+// after a reset are printed once, newest copy (resultPagesCurrent).
+static void dumpResults() {
+  static uint8_t keep[FLASH_RESULTS_SIZE / FLASH_PAGE_SIZE / 8];
+  const ResultPage *pages = (const ResultPage *)flashResultsPtr(0);
+  uint32_t n = resultsOff / FLASH_PAGE_SIZE;
+  resultPagesCurrent(pages, n, keep);
+  Serial.println("index,freq_hz,adc_sum");
+  for (uint32_t p = 0; p < n; p++) {
+    if (!resultPageKept(keep, p)) continue;
+    const ResultPage &pg = pages[p];
+    for (uint32_t i = 0; i < pg.count; i++) {
+      uint32_t idx = pg.first_index + i;
+      Serial.printf("%lu,%llu,%lu\n", (unsigned long)idx,
+                    (unsigned long long)sweepTableFreq(table, idx),
+                    (unsigned long)pg.samples[i]);
+    }
+  }
+}
+
+// ============================================================================
+// Live compressed stream
+// ============================================================================
+//
+// Record = (table index, time of the measurement, ADC sum). Unplannable
+// points go out with amplitude -1, same as the 0xFFFFFFFF in the pages.
+
+static StreamEncoder streamEnc;
+static bool     streaming = STREAM_AT_BOOT;
+static uint32_t streamLastFlushMs = 0;
+
+static void streamFlush() {
+  uint32_t n = streamEncFinish(streamEnc);
+  if (n) Serial.write(streamEnc.block, n);
+  streamLastFlushMs = millis();
+}
+
+static void streamPoint(uint32_t index, uint64_t t_us, uint32_t sample) {
+  int32_t amp = (int32_t)sample;
+  if (!streamEncAdd(streamEnc, index, t_us, &amp)) {
+    streamFlush();
+    streamEncAdd(streamEnc, index, t_us, &amp);
+  }
+}
+
+static void printStreamStats() {
+  if (!streamEnc.records) return;
+  uint64_t raw = streamRawBytes(streamEnc);
+  uint32_t x100 = streamEnc.bytes_out ? (uint32_t)(raw * 100 / streamEnc.bytes_out) : 0;
+  Serial.printf("Stream: %lu points in %lu blocks, %llu bytes (raw %llu, %lu.%02lux)\n",
+                (unsigned long)streamEnc.records, (unsigned long)streamEnc.blocks,
+                (unsigned long long)streamEnc.bytes_out, (unsigned long long)raw,
+                (unsigned long)(x100 / 100), (unsigned long)(x100 % 100));
+}
+
+// ============================================================================
+// Arduino setup/loop
+// ============================================================================
+static bool reportedDone = false;
+
+void setup() {
+  uint32_t t0 = micros();
+  Serial.begin(115200);
+
+  pinMode(A_LE, OUTPUT); pinMode(A_CE, OUTPUT);
+  digitalWrite(A_LE, LOW); digitalWrite(A_CE, LOW);
+  spiA.begin();
+
+  table.id = tableId();
+  streamEncInit(streamEnc, 1, 0);
+
+  Checkpoint cp;
+  bool resume = flashLogLoad(&cp) && cp.table_id == table.id && cp.index < table.count;
+  if (resume) warmBoot(cp);
+  else        coldBoot();
+
+  digitalWrite(A_CE, HIGH);
+
+  Serial.printf("%s boot in %lu us, table 0x%04X, starting at point %lu\n",
+                resume ? "Warm" : "Cold", (unsigned long)(micros() - t0),
+                table.id, (unsigned long)engine.index);
+}
+
+void loop() {
+  if (Serial.available()) {
+    char c = Serial.read();
+    if (c == 'd') dumpResults();
+    if (c == 's') { printStats(); printStreamStats(); }
+    if (c == 'z') {               // live compressed stream on/off
+      streamFlush();
+      streaming = !streaming;
+    }
+    if (c == 'r') {               // throw away progress, start over
+      coldBoot();
+      reportedDone = false;
+    }
+  }
+
+  uint32_t idx = engine.index;
+  lastSample = 0xFFFFFFFFu;            // stays if the point can't be planned
+  lastSampleUs = time_us_64();
+  bool more = sweepStep(engine);
+  if (streaming && engine.index != idx) streamPoint(idx, lastSampleUs, lastSample);
+  if (streaming && !streamEncEmpty(streamEnc) &&
+      (!more || millis() - streamLastFlushMs >= STREAM_FLUSH_MS)) {
+    streamFlush();
+  }
+
+  if (more) {
+    if (engine.index % 10000 == 0) printStats();
+    return;
+  }
+
+  if (!reportedDone) {
+    Serial.println(engine.storageFull ? "Results area full, sweep stopped." : "Sweep complete.");
+    printStats();
+    reportedDone = true;
+  }
+}
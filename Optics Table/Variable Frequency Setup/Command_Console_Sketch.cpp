@@ -0,0 +1,227 @@
+#include <Arduino.h>
+#include <SPI.h>
+#include "adf5355_plan.h"
+#include "write_combine.h"
+
+// ============================================================================
+// USER SETTINGS
+// ============================================================================
+
+static constexpr uint32_t PFD_HZ          = 10000000;   // must match R4 in the image
+static constexpr uint32_t CHANNEL_STEP_HZ = 10000;
+static constexpr bool     USE_RFOUTB      = true;
+
+static constexpr uint64_t START_HZ    = 10525000000ull;
+static constexpr uint8_t  START_POWER = 3;              // RFOUTA, +5 dBm
+static constexpr bool     START_OUT_A = false;
+static constexpr bool     START_OUT_B = true;
+
+// Changes arriving within this long of the first one go out as one burst.
+// A command line from a script arrives in well under a millisecond at
+// 115200 baud; a few ms also catches separate lines sent back to back.
+// 'w' changes it at run time, 0 = write through.
+static constexpr uint32_t COMBINE_WINDOW_US = 2000;
+
+// ============================================================================
+// PIN DEFINITIONS (board A of the dual-board sketch)
+// ============================================================================
+static const int A_SCLK = 18;
+static const int A_MOSI = 19;
+static const int A_LE   = 20;
+static const int A_CE   = 17;
+
+static const int A_MISO_UNUSED = 16;
+static const int A_CS_UNUSED   = 21;
+
+SPIClassRP2040 spiA(spi0, A_MISO_UNUSED, A_CS_UNUSED, A_SCLK, A_MOSI);
+SPISettings pllSPI(1000000, MSBFIRST, SPI_MODE0);
+
+static constexpr PlanConfig planCfg = { PFD_HZ, CHANNEL_STEP_HZ, USE_RFOUTB };
+
+// ============================================================================
+// SPI
+// ============================================================================
+static inline void pulseLE(int pinLE) {
+  digitalWrite(pinLE, HIGH);
+  delayMicroseconds(2);
+  digitalWrite(pinLE, LOW);
+  delayMicroseconds(2);
+}
+
+static void writeReg(SPIClassRP2040 &spi, int pinLE, uint32_t reg) {
+  spi.beginTransaction(pllSPI);
+  spi.transfer((reg >> 24) & 0xFF);
+  spi.transfer((reg >> 16) & 0xFF);
+  spi.transfer((reg >>  8) & 0xFF);
+  spi.transfer((reg >>  0) & 0xFF);
+  spi.endTransaction();
+  pulseLE(pinLE);
+}
+
+static const uint32_t baseRegs[13] = {
+  0x0001040C, // R12
+  0x0061300B, // R11
+  0x00C0000A, // R10
+  0x00000009, // R9
+  0x102D0428, // R8
+  0x12000007, // R7
+  0x35000006, // R6
+  0x00800005, // R5
+  0x00000004, // R4
+  0x00000003, // R3
+  0x00001002, // R2
+  0x00000A41, // R1
+  0x00550000  // R0 LAST
+};
+
+static constexpr int IDX_R6 = 12 - 6;
+static constexpr int IDX_R1 = 12 - 1;
+static constexpr int IDX_R0 = 12 - 0;
+
+static void programPLL() {
+  for (int i = 0; i < 13; i++) {
+    Serial.printf("Writing R%d = 0x%08lX\n", 12 - i, (unsigned long)baseRegs[i]);
+    writeReg(spiA, A_LE, baseRegs[i]);
+    delay(2);
+  }
+}
+
+// ============================================================================
+// Combiner hooks
+// ============================================================================
+static bool verbose = false;
+
+static void combWrite(uint32_t word) {
+  writeReg(spiA, A_LE, word);
+  if (verbose) Serial.printf("  R%lu = 0x%08lX\n", (unsigned long)(word & 0xF), (unsigned long)word);
+}
+
+static uint32_t combMicros() {
+  return micros();
+}
+
+static Combiner comb;
+
+// ============================================================================
+// Commands
+// ============================================================================
+//
+// One or more per line, separated by ';' (or one per line):
+//
+//   f <Hz>       frequency (1e10, 10525000000 and 10.525e9 all work)
+//   p <0..3>     RFOUTA power
+//   o <a|b|ab|->  outputs on
+//   w <us>       combining window, 0 = write through
+//   !            write what's pending now
+//   s            stats        v  echo register writes        ?  help
+
+static void printHelp() {
+  Serial.println("f <Hz> | p <0..3> | o <a|b|ab|-> | w <us> | ! flush | s stats | v verbose | ? help");
+  Serial.println("Several per line with ';'. Changes within the window go out as one burst.");
+}
+
+static void printStats() {
+  const CombineStats &s = comb.stats;
+  uint32_t saved = s.words_naive > s.words ? s.words_naive - s.words : 0;
+  uint32_t recalSaved = s.recals_naive > s.recals ? s.recals_naive - s.recals : 0;
+  Serial.printf("Commands %lu (%lu rejected) in %lu bursts, up to %lu per burst | window %lu us\n",
+                (unsigned long)s.commands, (unsigned long)s.rejected, (unsigned long)s.bursts,
+                (unsigned long)s.max_batch, (unsigned long)comb.window_us);
+  Serial.printf("Words %lu of %lu one by one (%lu saved) | recals %lu of %lu (%lu saved)\n",
+                (unsigned long)s.words, (unsigned long)s.words_naive, (unsigned long)saved,
+                (unsigned long)s.recals, (unsigned long)s.recals_naive, (unsigned long)recalSaved);
+  Serial.printf("Live: %llu Hz, power %u, RFOUTA %s, RFOUTB %s%s\n",
+                (unsigned long long)comb.live.freq_hz, comb.live.power,
+                comb.live.out_a ? "on" : "off", comb.live.out_b ? "on" : "off",
+                comb.dirty ? " (changes pending)" : "");
+}
+
+static void runCommand(char *cmd) {
+  while (*cmd == ' ' || *cmd == '\t') cmd++;
+  if (!*cmd) return;
+  char op = *cmd++;
+  while (*cmd == ' ' || *cmd == '\t') cmd++;
+
+  switch (op) {
+    case 'f': {
+      char *end;
+      double hz = strtod(cmd, &end);
+      if (end == cmd || hz <= 0 || !combSetFreq(comb, (uint64_t)(hz + 0.5))) {
+        Serial.printf("f: %s not plannable\n", cmd);
+      }
+      break;
+    }
+    case 'p': {
+      char *end;
+      long p = strtol(cmd, &end, 10);
+      if (end == cmd || p < 0 || p > 3 || !combSetPower(comb, (uint8_t)p)) Serial.println("p: 0..3");
+      break;
+    }
+    case 'o': {
+      bool a = strchr(cmd, 'a') != nullptr;
+      bool b = strchr(cmd, 'b') != nullptr;
+      if (!a && !b && *cmd != '-') { Serial.println("o: a, b, ab or -"); break; }
+      combSetOutputs(comb, a, b);
+      break;
+    }
+    case 'w':
+      combFlush(comb);
+      comb.window_us = (uint32_t)strtoul(cmd, nullptr, 10);
+      Serial.printf("Window %lu us\n", (unsigned long)comb.window_us);
+      break;
+    case '!': combFlush(comb); break;
+    case 's': printStats(); break;
+    case 'v':
+      verbose = !verbose;
+      Serial.printf("Verbose %s\n", verbose ? "on" : "off");
+      break;
+    case '?': printHelp(); break;
+    default:
+      Serial.printf("Unknown command '%c' (? for help)\n", op);
+      break;
+  }
+}
+
+static char    line[128];
+static uint8_t lineLen = 0;
+
+static void runLine() {
+  line[lineLen] = 0;
+  char *save = nullptr;
+  for (char *cmd = strtok_r(line, ";", &save); cmd; cmd = strtok_r(nullptr, ";", &save)) {
+    runCommand(cmd);
+  }
+  lineLen = 0;
+}
+
+// ============================================================================
+// Arduino setup/loop
+// ============================================================================
+void setup() {
+  Serial.begin(115200);
+  delay(1000);
+  Serial.println("Command console (write-combining)");
+
+  pinMode(A_LE, OUTPUT); pinMode(A_CE, OUTPUT);
+  digitalWrite(A_LE, LOW); digitalWrite(A_CE, LOW);
+  spiA.begin();
+  programPLL();
+
+  const RfState initial = { START_HZ, START_POWER, START_OUT_A, START_OUT_B };
+  if (!combBegin(comb, planCfg, baseRegs[IDX_R6], baseRegs[IDX_R1], baseRegs[IDX_R0],
+                 COMBINE_WINDOW_US, initial)) {
+    Serial.println("Start frequency not plannable");
+  }
+  digitalWrite(A_CE, HIGH);
+  printHelp();
+}
+
+void loop() {
+  while (Serial.available()) {
+    char c = Serial.read();
+    if (c == '\r') continue;
+    if (c == '\n') { runLine(); continue; }
+    if (lineLen < sizeof(line) - 1) line[lineLen++] = c;
+  }
+  combPoll(comb);
+}
@@ -0,0 +1,290 @@
+#include <Arduino.h>
+#include <SPI.h>
+#include "hardware/gpio.h"
+#include "hardware/spi.h"
+#include "adf5355_plan.h"
+
+// ============================================================================
+// USER SETTINGS
+// ============================================================================
+
+// PFD must match what R4 in the register image below actually sets up
+static constexpr uint32_t PFD_HZ          = 10000000;   // 10 MHz ref, R = 1
+static constexpr uint32_t CHANNEL_STEP_HZ = 10000;      // MOD2 has to fit 14 bits
+static constexpr bool     USE_RFOUTB      = true;
+
+// Board A sweeps, board B follows at A + OFFSET_HZ (heterodyne pair)
+static constexpr uint64_t SWEEP_START_HZ = 10400000000ull;
+static constexpr uint64_t SWEEP_STOP_HZ  = 10650000000ull;
+static constexpr uint64_t SWEEP_STEP_HZ  =     1000000ull;
+static constexpr int64_t  OFFSET_HZ      =    10000000ll;   // B - A
+
+static constexpr uint32_t DWELL_US = 500;   // per point, after the burst
+
+// ============================================================================
+// PIN DEFINITIONS (same wiring as the dual-board sketch)
+// ============================================================================
+static const int A_SCLK = 18;
+static const int A_MOSI = 19;
+static const int A_LE   = 20;
+static const int A_CE   = 17;
+
+static const int B_SCLK = 10;
+static const int B_MOSI = 11;
+static const int B_LE   = 12;
+static const int B_CE   = 13;
+
+static const int A_MISO_UNUSED = 16;
+static const int A_CS_UNUSED   = 21;
+static const int B_MISO_UNUSED = 14;
+static const int B_CS_UNUSED   = 15;
+
+SPIClassRP2040 spiA(spi0, A_MISO_UNUSED, A_CS_UNUSED, A_SCLK, A_MOSI);
+SPIClassRP2040 spiB(spi1, B_MISO_UNUSED, B_CS_UNUSED, B_SCLK, B_MOSI);
+
+SPISettings pllSPI(1000000, MSBFIRST, SPI_MODE0);
+
+static constexpr PlanConfig planCfg = { PFD_HZ, CHANNEL_STEP_HZ, USE_RFOUTB };
+
+// ============================================================================
+// SPI
+// ============================================================================
+static inline void pulseLE(int pinLE) {
+  digitalWrite(pinLE, HIGH);
+  delayMicroseconds(2);
+  digitalWrite(pinLE, LOW);
+  delayMicroseconds(2);
+}
+
+static void writeReg(SPIClassRP2040 &spi, int pinLE, uint32_t reg) {
+  spi.beginTransaction(pllSPI);
+  spi.transfer((reg >> 24) & 0xFF);
+  spi.transfer((reg >> 16) & 0xFF);
+  spi.transfer((reg >>  8) & 0xFF);
+  spi.transfer((reg >>  0) & 0xFF);
+  spi.endTransaction();
+  pulseLE(pinLE);
+}
+
+// Shift one word into each board at the same time (both SPI blocks run in
+// parallel off their FIFOs), then latch both with a single LE edge.
+// Pass nullptr for a side that has nothing to send.
+static void shiftPair(spi_inst_t *sa, uint32_t wa, spi_inst_t *sb, uint32_t wb) {
+  spi_hw_t *ha = sa ? spi_get_hw(sa) : nullptr;
+  spi_hw_t *hb = sb ? spi_get_hw(sb) : nullptr;
+
+  for (int s = 24; s >= 0; s -= 8) {
+    if (ha) ha->dr = (wa >> s) & 0xFF;
+    if (hb) hb->dr = (wb >> s) & 0xFF;
+  }
+  while ((ha && (ha->sr & SPI_SSPSR_BSY_BITS)) || (hb && (hb->sr & SPI_SSPSR_BSY_BITS))) {}
+
+  // Keep RX empty so later SPI.transfer() calls don't read stale bytes
+  while (ha && (ha->sr & SPI_SSPSR_RNE_BITS)) (void)ha->dr;
+  while (hb && (hb->sr & SPI_SSPSR_RNE_BITS)) (void)hb->dr;
+
+  uint32_t mask = (ha ? (1u << A_LE) : 0) | (hb ? (1u << B_LE) : 0);
+  gpio_set_mask(mask);
+  delayMicroseconds(1);
+  gpio_clr_mask(mask);
+}
+
+// ============================================================================
+// Register images
+// ============================================================================
+static const uint32_t baseRegs[13] = {
+  0x0001040C, // R12
+  0x0061300B, // R11
+  0x00C0000A, // R10
+  0x00000009, // R9
+  0x102D0428, // R8
+  0x12000007, // R7
+  0x35000006, // R6
+  0x00800005, // R5
+  0x00000004, // R4
+  0x00000003, // R3
+  0x00001002, // R2
+  0x00000A41, // R1
+  0x00550000  // R0 LAST
+};
+
+static constexpr int IDX_R6 = 12 - 6;
+static constexpr int IDX_R2 = 12 - 2;
+static constexpr int IDX_R1 = 12 - 1;
+static constexpr int IDX_R0 = 12 - 0;
+
+static void programPLL(SPIClassRP2040 &spi, int pinLE) {
+  for (int i = 0; i < 13; i++) {
+    writeReg(spi, pinLE, baseRegs[i]);
+    delay(2);
+  }
+}
+
+// Frequency-dependent words for one board, in write order
+struct HopWords {
+  uint32_t r6;
+  uint32_t r2;
+  uint32_t r1;
+  uint32_t r0;
+};
+
+static HopWords packHop(const PllPlan &p) {
+  HopWords w;
+  w.r6 = packR6Div(baseRegs[IDX_R6], p);
+  w.r2 = packR2(p);
+  w.r1 = packR1(baseRegs[IDX_R1], p);
+  w.r0 = packR0(baseRegs[IDX_R0], p) | ADF_R0_AUTOCAL;
+  return w;
+}
+
+// ============================================================================
+// Planning: A full, B derived
+// ============================================================================
+struct PairStats {
+  uint32_t points;
+  uint32_t derived;
+  uint32_t fallbacks;
+  uint32_t failed;
+  uint32_t plan_us;
+  uint32_t burst_us;
+};
+
+static PairStats stats;
+static PlanOffset offsetStep;   // rebuilt whenever A changes divider band
+static uint8_t lastDivA = 0, lastDivB = 0;
+
+static bool planPair(uint64_t rf_a, PllPlan &a, PllPlan &b) {
+  a = planFrequencyInt(planCfg, rf_a);
+  if (!a.ok) return false;
+
+  if (offsetStep.out_div != a.out_div || !offsetStep.ok) {
+    offsetStep = makePlanOffset(planCfg, OFFSET_HZ, a.out_div);
+  }
+
+  if (derivePlan(a, offsetStep, b)) {
+    stats.derived++;
+    return true;
+  }
+
+  // Divider-band crossing (or off-grid offset): plan B from scratch
+  stats.fallbacks++;
+  b = planFrequencyInt(planCfg, rf_a + OFFSET_HZ);
+  return b.ok;
+}
+
+// One synchronized burst for both boards. R6 only goes out when a divider
+// band changed; R0 goes last on both so the autocal starts together.
+static void burstPair(const PllPlan &a, const PllPlan &b) {
+  HopWords wa = packHop(a);
+  HopWords wb = packHop(b);
+
+  spiA.beginTransaction(pllSPI);
+  spiB.beginTransaction(pllSPI);
+
+  bool r6a = (a.out_div != lastDivA);
+  bool r6b = (b.out_div != lastDivB);
+  if (r6a || r6b) {
+    shiftPair(r6a ? spi0 : nullptr, wa.r6, r6b ? spi1 : nullptr, wb.r6);
+    lastDivA = a.out_div;
+    lastDivB = b.out_div;
+  }
+  shiftPair(spi0, wa.r2, spi1, wb.r2);
+  shiftPair(spi0, wa.r1, spi1, wb.r1);
+  shiftPair(spi0, wa.r0, spi1, wb.r0);
+
+  spiB.endTransaction();
+  spiA.endTransaction();
+}
+
+// Same burst, board A only -- used to show the pair costs the same
+static void burstSingle(const PllPlan &a) {
+  HopWords wa = packHop(a);
+  spiA.beginTransaction(pllSPI);
+  shiftPair(spi0, wa.r2, nullptr, 0);
+  shiftPair(spi0, wa.r1, nullptr, 0);
+  shiftPair(spi0, wa.r0, nullptr, 0);
+  spiA.endTransaction();
+}
+
+static void compareBurstCost() {
+  const int RUNS = 200;
+  PllPlan a, b;
+  planPair(SWEEP_START_HZ, a, b);
+
+  uint32_t t0 = micros();
+  for (int i = 0; i < RUNS; i++) burstSingle(a);
+  uint32_t t1 = micros();
+  for (int i = 0; i < RUNS; i++) burstPair(a, b);
+  uint32_t t2 = micros();
+
+  Serial.printf("Burst cost: single %lu us, pair %lu us\n",
+                (unsigned long)((t1 - t0) / RUNS), (unsigned long)((t2 - t1) / RUNS));
+}
+
+// ============================================================================
+// Arduino setup/loop
+// ============================================================================
+static uint64_t rfA = SWEEP_START_HZ;
+
+void setup() {
+  Serial.begin(115200);
+  delay(1000);
+
+  Serial.println("Dual ADF5355 offset sweep: B derived from A");
+
+  pinMode(A_LE, OUTPUT); pinMode(A_CE, OUTPUT);
+  pinMode(B_LE, OUTPUT); pinMode(B_CE, OUTPUT);
+  digitalWrite(A_LE, LOW); digitalWrite(A_CE, LOW);
+  digitalWrite(B_LE, LOW); digitalWrite(B_CE, LOW);
+
+  spiA.begin();
+  spiB.begin();
+
+  programPLL(spiA, A_LE);
+  programPLL(spiB, B_LE);
+
+  digitalWrite(A_CE, HIGH);
+  digitalWrite(B_CE, HIGH);
+
+  if (planMod2(planCfg, 1) == 0) {
+    Serial.println("ERROR: CHANNEL_STEP_HZ too fine for this PFD (MOD2 > 16383).");
+  }
+
+  Serial.printf("Offset: %ld Hz\n", (long)OFFSET_HZ);
+  compareBurstCost();
+  memset(&stats, 0, sizeof(stats));
+}
+
+void loop() {
+  PllPlan a, b;
+
+  uint32_t t0 = micros();
+  bool ok = planPair(rfA, a, b);
+  uint32_t t1 = micros();
+
+  if (ok) {
+    burstPair(a, b);
+    stats.burst_us += micros() - t1;
+  } else {
+    stats.failed++;
+  }
+  stats.plan_us += t1 - t0;
+  stats.points++;
+
+  delayMicroseconds(DWELL_US);
+
+  rfA += SWEEP_STEP_HZ;
+  if (rfA > SWEEP_STOP_HZ) {
+    Serial.printf("Sweep: %lu pts, %lu derived, %lu full re-plans, %lu failed | "
+                  "plan %lu us/pt, burst %lu us/pt\n",
+                  (unsigned long)stats.points, (unsigned long)stats.derived,
+                  (unsigned long)stats.fallbacks, (unsigned long)stats.failed,
+                  (unsigned long)(stats.plan_us / stats.points),
+                  (unsigned long)(stats.burst_us / stats.points));
+    Serial.printf("Last: A INT=%u FRAC1=%lu FRAC2=%u | B INT=%u FRAC1=%lu FRAC2=%u (MOD2=%u)\n",
+                  a.INT, (unsigned long)a.FRAC1, a.FRAC2,
+                  b.INT, (unsigned long)b.FRAC1, b.FRAC2, b.MOD2);
+    memset(&stats, 0, sizeof(stats));
+    rfA = SWEEP_START_HZ;
+  }
+}
@@ -0,0 +1,211 @@
+#include <Arduino.h>
+#include <SPI.h>
+#include "hardware/pwm.h"
+#include "hardware/clocks.h"
+#include "hardware/gpio.h"
+#include "acquisition.h"
+#include "lockin.h"
+
+// ============================================================================
+// USER SETTINGS
+// ============================================================================
+
+// Each board's CE is chopped at its own frequency by a PWM slice, instead of
+// the shared 3 s ON / 3 s OFF pattern. Keep them on integer bins of the
+// demodulator (multiples of RX_RATE_HZ / DEMOD_BLOCK) and away from each
+// other's odd harmonics (square-wave keying).
+static const uint32_t CHOP_HZ[] = { 170, 230 };
+
+// Receiver on ADC0 (GPIO26)
+static constexpr uint8_t  RX_INPUT   = 0;
+static constexpr uint32_t RX_RATE_HZ = 10000;
+
+// One result per channel every DEMOD_BLOCK samples (10 Hz bins, 10 updates/s)
+static constexpr uint16_t DEMOD_BLOCK = 1000;
+
+// ============================================================================
+// PIN DEFINITIONS (same wiring as the dual-board sketch)
+// ============================================================================
+static const int A_SCLK = 18;
+static const int A_MOSI = 19;
+static const int A_LE   = 20;
+static const int A_CE   = 17;
+
+static const int B_SCLK = 10;
+static const int B_MOSI = 11;
+static const int B_LE   = 12;
+static const int B_CE   = 13;
+
+static const int A_MISO_UNUSED = 16;
+static const int A_CS_UNUSED   = 21;
+static const int B_MISO_UNUSED = 14;
+static const int B_CS_UNUSED   = 15;
+
+SPIClassRP2040 spiA(spi0, A_MISO_UNUSED, A_CS_UNUSED, A_SCLK, A_MOSI);
+SPIClassRP2040 spiB(spi1, B_MISO_UNUSED, B_CS_UNUSED, B_SCLK, B_MOSI);
+
+SPISettings pllSPI(1000000, MSBFIRST, SPI_MODE0);
+
+// CE pin per keyed channel, same order as CHOP_HZ. Each needs its own PWM
+// slice (GPIO 17 -> slice 0, GPIO 13 -> slice 6).
+static const int CHOP_CE_PINS[] = { A_CE, B_CE };
+static constexpr uint8_t CHOP_COUNT = sizeof(CHOP_HZ) / sizeof(CHOP_HZ[0]);
+
+// ============================================================================
+// SPI
+// ============================================================================
+static inline void pulseLE(int pinLE) {
+  digitalWrite(pinLE, HIGH);
+  delayMicroseconds(2);
+  digitalWrite(pinLE, LOW);
+  delayMicroseconds(2);
+}
+
+static void writeReg(SPIClassRP2040 &spi, int pinLE, uint32_t reg) {
+  spi.beginTransaction(pllSPI);
+  spi.transfer((reg >> 24) & 0xFF);
+  spi.transfer((reg >> 16) & 0xFF);
+  spi.transfer((reg >>  8) & 0xFF);
+  spi.transfer((reg >>  0) & 0xFF);
+  spi.endTransaction();
+  pulseLE(pinLE);
+}
+
+static void programPLL(SPIClassRP2040 &spi, int pinLE, const char *name) {
+  Serial.printf("Programming %s for 10.525 GHz RFOUTB\n", name);
+
+  uint32_t regs[13] = {
+    0x0001040C, // R12
+    0x0061300B, // R11
+    0x00C0000A, // R10
+    0x00000009, // R9
+    0x102D0428, // R8
+    0x12000007, // R7
+    0x35000006, // R6
+    0x00800005, // R5
+    0x00000004, // R4
+    0x00000003, // R3
+    0x00001002, // R2
+    0x00000A41, // R1
+    0x00550000  // R0 LAST
+  };
+
+  for (int i = 0; i < 13; i++) {
+    writeReg(spi, pinLE, regs[i]);
+    delay(2);
+  }
+}
+
+// ============================================================================
+// CE chopping (hardware PWM, 50% duty)
+// ============================================================================
+//
+// PWM frequency = clk_sys / (div * (wrap + 1)). Integer divider only, so the
+// keying has no fractional-divider jitter; the leftover frequency error is
+// printed (it's a few ppm, far inside one demodulator bin).
+
+static void startChopping() {
+  uint32_t clk = clock_get_hz(clk_sys);
+  uint32_t sliceMask = 0;
+
+  for (uint8_t k = 0; k < CHOP_COUNT; k++) {
+    uint32_t f = CHOP_HZ[k];
+    uint32_t div = (clk / f + 65535) / 65536;
+    if (div < 1) div = 1;
+    if (div > 255) div = 255;
+    uint32_t top = (clk + (div * f) / 2) / (div * f);   // wrap + 1
+    uint32_t wrap = top - 1;
+
+    int pin = CHOP_CE_PINS[k];
+    uint slice = pwm_gpio_to_slice_num(pin);
+    gpio_set_function(pin, GPIO_FUNC_PWM);
+    pwm_set_enabled(slice, false);
+    pwm_set_clkdiv_int_frac(slice, (uint8_t)div, 0);
+    pwm_set_wrap(slice, (uint16_t)wrap);
+    pwm_set_gpio_level(pin, (uint16_t)(top / 2));
+    pwm_set_counter(slice, 0);
+    sliceMask |= 1u << slice;
+
+    // actual f in mHz, for the printout
+    uint64_t fAct_mhz = (uint64_t)clk * 1000 / ((uint64_t)div * top);
+    Serial.printf("Channel %u: CE pin %d, %lu Hz -> %lu.%03lu Hz (div %lu, wrap %lu)\n",
+                  k, pin, (unsigned long)f,
+                  (unsigned long)(fAct_mhz / 1000), (unsigned long)(fAct_mhz % 1000),
+                  (unsigned long)div, (unsigned long)wrap);
+  }
+
+  // All slices start on the same cycle so the keying phases are fixed
+  pwm_set_mask_enabled(sliceMask);
+}
+
+// ============================================================================
+// Arduino setup/loop
+// ============================================================================
+static DemodBank demod;
+
+void setup() {
+  Serial.begin(115200);
+  delay(1000);
+
+  Serial.println("FDM keying: every board chopped at its own frequency, one receiver");
+
+  pinMode(A_LE, OUTPUT); pinMode(B_LE, OUTPUT);
+  digitalWrite(A_LE, LOW); digitalWrite(B_LE, LOW);
+  for (uint8_t k = 0; k < CHOP_COUNT; k++) {
+    pinMode(CHOP_CE_PINS[k], OUTPUT);
+    digitalWrite(CHOP_CE_PINS[k], LOW);
+  }
+
+  spiA.begin();
+  spiB.begin();
+
+  // CE must be high while programming; hold both on, then hand CE to PWM
+  for (uint8_t k = 0; k < CHOP_COUNT; k++) digitalWrite(CHOP_CE_PINS[k], HIGH);
+  programPLL(spiA, A_LE, "ADF-A");
+  programPLL(spiB, B_LE, "ADF-B");
+
+  uint16_t bins[CHOP_COUNT];
+  for (uint8_t k = 0; k < CHOP_COUNT; k++) {
+    bins[k] = demodBinFor(CHOP_HZ[k], RX_RATE_HZ, DEMOD_BLOCK);
+    if ((uint32_t)bins[k] * RX_RATE_HZ != CHOP_HZ[k] * DEMOD_BLOCK) {
+      Serial.printf("WARNING: %lu Hz isn't on a demod bin, using bin %u\n",
+                    (unsigned long)CHOP_HZ[k], bins[k]);
+    }
+  }
+  demodInit(demod, DEMOD_BLOCK, bins, CHOP_COUNT);
+
+  AcqConfig cfg = { RX_INPUT, 1, RX_RATE_HZ };
+  acqBegin(cfg);
+
+  startChopping();
+  acqStart();
+
+  Serial.print("block");
+  for (uint8_t k = 0; k < CHOP_COUNT; k++) Serial.printf(",ch%u_%luHz", k, (unsigned long)CHOP_HZ[k]);
+  Serial.println();
+}
+
+void loop() {
+  static RxBlock blk;
+  while (acqRead(blk)) {
+    for (uint16_t i = 0; i < blk.per_channel; i++) {
+      if (!demodPush(demod, blk.data[0][i])) continue;
+
+      // Per-board step height at the receiver, ADC codes
+      Serial.printf("%lu", (unsigned long)demod.blocks_done);
+      for (uint8_t k = 0; k < CHOP_COUNT; k++) {
+        uint32_t a = demodKeyedAmplitudeMilli(demod, k);
+        Serial.printf(",%lu.%03lu", (unsigned long)(a / 1000), (unsigned long)(a % 1000));
+      }
+      Serial.println();
+    }
+  }
+
+  static uint32_t lastReport = 0;
+  if (millis() - lastReport > 10000) {
+    lastReport = millis();
+    Serial.printf("# blocks %lu, dropped %lu, fifo overflows %lu\n",
+                  (unsigned long)acqStats.blocks, (unsigned long)acqStats.dropped,
+                  (unsigned long)acqStats.fifo_overflows);
+  }
+}
@@ -0,0 +1,408 @@
+#include <Arduino.h>
+#include <SPI.h>
+#include "hardware/gpio.h"
+#include "hardware/spi.h"
+#include "hardware/timer.h"
+#include "hardware/irq.h"
+#include "adf5355_plan.h"
+#include "hot_path.h"
+
+// ============================================================================
+// USER SETTINGS
+// ============================================================================
+
+// One controller is the master and drives SYNC_PIN; every other controller
+// listens on its SYNC_PIN and disciplines its hop timer to the pulses.
+// Tie ROLE_PIN low on the master, leave it floating (pulled up) on the others.
+static const int ROLE_PIN = 2;
+
+static constexpr uint32_t HOP_PERIOD_US  = 1000;  // nominal, identical on all controllers
+static constexpr uint32_t HOPS_PER_SYNC  = 100;   // sync pulse on every 100th hop edge
+static constexpr uint32_t SYNC_PULSE_US  = 5;
+
+// Loop filter: phase and frequency gains as right shifts (1/2 and 1/8).
+// Settles in ~10 sync periods from 100 ppm of crystal mismatch.
+static constexpr int PLL_KP_SHIFT = 1;
+static constexpr int PLL_KI_SHIFT = 3;
+
+// Declare lock once |error| stays under this for LOCK_COUNT pulses
+static constexpr uint32_t LOCK_THRESHOLD_US = 5;
+static constexpr uint32_t LOCK_COUNT        = 8;
+
+// Fixed GPIO IRQ entry latency on the listener, subtracted from edge stamps.
+// The master stamps its own edge in an alarm IRQ, so only the difference
+// matters; measure once with a scope on HOP_MARK_PIN of both boards.
+static constexpr uint32_t SYNC_IRQ_LATENCY_US = 0;
+
+static constexpr uint32_t PFD_HZ          = 10000000;   // must match R4 in the image
+static constexpr uint32_t CHANNEL_STEP_HZ = 10000;
+static constexpr bool     USE_RFOUTB      = true;
+
+static const uint64_t HOP_FREQS_HZ[] = {
+  10500000000ull, 10510000000ull, 10520000000ull, 10530000000ull,
+};
+
+// ============================================================================
+// PIN DEFINITIONS (board A of the dual-board sketch, plus sync)
+// ============================================================================
+static const int A_SCLK = 18;
+static const int A_MOSI = 19;
+static const int A_LE   = 20;
+static const int A_CE   = 17;
+
+static const int A_MISO_UNUSED = 16;
+static const int A_CS_UNUSED   = 21;
+
+static const int SYNC_PIN     = 3;   // master: output, others: input
+static const int HOP_MARK_PIN = 4;   // toggles on every hop, for the scope
+
+SPIClassRP2040 spiA(spi0, A_MISO_UNUSED, A_CS_UNUSED, A_SCLK, A_MOSI);
+SPISettings pllSPI(1000000, MSBFIRST, SPI_MODE0);
+
+static constexpr PlanConfig planCfg = { PFD_HZ, CHANNEL_STEP_HZ, USE_RFOUTB };
+static constexpr uint32_t HOP_COUNT = sizeof(HOP_FREQS_HZ) / sizeof(HOP_FREQS_HZ[0]);
+
+// The master starts at table position 0 and a sync period is a whole number
+// of passes, so every pulse marks a hop to HOP_FREQS_HZ[0]
+static_assert(HOPS_PER_SYNC % HOP_COUNT == 0, "HOPS_PER_SYNC: a multiple of the hop count");
+
+// ============================================================================
+// SPI
+// ============================================================================
+static inline void pulseLE(int pinLE) {
+  digitalWrite(pinLE, HIGH);
+  delayMicroseconds(2);
+  digitalWrite(pinLE, LOW);
+  delayMicroseconds(2);
+}
+
+static void writeReg(SPIClassRP2040 &spi, int pinLE, uint32_t reg) {
+  spi.beginTransaction(pllSPI);
+  spi.transfer((reg >> 24) & 0xFF);
+  spi.transfer((reg >> 16) & 0xFF);
+  spi.transfer((reg >>  8) & 0xFF);
+  spi.transfer((reg >>  0) & 0xFF);
+  spi.endTransaction();
+  pulseLE(pinLE);
+}
+
+// IRQ-safe version: raw SPI registers, no transaction bookkeeping (RAM)
+static void HOT_PATH(shiftRaw)(uint32_t reg) {
+  hotSpiWrite32(spi0_hw, reg);
+}
+
+static void HOT_PATH(latchLE)() {
+  hotGpioPut(A_LE, 1);
+  hotBusyWaitUs(1);
+  hotGpioPut(A_LE, 0);
+}
+
+static const uint32_t baseRegs[13] = {
+  0x0001040C, // R12
+  0x0061300B, // R11
+  0x00C0000A, // R10
+  0x00000009, // R9
+  0x102D0428, // R8
+  0x12000007, // R7
+  0x35000006, // R6
+  0x00800005, // R5
+  0x00000004, // R4
+  0x00000003, // R3
+  0x00001002, // R2
+  0x00000A41, // R1
+  0x00550000  // R0 LAST
+};
+
+static constexpr int IDX_R1 = 12 - 1;
+static constexpr int IDX_R0 = 12 - 0;
+
+static void programPLL() {
+  for (int i = 0; i < 13; i++) {
+    writeReg(spiA, A_LE, baseRegs[i]);
+    delay(2);
+  }
+}
+
+// ============================================================================
+// Hop schedule
+// ============================================================================
+//
+// Hop k happens at  anchor + k * period  (local microseconds, Q16 so the
+// loop filter can trim the period by fractions of a microsecond). The hop
+// edge is R0's LE: R0 for the next hop is shifted in ahead of time and only
+// latched at the deadline, so SPI time isn't part of the edge timing.
+// (R1/R2 are double buffered and only take effect on the R0 write.)
+//
+// The alarm and sync handlers are HOT_PATH (RAM, see hot_path.h), so hop
+// edges don't wait on XIP cache misses or flash writes.
+
+struct HopWords { uint32_t r2, r1, r0; };
+static HopWords hopTable[HOP_COUNT];
+static volatile uint32_t hopIndex = 0;           // table position, stepped without a divide
+
+static bool     isMaster = false;
+static int      hopAlarm = -1;
+
+static volatile int64_t  anchorQ16 = 0;          // local time of hop 0 of this sync period
+static volatile int64_t  periodQ16 = (int64_t)HOP_PERIOD_US << 16;
+static volatile uint32_t hopInPeriod = 0;        // 0..HOPS_PER_SYNC-1
+static volatile uint32_t hopNumber = 0;
+static volatile bool     markLevel = false;
+
+static void buildHopTable() {
+  for (uint32_t i = 0; i < HOP_COUNT; i++) {
+    PllPlan p = planFrequencyInt(planCfg, HOP_FREQS_HZ[i]);
+    hopTable[i].r2 = packR2(p);
+    hopTable[i].r1 = packR1(baseRegs[IDX_R1], p);
+    hopTable[i].r0 = packR0(baseRegs[IDX_R0], p) | ADF_R0_AUTOCAL;
+  }
+}
+
+static void HOT_PATH(preloadHop)(uint32_t idx) {
+  const HopWords &w = hopTable[idx];
+  shiftRaw(w.r2); latchLE();
+  shiftRaw(w.r1); latchLE();
+  shiftRaw(w.r0);             // latched at the deadline
+}
+
+// periodQ16 stays below 2^32 (HOP_PERIOD_US < 65536), k < HOPS_PER_SYNC
+static __force_inline int64_t periodsQ16(uint32_t k) {
+  return (int64_t)hotMulU32(k, (uint32_t)periodQ16);
+}
+
+static __force_inline uint64_t hopDeadlineUs(uint32_t k) {
+  return (uint64_t)((anchorQ16 + periodsQ16(k)) >> 16);
+}
+
+// Arm the alarm for hop k of the current period; if that's already past
+// (big correction, or a slow preload) it fires as soon as possible instead.
+static void HOT_PATH(armHop)(uint32_t k) {
+  hotAlarmArm(hopAlarm, (uint32_t)hopDeadlineUs(k));
+}
+
+static void HOT_PATH(hopAlarmIrq)() {
+  hotAlarmAck(hopAlarm);
+  latchLE();                                      // <- the hop edge
+  markLevel = !markLevel;
+  hotGpioPut(HOP_MARK_PIN, markLevel);
+
+  if (isMaster && hopInPeriod == 0) {
+    hotGpioPut(SYNC_PIN, 1);
+    hotBusyWaitUs(SYNC_PULSE_US);
+    hotGpioPut(SYNC_PIN, 0);
+  }
+
+  hopNumber++;
+  uint32_t k = hopInPeriod + 1;
+  if (k >= HOPS_PER_SYNC) {
+    // Roll the anchor into the next sync period. On listeners the next pulse
+    // corrects it; without pulses this is the holdover path.
+    anchorQ16 += periodsQ16(HOPS_PER_SYNC);
+    k = 0;
+  }
+  hopInPeriod = k;
+
+  uint32_t idx = hopIndex + 1;
+  if (idx == HOP_COUNT) idx = 0;
+  hopIndex = idx;
+  preloadHop(idx);
+  armHop(k);
+}
+
+// ============================================================================
+// Software PLL (listeners)
+// ============================================================================
+//
+// Each pulse is the master's hop 0. Error = edge - where we expected our hop
+// 0 to be. First pulse snaps the phase, second snaps the frequency, after
+// that a PI filter trims anchor (phase) and period (frequency).
+
+struct SyncStats {
+  uint32_t pulses;
+  uint32_t missed;
+  int32_t  last_err_us;
+  uint32_t max_abs_err_us;        // since lock
+  uint64_t sum_abs_err_us;        // since lock
+  uint32_t locked_pulses;
+  bool     locked;
+};
+
+static volatile SyncStats syncStats;
+static volatile uint64_t  lastEdgeUs = 0;
+static uint32_t inLockRun = 0;
+
+// Hop 0 of the period is next, and so is the master's table position for
+// it: a listener that booted mid-schedule has its own index until now
+static void HOT_PATH(restartPeriod)() {
+  hopInPeriod = 0;
+  hopIndex = 0;
+  preloadHop(0);
+}
+
+// Straight on IO_IRQ_BANK0 (not the SDK's GPIO callback dispatcher, which
+// is in flash); SYNC_PIN is the only GPIO IRQ in this sketch.
+static void HOT_PATH(syncEdgeIrq)() {
+  if (!(hotGpioTakeEvents(SYNC_PIN) & GPIO_IRQ_EDGE_RISE)) return;
+  uint64_t edgeUs = hotTimeUs64() - SYNC_IRQ_LATENCY_US;
+  int64_t  edgeQ16 = (int64_t)edgeUs << 16;
+
+  syncStats.pulses++;
+
+  if (syncStats.pulses == 1) {
+    // Phase snap: our hop 0 is now
+    anchorQ16 = edgeQ16;
+  } else if (syncStats.pulses == 2) {
+    // Frequency snap from one full sync interval (Q16 quotient in two steps,
+    // 32-bit divides only)
+    uint32_t rem;
+    uint32_t q = hotDivU32((uint32_t)(edgeUs - lastEdgeUs), HOPS_PER_SYNC, &rem);
+    periodQ16 = ((int64_t)q << 16) + hotDivU32(rem << 16, HOPS_PER_SYNC, nullptr);
+    anchorQ16 = edgeQ16;
+  } else {
+    // The pulse is the master's hop 0; ours is normally `anchor`, whether it
+    // already fired (we're a bit fast) or is about to (a bit slow), since the
+    // hop timer rolls the anchor right after the last hop of a period. If
+    // we're more than half a period behind it hasn't rolled yet.
+    bool slow = hopInPeriod > HOPS_PER_SYNC / 2;
+    int64_t expected = anchorQ16;
+    if (slow) expected += periodsQ16(HOPS_PER_SYNC);
+    int64_t err = edgeQ16 - expected;
+
+    // Frequency term in 32 bits: |err| that big (> 2^31 Q16 = 32 ms) only
+    // happens while acquiring, and clamping it there is harmless
+    int64_t ki = err >> PLL_KI_SHIFT;
+    if (ki >  INT32_MAX) ki =  INT32_MAX;
+    if (ki < -INT32_MAX) ki = -INT32_MAX;
+    periodQ16 = periodQ16 + hotDivS32((int32_t)ki, HOPS_PER_SYNC);
+    anchorQ16 = expected + (err >> PLL_KP_SHIFT);
+
+    // Way behind: drop the rest of the old period, hop 0 is next.
+    // Otherwise keep counting from whatever already fired.
+    if (slow) restartPeriod();
+
+    int32_t errUs = (int32_t)(err >> 16);
+    uint32_t absErr = errUs < 0 ? -errUs : errUs;
+    syncStats.last_err_us = errUs;
+
+    if (absErr <= LOCK_THRESHOLD_US) {
+      if (++inLockRun >= LOCK_COUNT) syncStats.locked = true;
+    } else {
+      inLockRun = 0;
+      syncStats.locked = false;
+    }
+    if (syncStats.locked) {
+      syncStats.locked_pulses++;
+      syncStats.sum_abs_err_us += absErr;
+      if (absErr > syncStats.max_abs_err_us) syncStats.max_abs_err_us = absErr;
+    }
+  }
+  lastEdgeUs = edgeUs;
+
+  // Snaps restart the period at this edge; hop 0 fires right away
+  if (syncStats.pulses <= 2) restartPeriod();
+
+  // Re-aim the hop timer at the corrected schedule
+  armHop(hopInPeriod);
+}
+
+// ============================================================================
+// Stats interface
+// ============================================================================
+static void printStats() {
+  SyncStats s;
+  noInterrupts();
+  memcpy(&s, (const void *)&syncStats, sizeof(s));
+  interrupts();
+
+  if (isMaster) {
+    Serial.printf("SYNC master: hop %lu, %lu pulses sent\n",
+                  (unsigned long)hopNumber, (unsigned long)(hopNumber / HOPS_PER_SYNC));
+    return;
+  }
+  uint32_t mean = s.locked_pulses ? (uint32_t)(s.sum_abs_err_us / s.locked_pulses) : 0;
+  int64_t nominal = (int64_t)HOP_PERIOD_US << 16;
+  int32_t drift_ppb = (int32_t)((periodQ16 - nominal) * 1000000000LL / nominal);
+  Serial.printf("SYNC %s: pulses %lu, missed %lu | align err last %ld us, mean |%lu| us, "
+                "max |%lu| us | drift %ld ppb\n",
+                s.locked ? "LOCKED" : "acquiring",
+                (unsigned long)s.pulses, (unsigned long)s.missed,
+                (long)s.last_err_us, (unsigned long)mean,
+                (unsigned long)s.max_abs_err_us, (long)drift_ppb);
+}
+
+// ============================================================================
+// Arduino setup/loop
+// ============================================================================
+void setup() {
+  Serial.begin(115200);
+  delay(1000);
+
+  pinMode(ROLE_PIN, INPUT_PULLUP);
+  delay(1);
+  isMaster = (digitalRead(ROLE_PIN) == LOW);
+
+  Serial.printf("Hop sync: %s, hop %lu us, sync every %lu hops\n",
+                isMaster ? "MASTER" : "listener",
+                (unsigned long)HOP_PERIOD_US, (unsigned long)HOPS_PER_SYNC);
+
+  pinMode(A_LE, OUTPUT); pinMode(A_CE, OUTPUT);
+  digitalWrite(A_LE, LOW); digitalWrite(A_CE, LOW);
+  pinMode(HOP_MARK_PIN, OUTPUT);
+  spiA.begin();
+  programPLL();
+  digitalWrite(A_CE, HIGH);
+
+  buildHopTable();
+  preloadHop(0);
+
+  hopAlarm = hardware_alarm_claim_unused(true);
+  hotAlarmInit(hopAlarm, hopAlarmIrq);
+
+  if (isMaster) {
+    pinMode(SYNC_PIN, OUTPUT);
+    digitalWrite(SYNC_PIN, LOW);
+  } else {
+    pinMode(SYNC_PIN, INPUT);
+    gpio_set_irq_enabled(SYNC_PIN, GPIO_IRQ_EDGE_RISE, true);
+    irq_set_exclusive_handler(IO_IRQ_BANK0, syncEdgeIrq);
+    irq_set_enabled(IO_IRQ_BANK0, true);
+    hotIrqAllow(IO_IRQ_BANK0);
+  }
+
+  // Free-run from nominal until the first pulse pulls us in
+  anchorQ16 = (int64_t)(time_us_64() + 1000) << 16;
+  hopInPeriod = 0;
+  armHop(0);
+}
+
+void loop() {
+  // Missing pulses: listener keeps running on its last period estimate
+  if (!isMaster && syncStats.pulses > 0) {
+    static uint32_t lastPulses = 0;
+    static uint32_t lastChangeMs = 0;
+    uint32_t syncMs = HOP_PERIOD_US * HOPS_PER_SYNC / 1000;
+    if (syncStats.pulses != lastPulses) {
+      lastPulses = syncStats.pulses;
+      lastChangeMs = millis();
+    } else if (millis() - lastChangeMs > syncMs + syncMs / 2) {
+      // The sync ISR writes the same fields: update them with it held off,
+      // and only if no pulse slipped in since the check above
+      noInterrupts();
+      if (syncStats.pulses == lastPulses) {
+        syncStats.missed++;
+        syncStats.locked = false;
+        inLockRun = 0;
+      }
+      interrupts();
+      lastChangeMs += syncMs;
+    }
+  }
+
+  if (Serial.available() && Serial.read() == 's') printStats();
+
+  static uint32_t lastReport = 0;
+  if (millis() - lastReport > 5000) {
+    lastReport = millis();
+    printStats();
+  }
+}
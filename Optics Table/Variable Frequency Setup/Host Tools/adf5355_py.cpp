@@ -0,0 +1,319 @@
+// ============================================================================
+// Python bindings: planner, table precompiler, result readers (pybind11)
+// ============================================================================
+//
+// The same headers the firmware uses, so a notebook plans exactly what the
+// board will be told. Results come back as NumPy arrays that own (or view)
+// the C++ memory directly -- nothing is copied element by element through
+// Python.
+//
+// Build (from this folder, needs pybind11 + NumPy):
+//   c++ -O3 -Wall -shared -std=c++17 -fPIC $(python3 -m pybind11 --includes) -I.. adf5355_py.cpp -o adf5355$(python3-config --extension-suffix)
+//
+//   import adf5355, numpy as np
+//   cfg = adf5355.PlanConfig(pfd_hz=10e6, step_hz=10e3, rfoutb=True)
+//   f = 10e9 + 10e3 * np.arange(1_000_000, dtype=np.uint64)
+//   plans = adf5355.plan(cfg, f)             # structured array, one row per point
+//   words, ok = adf5355.precompile(cfg, f)   # (n, 4) R6 R2 R1 R0, like the hop tables
+//
+//   r = adf5355.ResultFile("results.bin")    # mmap, O(1) to open
+//   r.samples                                # (pages, 62) view into the file
+//   idx, s = r.points()                      # valid pages flattened
+//
+//   d = adf5355.read_stream("capture.bin")   # stream_codec blocks -> dict of arrays
+//
+// results.bin is the flash results area (flash_log.h), e.g. for 2 MB flash:
+//   picotool save -r 0x101AC000 0x101EC000 results.bin
+
+#include <fcntl.h>
+#include <stdint.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <pybind11/pybind11.h>
+#include <pybind11/numpy.h>
+#include "adf5355_plan.h"
+#include "result_page.h"
+#include "stream_codec.h"
+
+namespace py = pybind11;
+
+// Same image as the sketches; only the frequency fields get replaced
+static const uint32_t BASE_R6 = 0x35000006;
+static const uint32_t BASE_R1 = 0x00000A41;
+static const uint32_t BASE_R0 = 0x00550000;
+
+using U64Array = py::array_t<uint64_t, py::array::c_style | py::array::forcecast>;
+
+// Hand a vector to NumPy without copying: the array's base is a capsule
+// that deletes the vector.
+template <typename T>
+static py::array_t<T> adoptVector(std::vector<T> *v, std::vector<py::ssize_t> shape) {
+  py::capsule owner(v, [](void *p) { delete static_cast<std::vector<T> *>(p); });
+  return py::array_t<T>(shape, v->data(), owner);
+}
+
+// ============================================================================
+// Planner
+// ============================================================================
+static py::array_t<PllPlan> planBatch(const PlanConfig &cfg, U64Array freqs) {
+  auto f = freqs.unchecked<1>();
+  py::ssize_t n = f.shape(0);
+  py::array_t<PllPlan> out(n);
+  PllPlan *o = out.mutable_data();
+  {
+    py::gil_scoped_release nogil;
+    for (py::ssize_t i = 0; i < n; i++) o[i] = planFrequencyInt(cfg, f(i));
+  }
+  return out;
+}
+
+// (n, 4) words R6, R2, R1, R0 per point -- what the hop sketches hold in
+// their HopWords tables -- plus the ok mask. Unplannable rows are zero.
+static py::tuple precompile(const PlanConfig &cfg, U64Array freqs, bool autocal) {
+  auto f = freqs.unchecked<1>();
+  py::ssize_t n = f.shape(0);
+  py::array_t<uint32_t> words({ n, (py::ssize_t)4 });
+  py::array_t<bool> ok(n);
+  uint32_t *w = words.mutable_data();
+  bool *k = ok.mutable_data();
+  {
+    py::gil_scoped_release nogil;
+    for (py::ssize_t i = 0; i < n; i++) {
+      PllPlan p = planFrequencyInt(cfg, f(i));
+      k[i] = p.ok;
+      uint32_t *row = w + 4 * i;
+      if (!p.ok) { memset(row, 0, 16); continue; }
+      row[0] = packR6Div(BASE_R6, p);
+      row[1] = packR2(p);
+      row[2] = packR1(BASE_R1, p);
+      row[3] = packR0(BASE_R0, p) | (autocal ? ADF_R0_AUTOCAL : 0u);
+    }
+  }
+  return py::make_tuple(words, ok);
+}
+
+// Hop deltas against `back` points earlier (1 = plain sweep, 2 = ping-pong
+// boards), wrapping like the sketches' cyclic hop lists. Returns (n words
+// per point, (n, 4) words in write order, zero padded).
+static py::tuple hopDeltas(const PlanConfig &cfg, U64Array freqs, int back, bool autocal) {
+  auto f = freqs.unchecked<1>();
+  py::ssize_t n = f.shape(0);
+  if (back < 1) throw std::invalid_argument("back must be >= 1");
+  if (n == 0) return py::make_tuple(py::array_t<uint8_t>(0), py::array_t<uint32_t>({ (py::ssize_t)0, (py::ssize_t)4 }));
+  py::array_t<uint8_t> counts(n);
+  py::array_t<uint32_t> words({ n, (py::ssize_t)4 });
+  uint8_t *c = counts.mutable_data();
+  uint32_t *w = words.mutable_data();
+  {
+    py::gil_scoped_release nogil;
+    std::vector<PllPlan> plans(n);
+    for (py::ssize_t i = 0; i < n; i++) plans[i] = planFrequencyInt(cfg, f(i));
+    for (py::ssize_t i = 0; i < n; i++) {
+      const PllPlan &from = plans[((i - back) % n + n) % n];
+      HopDelta d = packHopDelta(from, plans[i], BASE_R6, BASE_R1, BASE_R0, autocal);
+      c[i] = plans[i].ok ? d.n : 0;
+      memset(w + 4 * i, 0, 16);
+      if (plans[i].ok) memcpy(w + 4 * i, d.words, 4 * d.n);
+    }
+  }
+  return py::make_tuple(counts, words);
+}
+
+// ============================================================================
+// Results area (ResultPage pages), memory mapped
+// ============================================================================
+struct ResultFile {
+  void  *map = nullptr;
+  size_t size = 0;
+  size_t pages = 0;
+
+  ResultFile(const ResultFile &) = delete;
+  ResultFile &operator=(const ResultFile &) = delete;
+
+  explicit ResultFile(const std::string &path) {
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) throw std::runtime_error("can't open " + path);
+    struct stat st;
+    fstat(fd, &st);
+    size = (size_t)st.st_size;
+    pages = size / sizeof(ResultPage);
+    if (pages) {
+      map = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+      if (map == MAP_FAILED) { close(fd); throw std::runtime_error("can't map " + path); }
+    }
+    close(fd);
+  }
+  ~ResultFile() { if (map && map != MAP_FAILED) munmap(map, size); }
+
+  const ResultPage *data() const { return (const ResultPage *)map; }
+};
+
+// Views keep the ResultFile alive through their base object
+static py::array resultPagesView(py::object self) {
+  ResultFile &r = self.cast<ResultFile &>();
+  py::array a(py::dtype::of<ResultPage>(), { (py::ssize_t)r.pages }, { (py::ssize_t)sizeof(ResultPage) },
+              r.data(), self);
+  a.attr("setflags")(py::arg("write") = false);
+  return a;
+}
+
+static py::array resultSamplesView(py::object self) {
+  ResultFile &r = self.cast<ResultFile &>();
+  py::array a(py::dtype::of<uint32_t>(), { (py::ssize_t)r.pages, (py::ssize_t)RESULTS_PER_PAGE },
+              { (py::ssize_t)sizeof(ResultPage), (py::ssize_t)4 },
+              r.pages ? r.data()->samples : nullptr, self);
+  a.attr("setflags")(py::arg("write") = false);
+  return a;
+}
+
+static py::array_t<bool> resultValid(const ResultFile &r) {
+  py::array_t<bool> out((py::ssize_t)r.pages);
+  bool *o = out.mutable_data();
+  {
+    py::gil_scoped_release nogil;
+    for (size_t i = 0; i < r.pages; i++) o[i] = resultPageValid(r.data()[i]);
+  }
+  return out;
+}
+
+// Valid pages flattened into (index, sample). 0xFFFFFFFF samples are
+// unplannable points, left in so indices stay contiguous.
+static py::tuple resultPoints(const ResultFile &r) {
+  auto *idx = new std::vector<uint32_t>();
+  auto *smp = new std::vector<uint32_t>();
+  {
+    py::gil_scoped_release nogil;
+    idx->reserve(r.pages * RESULTS_PER_PAGE);
+    smp->reserve(r.pages * RESULTS_PER_PAGE);
+    for (size_t i = 0; i < r.pages; i++) {
+      const ResultPage &pg = r.data()[i];
+      if (!resultPageValid(pg)) continue;
+      for (uint32_t k = 0; k < pg.count; k++) {
+        idx->push_back(pg.first_index + k);
+        smp->push_back(pg.samples[k]);
+      }
+    }
+  }
+  py::ssize_t n = (py::ssize_t)idx->size();
+  return py::make_tuple(adoptVector(idx, { n }), adoptVector(smp, { n }));
+}
+
+// ============================================================================
+// Compressed stream captures (stream_codec.h)
+// ============================================================================
+static py::dict readStream(const std::string &path) {
+  FILE *f = fopen(path.c_str(), "rb");
+  if (!f) throw std::runtime_error("can't open " + path);
+  std::vector<uint8_t> buf;
+  {
+    fseek(f, 0, SEEK_END);
+    long sz = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    buf.resize(sz > 0 ? (size_t)sz : 0);
+    size_t got = fread(buf.data(), 1, buf.size(), f);
+    buf.resize(got);
+    fclose(f);
+  }
+
+  auto *idx = new std::vector<uint32_t>();
+  auto *t   = new std::vector<uint64_t>();
+  auto *amp = new std::vector<int32_t>();
+  uint8_t channels = 0, frac = 0;
+  uint64_t blocks = 0, lost = 0, skipped = 0;
+  {
+    py::gil_scoped_release nogil;
+    idx->reserve(buf.size() / 3);
+    t->reserve(buf.size() / 3);
+    int lastSeq = -1;
+    size_t pos = 0;
+    while (pos < buf.size()) {
+      // console text between blocks: jump to the next possible magic byte
+      const uint8_t *m = (const uint8_t *)memchr(buf.data() + pos, (uint8_t)STREAM_MAGIC, buf.size() - pos);
+      size_t next = m ? (size_t)(m - buf.data()) : buf.size();
+      skipped += next - pos;
+      pos = next;
+      if (pos >= buf.size()) break;
+
+      uint32_t len = 0;
+      if (streamCheckBlock(buf.data() + pos, buf.size() - pos, &len) != STREAM_BLOCK_OK) {
+        pos++;
+        skipped++;
+        continue;
+      }
+      StreamBlockHeader h;
+      memcpy(&h, buf.data() + pos, sizeof(h));
+      if (channels && h.channels != channels) break;     // a different stream started
+      channels = h.channels;
+      frac = h.amp_frac_bits;
+
+      size_t base = idx->size();
+      idx->resize(base + h.count);
+      t->resize(base + h.count);
+      amp->resize((base + h.count) * channels);
+      int k = streamDecodeBlock(buf.data() + pos, idx->data() + base, t->data() + base,
+                                amp->data() + base * channels);
+      if (k < 0) {
+        idx->resize(base); t->resize(base); amp->resize(base * channels);
+      } else {
+        if (lastSeq >= 0) lost += (uint16_t)(h.seq - (uint16_t)lastSeq - 1);
+        lastSeq = h.seq;
+        blocks++;
+      }
+      pos += len;
+    }
+  }
+  py::ssize_t n = (py::ssize_t)idx->size();
+  py::dict d;
+  d["index"] = adoptVector(idx, { n });
+  d["t_us"] = adoptVector(t, { n });
+  d["amp"] = adoptVector(amp, { n, (py::ssize_t)(channels ? channels : 1) });
+  d["amp_frac_bits"] = frac;
+  d["blocks"] = blocks;
+  d["lost_blocks"] = lost;
+  d["skipped_bytes"] = skipped;
+  return d;
+}
+
+// ============================================================================
+// Module
+// ============================================================================
+PYBIND11_MODULE(adf5355, m) {
+  m.doc() = "ADF5355 integer planner, table precompiler and result readers";
+
+  PYBIND11_NUMPY_DTYPE(PllPlan, rf_hz, vco_hz, INT, FRAC1, FRAC2, MOD2, out_div, ok);
+  PYBIND11_NUMPY_DTYPE(ResultPage, first_index, count, crc, samples);
+
+  py::class_<PlanConfig>(m, "PlanConfig")
+    .def(py::init([](double pfd_hz, double step_hz, bool rfoutb) {
+           return PlanConfig{ (uint32_t)pfd_hz, (uint32_t)step_hz, rfoutb };
+         }), py::arg("pfd_hz") = 10e6, py::arg("step_hz") = 10e3, py::arg("rfoutb") = true)
+    .def_readwrite("pfd_hz", &PlanConfig::pfd_hz)
+    .def_readwrite("step_hz", &PlanConfig::chan_step_hz)
+    .def_readwrite("rfoutb", &PlanConfig::use_rfoutb);
+
+  m.def("plan", &planBatch, py::arg("cfg"), py::arg("freqs_hz"),
+        "Plan every frequency; structured array with the PllPlan fields");
+  m.def("precompile", &precompile, py::arg("cfg"), py::arg("freqs_hz"), py::arg("autocal") = true,
+        "(words[n, 4] = R6 R2 R1 R0, ok[n])");
+  m.def("hop_deltas", &hopDeltas, py::arg("cfg"), py::arg("freqs_hz"), py::arg("back") = 1,
+        py::arg("autocal") = true,
+        "(count[n], words[n, 4]): only the words that change vs the point `back` earlier");
+
+  py::class_<ResultFile>(m, "ResultFile")
+    .def(py::init<const std::string &>(), py::arg("path"))
+    .def_readonly("n_pages", &ResultFile::pages)
+    .def_property_readonly("pages", &resultPagesView, "all pages, read-only view into the file")
+    .def_property_readonly("samples", &resultSamplesView, "(pages, 62) read-only view")
+    .def("valid", &resultValid, "per-page CRC check")
+    .def("points", &resultPoints, "(index, sample) of every valid page, flattened");
+
+  m.def("read_stream", &readStream, py::arg("path"),
+        "Decode a stream_codec capture: index, t_us, amp[n, channels] and block stats");
+
+  m.attr("RESULTS_PER_PAGE") = RESULTS_PER_PAGE;
+}
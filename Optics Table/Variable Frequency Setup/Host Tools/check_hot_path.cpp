@@ -0,0 +1,275 @@
+// ============================================================================
+// Hot-path placement check (host)
+// ============================================================================
+//
+// Verifies what hot_path.h promises on a built firmware ELF:
+//   - every HOT_PATH(...) function and HOT_DATA(...) object named in the
+//     sources ended up in RAM, and
+//   - nothing reachable from a hot function calls into flash -- directly,
+//     through a linker veneer, or via a literal-pool function pointer.
+// Calls are followed transitively through RAM functions, so a hot handler
+// calling a helper that calls flash is still caught.
+//
+// Build (from this folder):
+//   g++ -O2 -std=c++17 -Wall check_hot_path.cpp -o check_hot_path
+//
+// Usage:
+//   check_hot_path [--prefix arm-none-eabi-] [--esp32] firmware.elf sources...
+//
+// Arduino IDE: Sketch -> Export Compiled Binary puts the .elf in build/.
+// Needs <prefix>nm and <prefix>objdump on PATH (they ship with the core's
+// toolchain). Exits 1 if anything is misplaced, 2 on usage/tool errors.
+
+#include <ctype.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
+struct Range { uint64_t lo, hi; const char *name; };
+
+// RP2040: SRAM (striped + the two 4 KB banks) and XIP flash incl. aliases
+static const Range RP_RAM[]   = { { 0x20000000, 0x20042000, "SRAM" } };
+static const Range RP_FLASH[] = { { 0x10000000, 0x14000000, "XIP" } };
+
+// ESP32: IRAM/DRAM vs the cached flash mappings
+static const Range ESP_RAM[] = {
+  { 0x40070000, 0x400A0000, "IRAM" },
+  { 0x3FFAE000, 0x40000000, "DRAM" },
+};
+static const Range ESP_FLASH[] = {
+  { 0x400C2000, 0x40C00000, "IROM" },
+  { 0x3F400000, 0x3F800000, "DROM" },
+};
+
+struct Target {
+  const Range *ram;   size_t nram;
+  const Range *flash; size_t nflash;
+};
+
+static bool inRanges(uint64_t a, const Range *r, size_t n) {
+  for (size_t i = 0; i < n; i++) if (a >= r[i].lo && a < r[i].hi) return true;
+  return false;
+}
+
+static std::string trim(const std::string &s) {
+  size_t a = s.find_first_not_of(" \t\r\n");
+  size_t b = s.find_last_not_of(" \t\r\n");
+  return a == std::string::npos ? std::string() : s.substr(a, b - a + 1);
+}
+
+// ----------------------------------------------------------------------------
+// Sources: collect the names inside HOT_PATH(...) / HOT_DATA(...)
+// ----------------------------------------------------------------------------
+static void scanSource(const char *path, std::set<std::string> &fns, std::set<std::string> &data) {
+  FILE *f = fopen(path, "r");
+  if (!f) { fprintf(stderr, "can't open %s\n", path); exit(2); }
+  std::string text;
+  char buf[4096];
+  size_t n;
+  while ((n = fread(buf, 1, sizeof(buf), f)) > 0) text.append(buf, n);
+  fclose(f);
+
+  const char *keys[] = { "HOT_PATH(", "HOT_DATA(" };
+  for (int k = 0; k < 2; k++) {
+    size_t pos = 0;
+    while ((pos = text.find(keys[k], pos)) != std::string::npos) {
+      size_t start = pos + strlen(keys[k]);
+      pos = start;
+      // skip the macro definitions themselves and comment examples
+      size_t lineStart = text.rfind('\n', start);
+      lineStart = (lineStart == std::string::npos) ? 0 : lineStart + 1;
+      std::string head = trim(text.substr(lineStart, start - lineStart));
+      if (head.compare(0, 7, "#define") == 0 || head.compare(0, 2, "//") == 0) continue;
+
+      size_t end = text.find(')', start);
+      if (end == std::string::npos) break;
+      std::string name = trim(text.substr(start, end - start));
+      if (name.empty() || name == "fn" || name == "name") continue;
+      (k == 0 ? fns : data).insert(name);
+    }
+  }
+}
+
+// ----------------------------------------------------------------------------
+// ELF via binutils
+// ----------------------------------------------------------------------------
+static FILE *tool(const std::string &cmd) {
+  FILE *p = popen(cmd.c_str(), "r");
+  if (!p) { fprintf(stderr, "can't run: %s\n", cmd.c_str()); exit(2); }
+  return p;
+}
+
+struct Sym { uint64_t addr; char type; std::string name; };
+
+// Demangled names are matched on the bare identifier: "foo(unsigned int)"
+// and "ns::foo" both count as "foo".
+static std::string bareName(const std::string &s) {
+  std::string n = s.substr(0, s.find('('));
+  size_t c = n.rfind("::");
+  return c == std::string::npos ? n : n.substr(c + 2);
+}
+
+static std::vector<Sym> readSymbols(const std::string &prefix, const char *elf) {
+  std::vector<Sym> out;
+  FILE *p = tool(prefix + "nm -C \"" + elf + "\"");
+  char line[1024];
+  while (fgets(line, sizeof(line), p)) {
+    char *end;
+    uint64_t a = strtoull(line, &end, 16);
+    if (end == line || *end != ' ') continue;            // undefined symbols
+    Sym s;
+    s.addr = a;
+    s.type = end[1];
+    s.name = trim(end + 3);
+    out.push_back(s);
+  }
+  if (pclose(p) != 0 && out.empty()) { fprintf(stderr, "nm failed on %s\n", elf); exit(2); }
+  return out;
+}
+
+struct Func {
+  uint64_t addr = 0;
+  std::vector<uint64_t> calls;          // bl/blx/call targets
+  std::vector<uint64_t> literals;       // .word constants
+  std::vector<std::string> callNames;   // objdump's <symbol> for each call
+};
+
+// objdump -d: "<addr> <name>:" starts a function, instruction lines are
+// "  addr:\tbytes \tmnemonic\toperands <sym>"
+static std::map<std::string, Func> readDisassembly(const std::string &prefix, const char *elf) {
+  std::map<std::string, Func> funcs;
+  FILE *p = tool(prefix + "objdump -d -C --no-show-raw-insn \"" + elf + "\"");
+  char line[2048];
+  Func *cur = nullptr;
+  while (fgets(line, sizeof(line), p)) {
+    std::string s = line;
+    size_t lt = s.find(" <");
+    if (lt != std::string::npos && s.size() > 2 && s[s.size() - 2] == ':' && s[0] != ' ') {
+      std::string name = s.substr(lt + 2);
+      name = name.substr(0, name.rfind(">:"));
+      cur = &funcs[name];
+      cur->addr = strtoull(s.c_str(), nullptr, 16);
+      continue;
+    }
+    if (!cur) continue;
+    size_t colon = s.find(":\t");
+    if (colon == std::string::npos) continue;
+    std::string ins = s.substr(colon + 2);
+    size_t tab = ins.find('\t');
+    std::string mnem = trim(tab == std::string::npos ? ins : ins.substr(0, tab));
+    std::string ops = tab == std::string::npos ? "" : trim(ins.substr(tab + 1));
+
+    bool isCall = mnem == "bl" || mnem == "blx" || mnem == "call0" || mnem == "call4" ||
+                  mnem == "call8" || mnem == "call12";
+    if (isCall && !ops.empty() && isxdigit((unsigned char)ops[0])) {
+      cur->calls.push_back(strtoull(ops.c_str(), nullptr, 16));
+      size_t a = ops.find('<'), b = ops.rfind('>');
+      cur->callNames.push_back(a != std::string::npos && b > a ? ops.substr(a + 1, b - a - 1) : ops);
+    } else if (mnem == ".word") {
+      cur->literals.push_back(strtoull(ops.c_str(), nullptr, 16));
+    }
+  }
+  pclose(p);
+  return funcs;
+}
+
+// ----------------------------------------------------------------------------
+// main
+// ----------------------------------------------------------------------------
+int main(int argc, char **argv) {
+  std::string prefix = "arm-none-eabi-";
+  bool esp32 = false;
+  const char *elf = nullptr;
+  std::vector<const char *> sources;
+
+  for (int i = 1; i < argc; i++) {
+    if (!strcmp(argv[i], "--prefix") && i + 1 < argc) prefix = argv[++i];
+    else if (!strcmp(argv[i], "--esp32")) { esp32 = true; if (prefix == "arm-none-eabi-") prefix = "xtensa-esp32-elf-"; }
+    else if (!elf) elf = argv[i];
+    else sources.push_back(argv[i]);
+  }
+  if (!elf || sources.empty()) {
+    fprintf(stderr, "usage: %s [--prefix arm-none-eabi-] [--esp32] firmware.elf sources...\n", argv[0]);
+    return 2;
+  }
+
+  Target t = esp32 ? Target{ ESP_RAM, 2, ESP_FLASH, 2 } : Target{ RP_RAM, 1, RP_FLASH, 1 };
+
+  std::set<std::string> hotFns, hotData;
+  for (const char *s : sources) scanSource(s, hotFns, hotData);
+  printf("%zu HOT_PATH functions, %zu HOT_DATA objects in %zu sources\n",
+         hotFns.size(), hotData.size(), sources.size());
+
+  std::vector<Sym> syms = readSymbols(prefix, elf);
+  std::map<uint64_t, std::string> byAddr;
+  for (const Sym &s : syms) if (s.type == 't' || s.type == 'T') byAddr[s.addr & ~1ull] = s.name;
+
+  int violations = 0;
+
+  // 1. placement
+  std::set<std::string> seen;
+  std::vector<std::string> roots;
+  for (const Sym &s : syms) {
+    std::string bare = bareName(s.name);
+    bool fn = hotFns.count(bare) != 0, data = hotData.count(bare) != 0;
+    if (!fn && !data) continue;
+    seen.insert(bare);
+    if (!inRanges(s.addr, t.ram, t.nram)) {
+      printf("NOT IN RAM   %-40s 0x%08llx\n", s.name.c_str(), (unsigned long long)s.addr);
+      violations++;
+    }
+    if (fn) roots.push_back(s.name);
+  }
+  for (const std::string &n : hotFns)
+    if (!seen.count(n)) printf("note: HOT_PATH %s not in the ELF (inlined or unused)\n", n.c_str());
+  for (const std::string &n : hotData)
+    if (!seen.count(n)) printf("note: HOT_DATA %s not in the ELF (optimised out)\n", n.c_str());
+
+  // 2. calls, transitively from every hot function
+  std::map<std::string, Func> funcs = readDisassembly(prefix, elf);
+  std::set<std::string> visited;
+  std::vector<std::pair<std::string, std::string>> work;     // (function, reached from)
+  for (const std::string &r : roots) work.push_back({ r, r });
+
+  while (!work.empty()) {
+    auto [name, root] = work.back();
+    work.pop_back();
+    if (!visited.insert(name).second) continue;
+    auto it = funcs.find(name);
+    if (it == funcs.end()) continue;
+    const Func &f = it->second;
+
+    for (size_t i = 0; i < f.calls.size(); i++) {
+      uint64_t a = f.calls[i];
+      const std::string &callee = f.callNames[i];
+      bool veneer = callee.find("_veneer") != std::string::npos;
+      if (inRanges(a, t.flash, t.nflash) || veneer) {
+        printf("FLASH CALL   %s -> %s (via %s)\n", name.c_str(), callee.c_str(), root.c_str());
+        violations++;
+      } else if (inRanges(a, t.ram, t.nram)) {
+        auto s = byAddr.find(a & ~1ull);
+        work.push_back({ s != byAddr.end() ? s->second : callee, root });
+      }
+    }
+    // function pointers loaded from the literal pool (blx rN)
+    for (uint64_t w : f.literals) {
+      auto s = byAddr.find(w & ~1ull);
+      if (s == byAddr.end()) continue;
+      if (inRanges(w, t.flash, t.nflash)) {
+        printf("FLASH PTR    %s -> %s (via %s)\n", name.c_str(), s->second.c_str(), root.c_str());
+        violations++;
+      } else if (inRanges(w, t.ram, t.nram)) {
+        work.push_back({ s->second, root });
+      }
+    }
+  }
+
+  printf("%zu functions checked, %d violation%s\n", visited.size(), violations,
+         violations == 1 ? "" : "s");
+  return violations ? 1 : 0;
+}
@@ -0,0 +1,531 @@
+// ============================================================================
+// Lab digital twin: sweep engine + mock HAL + synth / sample / receiver model
+// ============================================================================
+//
+// Runs the real sweep engine (sweep_engine.h, the same planner and register
+// packing as the sketches) against a model of the bench, on a virtual
+// clock, so whole measurement pipelines can be run and timed without the
+// hardware -- much faster than real time.
+//
+// Build (from this folder):
+//   g++ -O2 -std=c++17 -Wall -I.. lab_twin.cpp -o lab_twin
+//
+//   lab_twin [options]                       one sweep, summary only
+//   lab_twin --sweeps 100 -o results.bin     result pages, as the flash holds them
+//   lab_twin --csv sweep.csv                 per point: requested / actual
+//                                            frequency, true transmission, reading
+//   lab_twin -o r.bin && resonance_fit r.bin --start-hz 10.2e9 --step-hz 250e3
+//   lab_twin --track 2 --shift-hz-per-s 2e6  tracker.h following a moving dip;
+//                                            --csv gets one row per update
+//   lab_twin --track 2.15 --probes 9 --shift-hz-per-s 45e6
+//                                            the same dip run off the top of
+//                                            the band (start + acquire span)
+//
+// Signal chain, in order:
+//
+//   mock HAL       the sweep hooks, as the Checkpointed sweep sketch does
+//                  them: R6 on a divider change, R2, R1, R0 | autocal, each
+//                  word costing its SPI + LE time on the virtual clock.
+//                  Flash page writes, sector erases and checkpoints cost
+//                  their flash time too.
+//   synthesizer    decodes the register words (double-buffered until R0,
+//                  like the chip), muted during autocal, then settles onto
+//                  the new frequency exponentially (lock time grows with the
+//                  VCO step, same model as sweep_estimate).
+//   sample         |S21|^2 of a baseline with Lorentzian / Fano resonances,
+//                  optionally all moving at a fixed rate (heating, bias).
+//   receiver       square-law detector, non-inverting amp with the gain of
+//                  the PASCO receiver repair (1 + 18k/100 = 181, Gain.m)
+//                  saturating towards 12 V, a first-order low-pass, noise,
+//                  a divider into the 12-bit ADC. --hard-clip uses Gain.m's
+//                  theoretical min(G Vin, 12 V); the default soft knee
+//                  follows its measured points instead.
+//
+// Resonances: --res F0_HZ,Q,DEPTH[,FANO_PHASE_RAD], repeatable. DEPTH is
+// the fraction of the field removed at the centre (0.7 = 91% power dip).
+
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <complex>
+#include <random>
+#include <string>
+#include <vector>
+#include "adf5355_plan.h"
+#include "sweep_engine.h"
+#include "tracker.h"
+
+static double nowSec() {
+  timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+// ============================================================================
+// Settings
+// ============================================================================
+struct Resonance {
+  double f0_hz, q, depth, fano;
+};
+
+struct TwinConfig {
+  PlanConfig plan      = { 10000000, 10000, true };
+
+  // Sweep (one table, run --sweeps times)
+  uint64_t start_hz    = 10200000000ull;
+  uint64_t step_hz     = 250000;
+  uint32_t points      = 401;
+  uint32_t dwell_us    = 200;
+  uint32_t sweeps      = 1;
+
+  // Tracking (--track): seconds of bench time; --start-hz is the first guess
+  double   track_s     = 0;
+  uint32_t probe_step_hz = 1000000;
+  uint8_t  probes      = 5;
+  uint32_t acquire_span_hz = 100000000;
+  uint16_t acquire_points = 101;
+  uint8_t  alpha_q8    = 128;
+  uint8_t  beta_q8     = 32;
+
+  // Timing of the board (sketch defaults)
+  double spi_hz        = 1e6;
+  double le_us         = 4.0;
+  double word_ovh_us   = 3.0;
+  double adc_read_us   = 4.0;        // one analogRead()
+  int    adc_avg       = 8;          // reads summed per point
+  double page_prog_us  = 800;        // flash_range_program, 256 B
+  double sector_erase_us = 45000;    // flash_range_erase, 4 KB (every 16 pages)
+  double checkpoint_us = 900;        // checkpoint slot program (+ sector erase amortised)
+
+  // Synthesizer
+  double autocal_us    = 100;
+  double lock_base_us  = 20;
+  double lock_per_mhz  = 0.2;        // per MHz of VCO step
+  double out_dbm       = 5;
+
+  // Sample
+  std::vector<Resonance> res;
+  double shift_hz_per_s = 0;         // all resonances move at this rate
+  double baseline_slope_db_per_ghz = -1.5;
+
+  // Receiver
+  double path_loss_db  = 20;
+  double det_mv_per_uw = 0.5;        // square-law detector responsivity
+  double amp_gain      = 1 + 18000.0 / 100.0;
+  double amp_vsat      = 12.0;
+  double amp_knee      = 6.0;        // soft-clip sharpness; fitted to Gain.m's measured points
+  bool   hard_clip     = false;
+  double amp_tau_us    = 10;
+  double noise_uv      = 50;         // rms at the amp input, per read
+  double adc_divider   = 3.3 / 12.0; // amp output -> ADC pin
+  double adc_noise_lsb = 1.5;
+  uint64_t seed        = 1;
+
+  const char *out_path = nullptr;
+  const char *csv_path = nullptr;
+};
+
+static TwinConfig cfg;
+
+// ============================================================================
+// Virtual clock + models
+// ============================================================================
+static double vNow_ns = 0;
+
+static void advanceUs(double us) { vNow_ns += us * 1000; }
+
+// --- Synthesizer: what the chip does with the words it's sent ---
+struct SynthModel {
+  uint32_t r6 = 0, r2 = 0, r1 = 0;   // latched on R0, like the double-buffered chip
+  bool     valid = false;
+  double   f_hz = 0;                 // frequency being settled onto
+  double   f_from = 0;               // where it was when R0 landed
+  double   t_r0_ns = 0;
+  double   cal_ns = 0;
+  double   tau_ns = 1;
+  uint64_t words = 0;
+};
+
+static SynthModel synth;
+
+// Frequency now; NaN while muted (autocal, or never tuned)
+static double synthFreqAt(double t_ns) {
+  if (!synth.valid || t_ns < synth.t_r0_ns + synth.cal_ns) return NAN;
+  double dt = t_ns - synth.t_r0_ns - synth.cal_ns;
+  return synth.f_hz + (synth.f_from - synth.f_hz) * exp(-dt / synth.tau_ns);
+}
+
+static double decodeRf(uint32_t r6, uint32_t r2, uint32_t r1, uint32_t r0) {
+  uint32_t INT   = (r0 >> 4) & 0xFFFF;
+  uint32_t FRAC1 = (r1 >> 4) & 0xFFFFFF;
+  uint32_t MOD2  = (r2 >> 4) & 0x3FFF;
+  uint32_t FRAC2 = (r2 >> 18) & 0x3FFF;
+  double n = INT + (FRAC1 + (MOD2 ? (double)FRAC2 / MOD2 : 0.0)) / ADF_MOD1;
+  double vco = n * cfg.plan.pfd_hz;
+  if (cfg.plan.use_rfoutb) return vco * 2;
+  return vco / (double)(1u << ((r6 >> 21) & 7));
+}
+
+static void synthWrite(uint32_t w) {
+  synth.words++;
+  switch (w & 0xF) {
+    case 6: synth.r6 = w; break;
+    case 2: synth.r2 = w; break;
+    case 1: synth.r1 = w; break;
+    case 0: {
+      double f = decodeRf(synth.r6, synth.r2, synth.r1, w);
+      double now = synthFreqAt(vNow_ns);
+      if (std::isnan(now)) now = synth.f_hz;      // retuned during autocal
+      double vcoStepMHz = fabs(f - (synth.valid ? now : f)) / 1e6 / (cfg.plan.use_rfoutb ? 2 : 1);
+      synth.f_from = synth.valid ? now : f;
+      synth.f_hz = f;
+      synth.t_r0_ns = vNow_ns;
+      synth.cal_ns = (w & ADF_R0_AUTOCAL) ? cfg.autocal_us * 1000 : 0;
+      // lock time ~ 5 tau
+      synth.tau_ns = (cfg.lock_base_us + cfg.lock_per_mhz * vcoStepMHz) * 1000 / 5;
+      synth.valid = true;
+      break;
+    }
+    default: break;        // the rest of the image doesn't move the output
+  }
+}
+
+// --- Sample: complex transmission ---
+static double sampleTransmission(double f_hz, double t_ns) {
+  double shift = cfg.shift_hz_per_s * t_ns * 1e-9;
+  std::complex<double> t(1, 0);
+  for (const Resonance &r : cfg.res) {
+    double f0 = r.f0_hz + shift;
+    std::complex<double> lor = 1.0 / std::complex<double>(1, 2 * r.q * (f_hz - f0) / f0);
+    t -= r.depth * std::polar(1.0, r.fano) * lor;
+  }
+  double baseDb = cfg.baseline_slope_db_per_ghz * (f_hz - cfg.start_hz) / 1e9;
+  return std::norm(t) * pow(10, baseDb / 10);
+}
+
+// --- Receiver ---
+static std::mt19937_64 rng;
+static std::normal_distribution<double> gauss(0, 1);
+static double ampOut_v = 0;          // low-pass state
+static double ampAt_ns = 0;
+
+static double ampTransfer(double vin) {
+  double v = cfg.amp_gain * vin;
+  if (cfg.hard_clip) return v > cfg.amp_vsat ? cfg.amp_vsat : v;
+  return v / pow(1 + pow(fabs(v) / cfg.amp_vsat, cfg.amp_knee), 1 / cfg.amp_knee);
+}
+
+static uint32_t adcRead() {
+  double f = synthFreqAt(vNow_ns);
+  double uw = 0;
+  if (!std::isnan(f)) {
+    double dbm = cfg.out_dbm - cfg.path_loss_db;
+    uw = pow(10, dbm / 10) * 1000 * sampleTransmission(f, vNow_ns);
+  }
+  double vdet = cfg.det_mv_per_uw * uw / 1000 + cfg.noise_uv * 1e-6 * gauss(rng);
+  double target = ampTransfer(vdet);
+
+  double dt = vNow_ns - ampAt_ns;
+  ampOut_v += (target - ampOut_v) * (1 - exp(-dt / (cfg.amp_tau_us * 1000)));
+  ampAt_ns = vNow_ns;
+
+  double counts = ampOut_v * cfg.adc_divider / 3.3 * 4096 + cfg.adc_noise_lsb * gauss(rng);
+  advanceUs(cfg.adc_read_us);
+  if (counts < 0) return 0;
+  if (counts > 4095) return 4095;
+  return (uint32_t)(counts + 0.5);
+}
+
+// ============================================================================
+// Mock HAL: the sweep engine hooks
+// ============================================================================
+static const uint32_t BASE_R6 = 0x35000006;
+static const uint32_t BASE_R1 = 0x00000A41;
+static const uint32_t BASE_R0 = 0x00550000;
+
+struct TwinStats {
+  uint64_t points;
+  uint64_t muted;            // reading started while the output was muted
+  uint64_t unsettled;        // ... or still more than 1 kHz off
+  double   plan_err_max_hz;  // decoded words vs requested frequency
+  uint64_t pages, erases, checkpoints;
+};
+
+static TwinStats stats;
+static uint8_t lastDiv = 0;
+static uint64_t lastRequested = 0;
+static std::vector<ResultPage> stored;
+static FILE *csv = nullptr;
+static uint32_t csvSweep = 0;
+
+static void spiWord(uint32_t w) {
+  advanceUs(32 / cfg.spi_hz * 1e6 + cfg.word_ovh_us + cfg.le_us);
+  synthWrite(w);
+}
+
+static void sweepTune(const PllPlan &p) {
+  if (p.out_div != lastDiv) {
+    spiWord(packR6Div(BASE_R6, p));
+    lastDiv = p.out_div;
+  }
+  spiWord(packR2(p));
+  spiWord(packR1(BASE_R1, p));
+  spiWord(packR0(BASE_R0, p) | ADF_R0_AUTOCAL);
+  lastRequested = p.rf_hz;
+  double err = fabs(synth.f_hz - (double)p.rf_hz);
+  if (err > stats.plan_err_max_hz) stats.plan_err_max_hz = err;
+}
+
+static void sweepSettle(uint32_t us) {
+  advanceUs(us);
+}
+
+static uint32_t sweepMeasure() {
+  double f = synthFreqAt(vNow_ns);
+  if (std::isnan(f)) stats.muted++;
+  else if (fabs(f - (double)lastRequested) > 1000) stats.unsettled++;
+  stats.points++;
+
+  double tMid = vNow_ns + cfg.adc_avg * cfg.adc_read_us * 500;
+  uint32_t acc = 0;
+  for (int i = 0; i < cfg.adc_avg; i++) acc += adcRead();
+
+  if (csv) {
+    fprintf(csv, "%u,%llu,%.1f,%.6f,%lu\n", csvSweep, (unsigned long long)lastRequested,
+            std::isnan(f) ? 0.0 : f, sampleTransmission((double)lastRequested, tMid),
+            (unsigned long)acc);
+  }
+  return acc;
+}
+
+static uint32_t sweepMicros() {
+  return (uint32_t)(uint64_t)(vNow_ns / 1000);
+}
+
+static bool sweepStorePage(const ResultPage &page) {
+  if (stats.pages % 16 == 0) {
+    advanceUs(cfg.sector_erase_us);
+    stats.erases++;
+  }
+  advanceUs(cfg.page_prog_us);
+  stats.pages++;
+  if (cfg.out_path) stored.push_back(page);
+  return true;
+}
+
+static void sweepCheckpoint(uint16_t, uint32_t) {
+  advanceUs(cfg.checkpoint_us);
+  stats.checkpoints++;
+}
+
+// The tracker's hooks are the same bench
+static void trackTune(const PllPlan &p) { sweepTune(p); }
+static void trackSettle(uint32_t us) { sweepSettle(us); }
+static uint32_t trackMeasure() { return sweepMeasure(); }
+static uint32_t trackMicros() { return sweepMicros(); }
+
+// ============================================================================
+// Run
+// ============================================================================
+
+// Tracking error is against the first resonance's true centre at the end
+// of each round; the first second of drift after a reacquire is included.
+// Rounds with the centre outside the tracker's band are counted apart.
+static int runTrack() {
+  FILE *out = nullptr;
+  if (cfg.csv_path) {
+    out = fopen(cfg.csv_path, "w");
+    if (!out) { fprintf(stderr, "can't write %s\n", cfg.csv_path); return 2; }
+    fprintf(out, "t_s,true_hz,center_hz,drift_hz_s,extreme,flags\n");
+  }
+
+  uint64_t span = cfg.acquire_span_hz;
+  TrackConfig tc = {
+    cfg.plan, cfg.start_hz, cfg.probe_step_hz, cfg.probes, cfg.dwell_us, true,
+    cfg.start_hz > span ? cfg.start_hz - span : 0, cfg.start_hz + span,
+    cfg.acquire_span_hz, cfg.acquire_points, 8, cfg.alpha_q8, cfg.beta_q8
+  };
+  Tracker t;
+  double w0 = nowSec();
+  if (!trackBegin(t, tc)) {
+    fprintf(stderr, "tracker setup failed (start or probe spacing not plannable)\n");
+    return 2;
+  }
+  double acquired_s = vNow_ns * 1e-9;
+
+  uint64_t n = 0, outside = 0, outsideOk = 0;
+  double sq = 0, worst = 0;
+  while (vNow_ns * 1e-9 < acquired_s + cfg.track_s) {
+    TrackUpdate u;
+    trackStep(t, u);
+    double truth = cfg.res[0].f0_hz + cfg.shift_hz_per_s * vNow_ns * 1e-9;
+    double err = (double)u.center_hz - truth;
+    if (truth < tc.min_hz || truth > tc.max_hz) {
+      outside++;
+      if (!u.flags) outsideOk++;
+    } else {
+      sq += err * err;
+      if (fabs(err) > worst) worst = fabs(err);
+      n++;
+    }
+    if (out) {
+      fprintf(out, "%.6f,%.0f,%llu,%ld,%lu,%u\n", vNow_ns * 1e-9, truth,
+              (unsigned long long)u.center_hz, (long)u.velocity_hz_s,
+              (unsigned long)u.extreme, u.flags);
+    }
+  }
+  double wall = nowSec() - w0;
+  if (out) fclose(out);
+
+  const TrackStats &s = t.stats;
+  double roundUs = s.rounds ? (double)s.round_us_total / s.rounds : 0;
+  printf("tracked %.3f s on the bench clock (first scan %.1f ms), %.3f s here: %llu updates, "
+         "%.0f updates/s (round %.0f us avg, %u max)\n",
+         cfg.track_s, acquired_s * 1e3, wall, (unsigned long long)(n + outside),
+         roundUs > 0 ? 1e6 / roundUs : 0.0, roundUs, s.round_us_max);
+  double fwhm = cfg.res[0].f0_hz / cfg.res[0].q;
+  printf("error vs true centre: rms %.0f Hz, max %.0f Hz (FWHM %.0f Hz) | final drift "
+         "estimate %lld Hz/s (true %.0f)\n",
+         n ? sqrt(sq / n) : 0.0, worst, fwhm, (long long)t.velocity_hz_s, cfg.shift_hz_per_s);
+  if (outside) {
+    printf("centre outside the band (%.4f-%.4f GHz) for %llu updates, %llu of them unflagged\n",
+           tc.min_hz * 1e-9, tc.max_hz * 1e-9, (unsigned long long)outside,
+           (unsigned long long)outsideOk);
+  }
+  printf("clamped %u, no curve %u, reacquired %u | plans: %u derived, %u full | "
+         "readings started muted %llu, unsettled %llu\n",
+         s.clamped, s.no_curve, s.reacquires, s.derived, s.planned,
+         (unsigned long long)stats.muted, (unsigned long long)stats.unsettled);
+  return 0;
+}
+
+static int run() {
+  rng.seed(cfg.seed);
+  if (cfg.res.empty()) cfg.res.push_back({ 10.25e9, 2000, 0.7, 0 });
+  if (cfg.track_s > 0) return runTrack();
+
+  if (cfg.csv_path) {
+    csv = fopen(cfg.csv_path, "w");
+    if (!csv) { fprintf(stderr, "can't write %s\n", cfg.csv_path); return 2; }
+    fprintf(csv, "sweep,freq_hz,actual_hz,transmission,adc_sum\n");
+  }
+
+  SweepTable table = { 1, cfg.start_hz, cfg.step_hz, cfg.points, cfg.dwell_us };
+  SweepEngine e;
+  uint64_t planFails = 0;
+  double w0 = nowSec();
+  for (uint32_t s = 0; s < cfg.sweeps; s++) {
+    csvSweep = s;
+    sweepBegin(e, cfg.plan, table, 0);
+    while (sweepStep(e)) {}
+    planFails += e.stats.plan_fail;
+  }
+  double wall = nowSec() - w0;
+  if (csv) fclose(csv);
+
+  if (cfg.out_path) {
+    FILE *f = fopen(cfg.out_path, "wb");
+    if (!f || fwrite(stored.data(), sizeof(ResultPage), stored.size(), f) != stored.size()) {
+      fprintf(stderr, "can't write %s\n", cfg.out_path);
+      return 2;
+    }
+    fclose(f);
+  }
+
+  double virt = vNow_ns * 1e-9;
+  printf("%u sweep%s x %u points: %.3f s on the bench clock, %.3f s here (%.0fx real time), "
+         "%.0f points/s\n",
+         cfg.sweeps, cfg.sweeps == 1 ? "" : "s", cfg.points, virt, wall,
+         wall > 0 ? virt / wall : 0.0, wall > 0 ? stats.points / wall : 0.0);
+  printf("per point %.1f us (dwell %u) | %llu pages, %llu erases, %llu checkpoints | "
+         "%llu unplannable\n",
+         stats.points ? vNow_ns / 1000 / stats.points : 0.0, cfg.dwell_us,
+         (unsigned long long)stats.pages, (unsigned long long)stats.erases,
+         (unsigned long long)stats.checkpoints, (unsigned long long)planFails);
+  printf("synth: %llu words, planner error max %.3f Hz | readings started muted %llu, "
+         "unsettled (>1 kHz off) %llu\n",
+         (unsigned long long)synth.words, stats.plan_err_max_hz,
+         (unsigned long long)stats.muted, (unsigned long long)stats.unsettled);
+  return 0;
+}
+
+// ============================================================================
+// main
+// ============================================================================
+static void usage() {
+  fprintf(stderr,
+    "usage: lab_twin [options]\n"
+    " sweep:     --start-hz HZ --step-hz HZ --points N --dwell-us US --sweeps N\n"
+    "            --pfd-hz HZ --chan-step-hz HZ --rfouta\n"
+    " track:     --track SECONDS --probe-step-hz HZ --probes N --acquire-span-hz HZ\n"
+    "            --acquire-points N --alpha-q8 A --beta-q8 B\n"
+    " sample:    --res F0_HZ,Q,DEPTH[,FANO_RAD] (repeatable; default 10.25e9,2000,0.7)\n"
+    "            --shift-hz-per-s R   --baseline-db-per-ghz S\n"
+    " synth:     --out-dbm P --autocal-us US --lock-base-us US --lock-us-per-mhz US\n"
+    " receiver:  --path-loss-db L --det-mv-per-uw R --gain G --vsat V --knee K --hard-clip\n"
+    "            --amp-tau-us US --noise-uv UV --adc-divider D --adc-noise-lsb N --adc-avg N\n"
+    " timing:    --spi-hz HZ --adc-read-us US\n"
+    " output:    -o results.bin  --csv file.csv  --seed N\n");
+}
+
+int main(int argc, char **argv) {
+  for (int i = 1; i < argc; i++) {
+    std::string a = argv[i];
+    auto next = [&]() -> const char * {
+      if (i + 1 >= argc) { usage(); exit(2); }
+      return argv[++i];
+    };
+    auto num = [&]() { return atof(next()); };
+    if      (a == "--start-hz")        cfg.start_hz = (uint64_t)num();
+    else if (a == "--step-hz")         cfg.step_hz = (uint64_t)num();
+    else if (a == "--points")          cfg.points = (uint32_t)num();
+    else if (a == "--dwell-us")        cfg.dwell_us = (uint32_t)num();
+    else if (a == "--sweeps")          cfg.sweeps = (uint32_t)num();
+    else if (a == "--pfd-hz")          cfg.plan.pfd_hz = (uint32_t)num();
+    else if (a == "--chan-step-hz")    cfg.plan.chan_step_hz = (uint32_t)num();
+    else if (a == "--rfouta")          cfg.plan.use_rfoutb = false;
+    else if (a == "--track")           cfg.track_s = num();
+    else if (a == "--probe-step-hz")   cfg.probe_step_hz = (uint32_t)num();
+    else if (a == "--probes")          cfg.probes = (uint8_t)num();
+    else if (a == "--acquire-span-hz") cfg.acquire_span_hz = (uint32_t)num();
+    else if (a == "--acquire-points")  cfg.acquire_points = (uint16_t)num();
+    else if (a == "--alpha-q8")        cfg.alpha_q8 = (uint8_t)num();
+    else if (a == "--beta-q8")         cfg.beta_q8 = (uint8_t)num();
+    else if (a == "--res") {
+      Resonance r = { 0, 0, 0, 0 };
+      if (sscanf(next(), "%lf,%lf,%lf,%lf", &r.f0_hz, &r.q, &r.depth, &r.fano) < 3 || r.q <= 0) {
+        usage();
+        return 2;
+      }
+      cfg.res.push_back(r);
+    }
+    else if (a == "--shift-hz-per-s")  cfg.shift_hz_per_s = num();
+    else if (a == "--baseline-db-per-ghz") cfg.baseline_slope_db_per_ghz = num();
+    else if (a == "--out-dbm")         cfg.out_dbm = num();
+    else if (a == "--autocal-us")      cfg.autocal_us = num();
+    else if (a == "--lock-base-us")    cfg.lock_base_us = num();
+    else if (a == "--lock-us-per-mhz") cfg.lock_per_mhz = num();
+    else if (a == "--path-loss-db")    cfg.path_loss_db = num();
+    else if (a == "--det-mv-per-uw")   cfg.det_mv_per_uw = num();
+    else if (a == "--gain")            cfg.amp_gain = num();
+    else if (a == "--vsat")            cfg.amp_vsat = num();
+    else if (a == "--knee")            cfg.amp_knee = num();
+    else if (a == "--hard-clip")       cfg.hard_clip = true;
+    else if (a == "--amp-tau-us")      cfg.amp_tau_us = num();
+    else if (a == "--noise-uv")        cfg.noise_uv = num();
+    else if (a == "--adc-divider")     cfg.adc_divider = num();
+    else if (a == "--adc-noise-lsb")   cfg.adc_noise_lsb = num();
+    else if (a == "--adc-avg")         cfg.adc_avg = (int)num();
+    else if (a == "--spi-hz")          cfg.spi_hz = num();
+    else if (a == "--adc-read-us")     cfg.adc_read_us = num();
+    else if (a == "-o")                cfg.out_path = next();
+    else if (a == "--csv")             cfg.csv_path = next();
+    else if (a == "--seed")            cfg.seed = (uint64_t)num();
+    else { usage(); return 2; }
+  }
+  if (!cfg.points || !cfg.sweeps || !cfg.step_hz || cfg.adc_avg <= 0) { usage(); return 2; }
+  return run();
+}
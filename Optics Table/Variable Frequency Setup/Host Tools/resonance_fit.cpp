@@ -0,0 +1,696 @@
+// ============================================================================
+// Resonance extraction over many sweeps (host, multi-threaded)
+// ============================================================================
+//
+// Reads sweep results in the board's binary formats, splits them into
+// sweeps (a new sweep starts whenever the point index goes back down), and
+// fits each one with a Lorentzian -- or a Fano line shape with --fano --
+// on a linear baseline. One CSV row per sweep, written in sweep order as
+// soon as it and everything before it is done:
+//   sweep,points,f0_hz,fwhm_hz,q,depth,amp,fano_q,rms,iters,status
+//
+// Build (from this folder):
+//   g++ -O3 -march=native -std=c++17 -Wall -pthread -I.. resonance_fit.cpp -o resonance_fit
+//
+// Inputs:
+//   resonance_fit results.bin --start-hz 10e9 --step-hz 10e3     flash result pages
+//   resonance_fit --stream capture.bin --start-hz 10e9 ...      stream_codec capture
+// Without --start-hz/--step-hz the x axis is the point index (f0/fwhm in
+// points, q then means nothing).
+//
+// Sweeps are fitted independently, so they go to a work-stealing pool:
+// the reader deals them round-robin into per-thread queues and an idle
+// thread takes from the back of a busy one's. The model/Jacobian pass is
+// branch-free over padded arrays and the sums use fixed lanes, so -O3
+// -march=native vectorises both without -ffast-math.
+//
+// resonance_fit --bench [sweeps] [points] fits synthetic sweeps at 1, 2, 4
+// ... threads and prints throughput and scaling.
+
+#include <fcntl.h>
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "result_page.h"
+#include "stream_codec.h"
+
+static double nowSec() {
+  timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+// ============================================================================
+// Settings
+// ============================================================================
+static constexpr size_t LANES       = 8;     // partial sums per reduction
+static constexpr int    MAXP        = 6;
+static constexpr int    MAX_ITERS   = 60;
+static constexpr uint32_t MIN_POINTS = 8;
+
+struct FitConfig {
+  double start_hz = 0;
+  double step_hz  = 0;           // 0 = x is the point index
+  bool   fano     = false;
+  int    channel  = 0;           // stream captures with several channels
+  unsigned threads = 0;          // 0 = all cores
+};
+
+// ============================================================================
+// Sweeps and fits
+// ============================================================================
+struct Sweep {
+  uint64_t id = 0;
+  std::vector<double> x, y;
+};
+
+struct Fit {
+  uint64_t id = 0;
+  uint32_t points = 0;
+  double f0 = 0, fwhm = 0, q = 0, depth = 0, amp = 0, fano_q = 0, rms = 0;
+  int iters = 0;
+  const char *status = "ok";
+};
+
+// Parameters, in normalised units: u = (x - xc) / xs, y / ys
+enum { P_F0, P_G, P_A, P_B0, P_B1, P_Q };
+
+// Per-thread scratch, reused across sweeps
+struct Scratch {
+  size_t npad = 0;
+  std::vector<double> u, y, w, r, J;      // J: MAXP columns of npad
+  std::vector<double> tmp;
+
+  void resize(size_t n) {
+    npad = (n + LANES - 1) / LANES * LANES;
+    u.assign(npad, 0.0);
+    y.assign(npad, 0.0);
+    w.assign(npad, 0.0);                  // 0 on the padding
+    r.resize(npad);
+    J.resize(MAXP * npad);
+  }
+  double *col(int k) { return J.data() + k * npad; }
+};
+
+// ----------------------------------------------------------------------------
+// Model: y = b0 + b1 u - A (1 - G),  G = (q + e)^2 / ((1 + q^2)(1 + e^2)),
+// e = (u - f0) / g. At q = 0, 1 - G is the Lorentzian 1 / (1 + e^2), so the
+// Lorentz fit is the Fano fit with q held at zero. A > 0 is a dip.
+// ----------------------------------------------------------------------------
+static inline double laneSum(const double *acc) {
+  double s = 0;
+  for (size_t k = 0; k < LANES; k++) s += acc[k];
+  return s;
+}
+
+static double dotLanes(const double *a, const double *b, size_t n) {
+  double acc[LANES] = {};
+  for (size_t i = 0; i < n; i += LANES)
+    for (size_t k = 0; k < LANES; k++) acc[k] += a[i + k] * b[i + k];
+  return laneSum(acc);
+}
+
+// Residuals (and Jacobian columns with JAC) for every point; returns the
+// sum of squares. Padding points have w = 0 and contribute nothing.
+template <bool FANO, bool JAC>
+static double evalModel(const double *p, Scratch &s) {
+  const double f0 = p[P_F0], g = p[P_G], A = p[P_A], b0 = p[P_B0], b1 = p[P_B1];
+  const double q = FANO ? p[P_Q] : 0.0;
+  const double ig = 1.0 / g, iq = 1.0 / (1.0 + q * q);
+  const double *u = s.u.data(), *y = s.y.data(), *w = s.w.data();
+  double *r = s.r.data();
+  double *jf = s.col(P_F0), *jg = s.col(P_G), *ja = s.col(P_A);
+  double *j0 = s.col(P_B0), *j1 = s.col(P_B1), *jq = s.col(P_Q);
+  double acc[LANES] = {};
+
+  for (size_t i = 0; i < s.npad; i += LANES) {
+    for (size_t k = 0; k < LANES; k++) {
+      const size_t n = i + k;
+      const double e  = (u[n] - f0) * ig;
+      const double ie = 1.0 / (1.0 + e * e);
+      const double qe = q + e;
+      const double G  = qe * qe * iq * ie;
+      const double rn = w[n] * (b0 + b1 * u[n] - A * (1.0 - G) - y[n]);
+      r[n] = rn;
+      acc[k] += rn * rn;
+      if (JAC) {
+        const double c    = 2.0 * qe * (1.0 - q * e) * iq;  // dG/de = c ie^2, dG/dq = c ie iq
+        const double dGde = c * ie * ie;
+        jf[n] = -w[n] * A * dGde * ig;
+        jg[n] = -w[n] * A * dGde * e * ig;
+        ja[n] = w[n] * (G - 1.0);
+        j0[n] = w[n];
+        j1[n] = w[n] * u[n];
+        if (FANO) jq[n] = w[n] * A * c * ie * iq;
+      }
+    }
+  }
+  return laneSum(acc);
+}
+
+// Cholesky solve of the (small, SPD) damped normal equations
+static bool solveSpd(double M[MAXP][MAXP], const double *b, double *x, int n) {
+  double L[MAXP][MAXP] = {};
+  for (int i = 0; i < n; i++) {
+    for (int j = 0; j <= i; j++) {
+      double s = M[i][j];
+      for (int k = 0; k < j; k++) s -= L[i][k] * L[j][k];
+      if (i == j) {
+        if (!(s > 0)) return false;
+        L[i][i] = sqrt(s);
+      } else {
+        L[i][j] = s / L[j][j];
+      }
+    }
+  }
+  double z[MAXP];
+  for (int i = 0; i < n; i++) {
+    double s = b[i];
+    for (int k = 0; k < i; k++) s -= L[i][k] * z[k];
+    z[i] = s / L[i][i];
+  }
+  for (int i = n - 1; i >= 0; i--) {
+    double s = z[i];
+    for (int k = i + 1; k < n; k++) s -= L[k][i] * x[k];
+    x[i] = s / L[i][i];
+  }
+  return true;
+}
+
+// Levenberg-Marquardt; p is updated in place. Returns iterations, or -1 if
+// it ran out without converging.
+template <bool FANO>
+static int levmar(double *p, Scratch &s, double *costOut) {
+  const int np = FANO ? 6 : 5;
+  double cost = evalModel<FANO, true>(p, s);
+  double lambda = 1e-3;
+
+  for (int it = 1; it <= MAX_ITERS; it++) {
+    double H[MAXP][MAXP], grad[MAXP];
+    for (int a = 0; a < np; a++) {
+      grad[a] = dotLanes(s.col(a), s.r.data(), s.npad);
+      for (int b = 0; b <= a; b++) H[a][b] = H[b][a] = dotLanes(s.col(a), s.col(b), s.npad);
+    }
+
+    bool accepted = false;
+    double trial[MAXP], c2 = cost;
+    while (!accepted && lambda < 1e12) {
+      double M[MAXP][MAXP], d[MAXP], neg[MAXP];
+      for (int a = 0; a < np; a++) {
+        for (int b = 0; b < np; b++) M[a][b] = H[a][b];
+        M[a][a] = H[a][a] * (1.0 + lambda) + 1e-30;
+        neg[a] = -grad[a];
+      }
+      if (!solveSpd(M, neg, d, np)) { lambda *= 10; continue; }
+      for (int a = 0; a < np; a++) trial[a] = p[a] + d[a];
+      trial[P_G] = fabs(trial[P_G]) + 1e-12;
+      c2 = evalModel<FANO, false>(trial, s);
+      if (c2 < cost) accepted = true;
+      else lambda *= 4;
+    }
+    if (!accepted) { *costOut = cost; return it; }       // at the minimum already
+
+    bool done = cost - c2 <= 1e-10 * cost + 1e-300;
+    memcpy(p, trial, sizeof(double) * np);
+    cost = evalModel<FANO, true>(p, s);
+    lambda = std::max(lambda * 0.3, 1e-12);
+    if (done) { *costOut = cost; return it; }
+  }
+  *costOut = cost;
+  return -1;
+}
+
+// Starting point from the data: median baseline, the biggest (smoothed)
+// excursion as the line centre, its half-height points for the width.
+static void initialGuess(Scratch &s, size_t n, double *p) {
+  s.tmp.assign(s.y.begin(), s.y.begin() + n);
+  std::nth_element(s.tmp.begin(), s.tmp.begin() + n / 2, s.tmp.end());
+  const double base = s.tmp[n / 2];
+  const double *y = s.y.data(), *u = s.u.data();
+
+  size_t k = 0;
+  double best = -1;
+  for (size_t i = 1; i + 1 < n; i++) {
+    double d = fabs(y[i - 1] + y[i] + y[i + 1] - 3 * base);
+    if (d > best) { best = d; k = i; }
+  }
+  const double A = base - (y[k - 1] + y[k] + y[k + 1]) / 3;
+  size_t lo = k, hi = k;
+  while (lo > 0 && fabs(y[lo] - base) > fabs(A) / 2) lo--;
+  while (hi + 1 < n && fabs(y[hi] - base) > fabs(A) / 2) hi++;
+  const double du = (u[n - 1] - u[0]) / (n - 1);
+
+  p[P_F0] = u[k];
+  p[P_G]  = std::max((u[hi] - u[lo]) / 2, du);
+  p[P_A]  = A;
+  p[P_B0] = base;
+  p[P_B1] = 0;
+  p[P_Q]  = 0;
+}
+
+static Fit fitSweep(const Sweep &sw, bool fano, Scratch &s) {
+  Fit f;
+  f.id = sw.id;
+  f.points = (uint32_t)sw.x.size();
+  const size_t n = sw.x.size();
+  if (n < MIN_POINTS) { f.status = "short"; return f; }
+
+  const double x0 = sw.x.front(), x1 = sw.x.back();
+  const double xc = (x0 + x1) / 2, xs = (x1 != x0) ? (x1 - x0) / 2 : 1.0;
+  double ys = 0;
+  for (double v : sw.y) ys = std::max(ys, fabs(v));
+  if (ys == 0) ys = 1;
+
+  s.resize(n);
+  for (size_t i = 0; i < n; i++) {
+    s.u[i] = (sw.x[i] - xc) / xs;
+    s.y[i] = sw.y[i] / ys;
+    s.w[i] = 1.0;
+  }
+
+  double p[MAXP], cost = 0;
+  initialGuess(s, n, p);
+  int it = levmar<false>(p, s, &cost);
+  if (fano && it >= 0) {
+    int it2 = levmar<true>(p, s, &cost);
+    it = it2 < 0 ? -1 : it + it2;
+  }
+
+  f.iters = it < 0 ? MAX_ITERS : it;
+  f.f0 = xc + xs * p[P_F0];
+  f.fwhm = 2 * xs * p[P_G];
+  f.q = f.fwhm > 0 ? f.f0 / f.fwhm : 0;
+  f.amp = p[P_A] * ys;
+  f.depth = p[P_B0] != 0 ? p[P_A] / p[P_B0] : 0;
+  f.fano_q = fano ? p[P_Q] : 0;
+  f.rms = sqrt(cost / n) * ys;
+  if (it < 0) f.status = "maxiter";
+  else if (p[P_F0] < -1 || p[P_F0] > 1) f.status = "edge";   // centre outside the sweep
+  else if (!std::isfinite(f.f0) || !std::isfinite(f.fwhm)) f.status = "nofit";
+  return f;
+}
+
+// ============================================================================
+// Work-stealing pool
+// ============================================================================
+// Each worker owns a queue and takes from its front (sweep order, so the
+// ordered output drains steadily); an idle worker steals from the back of
+// the others. All queues share one counter so sleeping workers wake on
+// any push.
+struct StealQueue {
+  std::mutex m;
+  std::deque<Sweep *> d;
+};
+
+struct Pool {
+  std::vector<std::unique_ptr<StealQueue>> queues;
+  std::vector<std::thread> threads;
+  std::mutex m;
+  std::condition_variable cv;
+  std::atomic<size_t> queued{ 0 };
+  bool closing = false;
+  unsigned next = 0;
+  std::atomic<uint64_t> steals{ 0 };
+  std::function<void(unsigned, Sweep *)> work;
+};
+
+static Sweep *poolTake(Pool &p, unsigned self) {
+  const unsigned n = (unsigned)p.queues.size();
+  {
+    StealQueue &q = *p.queues[self];
+    std::lock_guard<std::mutex> lk(q.m);
+    if (!q.d.empty()) {
+      Sweep *s = q.d.front();
+      q.d.pop_front();
+      p.queued--;
+      return s;
+    }
+  }
+  for (unsigned k = 1; k < n; k++) {
+    StealQueue &q = *p.queues[(self + k) % n];
+    std::lock_guard<std::mutex> lk(q.m);
+    if (!q.d.empty()) {
+      Sweep *s = q.d.back();
+      q.d.pop_back();
+      p.queued--;
+      p.steals++;
+      return s;
+    }
+  }
+  return nullptr;
+}
+
+static void poolWorker(Pool &p, unsigned self) {
+  for (;;) {
+    Sweep *s = poolTake(p, self);
+    if (s) { p.work(self, s); continue; }
+    std::unique_lock<std::mutex> lk(p.m);
+    p.cv.wait(lk, [&] { return p.queued.load() > 0 || p.closing; });
+    if (p.closing && p.queued.load() == 0) return;
+  }
+}
+
+static void poolStart(Pool &p, unsigned n, std::function<void(unsigned, Sweep *)> work) {
+  p.work = std::move(work);
+  for (unsigned i = 0; i < n; i++) p.queues.emplace_back(new StealQueue);
+  for (unsigned i = 0; i < n; i++) p.threads.emplace_back(poolWorker, std::ref(p), i);
+}
+
+static void poolPush(Pool &p, Sweep *s) {
+  StealQueue &q = *p.queues[p.next++ % p.queues.size()];
+  {
+    // Counted before it's takeable, so a taker's queued-- never wraps
+    std::lock_guard<std::mutex> lk(p.m);      // pairs with the wait predicate
+    p.queued++;
+  }
+  {
+    std::lock_guard<std::mutex> lk(q.m);
+    q.d.push_back(s);
+  }
+  p.cv.notify_one();
+}
+
+static void poolFinish(Pool &p) {
+  {
+    std::lock_guard<std::mutex> lk(p.m);
+    p.closing = true;
+  }
+  p.cv.notify_all();
+  for (std::thread &t : p.threads) t.join();
+}
+
+// ============================================================================
+// Ordered output with a bound on sweeps in flight
+// ============================================================================
+struct Output {
+  FILE *csv = nullptr;
+  std::mutex m;
+  std::condition_variable cv;
+  std::map<uint64_t, Fit> done;       // finished but waiting for an earlier one
+  uint64_t next = 0;
+  uint64_t inFlight = 0;
+  uint64_t written = 0;
+  uint64_t bad = 0;
+};
+
+static void outputHeader(Output &o) {
+  if (o.csv) fprintf(o.csv, "sweep,points,f0_hz,fwhm_hz,q,depth,amp,fano_q,rms,iters,status\n");
+}
+
+static void outputAdd(Output &o, const Fit &f) {
+  std::lock_guard<std::mutex> lk(o.m);
+  o.done[f.id] = f;
+  for (auto it = o.done.begin(); it != o.done.end() && it->first == o.next; it = o.done.erase(it)) {
+    const Fit &r = it->second;
+    if (o.csv) {
+      fprintf(o.csv, "%llu,%u,%.3f,%.3f,%.2f,%.5f,%.6g,%.4f,%.4g,%d,%s\n",
+              (unsigned long long)r.id, r.points, r.f0, r.fwhm, r.q, r.depth, r.amp, r.fano_q,
+              r.rms, r.iters, r.status);
+    }
+    if (strcmp(r.status, "ok")) o.bad++;
+    o.next++;
+    o.written++;
+    o.inFlight--;
+  }
+  o.cv.notify_all();
+}
+
+// Reader side: blocks while too many sweeps are queued or waiting to print
+static void outputReserve(Output &o, uint64_t limit) {
+  std::unique_lock<std::mutex> lk(o.m);
+  o.cv.wait(lk, [&] { return o.inFlight < limit; });
+  o.inFlight++;
+}
+
+// ============================================================================
+// Readers: points in file order, split into sweeps on an index reset
+// ============================================================================
+struct Splitter {
+  const FitConfig *cfg;
+  std::function<void(Sweep *)> emit;
+  Sweep *cur = nullptr;
+  int64_t lastIndex = -1;
+  uint64_t nextId = 0;
+  uint64_t points = 0;
+};
+
+static void splitFlush(Splitter &sp) {
+  if (sp.cur && !sp.cur->x.empty()) sp.emit(sp.cur);
+  else delete sp.cur;
+  sp.cur = nullptr;
+}
+
+static void splitPoint(Splitter &sp, uint32_t index, double y) {
+  if (!sp.cur || (int64_t)index <= sp.lastIndex) {
+    splitFlush(sp);
+    sp.cur = new Sweep;
+    sp.cur->id = sp.nextId++;
+  }
+  sp.lastIndex = index;
+  double x = sp.cfg->step_hz ? sp.cfg->start_hz + sp.cfg->step_hz * index : (double)index;
+  sp.cur->x.push_back(x);
+  sp.cur->y.push_back(y);
+  sp.points++;
+}
+
+struct Mapped {
+  const uint8_t *p = nullptr;
+  size_t n = 0;
+};
+
+static bool mapFile(const char *path, Mapped &m) {
+  int fd = open(path, O_RDONLY);
+  if (fd < 0) { fprintf(stderr, "can't open %s\n", path); return false; }
+  struct stat st;
+  fstat(fd, &st);
+  m.n = (size_t)st.st_size;
+  if (m.n) {
+    void *a = mmap(nullptr, m.n, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (a == MAP_FAILED) { close(fd); fprintf(stderr, "can't map %s\n", path); return false; }
+    madvise(a, m.n, MADV_SEQUENTIAL);
+    m.p = (const uint8_t *)a;
+  }
+  close(fd);
+  return true;
+}
+
+// Flash result pages; erased/torn pages fail the CRC and are skipped,
+// 0xFFFFFFFF samples (unplannable points) are left out of the fit.
+//
+// Pages written after the last checkpoint are written again after a reset
+// (flash_log.h), so a sweep can hold the same first_index twice: the newest
+// copy wins and the stale pages after the old one go with it
+// (resultPagesCurrent, shared with sweep_store). Index 0 starts the next
+// sweep.
+static uint64_t readResultPages(const Mapped &m, Splitter &sp) {
+  const ResultPage *pages = (const ResultPage *)m.p;
+  uint32_t n = (uint32_t)(m.n / sizeof(ResultPage));
+  std::vector<uint8_t> keep((n + 7) / 8);
+  uint64_t badPages = resultPagesCurrent(pages, n, keep.data());
+  for (uint32_t i = 0; i < n; i++) {
+    if (!resultPageKept(keep.data(), i)) continue;
+    const ResultPage &pg = pages[i];
+    for (uint32_t k = 0; k < pg.count; k++)
+      if (pg.samples[k] != 0xFFFFFFFFu) splitPoint(sp, pg.first_index + k, pg.samples[k]);
+  }
+  return badPages;
+}
+
+static uint64_t readStreamCapture(const Mapped &m, Splitter &sp, int channel) {
+  static uint32_t index[STREAM_PAYLOAD_MAX];
+  static uint64_t t_us[STREAM_PAYLOAD_MAX];
+  static int32_t  amp[STREAM_PAYLOAD_MAX * STREAM_MAX_CH];
+  uint64_t bad = 0;
+  size_t pos = 0;
+  while (pos < m.n) {
+    const uint8_t *mg = (const uint8_t *)memchr(m.p + pos, (uint8_t)STREAM_MAGIC, m.n - pos);
+    if (!mg) break;
+    pos = (size_t)(mg - m.p);
+    uint32_t len = 0;
+    if (streamCheckBlock(m.p + pos, m.n - pos, &len) != STREAM_BLOCK_OK) { pos++; continue; }
+    StreamBlockHeader h;
+    memcpy(&h, m.p + pos, sizeof(h));
+    int k = streamDecodeBlock(m.p + pos, index, t_us, amp);
+    pos += len;
+    if (k < 0 || channel >= h.channels) { bad++; continue; }
+    double scale = 1.0 / (double)(1u << h.amp_frac_bits);
+    for (int i = 0; i < k; i++) splitPoint(sp, index[i], amp[i * h.channels + channel] * scale);
+  }
+  return bad;
+}
+
+// ============================================================================
+// Benchmark
+// ============================================================================
+// Known lines on a sloped baseline with Gaussian noise; truth[] gets the
+// centre of each so the bench can report accuracy as well as speed.
+static void synthSweeps(std::vector<Sweep> &out, std::vector<double> &truth, uint32_t sweeps,
+                        uint32_t points, bool fano) {
+  uint32_t rng = 987654321u;
+  auto uni = [&]() { rng = rng * 1664525u + 1013904223u; return (rng >> 8) * (1.0 / 16777216.0); };
+  auto gauss = [&]() { return sqrt(-2 * log(uni() + 1e-12)) * cos(2 * M_PI * uni()); };
+  out.resize(sweeps);
+  truth.resize(sweeps);
+  for (uint32_t s = 0; s < sweeps; s++) {
+    Sweep &sw = out[s];
+    sw.id = s;
+    const double start = 10e9, step = 10e3;
+    const double f0 = start + step * points * (0.3 + 0.4 * uni());
+    const double hw = step * points * (0.01 + 0.04 * uni());
+    const double depth = 0.3 + 0.6 * uni(), q = fano ? 0.5 * (uni() - 0.5) : 0.0;
+    truth[s] = f0;
+    sw.x.resize(points);
+    sw.y.resize(points);
+    for (uint32_t i = 0; i < points; i++) {
+      double x = start + step * i, e = (x - f0) / hw;
+      double G = (q + e) * (q + e) / ((1 + q * q) * (1 + e * e));
+      sw.x[i] = x;
+      sw.y[i] = 20000 * (1 - depth * (1 - G)) + 1e-6 * (x - start) + 60 * gauss();
+    }
+  }
+}
+
+static int bench(uint32_t sweeps, uint32_t points, bool fano) {
+  std::vector<Sweep> data;
+  std::vector<double> truth;
+  synthSweeps(data, truth, sweeps, points, fano);
+  unsigned hw = std::max(1u, std::thread::hardware_concurrency());
+  printf("%u sweeps x %u points, %s, %u hardware threads\n", sweeps, points,
+         fano ? "Fano" : "Lorentz", hw);
+
+  std::vector<unsigned> counts;
+  for (unsigned t = 1; t < hw; t *= 2) counts.push_back(t);
+  counts.push_back(hw);
+
+  double base = 0;
+  for (unsigned t : counts) {
+    std::vector<Scratch> scratch(t);
+    std::vector<Fit> fits(sweeps);
+    Pool p;
+    double t0 = nowSec();
+    poolStart(p, t, [&](unsigned self, Sweep *s) { fits[s->id] = fitSweep(*s, fano, scratch[self]); });
+    for (Sweep &s : data) poolPush(p, &s);
+    poolFinish(p);
+    double sec = nowSec() - t0;
+    if (t == 1) base = sec;
+
+    std::vector<double> err;
+    uint32_t bad = 0;
+    for (uint32_t i = 0; i < sweeps; i++) {
+      if (strcmp(fits[i].status, "ok")) bad++;
+      err.push_back(fabs(fits[i].f0 - truth[i]) / fits[i].fwhm);
+    }
+    std::nth_element(err.begin(), err.begin() + err.size() / 2, err.end());
+    printf("%3u threads: %8.0f sweeps/s  %6.2f M points/s  speedup %5.2fx  (%llu steals, "
+           "median |f0 err| %.2g fwhm, %u not ok)\n",
+           t, sweeps / sec, (double)sweeps * points / sec / 1e6, base / sec,
+           (unsigned long long)p.steals.load(), err[err.size() / 2], bad);
+  }
+  return 0;
+}
+
+// ============================================================================
+// main
+// ============================================================================
+static void usage() {
+  fprintf(stderr,
+    "usage: resonance_fit [options] <results.bin>\n"
+    "       resonance_fit [options] --stream <capture>\n"
+    "       resonance_fit --bench [sweeps] [points] [--fano]\n"
+    "  --start-hz HZ   frequency of point index 0\n"
+    "  --step-hz HZ    table step\n"
+    "  --fano          fit a Fano line shape (default Lorentzian)\n"
+    "  --channel N     amplitude channel of a stream capture (default 0)\n"
+    "  -j N            threads (default: all cores)\n"
+    "  --csv FILE      write fits here instead of stdout\n");
+}
+
+int main(int argc, char **argv) {
+  FitConfig cfg;
+  const char *inPath = nullptr;
+  const char *csvPath = nullptr;
+  bool stream = false, benchMode = false;
+  std::vector<uint32_t> benchArgs;
+
+  for (int i = 1; i < argc; i++) {
+    std::string a = argv[i];
+    auto next = [&]() -> const char * {
+      if (i + 1 >= argc) { usage(); exit(2); }
+      return argv[++i];
+    };
+    if      (a == "--bench")    benchMode = true;
+    else if (a == "--start-hz") cfg.start_hz = atof(next());
+    else if (a == "--step-hz")  cfg.step_hz = atof(next());
+    else if (a == "--fano")     cfg.fano = true;
+    else if (a == "--channel")  cfg.channel = atoi(next());
+    else if (a == "-j")         cfg.threads = (unsigned)atoi(next());
+    else if (a == "--csv")      csvPath = next();
+    else if (a == "--stream")   { stream = true; inPath = next(); }
+    else if (a[0] == '-' && a.size() > 1) { usage(); return 2; }
+    else if (benchMode)         benchArgs.push_back((uint32_t)atof(argv[i]));
+    else inPath = argv[i];
+  }
+  if (benchMode) {
+    return bench(benchArgs.size() > 0 ? benchArgs[0] : 20000,
+                 benchArgs.size() > 1 ? benchArgs[1] : 1000, cfg.fano);
+  }
+  if (!inPath) { usage(); return 2; }
+
+  Mapped in;
+  if (!mapFile(inPath, in)) return 2;
+
+  Output o;
+  o.csv = csvPath ? fopen(csvPath, "w") : stdout;
+  if (!o.csv) { fprintf(stderr, "can't write %s\n", csvPath); return 2; }
+  outputHeader(o);
+
+  unsigned threads = cfg.threads ? cfg.threads : std::max(1u, std::thread::hardware_concurrency());
+  std::vector<Scratch> scratch(threads);
+  Pool pool;
+  poolStart(pool, threads, [&](unsigned self, Sweep *s) {
+    Fit f = fitSweep(*s, cfg.fano, scratch[self]);
+    delete s;
+    outputAdd(o, f);
+  });
+
+  Splitter sp;
+  sp.cfg = &cfg;
+  sp.emit = [&](Sweep *s) {
+    outputReserve(o, threads * 16);
+    poolPush(pool, s);
+  };
+
+  double t0 = nowSec();
+  uint64_t bad = stream ? readStreamCapture(in, sp, cfg.channel) : readResultPages(in, sp);
+  splitFlush(sp);
+  poolFinish(pool);
+  double sec = nowSec() - t0;
+
+  if (o.csv != stdout) fclose(o.csv);
+  else fflush(stdout);
+  if (in.p) munmap((void *)in.p, in.n);
+
+  fprintf(stderr, "%llu sweeps, %llu points, %llu not ok, %llu bad %s | %u threads, "
+                  "%llu steals | %.2f s, %.0f sweeps/s\n",
+          (unsigned long long)o.written, (unsigned long long)sp.points, (unsigned long long)o.bad,
+          (unsigned long long)bad, stream ? "blocks" : "pages", threads,
+          (unsigned long long)pool.steals.load(), sec, sec > 0 ? o.written / sec : 0.0);
+  return 0;
+}
@@ -0,0 +1,500 @@
+// ============================================================================
+// Sequencer assembler / simulator / uploader (sequencer.h programs)
+// ============================================================================
+//
+// Build (from this folder):
+//   g++ -O2 -std=c++17 -Wall -I.. seq_asm.cpp -o seq_asm
+//
+//   seq_asm prog.s                      listing (address, op, source line)
+//   seq_asm prog.s -o prog.seq          write the image
+//   seq_asm prog.s --sim [--trace N]    run it against fake hardware
+//   seq_asm prog.s --port /dev/ttyACM0  upload to Sequencer_Sketch
+//
+// Syntax: one op per line, "label:" in front, ';' or '#' comments. Registers
+// r0..r15; numbers may be 10.5e9, 0x1F, -3. Frequencies and anything else
+// that doesn't fit an int32 immediate go in the constant pool on their own.
+//
+//   const f_start 10.0e9          ; named pool constant
+//   tune  10.5e9 | tune f_start   ; planned at load
+//   tune_r r1                     ; planned at run time (cached)
+//   key   on | off
+//   wait  200                     ; us
+//   wait_r r2
+//   waitlock r3, 1000             ; r3 = us to lock, -1 after 1000 us
+//   acq   r4, 0, 16               ; r4 = 16 samples of channel 0
+//   ldi   r1, 5        ldk r1, f_start        mov r1, r2
+//   add   r1, r2, r3   sub r1, r2, r3
+//   addi  r1, r2, 5000000        muli r1, r2, 3        shri r1, r2, 4
+//   jmp   label
+//   jlt/jle/jeq/jne/jge/jgt r1, r2, label
+//   loop  r1, label               ; --r1, jump while > 0
+//   emit  r1, 7                   ; tag 7
+//   time  r1
+//   halt
+//
+// Example -- coarse scan for the deepest point, then park on it:
+//
+//           key   on
+//           ldk   r1, 10.0e9
+//           ldi   r2, 100
+//           ldi   r4, 0x7FFFFFFF
+//   scan:   tune_r r1
+//           waitlock r5, 500
+//           acq   r3, 0, 16
+//           emit  r3, 1
+//           jge   r3, r4, next
+//           mov   r4, r3
+//           mov   r6, r1
+//   next:   addi  r1, r1, 5000000
+//           loop  r2, scan
+//           tune_r r6
+//           waitlock r5, 500
+//           emit  r6, 2
+//           halt
+
+#include <fcntl.h>
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/select.h>
+#include <termios.h>
+#include <unistd.h>
+#include <map>
+#include <string>
+#include <vector>
+#include "sequencer.h"
+
+// ============================================================================
+// Assembler
+// ============================================================================
+struct AsmLine {
+  int line;
+  std::string text;
+  std::vector<std::string> tok;     // mnemonic + operands
+};
+
+struct Assembler {
+  std::vector<SeqOp> ops;
+  std::vector<uint64_t> consts;
+  std::vector<int> srcLine;                 // per op
+  std::map<std::string, uint16_t> labels;
+  std::map<std::string, uint64_t> named;
+  const char *path = "";
+  int errors = 0;
+};
+
+static void asmError(Assembler &a, int line, const char *fmt, const std::string &what) {
+  fprintf(stderr, "%s:%d: ", a.path, line);
+  fprintf(stderr, fmt, what.c_str());
+  fputc('\n', stderr);
+  a.errors++;
+}
+
+static std::vector<std::string> tokenize(const std::string &s) {
+  std::vector<std::string> out;
+  std::string cur;
+  for (char ch : s) {
+    if (ch == ',' || ch == ' ' || ch == '\t' || ch == '\r' || ch == '\n') {
+      if (!cur.empty()) out.push_back(cur);
+      cur.clear();
+    } else {
+      cur += ch;
+    }
+  }
+  if (!cur.empty()) out.push_back(cur);
+  return out;
+}
+
+static bool parseNumber(const std::string &s, double *out) {
+  char *end;
+  const char *p = s.c_str();
+  if (s.size() > 2 && s[0] == '0' && (s[1] == 'x' || s[1] == 'X')) *out = (double)strtoull(p, &end, 16);
+  else *out = strtod(p, &end);
+  return end != p && *end == 0;
+}
+
+static int parseReg(Assembler &a, const AsmLine &l, const std::string &s) {
+  if (s.size() >= 2 && (s[0] == 'r' || s[0] == 'R')) {
+    char *end;
+    long n = strtol(s.c_str() + 1, &end, 10);
+    if (*end == 0 && n >= 0 && n < SEQ_REGS) return (int)n;
+  }
+  asmError(a, l.line, "bad register '%s'", s);
+  return 0;
+}
+
+static int32_t parseImm(Assembler &a, const AsmLine &l, const std::string &s) {
+  double v;
+  if (!parseNumber(s, &v) || v != floor(v) || v < INT32_MIN || v > INT32_MAX) {
+    asmError(a, l.line, "bad 32-bit immediate '%s'", s);
+    return 0;
+  }
+  return (int32_t)v;
+}
+
+// Pool index for a literal or a named constant (shared if already there)
+static int32_t poolRef(Assembler &a, const AsmLine &l, const std::string &s) {
+  uint64_t v;
+  auto it = a.named.find(s);
+  if (it != a.named.end()) {
+    v = it->second;
+  } else {
+    double d;
+    if (!parseNumber(s, &d) || d < 0) { asmError(a, l.line, "bad constant '%s'", s); return 0; }
+    v = (uint64_t)llround(d);
+  }
+  for (size_t i = 0; i < a.consts.size(); i++) if (a.consts[i] == v) return (int32_t)i;
+  a.consts.push_back(v);
+  return (int32_t)a.consts.size() - 1;
+}
+
+static int32_t labelRef(Assembler &a, const AsmLine &l, const std::string &s) {
+  auto it = a.labels.find(s);
+  if (it != a.labels.end()) return it->second;
+  double v;
+  if (parseNumber(s, &v)) return (int32_t)v;        // absolute address
+  asmError(a, l.line, "unknown label '%s'", s);
+  return 0;
+}
+
+static void need(Assembler &a, const AsmLine &l, size_t n) {
+  if (l.tok.size() != n + 1) {
+    char msg[64];
+    snprintf(msg, sizeof(msg), "'%%s' takes %zu operand%s", n, n == 1 ? "" : "s");
+    asmError(a, l.line, msg, l.tok[0]);
+  }
+}
+
+static SeqOp assembleLine(Assembler &a, const AsmLine &l) {
+  SeqOp o = {};
+  const std::string &m = l.tok[0];
+  auto t = [&](size_t i) -> std::string { return i < l.tok.size() ? l.tok[i] : std::string("?"); };
+
+  for (int c = 0; c < SEQ_COND_COUNT; c++) {
+    if (m == std::string("j") + SEQ_COND_NAMES[c]) {
+      need(a, l, 3);
+      o.op = SEQ_JCMP;
+      o.a = parseReg(a, l, t(1));
+      o.b = parseReg(a, l, t(2));
+      o.c = c;
+      o.imm = labelRef(a, l, t(3));
+      return o;
+    }
+  }
+  int op = -1;
+  for (int i = 0; i < SEQ_OP_COUNT; i++) if (m == SEQ_OP_NAMES[i]) op = i;
+  if (op < 0 || op == SEQ_JCMP) { asmError(a, l.line, "unknown op '%s'", m); return o; }
+  o.op = (uint8_t)op;
+
+  switch (op) {
+    case SEQ_HALT: need(a, l, 0); break;
+    case SEQ_TUNE: need(a, l, 1); o.imm = poolRef(a, l, t(1)); break;
+    case SEQ_KEY:
+      need(a, l, 1);
+      if (t(1) == "on" || t(1) == "1") o.a = 1;
+      else if (t(1) != "off" && t(1) != "0") asmError(a, l.line, "key on|off, not '%s'", t(1));
+      break;
+    case SEQ_WAIT: need(a, l, 1); o.imm = parseImm(a, l, t(1)); break;
+    case SEQ_JMP:  need(a, l, 1); o.imm = labelRef(a, l, t(1)); break;
+    case SEQ_TUNE_R:
+    case SEQ_WAIT_R:
+    case SEQ_TIME: need(a, l, 1); o.a = parseReg(a, l, t(1)); break;
+    case SEQ_WAIT_LOCK:
+    case SEQ_LDI:
+    case SEQ_EMIT: need(a, l, 2); o.a = parseReg(a, l, t(1)); o.imm = parseImm(a, l, t(2)); break;
+    case SEQ_LDK:  need(a, l, 2); o.a = parseReg(a, l, t(1)); o.imm = poolRef(a, l, t(2)); break;
+    case SEQ_LOOP: need(a, l, 2); o.a = parseReg(a, l, t(1)); o.imm = labelRef(a, l, t(2)); break;
+    case SEQ_MOV:  need(a, l, 2); o.a = parseReg(a, l, t(1)); o.b = parseReg(a, l, t(2)); break;
+    case SEQ_ACQ:
+      need(a, l, 3);
+      o.a = parseReg(a, l, t(1));
+      o.b = (uint8_t)parseImm(a, l, t(2));
+      o.imm = parseImm(a, l, t(3));
+      break;
+    case SEQ_ADD:
+    case SEQ_SUB:
+      need(a, l, 3);
+      o.a = parseReg(a, l, t(1)); o.b = parseReg(a, l, t(2)); o.c = parseReg(a, l, t(3));
+      break;
+    default:      // ADDI, MULI, SHRI
+      need(a, l, 3);
+      o.a = parseReg(a, l, t(1)); o.b = parseReg(a, l, t(2)); o.imm = parseImm(a, l, t(3));
+      break;
+  }
+  return o;
+}
+
+static bool assembleFile(Assembler &a, const char *path, std::vector<AsmLine> &lines) {
+  a.path = path;
+  FILE *f = strcmp(path, "-") ? fopen(path, "r") : stdin;
+  if (!f) { fprintf(stderr, "can't open %s\n", path); return false; }
+
+  // Pass 1: labels, constants, one op per remaining line
+  char buf[512];
+  int lineNo = 0;
+  while (fgets(buf, sizeof(buf), f)) {
+    lineNo++;
+    std::string s = buf;
+    size_t c = s.find_first_of(";#");
+    std::string code = c == std::string::npos ? s : s.substr(0, c);
+    size_t colon = code.find(':');
+    if (colon != std::string::npos) {
+      std::vector<std::string> lt = tokenize(code.substr(0, colon));
+      if (lt.size() != 1) asmError(a, lineNo, "bad label '%s'", code.substr(0, colon));
+      else if (a.labels.count(lt[0])) asmError(a, lineNo, "label '%s' defined twice", lt[0]);
+      else a.labels[lt[0]] = (uint16_t)lines.size();
+      code = code.substr(colon + 1);
+    }
+    AsmLine l;
+    l.line = lineNo;
+    l.tok = tokenize(code);
+    if (l.tok.empty()) continue;
+    if (l.tok[0] == "const") {
+      double v;
+      if (l.tok.size() != 3 || !parseNumber(l.tok[2], &v) || v < 0) asmError(a, lineNo, "const <name> <value>%s", "");
+      else a.named[l.tok[1]] = (uint64_t)llround(v);
+      continue;
+    }
+    std::string t = s;
+    while (!t.empty() && (t.back() == '\n' || t.back() == '\r')) t.pop_back();
+    l.text = t;
+    lines.push_back(l);
+  }
+  if (f != stdin) fclose(f);
+
+  // Pass 2: encode
+  for (const AsmLine &l : lines) {
+    a.ops.push_back(assembleLine(a, l));
+    a.srcLine.push_back(l.line);
+  }
+  if (a.ops.empty()) { fprintf(stderr, "%s: no ops\n", path); a.errors++; }
+  if (a.ops.size() > SEQ_MAX_OPS) { fprintf(stderr, "%s: more than %u ops\n", path, SEQ_MAX_OPS); a.errors++; }
+  if (a.consts.size() > SEQ_MAX_CONSTS) { fprintf(stderr, "%s: more than %u constants\n", path, SEQ_MAX_CONSTS); a.errors++; }
+  return a.errors == 0;
+}
+
+static std::vector<uint8_t> buildImage(const Assembler &a) {
+  SeqHeader h = {};
+  h.magic = SEQ_MAGIC;
+  h.version = SEQ_VERSION;
+  h.n_ops = (uint16_t)a.ops.size();
+  h.n_consts = (uint16_t)a.consts.size();
+  std::vector<uint8_t> img(seqImageSize(h));
+  uint8_t *body = img.data() + sizeof(h);
+  memcpy(body, a.ops.data(), a.ops.size() * sizeof(SeqOp));
+  memcpy(body + a.ops.size() * sizeof(SeqOp), a.consts.data(), a.consts.size() * 8);
+  h.crc = crc16(body, img.size() - sizeof(h));
+  memcpy(img.data(), &h, sizeof(h));
+  return img;
+}
+
+// ============================================================================
+// Simulator: fake hardware behind the same hooks as the sketch
+// ============================================================================
+//
+// Virtual clock: every seqMicros() call is 1 us, a tune costs the SPI time,
+// lock comes SIM_LOCK_US after the last tune (only with the chip keyed on,
+// as CE powers it down on the board), and the receiver sees a Lorentzian
+// dip at SIM_F0_HZ.
+
+static constexpr uint32_t SIM_TUNE_US    = 70;        // 4 words at 1 MHz + LE pulses
+static constexpr uint32_t SIM_LOCK_US    = 120;
+static constexpr uint32_t SIM_SAMPLE_US  = 3;
+static constexpr double   SIM_F0_HZ      = 10.237e9;
+static constexpr double   SIM_HWHM_HZ    = 15e6;
+
+static uint32_t simNow = 0;
+static uint32_t simTunedAt = 0;
+static double   simFreq = 0;
+static bool     simKey = false;
+static uint32_t simRng = 1;
+static uint64_t simEmits = 0;
+static bool     simQuiet = false;
+
+static void seqTune(const PllPlan &p) {
+  simNow += SIM_TUNE_US;
+  simTunedAt = simNow;
+  simFreq = (double)p.rf_hz;
+}
+
+static void seqKey(bool on) { simKey = on; }
+
+static bool seqLocked() { return simKey && simNow - simTunedAt >= SIM_LOCK_US; }
+
+static int32_t seqAcquire(uint8_t channel, uint32_t samples) {
+  (void)channel;
+  simNow += samples * SIM_SAMPLE_US;
+  double e = (simFreq - SIM_F0_HZ) / SIM_HWHM_HZ;
+  double level = 3000.0 * (1.0 - 0.7 / (1.0 + e * e));
+  simRng = simRng * 1664525u + 1013904223u;
+  double noise = ((int32_t)(simRng >> 16) % 41) - 20;
+  return (int32_t)(samples * level + noise * sqrt((double)samples));
+}
+
+static void seqEmit(uint16_t tag, uint32_t t_us, int64_t value) {
+  simEmits++;
+  if (!simQuiet) printf("emit %u t=%lu value=%lld\n", tag, (unsigned long)t_us, (long long)value);
+}
+
+static uint32_t seqMicros() { return simNow++; }
+
+static bool seqAbortPending() { return false; }
+
+static SeqVm vm;
+
+static int simulate(const std::vector<uint8_t> &img, const PlanConfig &cfg, uint32_t traceN) {
+  const char *err = seqLoad(vm, cfg, img.data(), img.size());
+  if (err) { fprintf(stderr, "load: %s\n", err); return 1; }
+  vm.trace = traceN > 0;
+
+  SeqState st;
+  uint64_t slices = 0;
+  while ((st = seqRun(vm, 10000)) == SEQ_RUNNING) {
+    if (++slices > 100000) { fprintf(stderr, "still running after 1e9 ops, stopping\n"); break; }
+  }
+
+  static const char *names[] = { "empty", "ready", "running", "halted", "aborted", "fault" };
+  printf("%s at pc %u after %llu ops, %lu us virtual | plan cache %lu hits, %lu misses | "
+         "RF %s, %llu emits\n",
+         names[st], st == SEQ_FAULT ? vm.fault_pc : vm.pc, (unsigned long long)vm.opsRun,
+         (unsigned long)simNow, (unsigned long)vm.cacheHits, (unsigned long)vm.cacheMisses,
+         simKey ? "on" : "off", (unsigned long long)simEmits);
+
+  printf("op         count     total us   mean us   max us\n");
+  for (int i = 0; i < SEQ_OP_COUNT; i++) {
+    const SeqOpStats &s = vm.opStats[i];
+    if (!s.count) continue;
+    printf("%-9s %6lu %12llu %9.1f %8lu\n", SEQ_OP_NAMES[i], (unsigned long)s.count,
+           (unsigned long long)s.total_us, (double)s.total_us / s.count, (unsigned long)s.max_us);
+  }
+
+  if (traceN) {
+    uint32_t n = vm.traceCount < SEQ_TRACE_LEN ? vm.traceCount : SEQ_TRACE_LEN;
+    if (traceN < n) n = traceN;
+    printf("last %lu ops:\n      t_us    dt   pc  op                         value\n", (unsigned long)n);
+    for (uint32_t i = vm.traceCount - n; i != vm.traceCount; i++) {
+      const SeqTrace &t = vm.traceBuf[i & (SEQ_TRACE_LEN - 1)];
+      char txt[64];
+      seqFormatOp(&vm, vm.ops[t.pc], txt, sizeof(txt));
+      printf("%10lu %5lu %4u  %-26s %ld\n", (unsigned long)t.t_us, (unsigned long)t.dt_us, t.pc,
+             txt, (long)t.value);
+    }
+  }
+  return st == SEQ_HALTED ? 0 : 1;
+}
+
+// ============================================================================
+// Upload: 'u' + image on the sketch's serial port
+// ============================================================================
+static int upload(const char *port, const std::vector<uint8_t> &img) {
+  int fd = open(port, O_RDWR | O_NOCTTY);
+  if (fd < 0) { fprintf(stderr, "can't open %s\n", port); return 2; }
+  termios tio;
+  if (tcgetattr(fd, &tio) == 0) {
+    cfmakeraw(&tio);
+    cfsetspeed(&tio, B115200);
+    tcsetattr(fd, TCSANOW, &tio);
+  }
+  tcflush(fd, TCIOFLUSH);
+
+  std::vector<uint8_t> out;
+  out.push_back('u');
+  out.insert(out.end(), img.begin(), img.end());
+  size_t off = 0;
+  while (off < out.size()) {
+    ssize_t n = write(fd, out.data() + off, out.size() - off);
+    if (n <= 0) { fprintf(stderr, "write failed\n"); close(fd); return 2; }
+    off += (size_t)n;
+  }
+
+  // Echo the sketch's reply (one line, or whatever comes within a second)
+  std::string reply;
+  for (;;) {
+    fd_set rs;
+    FD_ZERO(&rs);
+    FD_SET(fd, &rs);
+    timeval tv = { 1, 0 };
+    if (select(fd + 1, &rs, nullptr, nullptr, &tv) <= 0) break;
+    char buf[256];
+    ssize_t n = read(fd, buf, sizeof(buf));
+    if (n <= 0) break;
+    reply.append(buf, n);
+    if (reply.find("\n") != std::string::npos) break;
+  }
+  close(fd);
+  if (reply.empty()) { fprintf(stderr, "no reply from %s\n", port); return 1; }
+  fputs(reply.c_str(), stdout);
+  return reply.compare(0, 6, "Loaded") == 0 ? 0 : 1;
+}
+
+// ============================================================================
+// main
+// ============================================================================
+static void usage() {
+  fprintf(stderr,
+    "usage: seq_asm <prog.s | -> [options]\n"
+    "  -o FILE         write the program image\n"
+    "  --sim           run on simulated hardware, print op timing\n"
+    "  --trace N       with --sim: print the last N ops (max %u)\n"
+    "  --quiet         with --sim: don't print emits\n"
+    "  --port DEV      upload to Sequencer_Sketch on this serial port\n"
+    "  --pfd-hz HZ / --step-hz HZ / --rfouta   planner settings (default 10e6 / 10e3 / RFOUTB)\n",
+    SEQ_TRACE_LEN);
+}
+
+int main(int argc, char **argv) {
+  const char *inPath = nullptr, *outPath = nullptr, *port = nullptr;
+  bool sim = false;
+  uint32_t traceN = 0;
+  PlanConfig cfg = { 10000000, 10000, true };
+
+  for (int i = 1; i < argc; i++) {
+    std::string a = argv[i];
+    auto next = [&]() -> const char * {
+      if (i + 1 >= argc) { usage(); exit(2); }
+      return argv[++i];
+    };
+    if      (a == "-o")        outPath = next();
+    else if (a == "--sim")     sim = true;
+    else if (a == "--trace")   traceN = (uint32_t)atoi(next());
+    else if (a == "--quiet")   simQuiet = true;
+    else if (a == "--port")    port = next();
+    else if (a == "--pfd-hz")  cfg.pfd_hz = (uint32_t)atof(next());
+    else if (a == "--step-hz") cfg.chan_step_hz = (uint32_t)atof(next());
+    else if (a == "--rfouta")  cfg.use_rfoutb = false;
+    else if (a[0] == '-' && a.size() > 1) { usage(); return 2; }
+    else inPath = argv[i];
+  }
+  if (!inPath) { usage(); return 2; }
+
+  Assembler as;
+  std::vector<AsmLine> lines;
+  if (!assembleFile(as, inPath, lines)) return 1;
+  std::vector<uint8_t> img = buildImage(as);
+
+  // Same checks the board does, so a bad program never gets uploaded
+  const char *err = seqLoad(vm, cfg, img.data(), img.size());
+  if (err) { fprintf(stderr, "%s: %s\n", inPath, err); return 1; }
+  fprintf(stderr, "%zu ops, %zu constants, %zu bytes\n", as.ops.size(), as.consts.size(), img.size());
+
+  if (outPath) {
+    FILE *f = fopen(outPath, "wb");
+    if (!f || fwrite(img.data(), 1, img.size(), f) != img.size()) {
+      fprintf(stderr, "can't write %s\n", outPath);
+      return 2;
+    }
+    fclose(f);
+  }
+  if (sim) return simulate(img, cfg, traceN);
+  if (port) return upload(port, img);
+  if (!outPath) {
+    for (size_t i = 0; i < as.ops.size(); i++) {
+      char txt[64];
+      seqFormatOp(&vm, as.ops[i], txt, sizeof(txt));
+      printf("%4zu  %-28s ; %s\n", i, txt, lines[i].text.c_str());
+    }
+  }
+  return 0;
+}
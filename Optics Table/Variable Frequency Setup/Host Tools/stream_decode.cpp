@@ -0,0 +1,594 @@
+// ============================================================================
+// Decoder for the compressed result stream (stream_codec.h)
+// ============================================================================
+//
+// Build (from this folder):
+//   g++ -O2 -std=c++17 -Wall -I.. stream_decode.cpp -o stream_decode
+//
+// Capture the serial port raw, then decode:
+//   stty -F /dev/ttyACM0 raw && cat /dev/ttyACM0 > capture.bin
+//   stream_decode capture.bin --start-hz 10e9 --step-hz 10e3 > sweep.csv
+//
+// Console text between blocks is skipped (and can be echoed with --text).
+// Blocks that fail the checksum are dropped and counted; gaps in the block
+// sequence are reported as lost blocks.
+//
+// Live plots: --view asks for a window at screen resolution, answered from
+// a min/max/mean pyramid kept as blocks decode (see "Live view" below):
+//   stty -F /dev/ttyACM0 raw
+//   stream_decode /dev/ttyACM0 --stats --start-hz 10e9 --step-hz 10e3
+//                 --live 0.5 --view t:-10::1000 --view f:::2000 --view-out view.csv
+//
+// --live rewrites the views every so many seconds while data comes in; a
+// plot just re-reads the file. Without --live they're written once at the end.
+//
+// stream_decode --bench [records] encodes a synthetic sweep with the
+// firmware encoder and times the decoder and the pyramid on it.
+
+#include <errno.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cmath>
+#include <string>
+#include <vector>
+#include "stream_codec.h"
+
+static double nowSec() {
+  timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+struct DecodeStats {
+  uint64_t blocks = 0;
+  uint64_t records = 0;
+  uint64_t lost_blocks = 0;     // sequence gaps
+  uint64_t bad = 0;             // blocks that passed the checksum but didn't parse
+  uint64_t skipped = 0;         // non-block bytes (console text, torn blocks)
+  uint64_t block_bytes = 0;
+  uint64_t raw_bytes = 0;       // what the same records take uncompressed
+};
+
+struct LiveView;
+
+struct Output {
+  FILE *csv = nullptr;
+  LiveView *view = nullptr;
+  double start_hz = 0;
+  double step_hz = 0;           // 0 = print the index only
+  bool text = false;
+  uint8_t channels = 0;         // header printed for this many
+};
+
+// Records of one block, reused across blocks
+struct Records {
+  uint32_t index[STREAM_PAYLOAD_MAX];
+  uint64_t t_us[STREAM_PAYLOAD_MAX];
+  int32_t  amp[STREAM_PAYLOAD_MAX * STREAM_MAX_CH];
+};
+
+static void writeCsv(Output &o, const StreamBlockHeader &h, const Records &r, int n) {
+  if (!o.csv) return;
+  if (o.channels != h.channels) {
+    fprintf(o.csv, "index,%st_us", o.step_hz ? "freq_hz," : "");
+    for (uint8_t ch = 0; ch < h.channels; ch++) fprintf(o.csv, ",amp%u", ch);
+    fputc('\n', o.csv);
+    o.channels = h.channels;
+  }
+  double scale = 1.0 / (double)(1u << h.amp_frac_bits);
+  for (int i = 0; i < n; i++) {
+    fprintf(o.csv, "%lu,", (unsigned long)r.index[i]);
+    if (o.step_hz) fprintf(o.csv, "%.0f,", o.start_hz + o.step_hz * r.index[i]);
+    fprintf(o.csv, "%llu", (unsigned long long)r.t_us[i]);
+    for (uint8_t ch = 0; ch < h.channels; ch++) {
+      int32_t a = r.amp[i * h.channels + ch];
+      if (h.amp_frac_bits) fprintf(o.csv, ",%.6g", a * scale);
+      else                 fprintf(o.csv, ",%ld", (long)a);
+    }
+    fputc('\n', o.csv);
+  }
+}
+
+// ============================================================================
+// Live view: min/max/mean pyramid
+// ============================================================================
+//
+// A plot of a run with millions of records wants a couple of thousand
+// points, not the records. Each channel keeps two pyramids, fed as blocks
+// decode:
+//
+//   time   over records in arrival order: level 0 is the values themselves,
+//          a level-L bin covers LOD_FANOUT^L records
+//   freq   over the table index: level 0 is one bin per index, accumulated
+//          over every sweep of the run
+//
+// A bin holds min, max, sum and count. A value goes into level 0 and into
+// the carry of the open bin one level up. A level's carry is folded into its
+// bin, and passed on up, only when a value lands in a different bin. With
+// records arriving in index order that happens once per LOD_FANOUT^L values
+// at level L, so a value costs O(1) however deep the pyramid gets.
+//
+// A view asks for W columns over a time or frequency window. A column of
+// any width is covered by at most 2*(LOD_FANOUT-1) bins per level, so a
+// view costs the same at a thousand records as at a hundred million (plus
+// a binary search per column on the time axis). Carries not yet folded in
+// are added on read, so a view always includes the latest record.
+//
+// Memory, time axis: 8 bytes of timestamp per record, plus per channel 4
+// for the value and the upper levels' bins -- a LodBin is 24 bytes, so
+// level 1 alone is 6 bytes per record and all levels together about 8.
+// Roughly 20 bytes per record for one channel, 12 more per extra channel.
+// None of it is ever dropped: on a live stream t_us, v0 and the level
+// vectors grow for as long as it runs (one channel at 1000 records/s is
+// ~1.7 GB a day), so restart the decoder for long unattended runs. The
+// frequency axis is bounded by the table: ~32 bytes per index per channel.
+
+static constexpr uint32_t LOD_SHIFT  = 2;
+static constexpr uint32_t LOD_FANOUT = 1u << LOD_SHIFT;
+static constexpr int      LOD_LEVELS = 16;             // 4^16 records
+
+struct LodBin {
+  float    lo = INFINITY, hi = -INFINITY;
+  double   sum = 0;
+  uint64_t n = 0;
+};
+
+static inline LodBin lodOne(float v) {
+  LodBin b;
+  b.lo = b.hi = v;
+  b.sum = v;
+  b.n = 1;
+  return b;
+}
+
+static inline void lodMerge(LodBin &a, const LodBin &b) {
+  if (!b.n) return;
+  a.lo = std::min(a.lo, b.lo);
+  a.hi = std::max(a.hi, b.hi);
+  a.sum += b.sum;
+  a.n += b.n;
+}
+
+struct Lod {
+  bool values;                        // level 0 = one value per key (time)
+  std::vector<float>  v0;             // level 0 when values
+  std::vector<LodBin> lv[LOD_LEVELS]; // lv[0] only when !values
+  int64_t open[LOD_LEVELS];           // bin carry[L] belongs to, -1 = none
+  LodBin  carry[LOD_LEVELS];
+
+  explicit Lod(bool values) : values(values) {
+    for (int64_t &o : open) o = -1;
+  }
+};
+
+static void lodCarry(Lod &d, int L, uint64_t k, LodBin b) {
+  for (; L < LOD_LEVELS; L++) {
+    if (d.open[L] == (int64_t)k) { lodMerge(d.carry[L], b); return; }
+    if (d.open[L] < 0) { d.open[L] = (int64_t)k; d.carry[L] = b; return; }
+    // Close the old bin, then carry it one level up as a whole
+    uint64_t old = (uint64_t)d.open[L];
+    if (d.lv[L].size() <= old) d.lv[L].resize(old + 1);
+    lodMerge(d.lv[L][old], d.carry[L]);
+    LodBin up = d.carry[L];
+    d.open[L] = (int64_t)k;
+    d.carry[L] = b;
+    b = up;
+    k = old >> LOD_SHIFT;
+  }
+}
+
+static void lodAdd(Lod &d, uint64_t key, float v) {
+  if (d.values) {
+    if (d.v0.size() <= key) d.v0.resize(key + 1, NAN);
+    d.v0[key] = v;
+  } else {
+    if (d.lv[0].size() <= key) d.lv[0].resize(key + 1);
+    lodMerge(d.lv[0][key], lodOne(v));
+  }
+  lodCarry(d, 1, key >> LOD_SHIFT, lodOne(v));
+}
+
+// Bin k of level L, including carries below it that aren't folded in yet
+static LodBin lodBin(const Lod &d, int L, uint64_t k) {
+  LodBin b;
+  if (L == 0 && d.values) {
+    if (k < d.v0.size() && !std::isnan(d.v0[k])) b = lodOne(d.v0[k]);
+    return b;
+  }
+  if (k < d.lv[L].size()) b = d.lv[L][k];
+  for (int j = 1; j <= L; j++) {
+    if (d.open[j] >= 0 && ((uint64_t)d.open[j] >> (LOD_SHIFT * (L - j))) == k) {
+      lodMerge(b, d.carry[j]);
+    }
+  }
+  return b;
+}
+
+// Everything in keys [a, b): edge bins at each level, then one level up
+static LodBin lodRange(const Lod &d, uint64_t a, uint64_t b) {
+  LodBin r;
+  for (int L = 0; L < LOD_LEVELS && a < b; L++) {
+    while (a < b && (a & (LOD_FANOUT - 1))) lodMerge(r, lodBin(d, L, a++));
+    while (a < b && (b & (LOD_FANOUT - 1))) lodMerge(r, lodBin(d, L, --b));
+    a >>= LOD_SHIFT;
+    b >>= LOD_SHIFT;
+  }
+  return r;
+}
+
+struct LiveView {
+  std::vector<uint64_t> t_us;         // per record, for time windows
+  std::vector<Lod> time, freq;        // per channel
+  uint64_t index_end = 0;             // highest table index seen + 1
+};
+
+static void viewAdd(LiveView &v, const StreamBlockHeader &h, const Records &r, int n) {
+  if (v.time.size() < h.channels) {
+    v.time.resize(h.channels, Lod(true));
+    v.freq.resize(h.channels, Lod(false));
+  }
+  float scale = 1.0f / (float)(1u << h.amp_frac_bits);
+  for (int i = 0; i < n; i++) {
+    uint64_t key = v.t_us.size();
+    v.t_us.push_back(r.t_us[i]);
+    v.index_end = std::max<uint64_t>(v.index_end, (uint64_t)r.index[i] + 1);
+    for (uint8_t ch = 0; ch < h.channels; ch++) {
+      float a = r.amp[i * h.channels + ch] * scale;
+      lodAdd(v.time[ch], key, a);
+      lodAdd(v.freq[ch], r.index[i], a);
+    }
+  }
+}
+
+// "t:FROM:TO:W"  seconds since the first record, negative = back from the
+//                latest, empty = that end of the run
+// "f:FROM:TO:W"  Hz (index without --step-hz), empty = that end of the table
+struct ViewSpec {
+  std::string text;
+  char     axis = 't';
+  bool     has_lo = false, has_hi = false;
+  double   lo = 0, hi = 0;
+  uint32_t cols = 0;
+};
+
+struct ViewColumn {
+  double x_lo, x_hi;
+  LodBin ch[STREAM_MAX_CH];
+};
+
+static bool parseView(const char *s, ViewSpec &v) {
+  v.text = s;
+  char lo[64] = "", hi[64] = "";
+  unsigned cols = 0;
+  if ((s[0] != 't' && s[0] != 'f') || s[1] != ':') return false;
+  v.axis = s[0];
+  if (sscanf(s + 2, "%63[^:]:%63[^:]:%u", lo, hi, &cols) != 3 &&
+      sscanf(s + 2, ":%63[^:]:%u", hi, &cols) != 2 &&
+      sscanf(s + 2, "%63[^:]::%u", lo, &cols) != 2 &&
+      sscanf(s + 2, "::%u", &cols) != 1) {
+    return false;
+  }
+  v.has_lo = lo[0] != 0;
+  v.has_hi = hi[0] != 0;
+  v.lo = atof(lo);
+  v.hi = atof(hi);
+  v.cols = cols;
+  return cols > 0;
+}
+
+// Column c covers keys [edge[c], edge[c + 1])
+static void viewColumns(const LiveView &v, const ViewSpec &s, double start_hz, double step_hz,
+                        std::vector<ViewColumn> &out) {
+  out.assign(s.cols, ViewColumn());
+  if (v.t_us.empty()) return;
+  std::vector<uint64_t> edge(s.cols + 1);
+  double x0, x1;
+  if (s.axis == 't') {
+    double first = (double)v.t_us.front(), span = (double)(v.t_us.back() - v.t_us.front()) + 1;
+    x0 = !s.has_lo ? 0 : s.lo < 0 ? span + s.lo * 1e6 : s.lo * 1e6;
+    x1 = !s.has_hi ? span : s.hi < 0 ? span + s.hi * 1e6 : s.hi * 1e6;
+    for (uint32_t c = 0; c <= s.cols; c++) {
+      double t = first + x0 + (x1 - x0) * c / s.cols;
+      edge[c] = std::lower_bound(v.t_us.begin(), v.t_us.end(), (uint64_t)std::max(t, 0.0)) -
+                v.t_us.begin();
+    }
+    x0 /= 1e6;
+    x1 /= 1e6;
+  } else {
+    // x as index, then back to Hz for the output
+    auto toIndex = [&](double f) { return step_hz ? (f - start_hz) / step_hz : f; };
+    double i0 = s.has_lo ? toIndex(s.lo) : 0;
+    double i1 = s.has_hi ? toIndex(s.hi) : (double)v.index_end;
+    for (uint32_t c = 0; c <= s.cols; c++) {
+      double i = std::ceil(i0 + (i1 - i0) * c / s.cols);
+      edge[c] = (uint64_t)std::min(std::max(i, 0.0), (double)v.index_end);
+    }
+    x0 = step_hz ? start_hz + step_hz * i0 : i0;
+    x1 = step_hz ? start_hz + step_hz * i1 : i1;
+  }
+  const std::vector<Lod> &lod = s.axis == 't' ? v.time : v.freq;
+  for (uint32_t c = 0; c < s.cols; c++) {
+    ViewColumn &col = out[c];
+    col.x_lo = x0 + (x1 - x0) * c / s.cols;
+    col.x_hi = x0 + (x1 - x0) * (c + 1) / s.cols;
+    for (size_t ch = 0; ch < lod.size(); ch++) {
+      if (edge[c] < edge[c + 1]) col.ch[ch] = lodRange(lod[ch], edge[c], edge[c + 1]);
+    }
+  }
+}
+
+static void viewPrint(FILE *f, const LiveView &v, const ViewSpec &s, double start_hz,
+                      double step_hz) {
+  std::vector<ViewColumn> cols;
+  viewColumns(v, s, start_hz, step_hz, cols);
+  size_t chans = v.time.size();
+  fprintf(f, "# view %s: %zu records\n", s.text.c_str(), v.t_us.size());
+  fprintf(f, "%s", s.axis == 't' ? "t_lo_s,t_hi_s" : step_hz ? "f_lo_hz,f_hi_hz" : "index_lo,index_hi");
+  fprintf(f, ",n");
+  for (size_t ch = 0; ch < chans; ch++) fprintf(f, ",min%zu,max%zu,mean%zu", ch, ch, ch);
+  fputc('\n', f);
+  for (const ViewColumn &c : cols) {
+    fprintf(f, s.axis == 't' ? "%.6f,%.6f" : "%.0f,%.0f", c.x_lo, c.x_hi);
+    fprintf(f, ",%llu", (unsigned long long)c.ch[0].n);
+    for (size_t ch = 0; ch < chans; ch++) {
+      const LodBin &b = c.ch[ch];
+      if (b.n) fprintf(f, ",%.6g,%.6g,%.6g", b.lo, b.hi, b.sum / b.n);
+      else     fprintf(f, ",,,");
+    }
+    fputc('\n', f);
+  }
+  fflush(f);
+}
+
+// Walk a buffer: blocks are decoded, everything else skipped. Returns the
+// number of bytes consumed (a block cut off at the end is left for later).
+static size_t decodeBuffer(const uint8_t *buf, size_t n, bool final, Output *o, DecodeStats &s,
+                           Records &r, int *lastSeq) {
+  size_t pos = 0;
+  while (pos < n) {
+    // jump to the next possible magic byte
+    const uint8_t lo = (uint8_t)STREAM_MAGIC;
+    const uint8_t *m = (const uint8_t *)memchr(buf + pos, lo, n - pos);
+    size_t next = m ? (size_t)(m - buf) : n;
+    if (o && o->text && next > pos) fwrite(buf + pos, 1, next - pos, stderr);
+    s.skipped += next - pos;
+    pos = next;
+    if (pos >= n) break;
+
+    uint32_t len = 0;
+    StreamScan sc = streamCheckBlock(buf + pos, n - pos, &len);
+    if (sc == STREAM_NEED_MORE && !final) break;
+    if (sc != STREAM_BLOCK_OK) {
+      if (o && o->text) fputc(buf[pos], stderr);
+      s.skipped++;
+      pos++;
+      continue;
+    }
+
+    StreamBlockHeader h;
+    memcpy(&h, buf + pos, sizeof(h));
+    int k = streamDecodeBlock(buf + pos, r.index, r.t_us, r.amp);
+    if (k < 0) {
+      s.bad++;
+    } else {
+      if (*lastSeq >= 0) s.lost_blocks += (uint16_t)(h.seq - (uint16_t)*lastSeq - 1);
+      *lastSeq = h.seq;
+      s.blocks++;
+      s.records += k;
+      s.block_bytes += len;
+      s.raw_bytes += (uint64_t)k * (4 + 8 + 4 * h.channels);
+      if (o) writeCsv(*o, h, r, k);
+      if (o && o->view) viewAdd(*o->view, h, r, k);
+    }
+    pos += len;
+  }
+  return pos;
+}
+
+// ============================================================================
+// Benchmark: firmware encoder -> decoder, synthetic sweep
+// ============================================================================
+static int bench(uint32_t records) {
+  // A detector trace: slow ripple + noise, 2 ms dwell with a little timer
+  // jitter, one channel of ADC sums (same shape as the checkpointed sweep),
+  // a 10k-point table swept over and over
+  static constexpr uint32_t TABLE = 10000;
+  std::vector<uint8_t> stream;
+  stream.reserve((size_t)records * 6);
+  static StreamEncoder enc;
+  streamEncInit(enc, 1, 0);
+
+  uint32_t rng = 12345;
+  auto rnd = [&]() { rng = rng * 1664525u + 1013904223u; return rng >> 8; };
+  uint64_t t = 1000000;
+  for (uint32_t i = 0; i < records; i++) {
+    t += 2000 + (rnd() % 5) - 2;
+    int32_t amp = 16000 + (int32_t)(4000 * ((i / 50) % 2 ? 1 : -1) * ((i % 50) / 50.0)) +
+                  (int32_t)(rnd() % 64) - 32;
+    if (!streamEncAdd(enc, i % TABLE, t, &amp)) {
+      uint32_t n = streamEncFinish(enc);
+      stream.insert(stream.end(), enc.block, enc.block + n);
+      streamEncAdd(enc, i % TABLE, t, &amp);
+    }
+  }
+  uint32_t n = streamEncFinish(enc);
+  stream.insert(stream.end(), enc.block, enc.block + n);
+
+  printf("%lu records: %zu bytes compressed, %llu raw -> %.2fx, %.2f bytes/record\n",
+         (unsigned long)records, stream.size(), (unsigned long long)streamRawBytes(enc),
+         (double)streamRawBytes(enc) / stream.size(), (double)stream.size() / records);
+
+  static Records r;
+  DecodeStats s;
+  int reps = 0;
+  double t0 = nowSec(), t1;
+  do {
+    s = DecodeStats();
+    int lastSeq = -1;
+    decodeBuffer(stream.data(), stream.size(), true, nullptr, s, r, &lastSeq);
+    reps++;
+    t1 = nowSec();
+  } while (t1 - t0 < 1.0);
+
+  double sec = (t1 - t0) / reps;
+  printf("decode: %.0f MB/s compressed, %.0f MB/s raw equivalent, %.1f M records/s\n",
+         stream.size() / sec / 1e6, s.raw_bytes / sec / 1e6, s.records / sec / 1e6);
+  if (s.records != records || s.bad || s.lost_blocks) {
+    printf("MISMATCH: decoded %llu records, %llu bad, %llu lost\n",
+           (unsigned long long)s.records, (unsigned long long)s.bad,
+           (unsigned long long)s.lost_blocks);
+    return 1;
+  }
+
+  // Pyramid: the same decode with the live view fed, minus the decode alone
+  static LiveView view;
+  Output o;
+  o.view = &view;
+  int lastSeq = -1;
+  double tv = nowSec();
+  decodeBuffer(stream.data(), stream.size(), true, &o, s, r, &lastSeq);
+  double build = nowSec() - tv - sec;
+  printf("pyramid: %.1f ns/record on top of decode\n", std::max(build, 0.0) / records * 1e9);
+
+  const char *specs[] = { "t:::2000", "t:-60::2000", "f:::2000", "f:4000:4100:2000" };
+  for (const char *spec : specs) {
+    ViewSpec vs;
+    parseView(spec, vs);
+    std::vector<ViewColumn> cols;
+    int n = 0;
+    tv = nowSec();
+    do {
+      viewColumns(view, vs, 0, 0, cols);
+      n++;
+    } while (nowSec() - tv < 0.2);
+    uint64_t covered = 0;
+    for (const ViewColumn &c : cols) covered += c.ch[0].n;
+    printf("view %-17s %6.0f us, %llu records in %u columns\n", spec, (nowSec() - tv) / n * 1e6,
+           (unsigned long long)covered, vs.cols);
+  }
+  return 0;
+}
+
+// ============================================================================
+// main
+// ============================================================================
+static void usage() {
+  fprintf(stderr,
+    "usage: stream_decode [options] <capture | ->\n"
+    "       stream_decode --bench [records]\n"
+    "  --start-hz HZ   first table frequency, adds a freq_hz column\n"
+    "  --step-hz HZ    table step (with --start-hz)\n"
+    "  --csv FILE      write records here instead of stdout\n"
+    "  --text          echo console text between blocks to stderr\n"
+    "  --stats         summary only, no records\n"
+    "  --view SPEC     min/max/mean at screen resolution, repeatable:\n"
+    "                  t:FROM:TO:COLS  seconds since the first record (-10 = 10 s before\n"
+    "                                  the latest, empty = that end)\n"
+    "                  f:FROM:TO:COLS  Hz (table index without --step-hz)\n"
+    "  --view-out FILE views go here, replaced whole each time (default stderr)\n"
+    "  --live SEC      write the views every SEC seconds while decoding\n");
+}
+
+static void writeViews(const char *path, const LiveView &v, const std::vector<ViewSpec> &specs,
+                       const Output &o) {
+  if (specs.empty()) return;
+  // Replaced by rename so a plot never reads half a file
+  std::string tmp = path ? std::string(path) + ".tmp" : "";
+  FILE *f = path ? fopen(tmp.c_str(), "w") : stderr;
+  if (!f) { fprintf(stderr, "can't write %s\n", tmp.c_str()); return; }
+  for (const ViewSpec &s : specs) viewPrint(f, v, s, o.start_hz, o.step_hz);
+  if (f != stderr) {
+    fclose(f);
+    rename(tmp.c_str(), path);
+  }
+}
+
+int main(int argc, char **argv) {
+  Output o;
+  const char *inPath = nullptr;
+  const char *csvPath = nullptr;
+  const char *viewPath = nullptr;
+  bool statsOnly = false;
+  double liveSec = 0;
+  std::vector<ViewSpec> views;
+
+  for (int i = 1; i < argc; i++) {
+    std::string a = argv[i];
+    auto next = [&]() -> const char * {
+      if (i + 1 >= argc) { usage(); exit(2); }
+      return argv[++i];
+    };
+    if      (a == "--bench")    return bench(i + 1 < argc ? (uint32_t)atof(argv[i + 1]) : 10000000);
+    else if (a == "--start-hz") o.start_hz = atof(next());
+    else if (a == "--step-hz")  o.step_hz = atof(next());
+    else if (a == "--csv")      csvPath = next();
+    else if (a == "--text")     o.text = true;
+    else if (a == "--stats")    statsOnly = true;
+    else if (a == "--view-out") viewPath = next();
+    else if (a == "--live")     liveSec = atof(next());
+    else if (a == "--view") {
+      ViewSpec v;
+      const char *spec = next();
+      if (!parseView(spec, v)) { fprintf(stderr, "bad view %s\n", spec); return 2; }
+      views.push_back(v);
+    }
+    else if (a[0] == '-' && a.size() > 1) { usage(); return 2; }
+    else inPath = argv[i];
+  }
+  if (!inPath) { usage(); return 2; }
+
+  FILE *in = strcmp(inPath, "-") ? fopen(inPath, "rb") : stdin;
+  if (!in) { fprintf(stderr, "can't open %s\n", inPath); return 2; }
+  if (!statsOnly) {
+    o.csv = csvPath ? fopen(csvPath, "w") : stdout;
+    if (!o.csv) { fprintf(stderr, "can't write %s\n", csvPath); return 2; }
+  }
+
+  static Records r;
+  static LiveView view;
+  if (!views.empty()) o.view = &view;
+  DecodeStats s;
+  int lastSeq = -1;
+  std::vector<uint8_t> buf(1 << 20);
+  size_t have = 0;
+  uint64_t inBytes = 0;
+  double t0 = nowSec(), lastView = t0;
+
+  for (;;) {
+    // read(), not fread(): a live port returns what's there instead of
+    // waiting for a full buffer
+    ssize_t got = read(fileno(in), buf.data() + have, buf.size() - have);
+    if (got < 0 && errno == EINTR) continue;
+    if (got < 0) got = 0;
+    inBytes += got;
+    have += got;
+    bool eof = got == 0;
+    size_t used = decodeBuffer(buf.data(), have, eof, &o, s, r, &lastSeq);
+    memmove(buf.data(), buf.data() + used, have - used);
+    have -= used;
+    if (eof) break;
+    if (liveSec > 0 && nowSec() - lastView >= liveSec) {
+      writeViews(viewPath, view, views, o);
+      lastView = nowSec();
+    }
+  }
+  double sec = nowSec() - t0;
+  writeViews(viewPath, view, views, o);
+
+  if (in != stdin) fclose(in);
+  if (o.csv && o.csv != stdout) fclose(o.csv);
+
+  fprintf(stderr, "%llu blocks, %llu records | %llu block bytes for %llu raw (%.2fx) | "
+                  "%llu lost, %llu bad, %llu bytes skipped | %.0f MB/s\n",
+          (unsigned long long)s.blocks, (unsigned long long)s.records,
+          (unsigned long long)s.block_bytes, (unsigned long long)s.raw_bytes,
+          s.block_bytes ? (double)s.raw_bytes / s.block_bytes : 0.0,
+          (unsigned long long)s.lost_blocks, (unsigned long long)s.bad,
+          (unsigned long long)s.skipped, sec > 0 ? inBytes / sec / 1e6 : 0.0);
+  return s.bad ? 1 : 0;
+}
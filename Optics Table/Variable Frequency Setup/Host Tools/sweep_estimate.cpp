@@ -0,0 +1,396 @@
+// ============================================================================
+// Sweep duration estimator + plan linter (host)
+// ============================================================================
+//
+// Runs a frequency list through the same integer planner and hop-delta
+// packer the sketches use, adds a lock-time model, and prints where the
+// time goes: total, per-hop breakdown, worst hops, and what would make it
+// shorter (reordering, faster SPI, ping-pong boards, ...).
+//
+// Build (from this folder):
+//   g++ -O2 -std=c++17 -Wall -I.. sweep_estimate.cpp -o sweep_estimate
+//
+// Frequency list: one frequency in Hz per line, or
+//   sweep <start_hz> <step_hz> <stop_hz>
+// '#' starts a comment. "-" reads stdin.
+//
+// Lock model: either the simple simulated one (--autocal-us, --lock-base-us,
+// --lock-us-per-mhz, --div-change-us) or a measured table (--lock-table) of
+// "<|VCO step| Hz> <lock us>" lines, linearly interpolated. Measure with the
+// LD pin (test.cpp wiring) or a scope on MUXOUT.
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include "adf5355_plan.h"
+
+// ============================================================================
+// Settings
+// ============================================================================
+struct EstConfig {
+  PlanConfig plan      = { 10000000, 10000, true };
+  double spi_hz        = 1e6;
+  double le_us         = 4.0;      // pulseLE() in the sketches: 2 + 2 us
+  double word_ovh_us   = 3.0;      // beginTransaction/endTransaction etc.
+  double dwell_us      = 1000.0;
+  double autocal_us    = 100.0;
+  double lock_base_us  = 20.0;
+  double lock_per_mhz  = 0.2;      // extra settling per MHz of VCO step
+  double div_change_us = 50.0;
+  bool   autocal       = true;
+  int    worst         = 10;
+  const char *csv      = nullptr;
+  const char *lock_table = nullptr;
+};
+
+struct LockPoint { double step_hz, us; };
+static std::vector<LockPoint> lockTable;
+
+// ============================================================================
+// Input
+// ============================================================================
+static bool readFreqList(const char *path, std::vector<uint64_t> &out) {
+  FILE *f = strcmp(path, "-") == 0 ? stdin : fopen(path, "r");
+  if (!f) { fprintf(stderr, "can't open %s\n", path); return false; }
+
+  char line[256];
+  int lineNo = 0;
+  while (fgets(line, sizeof(line), f)) {
+    lineNo++;
+    char *hash = strchr(line, '#');
+    if (hash) *hash = 0;
+
+    double a, b, c;
+    if (sscanf(line, " sweep %lf %lf %lf", &a, &b, &c) == 3) {
+      if (b <= 0 || c < a) {
+        fprintf(stderr, "%s:%d: bad sweep line\n", path, lineNo);
+        return false;
+      }
+      for (double x = a; x <= c + b / 2; x += b) out.push_back((uint64_t)(x + 0.5));
+    } else if (sscanf(line, " %lf", &a) == 1) {
+      out.push_back((uint64_t)(a + 0.5));
+    }
+  }
+  if (f != stdin) fclose(f);
+  return true;
+}
+
+static bool readLockTable(const char *path) {
+  FILE *f = fopen(path, "r");
+  if (!f) { fprintf(stderr, "can't open %s\n", path); return false; }
+  char line[256];
+  while (fgets(line, sizeof(line), f)) {
+    LockPoint p;
+    if (line[0] == '#') continue;
+    if (sscanf(line, " %lf %lf", &p.step_hz, &p.us) == 2) lockTable.push_back(p);
+  }
+  fclose(f);
+  std::sort(lockTable.begin(), lockTable.end(),
+            [](const LockPoint &x, const LockPoint &y) { return x.step_hz < y.step_hz; });
+  return !lockTable.empty();
+}
+
+// ============================================================================
+// Model
+// ============================================================================
+struct HopCost {
+  uint32_t index;          // position in the list
+  uint64_t rf_hz;
+  uint8_t  words;
+  bool     div_change;
+  bool     int_change;
+  double   spi_us, lock_us, dwell_us;
+  double total() const { return spi_us + lock_us + dwell_us; }
+};
+
+static double lockUs(const EstConfig &c, double vco_step_hz, bool div_change) {
+  if (!lockTable.empty()) {
+    const LockPoint *t = lockTable.data();
+    size_t n = lockTable.size();
+    if (vco_step_hz <= t[0].step_hz) return t[0].us;
+    if (vco_step_hz >= t[n - 1].step_hz) return t[n - 1].us;
+    for (size_t i = 1; i < n; i++) {
+      if (vco_step_hz <= t[i].step_hz) {
+        double k = (vco_step_hz - t[i - 1].step_hz) / (t[i].step_hz - t[i - 1].step_hz);
+        return t[i - 1].us + k * (t[i].us - t[i - 1].us);
+      }
+    }
+  }
+  double us = c.lock_base_us + c.lock_per_mhz * vco_step_hz / 1e6;
+  if (c.autocal) us += c.autocal_us;
+  if (div_change) us += c.div_change_us;
+  return us;
+}
+
+static double wordUs(const EstConfig &c) {
+  return 32.0 / c.spi_hz * 1e6 + c.le_us + c.word_ovh_us;
+}
+
+// Cost of every hop in list order. Unplannable entries are skipped (the
+// sketches skip them too) and counted in *failed.
+static std::vector<HopCost> costHops(const EstConfig &c, const std::vector<uint64_t> &freqs,
+                                     uint32_t *failed) {
+  std::vector<HopCost> hops;
+  PllPlan prev = {};
+  bool have = false;
+  if (failed) *failed = 0;
+
+  for (uint32_t i = 0; i < freqs.size(); i++) {
+    PllPlan p = planFrequencyInt(c.plan, freqs[i]);
+    if (!p.ok) { if (failed) (*failed)++; continue; }
+
+    HopCost h = {};
+    h.index = i;
+    h.rf_hz = p.rf_hz;
+    h.dwell_us = c.dwell_us;
+    if (!have) {
+      h.words = 13;                       // full image for the first point
+      h.div_change = true;
+      h.int_change = true;
+      h.lock_us = lockUs(c, (double)ADF_VCO_MAX_HZ - ADF_VCO_MIN_HZ, true);
+    } else {
+      HopDelta d = packHopDelta(prev, p, 0, 0, 0, c.autocal);
+      h.words = d.n;
+      h.div_change = p.out_div != prev.out_div;
+      h.int_change = p.INT != prev.INT;
+      double dv = (double)p.vco_hz - (double)prev.vco_hz;
+      h.lock_us = lockUs(c, dv < 0 ? -dv : dv, h.div_change);
+    }
+    h.spi_us = h.words * wordUs(c);
+    hops.push_back(h);
+    prev = p;
+    have = true;
+  }
+  return hops;
+}
+
+struct Totals { double spi, lock, dwell; uint32_t div_changes, int_changes, words; };
+
+static Totals sumHops(const std::vector<HopCost> &hops) {
+  Totals t = {};
+  for (const HopCost &h : hops) {
+    t.spi += h.spi_us; t.lock += h.lock_us; t.dwell += h.dwell_us;
+    t.words += h.words;
+    t.div_changes += h.div_change;
+    t.int_changes += h.int_change;
+  }
+  return t;
+}
+
+static double totalUs(const std::vector<HopCost> &hops) {
+  Totals t = sumHops(hops);
+  return t.spi + t.lock + t.dwell;
+}
+
+// Two boards behind a switch (PingPong_Source_Sketch): the next board
+// tunes while this one dwells, so each hop costs max(dwell, spi + lock).
+static double pingPongUs(const std::vector<HopCost> &hops) {
+  double t = 0;
+  for (size_t i = 0; i < hops.size(); i++) {
+    double tune = hops[i].spi_us + hops[i].lock_us;
+    t += (i == 0) ? tune + hops[i].dwell_us : std::max(hops[i].dwell_us, tune);
+  }
+  return t;
+}
+
+static void printDuration(double us) {
+  if (us < 1e3)       printf("%.1f us", us);
+  else if (us < 1e6)  printf("%.2f ms", us / 1e3);
+  else if (us < 60e6) printf("%.2f s", us / 1e6);
+  else                printf("%.1f min", us / 60e6);
+}
+
+// ============================================================================
+// Lint
+// ============================================================================
+static uint32_t lint(const EstConfig &c, const std::vector<uint64_t> &freqs) {
+  uint32_t errors = 0, warnings = 0;
+
+  for (uint32_t i = 0; i < freqs.size(); i++) {
+    PllPlan p = planFrequencyInt(c.plan, freqs[i]);
+    if (!p.ok) {
+      const char *why = "VCO out of range";
+      uint8_t div = c.plan.use_rfoutb ? 1 : planOutDiv(freqs[i]);
+      if (div && !planMod2(c.plan, div)) why = "channel step too fine for this PFD (MOD2 > 16383)";
+      printf("ERROR  #%u %llu Hz: can't be planned, %s\n", i,
+             (unsigned long long)freqs[i], why);
+      errors++;
+      continue;
+    }
+    if (freqs[i] % c.plan.chan_step_hz) {
+      printf("WARN   #%u %llu Hz: off the %lu Hz grid, will be rounded\n", i,
+             (unsigned long long)freqs[i], (unsigned long)c.plan.chan_step_hz);
+      warnings++;
+    }
+    if (i > 0 && freqs[i] == freqs[i - 1]) {
+      printf("WARN   #%u %llu Hz: same as previous point (merge into a longer dwell)\n",
+             i, (unsigned long long)freqs[i]);
+      warnings++;
+    }
+  }
+  printf("Lint: %u error(s), %u warning(s)\n\n", errors, warnings);
+  return errors;
+}
+
+// ============================================================================
+// main
+// ============================================================================
+static void usage() {
+  fprintf(stderr,
+    "usage: sweep_estimate [options] <freq list | ->\n"
+    "  --pfd HZ            PFD frequency (10e6)\n"
+    "  --step HZ           channel step (10e3)\n"
+    "  --rfouta            plan for RFOUTA instead of RFOUTB\n"
+    "  --spi-hz HZ         SPI clock (1e6)\n"
+    "  --dwell-us US       time on each point after lock (1000)\n"
+    "  --no-autocal        hops without autocal\n"
+    "  --autocal-us US     autocal time (100)\n"
+    "  --lock-base-us US   settle after autocal (20)\n"
+    "  --lock-us-per-mhz X extra settle per MHz of VCO step (0.2)\n"
+    "  --div-change-us US  extra for an RF divider change (50)\n"
+    "  --lock-table FILE   measured '<vco step Hz> <lock us>' table instead\n"
+    "  --worst N           worst hops to list (10)\n"
+    "  --csv FILE          per-hop breakdown\n");
+}
+
+int main(int argc, char **argv) {
+  EstConfig c;
+  const char *listPath = nullptr;
+
+  for (int i = 1; i < argc; i++) {
+    std::string a = argv[i];
+    auto next = [&]() -> const char * {
+      if (i + 1 >= argc) { usage(); exit(2); }
+      return argv[++i];
+    };
+    if      (a == "--pfd")             c.plan.pfd_hz = (uint32_t)atof(next());
+    else if (a == "--step")            c.plan.chan_step_hz = (uint32_t)atof(next());
+    else if (a == "--rfouta")          c.plan.use_rfoutb = false;
+    else if (a == "--spi-hz")          c.spi_hz = atof(next());
+    else if (a == "--dwell-us")        c.dwell_us = atof(next());
+    else if (a == "--no-autocal")      c.autocal = false;
+    else if (a == "--autocal-us")      c.autocal_us = atof(next());
+    else if (a == "--lock-base-us")    c.lock_base_us = atof(next());
+    else if (a == "--lock-us-per-mhz") c.lock_per_mhz = atof(next());
+    else if (a == "--div-change-us")   c.div_change_us = atof(next());
+    else if (a == "--lock-table")      c.lock_table = next();
+    else if (a == "--worst")           c.worst = atoi(next());
+    else if (a == "--csv")             c.csv = next();
+    else if (a[0] == '-' && a.size() > 1) { usage(); return 2; }
+    else listPath = argv[i];
+  }
+  if (!listPath) { usage(); return 2; }
+
+  std::vector<uint64_t> freqs;
+  if (!readFreqList(listPath, freqs)) return 2;
+  if (c.lock_table && !readLockTable(c.lock_table)) {
+    fprintf(stderr, "lock table %s is empty or unreadable\n", c.lock_table);
+    return 2;
+  }
+
+  printf("%zu points, PFD %lu Hz, step %lu Hz, %s, SPI %.0f Hz, lock model: %s\n\n",
+         freqs.size(), (unsigned long)c.plan.pfd_hz, (unsigned long)c.plan.chan_step_hz,
+         c.plan.use_rfoutb ? "RFOUTB" : "RFOUTA", c.spi_hz,
+         c.lock_table ? c.lock_table : "simulated");
+
+  uint32_t errors = lint(c, freqs);
+
+  uint32_t failed = 0;
+  std::vector<HopCost> hops = costHops(c, freqs, &failed);
+  if (hops.empty()) { printf("Nothing plannable.\n"); return 1; }
+
+  Totals t = sumHops(hops);
+  double total = t.spi + t.lock + t.dwell;
+
+  printf("Estimated total: "); printDuration(total); printf("\n");
+  printf("  SPI   "); printDuration(t.spi);
+  printf("  (%4.1f%%, %u words)\n", 100.0 * t.spi / total, t.words);
+  printf("  lock  "); printDuration(t.lock);
+  printf("  (%4.1f%%, %u divider changes, %u INT changes)\n",
+         100.0 * t.lock / total, t.div_changes, t.int_changes);
+  printf("  dwell "); printDuration(t.dwell);
+  printf("  (%4.1f%%)\n", 100.0 * t.dwell / total);
+  printf("  per hop: %.1f us avg\n\n", total / hops.size());
+
+  // Worst hops
+  std::vector<HopCost> worst = hops;
+  std::sort(worst.begin(), worst.end(),
+            [](const HopCost &x, const HopCost &y) { return x.total() > y.total(); });
+  if ((int)worst.size() > c.worst) worst.resize(c.worst);
+  printf("Worst hops:\n");
+  printf("  %6s %14s %5s %9s %9s %9s  %s\n", "#", "freq_hz", "words", "spi_us", "lock_us",
+         "total_us", "");
+  for (const HopCost &h : worst) {
+    printf("  %6u %14llu %5u %9.1f %9.1f %9.1f  %s%s\n", h.index,
+           (unsigned long long)h.rf_hz, h.words, h.spi_us, h.lock_us, h.total(),
+           h.div_change ? "div " : "", h.int_change ? "int" : "");
+  }
+  printf("\n");
+
+  if (c.csv) {
+    FILE *f = fopen(c.csv, "w");
+    if (!f) {
+      fprintf(stderr, "can't write %s\n", c.csv);
+    } else {
+      fprintf(f, "index,freq_hz,words,div_change,int_change,spi_us,lock_us,dwell_us,total_us\n");
+      for (const HopCost &h : hops) {
+        fprintf(f, "%u,%llu,%u,%d,%d,%.2f,%.2f,%.2f,%.2f\n", h.index,
+                (unsigned long long)h.rf_hz, h.words, h.div_change, h.int_change,
+                h.spi_us, h.lock_us, h.dwell_us, h.total());
+      }
+      fclose(f);
+      printf("Per-hop breakdown written to %s\n\n", c.csv);
+    }
+  }
+
+  // Suggestions: rerun the model with one thing changed at a time
+  printf("Suggestions:\n");
+  int suggestions = 0;
+  auto suggest = [&](const char *what, double us) {
+    double saved = total - us;
+    if (saved < total * 0.01) return;
+    printf("  - %s: ", what); printDuration(us);
+    printf(" (saves "); printDuration(saved); printf(", %.0f%%)\n", 100.0 * saved / total);
+    suggestions++;
+  };
+
+  std::vector<uint64_t> sorted = freqs;
+  std::sort(sorted.begin(), sorted.end());
+  suggest("play the list in ascending order", totalUs(costHops(c, sorted, nullptr)));
+
+  std::vector<uint64_t> dedup = freqs;
+  dedup.erase(std::unique(dedup.begin(), dedup.end()), dedup.end());
+  if (dedup.size() != freqs.size()) {
+    // same total dwell, just without the re-tunes
+    double merged = totalUs(costHops(c, dedup, nullptr)) +
+                    (double)(freqs.size() - dedup.size()) * c.dwell_us;
+    suggest("merge repeated points into longer dwells", merged);
+  }
+
+  if (c.spi_hz < 10e6) {
+    EstConfig fast = c;
+    fast.spi_hz = 10e6;
+    fast.word_ovh_us = 1.0;
+    fast.le_us = 1.0;
+    suggest("10 MHz SPI with a 1 us LE pulse", totalUs(costHops(fast, freqs, nullptr)));
+  }
+
+  if (c.autocal && !c.lock_table) {
+    // Autocal is only really needed when INT moves; keep it on those hops
+    double saved = 0;
+    for (size_t i = 1; i < hops.size(); i++) {
+      if (!hops[i].int_change && !hops[i].div_change) saved += c.autocal_us;
+    }
+    suggest("skip autocal on hops that keep INT (check lock first)", total - saved);
+  }
+
+  suggest("ping-pong between both boards (PingPong_Source_Sketch)", pingPongUs(hops));
+
+  if (!suggestions) printf("  none -- dwell dominates, that's as fast as this plan gets\n");
+
+  return errors ? 1 : 0;
+}
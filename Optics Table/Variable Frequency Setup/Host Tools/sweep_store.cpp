@@ -0,0 +1,837 @@
+// ============================================================================
+// Indexed sweep store: append-only segment log + sparse index (host)
+// ============================================================================
+//
+// Keeps the sweeps from every board and run in one directory, so "all
+// sweeps near 10.52 GHz from last week" reads those sweeps' bytes and
+// nothing else, instead of every results file there is.
+//
+// Build (from this folder):
+//   g++ -O2 -std=c++17 -Wall -I.. sweep_store.cpp -o sweep_store
+//
+//   sweep_store ingest <dir> results.bin --device A --run 7 --start-hz 10e9 --step-hz 10e3
+//                      [--time T] [--period-s S] [--no-compact]
+//   sweep_store query <dir> [--device A] [--run N] [--from T] [--to T]
+//                      [--fmin HZ] [--fmax HZ] [--sweeps] [--csv out.csv]
+//   sweep_store compact <dir> [--min-segments N]
+//   sweep_store info <dir>
+//
+// results.bin is anything made of flash result pages (the board's results
+// area, lab_twin -o). Pages written again after a reset replace the older
+// copies, and a new sweep starts at every index 0 (resultPagesCurrent in
+// result_page.h, as in resonance_fit). --time is the first sweep's start
+// (default: the file's modification time), --period-s the spacing of the
+// rest.
+//
+// T is unix seconds, 2026-10-11 or 2026-10-11T14:00:00 (UTC), or relative
+// to now: -7d, -12h, -30m.
+//
+// Layout of <dir>:
+//   seg-NNNNNN.dat   StoreRecord (64 B) + uint32 readings[count] per sweep,
+//                    8-byte aligned, never rewritten in place
+//   seg-NNNNNN.idx   one StoreIndexEntry (64 B) per record: device, run,
+//                    start time, frequency span, offset into the .dat
+//   MANIFEST         per segment: records, bytes, time and frequency
+//                    bounds. Replaced atomically (write, fsync, rename).
+//
+// A query drops whole segments on the manifest bounds, walks the index of
+// the rest -- 64 bytes per sweep, not per point -- and maps the .dat files,
+// handing out pointers straight into the mapping, clipped to the requested
+// frequency range. Readings outside a match are never touched.
+//
+// Ingest appends to the one open segment: data, then index, then the
+// manifest. Readers trust only what the manifest counts, so a torn append
+// is invisible (the next ingest trims it). Past SEGMENT_BYTES the segment
+// is sealed and a new one opened.
+//
+// Compaction merges the sealed segments into COMPACTED_BYTES ones sorted by
+// (device, run, time), so a device/run query hits one contiguous stretch,
+// and drops exact duplicates among them (the same file ingested twice).
+// Compacted segments aren't merged again. It holds the lock only to reserve
+// segment ids and to swap the manifest; ingest and queries go on meanwhile.
+// The replaced segments are unlinked right after the swap: a query maps all
+// of its segments before reading any, keeps that view to the end, and if
+// one is already gone reloads the manifest and starts over. Ingest forks
+// compaction into the background once COMPACT_TRIGGER sealed segments have
+// piled up.
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+#include <algorithm>
+#include <functional>
+#include <string>
+#include <vector>
+#include "result_page.h"
+
+// ============================================================================
+// Settings
+// ============================================================================
+static constexpr uint64_t SEGMENT_BYTES   = 16ull << 20;   // seal past this
+static constexpr uint64_t COMPACTED_BYTES = 256ull << 20;  // compaction output
+static constexpr uint32_t COMPACT_TRIGGER = 8;             // sealed segments
+static constexpr int      QUERY_ATTEMPTS  = 5;             // a segment compacted away
+static constexpr uint32_t STORE_MAGIC     = 0x53575354;    // "TSWS"
+static constexpr uint32_t STORE_VERSION   = 1;
+
+// ============================================================================
+// On-disk layout
+// ============================================================================
+#pragma pack(push, 1)
+struct StoreRecord {
+  uint32_t magic;           // STORE_MAGIC
+  uint32_t count;           // readings that follow
+  char     device[16];      // NUL-padded
+  uint32_t run;
+  uint32_t crc;             // CRC-32 of the readings
+  int64_t  t_ns;            // sweep start, unix time
+  uint64_t f0_hz;           // reading 0
+  uint64_t step_hz;
+  uint64_t reserved;
+};
+
+struct StoreIndexEntry {
+  char     device[16];
+  uint32_t run;
+  uint32_t count;
+  int64_t  t_ns;
+  uint64_t f_lo_hz;         // reading 0
+  uint64_t f_hi_hz;         // last reading
+  uint64_t offset;          // of the StoreRecord in the .dat
+  uint32_t crc;             // the record's, for duplicate detection
+  uint32_t reserved;
+};
+#pragma pack(pop)
+
+static_assert(sizeof(StoreRecord) == 64, "record header layout");
+static_assert(sizeof(StoreIndexEntry) == 64, "index entry layout");
+
+static uint32_t crc32(const void *data, size_t n) {
+  static uint32_t table[256];
+  if (!table[1]) {
+    for (uint32_t i = 0; i < 256; i++) {
+      uint32_t c = i;
+      for (int k = 0; k < 8; k++) c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+      table[i] = c;
+    }
+  }
+  const uint8_t *p = (const uint8_t *)data;
+  uint32_t c = 0xFFFFFFFFu;
+  while (n--) c = table[(c ^ *p++) & 0xFF] ^ (c >> 8);
+  return c ^ 0xFFFFFFFFu;
+}
+
+static inline uint64_t recordBytes(uint32_t count) {
+  return (sizeof(StoreRecord) + (uint64_t)count * 4 + 7) & ~7ull;
+}
+
+// ============================================================================
+// Manifest
+// ============================================================================
+struct SegInfo {
+  uint32_t id = 0;
+  bool     sealed = false;
+  bool     compacted = false; // sealed, written by compaction
+  uint64_t records = 0;
+  uint64_t bytes = 0;       // committed .dat bytes
+  int64_t  t_min = INT64_MAX, t_max = INT64_MIN;
+  uint64_t f_min = UINT64_MAX, f_max = 0;
+};
+
+struct Manifest {
+  uint32_t next_id = 1;
+  std::vector<SegInfo> segs;
+};
+
+static std::string segPath(const std::string &dir, uint32_t id, const char *ext) {
+  char name[32];
+  snprintf(name, sizeof(name), "/seg-%06u.%s", id, ext);
+  return dir + name;
+}
+
+static void segAdd(SegInfo &s, const StoreIndexEntry &e) {
+  s.records++;
+  s.t_min = std::min(s.t_min, e.t_ns);
+  s.t_max = std::max(s.t_max, e.t_ns);
+  s.f_min = std::min(s.f_min, e.f_lo_hz);
+  s.f_max = std::max(s.f_max, e.f_hi_hz);
+}
+
+// Missing manifest = empty store
+static bool loadManifest(const std::string &dir, Manifest &m) {
+  m = Manifest();
+  FILE *f = fopen((dir + "/MANIFEST").c_str(), "r");
+  if (!f) return errno == ENOENT;
+  char line[256];
+  unsigned version = 0;
+  bool ok = fgets(line, sizeof(line), f) && sscanf(line, "sweep_store %u", &version) == 1 &&
+            version == STORE_VERSION;
+  while (ok && fgets(line, sizeof(line), f)) {
+    SegInfo s;
+    char state[16];
+    long long tmin, tmax;
+    unsigned long long rec, bytes, fmin, fmax;
+    if (sscanf(line, "next %u", &m.next_id) == 1) continue;
+    if (sscanf(line, "seg %u %15s %llu %llu %lld %lld %llu %llu", &s.id, state, &rec, &bytes,
+               &tmin, &tmax, &fmin, &fmax) != 8) {
+      ok = false;
+      break;
+    }
+    s.compacted = strcmp(state, "compacted") == 0;
+    s.sealed = s.compacted || strcmp(state, "sealed") == 0;
+    s.records = rec;
+    s.bytes = bytes;
+    s.t_min = tmin;
+    s.t_max = tmax;
+    s.f_min = fmin;
+    s.f_max = fmax;
+    m.segs.push_back(s);
+  }
+  fclose(f);
+  if (!ok) fprintf(stderr, "%s/MANIFEST: unreadable\n", dir.c_str());
+  return ok;
+}
+
+static const char *segState(const SegInfo &s) {
+  return s.compacted ? "compacted" : s.sealed ? "sealed" : "open";
+}
+
+static bool saveManifest(const std::string &dir, const Manifest &m) {
+  std::string tmp = dir + "/MANIFEST.tmp";
+  FILE *f = fopen(tmp.c_str(), "w");
+  if (!f) { fprintf(stderr, "can't write %s\n", tmp.c_str()); return false; }
+  fprintf(f, "sweep_store %u\nnext %u\n", STORE_VERSION, m.next_id);
+  for (const SegInfo &s : m.segs) {
+    fprintf(f, "seg %u %s %llu %llu %lld %lld %llu %llu\n", s.id, segState(s),
+            (unsigned long long)s.records, (unsigned long long)s.bytes, (long long)s.t_min,
+            (long long)s.t_max, (unsigned long long)s.f_min, (unsigned long long)s.f_max);
+  }
+  fflush(f);
+  bool ok = fsync(fileno(f)) == 0;
+  ok &= fclose(f) == 0;
+  ok = ok && rename(tmp.c_str(), (dir + "/MANIFEST").c_str()) == 0;
+  if (!ok) fprintf(stderr, "can't replace %s/MANIFEST\n", dir.c_str());
+  return ok;
+}
+
+// Serialises writers (ingest, the manifest swap of a compaction)
+struct DirLock {
+  int fd = -1;
+  bool take(const std::string &path, bool wait = true) {
+    fd = open(path.c_str(), O_RDWR | O_CREAT, 0644);
+    if (fd < 0) return false;
+    if (flock(fd, LOCK_EX | (wait ? 0 : LOCK_NB)) != 0) { close(fd); fd = -1; return false; }
+    return true;
+  }
+  void release() {
+    if (fd >= 0) close(fd);
+    fd = -1;
+  }
+  ~DirLock() { release(); }
+};
+
+// ============================================================================
+// Mapping
+// ============================================================================
+struct Mapped {
+  const uint8_t *p = nullptr;
+  size_t n = 0;
+  Mapped() = default;
+  Mapped(const Mapped &) = delete;
+  Mapped &operator=(const Mapped &) = delete;
+  ~Mapped() { if (p) munmap((void *)p, n); }
+};
+
+// Maps the first `len` bytes (the committed part; the open segment may be
+// longer on disk). With `missing`, a file that doesn't exist is reported
+// there instead of on stderr.
+static bool mapFile(const std::string &path, size_t len, Mapped &m, int advice,
+                    bool *missing = nullptr) {
+  if (!len) return true;
+  int fd = open(path.c_str(), O_RDONLY);
+  if (fd < 0 && missing && errno == ENOENT) { *missing = true; return false; }
+  if (fd < 0) { fprintf(stderr, "can't open %s\n", path.c_str()); return false; }
+  void *a = mmap(nullptr, len, PROT_READ, MAP_SHARED, fd, 0);
+  close(fd);
+  if (a == MAP_FAILED) { fprintf(stderr, "can't map %s\n", path.c_str()); return false; }
+  madvise(a, len, advice);
+  m.p = (const uint8_t *)a;
+  m.n = len;
+  return true;
+}
+
+// ============================================================================
+// Time
+// ============================================================================
+static int64_t nowNs() {
+  timespec ts;
+  clock_gettime(CLOCK_REALTIME, &ts);
+  return (int64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+static bool parseTime(const char *s, int64_t &ns) {
+  char *end;
+  if (s[0] == '-') {
+    double v = strtod(s + 1, &end);
+    double unit = *end == 'd' ? 86400 : *end == 'h' ? 3600 : *end == 'm' ? 60 : *end == 's' ? 1 : 0;
+    if (end == s + 1 || unit == 0 || end[1]) return false;
+    ns = nowNs() - (int64_t)(v * unit * 1e9);
+    return true;
+  }
+  tm t = {};
+  int n = sscanf(s, "%d-%d-%dT%d:%d:%d", &t.tm_year, &t.tm_mon, &t.tm_mday,
+                 &t.tm_hour, &t.tm_min, &t.tm_sec);
+  if (n >= 3 && strchr(s, '-')) {
+    t.tm_year -= 1900;
+    t.tm_mon -= 1;
+    ns = (int64_t)timegm(&t) * 1000000000;
+    return true;
+  }
+  double v = strtod(s, &end);
+  if (end == s || *end) return false;
+  ns = (int64_t)(v * 1e9);
+  return true;
+}
+
+static std::string fmtTime(int64_t ns) {
+  time_t sec = (time_t)(ns / 1000000000);
+  tm t;
+  gmtime_r(&sec, &t);
+  char buf[32];
+  strftime(buf, sizeof(buf), "%Y-%m-%dT%H:%M:%S", &t);
+  return buf;
+}
+
+// ============================================================================
+// Ingest
+// ============================================================================
+struct SweepIn {
+  uint32_t first_index;
+  std::vector<uint32_t> readings;   // dense, gaps (dropped pages) 0xFFFFFFFF
+};
+
+// Current result pages in file order (resultPagesCurrent), a new sweep at
+// every index 0
+static bool readSweeps(const char *path, std::vector<SweepIn> &out, int64_t *mtime_ns) {
+  int fd = open(path, O_RDONLY);
+  if (fd < 0) { fprintf(stderr, "can't open %s\n", path); return false; }
+  struct stat st;
+  fstat(fd, &st);
+  close(fd);
+  *mtime_ns = (int64_t)st.st_mtim.tv_sec * 1000000000 + st.st_mtim.tv_nsec;
+  Mapped m;
+  if (!mapFile(path, (size_t)st.st_size, m, MADV_SEQUENTIAL)) return false;
+
+  const ResultPage *pages = (const ResultPage *)m.p;
+  uint32_t n = (uint32_t)(m.n / sizeof(ResultPage));
+  std::vector<uint8_t> keep((n + 7) / 8);
+  uint32_t bad = resultPagesCurrent(pages, n, keep.data());
+  for (uint32_t i = 0; i < n; i++) {
+    if (!resultPageKept(keep.data(), i)) continue;
+    const ResultPage &pg = pages[i];
+    if (out.empty() || pg.first_index == 0) {
+      out.push_back(SweepIn());
+      out.back().first_index = pg.first_index;
+    }
+    SweepIn &s = out.back();
+    s.readings.resize(pg.first_index - s.first_index, 0xFFFFFFFFu);
+    s.readings.insert(s.readings.end(), pg.samples, pg.samples + pg.count);
+  }
+  if (bad) fprintf(stderr, "%s: %lu torn pages skipped\n", path, (unsigned long)bad);
+  return true;
+}
+
+static bool writeAll(int fd, const void *p, size_t n, off_t at) {
+  const uint8_t *b = (const uint8_t *)p;
+  while (n) {
+    ssize_t w = pwrite(fd, b, n, at);
+    if (w <= 0) return false;
+    b += w;
+    n -= (size_t)w;
+    at += w;
+  }
+  return true;
+}
+
+// An open segment: both files trimmed to what the manifest counts
+struct SegWriter {
+  SegInfo *info = nullptr;
+  int dat = -1, idx = -1;
+
+  bool open(const std::string &dir, SegInfo &s) {
+    info = &s;
+    dat = ::open(segPath(dir, s.id, "dat").c_str(), O_RDWR | O_CREAT, 0644);
+    idx = ::open(segPath(dir, s.id, "idx").c_str(), O_RDWR | O_CREAT, 0644);
+    if (dat < 0 || idx < 0) return false;
+    return ftruncate(dat, (off_t)s.bytes) == 0 &&
+           ftruncate(idx, (off_t)(s.records * sizeof(StoreIndexEntry))) == 0;
+  }
+
+  bool append(const StoreRecord &r, const uint32_t *readings) {
+    StoreIndexEntry e = {};
+    memcpy(e.device, r.device, sizeof(e.device));
+    e.run = r.run;
+    e.count = r.count;
+    e.t_ns = r.t_ns;
+    e.f_lo_hz = r.f0_hz;
+    e.f_hi_hz = r.f0_hz + (uint64_t)(r.count ? r.count - 1 : 0) * r.step_hz;
+    e.offset = info->bytes;
+    e.crc = r.crc;
+
+    uint64_t n = recordBytes(r.count);
+    static const uint8_t pad[8] = {};
+    off_t at = (off_t)info->bytes;
+    if (!writeAll(dat, &r, sizeof(r), at) ||
+        !writeAll(dat, readings, (size_t)r.count * 4, at + sizeof(r)) ||
+        !writeAll(dat, pad, n - sizeof(r) - (uint64_t)r.count * 4, at + sizeof(r) + r.count * 4) ||
+        !writeAll(idx, &e, sizeof(e), (off_t)(info->records * sizeof(e)))) {
+      return false;
+    }
+    info->bytes += n;
+    segAdd(*info, e);
+    return true;
+  }
+
+  bool close() {
+    bool ok = true;
+    if (dat >= 0) { ok &= fdatasync(dat) == 0; ::close(dat); }
+    if (idx >= 0) { ok &= fdatasync(idx) == 0; ::close(idx); }
+    dat = idx = -1;
+    return ok;
+  }
+};
+
+static int cmdCompact(const std::string &dir, uint32_t minSegments, bool quiet);
+
+static int cmdIngest(const std::string &dir, const char *path, const char *device, uint32_t run,
+                     double startHz, double stepHz, const char *timeArg, double periodS,
+                     bool autoCompact) {
+  std::vector<SweepIn> sweeps;
+  int64_t t0;
+  if (!readSweeps(path, sweeps, &t0)) return 2;
+  if (timeArg && !parseTime(timeArg, t0)) { fprintf(stderr, "bad time %s\n", timeArg); return 2; }
+  if (sweeps.empty()) { fprintf(stderr, "%s: no sweeps\n", path); return 1; }
+
+  mkdir(dir.c_str(), 0755);
+  DirLock lock;
+  if (!lock.take(dir + "/LOCK")) { fprintf(stderr, "can't lock %s\n", dir.c_str()); return 1; }
+  Manifest m;
+  if (!loadManifest(dir, m)) return 1;
+
+  auto openSeg = [&]() -> SegInfo & {
+    for (SegInfo &s : m.segs) if (!s.sealed) return s;
+    SegInfo s;
+    s.id = m.next_id++;
+    m.segs.push_back(s);
+    return m.segs.back();
+  };
+
+  SegWriter w;
+  if (!w.open(dir, openSeg())) { fprintf(stderr, "can't open a segment in %s\n", dir.c_str()); return 1; }
+  uint64_t bytes = 0, readings = 0;
+  for (size_t k = 0; k < sweeps.size(); k++) {
+    const SweepIn &s = sweeps[k];
+    StoreRecord r = {};
+    r.magic = STORE_MAGIC;
+    r.count = (uint32_t)s.readings.size();
+    memcpy(r.device, device, std::min(strlen(device), sizeof(r.device)));
+    r.run = run;
+    r.crc = crc32(s.readings.data(), s.readings.size() * 4);
+    r.t_ns = t0 + (int64_t)(k * periodS * 1e9);
+    r.f0_hz = (uint64_t)(startHz + stepHz * s.first_index + 0.5);
+    r.step_hz = (uint64_t)(stepHz + 0.5);
+
+    if (w.info->bytes >= SEGMENT_BYTES) {
+      w.info->sealed = true;
+      if (!w.close() || !w.open(dir, openSeg())) break;
+    }
+    if (!w.append(r, s.readings.data())) {
+      fprintf(stderr, "write failed in segment %u: %s\n", w.info->id, strerror(errno));
+      break;
+    }
+    bytes += recordBytes(r.count);
+    readings += r.count;
+  }
+  // Data and index on disk before the manifest counts them
+  bool ok = w.close() && saveManifest(dir, m);
+  if (!ok) return 1;
+
+  uint32_t sealed = 0;
+  for (const SegInfo &s : m.segs) sealed += s.sealed && !s.compacted;
+  printf("%zu sweeps, %llu readings (%.1f MB) from %s as %s run %u, %s .. %s\n", sweeps.size(),
+         (unsigned long long)readings, bytes / 1048576.0, path, device, run,
+         fmtTime(t0).c_str(), fmtTime(t0 + (int64_t)((sweeps.size() - 1) * periodS * 1e9)).c_str());
+
+  if (autoCompact && sealed >= COMPACT_TRIGGER) {
+    lock.release();
+    pid_t pid = fork();
+    if (pid == 0) {
+      setsid();
+      _exit(cmdCompact(dir, COMPACT_TRIGGER, true));
+    }
+    if (pid > 0) printf("%u sealed segments: compacting in the background (pid %d)\n", sealed, (int)pid);
+  }
+  return 0;
+}
+
+// ============================================================================
+// Query
+// ============================================================================
+struct StoreQuery {
+  std::string device;                 // empty = any
+  bool     anyRun = true;
+  uint32_t run = 0;
+  int64_t  from = INT64_MIN, to = INT64_MAX;
+  uint64_t fmin = 0, fmax = UINT64_MAX;
+};
+
+// A view into the mapped segment: the readings of one sweep inside the
+// frequency range. Valid during the callback only.
+struct StoreSlice {
+  const StoreIndexEntry *entry;
+  const StoreRecord *rec;
+  const uint32_t *readings;
+  uint32_t first;                     // index of readings[0] in the sweep
+  uint32_t n;
+};
+
+struct QueryStats {
+  uint64_t segments = 0, skipped = 0;
+  uint64_t entries = 0, matches = 0;
+  uint64_t readings = 0;
+  uint64_t store_bytes = 0;
+  uint64_t bad = 0;                   // index entries pointing at a broken record
+};
+
+static bool entryMatches(const StoreIndexEntry &e, const StoreQuery &q) {
+  if (e.t_ns < q.from || e.t_ns > q.to) return false;
+  if (e.f_hi_hz < q.fmin || e.f_lo_hz > q.fmax) return false;
+  if (!q.anyRun && e.run != q.run) return false;
+  if (!q.device.empty() && strncmp(e.device, q.device.c_str(), sizeof(e.device)) != 0) return false;
+  return true;
+}
+
+// Maps every segment the query needs, or none: a compaction may unlink a
+// segment between reading the manifest and opening it (*stale is set then).
+// Once mapped, a segment stays readable even if it's unlinked.
+static bool mapSegments(const std::string &dir, const StoreQuery &q, std::vector<SegInfo> &segs,
+                        std::vector<Mapped> &maps, QueryStats &st, bool *stale) {
+  Manifest m;
+  if (!loadManifest(dir, m)) return false;
+  segs.clear();
+  st = QueryStats();
+  for (const SegInfo &s : m.segs) {
+    st.store_bytes += s.bytes;
+    if (!s.records || s.t_max < q.from || s.t_min > q.to || s.f_max < q.fmin || s.f_min > q.fmax) {
+      st.skipped++;
+      continue;
+    }
+    st.segments++;
+    segs.push_back(s);
+  }
+  maps = std::vector<Mapped>(segs.size() * 2);
+  for (size_t k = 0; k < segs.size(); k++) {
+    const SegInfo &s = segs[k];
+    if (!mapFile(segPath(dir, s.id, "idx"), s.records * sizeof(StoreIndexEntry), maps[2 * k],
+                 MADV_SEQUENTIAL, stale) ||
+        !mapFile(segPath(dir, s.id, "dat"), s.bytes, maps[2 * k + 1], MADV_RANDOM, stale)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+static bool storeQuery(const std::string &dir, const StoreQuery &q,
+                       const std::function<void(const StoreSlice &)> &fn, QueryStats &st) {
+  std::vector<SegInfo> segs;
+  std::vector<Mapped> maps;
+  for (int attempt = 1;; attempt++) {
+    bool stale = false;
+    if (mapSegments(dir, q, segs, maps, st, &stale)) break;
+    if (!stale) return false;
+    if (attempt == QUERY_ATTEMPTS) {
+      fprintf(stderr, "%s: segments keep disappearing under the query\n", dir.c_str());
+      return false;
+    }
+  }
+
+  for (size_t k = 0; k < segs.size(); k++) {
+    const SegInfo &s = segs[k];
+    const Mapped &dat = maps[2 * k + 1];
+    const StoreIndexEntry *ents = (const StoreIndexEntry *)maps[2 * k].p;
+    for (uint64_t i = 0; i < s.records; i++) {
+      const StoreIndexEntry &e = ents[i];
+      st.entries++;
+      if (!entryMatches(e, q)) continue;
+      if (e.offset + recordBytes(e.count) > s.bytes) { st.bad++; continue; }
+      const StoreRecord *r = (const StoreRecord *)(dat.p + e.offset);
+      if (r->magic != STORE_MAGIC || r->count != e.count) { st.bad++; continue; }
+
+      // Readings in [fmin, fmax]
+      uint64_t step = r->step_hz ? r->step_hz : 1;
+      uint32_t a = 0, b = r->count;
+      if (q.fmin > r->f0_hz) a = (uint32_t)std::min<uint64_t>((q.fmin - r->f0_hz + step - 1) / step, r->count);
+      if (q.fmax < e.f_hi_hz) b = (uint32_t)std::min<uint64_t>((q.fmax - r->f0_hz) / step + 1, r->count);
+      if (a >= b) continue;
+
+      StoreSlice sl = { &e, r, (const uint32_t *)(r + 1) + a, a, b - a };
+      st.matches++;
+      st.readings += sl.n;
+      fn(sl);
+    }
+  }
+  return true;
+}
+
+static int cmdQuery(const std::string &dir, const StoreQuery &q, bool sweepsOnly, const char *csvPath) {
+  FILE *csv = nullptr;
+  if (csvPath) {
+    csv = strcmp(csvPath, "-") == 0 ? stdout : fopen(csvPath, "w");
+    if (!csv) { fprintf(stderr, "can't write %s\n", csvPath); return 2; }
+    fprintf(csv, "device,run,t_unix,sweep_point,freq_hz,reading\n");
+  }
+
+  QueryStats st;
+  bool ok = storeQuery(dir, q, [&](const StoreSlice &s) {
+    char dev[17] = {};
+    memcpy(dev, s.rec->device, 16);
+    if (sweepsOnly || !csv) {
+      printf("%s run %u %s  %u readings %.6f..%.6f GHz\n", dev, s.rec->run,
+             fmtTime(s.rec->t_ns).c_str(), s.n,
+             (s.rec->f0_hz + (double)s.first * s.rec->step_hz) / 1e9,
+             (s.rec->f0_hz + (double)(s.first + s.n - 1) * s.rec->step_hz) / 1e9);
+    }
+    if (!csv || sweepsOnly) return;
+    double t = s.rec->t_ns / 1e9;
+    for (uint32_t i = 0; i < s.n; i++) {
+      if (s.readings[i] == 0xFFFFFFFFu) continue;   // unplannable / dropped
+      fprintf(csv, "%s,%u,%.3f,%u,%llu,%u\n", dev, s.rec->run, t, s.first + i,
+              (unsigned long long)(s.rec->f0_hz + (uint64_t)(s.first + i) * s.rec->step_hz),
+              s.readings[i]);
+    }
+  }, st);
+  if (csv && csv != stdout) fclose(csv);
+  if (!ok) return 1;
+
+  fprintf(stderr, "%llu sweeps matched: %llu segments searched, %llu skipped on bounds, "
+                  "%llu index entries | %.1f KB of readings read of %.1f MB stored\n",
+          (unsigned long long)st.matches, (unsigned long long)st.segments,
+          (unsigned long long)st.skipped, (unsigned long long)st.entries,
+          st.readings * 4 / 1024.0, st.store_bytes / 1048576.0);
+  if (st.bad) fprintf(stderr, "%llu index entries point at broken records\n", (unsigned long long)st.bad);
+  return 0;
+}
+
+// ============================================================================
+// Compaction
+// ============================================================================
+struct CompactEntry {
+  StoreIndexEntry e;
+  const uint8_t *rec;                 // in the mapped input
+};
+
+static bool entryLess(const CompactEntry &a, const CompactEntry &b) {
+  int d = strncmp(a.e.device, b.e.device, sizeof(a.e.device));
+  if (d) return d < 0;
+  if (a.e.run != b.e.run) return a.e.run < b.e.run;
+  if (a.e.t_ns != b.e.t_ns) return a.e.t_ns < b.e.t_ns;
+  return a.e.f_lo_hz < b.e.f_lo_hz;
+}
+
+static bool entrySame(const CompactEntry &a, const CompactEntry &b) {
+  return strncmp(a.e.device, b.e.device, sizeof(a.e.device)) == 0 && a.e.run == b.e.run &&
+         a.e.t_ns == b.e.t_ns && a.e.f_lo_hz == b.e.f_lo_hz && a.e.count == b.e.count &&
+         a.e.crc == b.e.crc;
+}
+
+static bool reserveId(const std::string &dir, uint32_t &id) {
+  DirLock lock;
+  Manifest m;
+  if (!lock.take(dir + "/LOCK") || !loadManifest(dir, m)) return false;
+  id = m.next_id++;
+  return saveManifest(dir, m);
+}
+
+static int cmdCompact(const std::string &dir, uint32_t minSegments, bool quiet) {
+  // One compaction at a time; ingest isn't held up by this lock
+  DirLock running;
+  if (!running.take(dir + "/COMPACT", false)) {
+    if (!quiet) fprintf(stderr, "a compaction is already running\n");
+    return 0;
+  }
+
+  Manifest m;
+  if (!loadManifest(dir, m)) return 1;
+  std::vector<SegInfo> inputs;
+  for (const SegInfo &s : m.segs) if (s.sealed && !s.compacted) inputs.push_back(s);
+  if (inputs.size() < std::max<uint32_t>(minSegments, 2)) {
+    if (!quiet) printf("%zu sealed segments, nothing to compact\n", inputs.size());
+    return 0;
+  }
+
+  // Sealed segments never change, so they're read without the lock
+  std::vector<Mapped> maps(inputs.size() * 2);
+  std::vector<CompactEntry> all;
+  for (size_t k = 0; k < inputs.size(); k++) {
+    const SegInfo &s = inputs[k];
+    Mapped &idx = maps[2 * k], &dat = maps[2 * k + 1];
+    if (!mapFile(segPath(dir, s.id, "idx"), s.records * sizeof(StoreIndexEntry), idx, MADV_SEQUENTIAL) ||
+        !mapFile(segPath(dir, s.id, "dat"), s.bytes, dat, MADV_SEQUENTIAL)) {
+      return 1;
+    }
+    const StoreIndexEntry *ents = (const StoreIndexEntry *)idx.p;
+    for (uint64_t i = 0; i < s.records; i++) {
+      if (ents[i].offset + recordBytes(ents[i].count) > s.bytes) continue;
+      all.push_back({ ents[i], dat.p + ents[i].offset });
+    }
+  }
+  size_t before = all.size();
+  std::stable_sort(all.begin(), all.end(), entryLess);
+  all.erase(std::unique(all.begin(), all.end(), entrySame), all.end());
+
+  // Outputs
+  std::vector<SegInfo> outputs;
+  SegWriter w;
+  for (const CompactEntry &c : all) {
+    if (outputs.empty() || outputs.back().bytes >= COMPACTED_BYTES) {
+      if (!outputs.empty() && !w.close()) return 1;
+      SegInfo s;
+      s.sealed = s.compacted = true;
+      if (!reserveId(dir, s.id)) return 1;
+      outputs.push_back(s);
+      if (!w.open(dir, outputs.back())) return 1;
+    }
+    const StoreRecord *r = (const StoreRecord *)c.rec;
+    if (!w.append(*r, (const uint32_t *)(r + 1))) return 1;
+  }
+  if (!w.close()) return 1;
+
+  // Swap: inputs out, outputs in, whatever ingest added meanwhile kept
+  {
+    DirLock lock;
+    if (!lock.take(dir + "/LOCK") || !loadManifest(dir, m)) return 1;
+    std::vector<SegInfo> segs;
+    for (const SegInfo &s : m.segs) {
+      bool replaced = false;
+      for (const SegInfo &in : inputs) replaced |= in.id == s.id;
+      if (!replaced) segs.push_back(s);
+    }
+    segs.insert(segs.begin(), outputs.begin(), outputs.end());
+    std::sort(segs.begin(), segs.end(), [](const SegInfo &a, const SegInfo &b) { return a.id < b.id; });
+    m.segs = segs;
+    if (!saveManifest(dir, m)) return 1;
+  }
+  uint64_t freed = 0, kept = 0;
+  for (const SegInfo &s : inputs) {
+    freed += s.bytes;
+    unlink(segPath(dir, s.id, "dat").c_str());
+    unlink(segPath(dir, s.id, "idx").c_str());
+  }
+  for (const SegInfo &s : outputs) kept += s.bytes;
+  if (!quiet) {
+    printf("%zu segments -> %zu, %zu sweeps (%zu duplicates dropped), %.1f MB -> %.1f MB\n",
+           inputs.size(), outputs.size(), all.size(), before - all.size(),
+           freed / 1048576.0, kept / 1048576.0);
+  }
+  return 0;
+}
+
+// ============================================================================
+// Info
+// ============================================================================
+static int cmdInfo(const std::string &dir) {
+  Manifest m;
+  if (!loadManifest(dir, m)) return 1;
+  uint64_t records = 0, bytes = 0;
+  for (const SegInfo &s : m.segs) {
+    records += s.records;
+    bytes += s.bytes;
+    if (!s.records) {
+      printf("seg %06u %-9s empty\n", s.id, segState(s));
+      continue;
+    }
+    printf("seg %06u %-9s %8llu sweeps %9.1f MB  %s .. %s  %.6f..%.6f GHz\n", s.id,
+           segState(s), (unsigned long long)s.records, s.bytes / 1048576.0,
+           fmtTime(s.t_min).c_str(), fmtTime(s.t_max).c_str(), s.f_min / 1e9, s.f_max / 1e9);
+  }
+  printf("%zu segments, %llu sweeps, %.1f MB\n", m.segs.size(), (unsigned long long)records,
+         bytes / 1048576.0);
+  return 0;
+}
+
+// ============================================================================
+// main
+// ============================================================================
+static void usage() {
+  fprintf(stderr,
+    "usage: sweep_store ingest <dir> <results.bin> --device NAME --run N --start-hz HZ --step-hz HZ\n"
+    "                          [--time T] [--period-s S] [--no-compact]\n"
+    "       sweep_store query <dir> [--device NAME] [--run N] [--from T] [--to T]\n"
+    "                          [--fmin HZ] [--fmax HZ] [--sweeps] [--csv FILE|-]\n"
+    "       sweep_store compact <dir> [--min-segments N]\n"
+    "       sweep_store info <dir>\n"
+    "  T: unix seconds, 2026-10-11[T14:00:00] (UTC), or -7d / -12h / -30m from now\n");
+}
+
+int main(int argc, char **argv) {
+  if (argc < 3) { usage(); return 2; }
+  std::string cmd = argv[1];
+  std::string dir = argv[2];
+
+  const char *input = nullptr, *device = nullptr, *timeArg = nullptr, *csvPath = nullptr;
+  double startHz = 0, stepHz = 0, periodS = 1;
+  bool haveRun = false, sweepsOnly = false, autoCompact = true;
+  uint32_t run = 0, minSegments = 2;
+  StoreQuery q;
+
+  for (int i = 3; i < argc; i++) {
+    std::string a = argv[i];
+    auto next = [&]() -> const char * {
+      if (i + 1 >= argc) { usage(); exit(2); }
+      return argv[++i];
+    };
+    auto timeOpt = [&](int64_t &ns) {
+      const char *s = next();
+      if (!parseTime(s, ns)) { fprintf(stderr, "bad time %s\n", s); exit(2); }
+    };
+    if      (a == "--device")       device = next();
+    else if (a == "--run")          { run = (uint32_t)atol(next()); haveRun = true; }
+    else if (a == "--start-hz")     startHz = atof(next());
+    else if (a == "--step-hz")      stepHz = atof(next());
+    else if (a == "--time")         timeArg = next();
+    else if (a == "--period-s")     periodS = atof(next());
+    else if (a == "--no-compact")   autoCompact = false;
+    else if (a == "--from")         timeOpt(q.from);
+    else if (a == "--to")           timeOpt(q.to);
+    else if (a == "--fmin")         q.fmin = (uint64_t)atof(next());
+    else if (a == "--fmax")         q.fmax = (uint64_t)atof(next());
+    else if (a == "--sweeps")       sweepsOnly = true;
+    else if (a == "--csv")          csvPath = next();
+    else if (a == "--min-segments") minSegments = (uint32_t)atoi(next());
+    else if (a[0] == '-' && a.size() > 1) { usage(); return 2; }
+    else input = argv[i];
+  }
+
+  if (cmd == "ingest") {
+    if (!input || !device || !haveRun || stepHz <= 0) { usage(); return 2; }
+    return cmdIngest(dir, input, device, run, startHz, stepHz, timeArg, periodS, autoCompact);
+  }
+  if (cmd == "query") {
+    if (device) q.device = device;
+    q.anyRun = !haveRun;
+    q.run = run;
+    return cmdQuery(dir, q, sweepsOnly, csvPath);
+  }
+  if (cmd == "compact") return cmdCompact(dir, minSegments, false);
+  if (cmd == "info") return cmdInfo(dir);
+  usage();
+  return 2;
+}
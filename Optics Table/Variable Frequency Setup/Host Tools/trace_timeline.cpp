@@ -0,0 +1,793 @@
+// ============================================================================
+// Merged trace timeline: host + every bulk-transport board on one clock
+// ============================================================================
+//
+// Build (from this folder, needs libusb-1.0 dev package):
+//   g++ -O2 -std=c++17 -Wall -I.. trace_timeline.cpp -o trace_timeline -lusb-1.0
+//
+//   trace_timeline <seconds> <out.json> [--stream] [--period-ms N] [--burst N]
+//   trace_timeline --simulate <seconds> <out.json> [--devices N]
+//
+// Opens every USB_Bulk_Transport_Sketch device it finds. Every period it
+// runs a burst of USB_T_TIME exchanges with each (t1 host send, t2 device
+// receive, t3 device send, t4 host receive) and reads the device's trace
+// ring. Per device, offset and drift are fitted over a sliding window:
+// only the lowest-delay exchanges are used (queueing behind stream frames
+// and USB frame alignment only ever add delay), outliers are dropped, and
+// a line through the rest gives offset + drift. Device events are rebased
+// with the fit current when they're read -- they're at most a period old.
+//
+// Output is Chrome trace-event JSON, which ui.perfetto.dev (and
+// chrome://tracing) open directly: one process per device with a track
+// per board / acquisition / USB, plus a host process with the time
+// exchanges and a clock counter per device (offset residual, round trip).
+//
+// --stream starts sample streaming on every device for the run (upload a
+// table first with usb_bulk_client so there are hops to see).
+// --simulate runs the estimator against fake devices with known offset,
+// drift and asymmetric USB delays, and reports how well hops that really
+// happened at the same instant line up after rebasing.
+//
+// On Linux, add a udev rule (or run as root) for VID 2e8a.
+
+#include <math.h>
+#include <stdarg.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <algorithm>
+#include <deque>
+#include <random>
+#include <string>
+#include <vector>
+#include <libusb-1.0/libusb.h>
+#include "usb_protocol.h"
+
+static constexpr int      IN_XFERS         = 4;
+static constexpr double   SYNC_WINDOW_NS   = 30e9;    // fit over the last 30 s of exchanges
+static constexpr size_t   SYNC_MAX_SAMPLES = 2048;
+static constexpr double   SYNC_KEEP_FRAC   = 0.3;     // lowest-delay share used in the fit
+static constexpr double   SYNC_MIN_SPAN_NS = 1e9;     // below this, offset only (no drift)
+static constexpr double   SYNC_MAX_DRIFT   = 1e-3;    // 1000 ppm: anything more is a bad fit
+static constexpr double   REPLY_TIMEOUT_S  = 0.05;
+
+static int64_t nowNs() {
+  timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (int64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+// ============================================================================
+// Clock estimator
+// ============================================================================
+//
+// Host times are ns since the run started; device offsets are kept relative
+// to the first one seen (base_ns), so everything stays small enough for
+// doubles to hold ns exactly.
+//
+//   offset = ((t2 - t1) + (t3 - t4)) / 2      device - host, at (t1 + t4) / 2
+//   delay  = (t4 - t1) - (t3 - t2)            round trip minus device time
+//
+// Fit: offset(h) = a + b (h - ref), ref = newest exchange.
+
+struct SyncSample {
+  double host_ns;
+  double offset_ns;          // minus base_ns
+  double delay_ns;
+};
+
+struct ClockFit {
+  bool   valid;
+  double ref_ns;
+  double offset_ns;          // a, minus base_ns
+  double drift;              // b (device runs fast by this fraction)
+  double resid_ns;           // RMS over the samples kept
+  uint32_t used;
+};
+
+struct ClockSync {
+  std::deque<SyncSample> win;
+  ClockFit fit = {};
+  int64_t  base_ns = 0;
+  bool     haveBase = false;
+  double   minDelay_ns = 1e18;
+  uint64_t samples = 0;
+};
+
+static void syncFit(ClockSync &cs);
+
+static SyncSample syncAdd(ClockSync &cs, int64_t t1, uint64_t t2_us, uint64_t t3_us, int64_t t4) {
+  int64_t t2 = (int64_t)t2_us * 1000, t3 = (int64_t)t3_us * 1000;
+  int64_t off2 = (t2 - t1) + (t3 - t4);             // 2 x offset, exact
+  if (!cs.haveBase) {
+    cs.base_ns = off2 / 2;
+    cs.haveBase = true;
+  }
+  SyncSample s;
+  s.host_ns = 0.5 * (double)(t1 + t4);
+  s.offset_ns = 0.5 * (double)(off2 - 2 * cs.base_ns);
+  s.delay_ns = (double)((t4 - t1) - (t3 - t2));
+  cs.win.push_back(s);
+  while (cs.win.size() > SYNC_MAX_SAMPLES || cs.win.front().host_ns < s.host_ns - SYNC_WINDOW_NS)
+    cs.win.pop_front();
+  cs.samples++;
+  if (s.delay_ns < cs.minDelay_ns) cs.minDelay_ns = s.delay_ns;
+  syncFit(cs);
+  return s;
+}
+
+// Least squares through the kept points; slope 0 when they span too little
+static bool fitLine(const std::vector<const SyncSample *> &pts, double ref, bool slope,
+                    double *a, double *b) {
+  size_t n = pts.size();
+  if (!n) return false;
+  double sx = 0, sy = 0;
+  for (const SyncSample *p : pts) { sx += p->host_ns - ref; sy += p->offset_ns; }
+  double mx = sx / n, my = sy / n;
+  double sxx = 0, sxy = 0;
+  for (const SyncSample *p : pts) {
+    double dx = p->host_ns - ref - mx;
+    sxx += dx * dx;
+    sxy += dx * (p->offset_ns - my);
+  }
+  *b = (slope && n >= 2 && sxx > 0) ? sxy / sxx : 0;
+  *a = my - *b * mx;
+  return true;
+}
+
+static void syncFit(ClockSync &cs) {
+  if (cs.win.empty()) return;
+  double ref = cs.win.back().host_ns;
+
+  // Lowest-delay share of the window (at least 3, or everything there is)
+  std::vector<double> delays;
+  for (const SyncSample &s : cs.win) delays.push_back(s.delay_ns);
+  size_t keep = std::max<size_t>(3, (size_t)(delays.size() * SYNC_KEEP_FRAC));
+  keep = std::min(keep, delays.size());
+  std::nth_element(delays.begin(), delays.begin() + (keep - 1), delays.end());
+  double cut = delays[keep - 1];
+
+  std::vector<const SyncSample *> pts;
+  for (const SyncSample &s : cs.win) if (s.delay_ns <= cut) pts.push_back(&s);
+  bool slope = pts.back()->host_ns - pts.front()->host_ns >= SYNC_MIN_SPAN_NS;
+
+  double a, b;
+  fitLine(pts, ref, slope, &a, &b);
+
+  // One pass of outlier rejection: 4 x MAD (robust sigma), floor 20 us
+  std::vector<double> res;
+  for (const SyncSample *p : pts) res.push_back(fabs(p->offset_ns - (a + b * (p->host_ns - ref))));
+  std::vector<double> sorted = res;
+  std::nth_element(sorted.begin(), sorted.begin() + sorted.size() / 2, sorted.end());
+  double lim = std::max(4 * 1.4826 * sorted[sorted.size() / 2], 20000.0);
+  std::vector<const SyncSample *> kept;
+  for (size_t i = 0; i < pts.size(); i++) if (res[i] <= lim) kept.push_back(pts[i]);
+  if (kept.size() >= 2 && kept.size() < pts.size()) fitLine(kept, ref, slope, &a, &b);
+  else kept = pts;
+
+  // A slope that no crystal has means the window is junk: keep the old drift
+  if (fabs(b) > SYNC_MAX_DRIFT) {
+    b = cs.fit.valid ? cs.fit.drift : 0;
+    a = 0;
+    for (const SyncSample *p : kept) a += p->offset_ns - b * (p->host_ns - ref);
+    a /= kept.size();
+  }
+
+  double ss = 0;
+  for (const SyncSample *p : kept) {
+    double r = p->offset_ns - (a + b * (p->host_ns - ref));
+    ss += r * r;
+  }
+  cs.fit.valid = true;
+  cs.fit.ref_ns = ref;
+  cs.fit.offset_ns = a;
+  cs.fit.drift = b;
+  cs.fit.resid_ns = sqrt(ss / kept.size());
+  cs.fit.used = (uint32_t)kept.size();
+}
+
+// Device clock (us since its boot) -> host ns since the run started.
+// dev = host + a + b (host - ref) - base, solved for host.
+static double syncToHost(const ClockSync &cs, uint64_t dev_us) {
+  const ClockFit &f = cs.fit;
+  double dev = (double)((int64_t)dev_us * 1000 - cs.base_ns);
+  return (dev - f.offset_ns + f.drift * f.ref_ns) / (1 + f.drift);
+}
+
+// Offset the fit predicts at host time h (for the residual counter)
+static double syncOffsetAt(const ClockSync &cs, double host_ns) {
+  return cs.fit.offset_ns + cs.fit.drift * (host_ns - cs.fit.ref_ns);
+}
+
+// ============================================================================
+// Timeline (Chrome trace-event JSON)
+// ============================================================================
+struct TlEvent {
+  double ts_us;
+  double dur_us;             // < 0: instant, 'C' counters use args only
+  int    pid, tid;
+  char   ph;
+  std::string name;
+  std::string args;          // JSON object body, may be empty
+};
+
+struct TlTrack {
+  int pid, tid;
+  std::string process, thread;
+};
+
+static std::vector<TlEvent> timeline;
+static std::vector<TlTrack> tracks;
+
+static void tlSlice(int pid, int tid, double t_ns, double dur_ns, const std::string &name,
+                    const std::string &args = "") {
+  timeline.push_back({ t_ns / 1000, dur_ns / 1000, pid, tid, 'X', name, args });
+}
+
+static void tlInstant(int pid, int tid, double t_ns, const std::string &name,
+                      const std::string &args = "") {
+  timeline.push_back({ t_ns / 1000, -1, pid, tid, 'i', name, args });
+}
+
+static void tlCounter(int pid, double t_ns, const std::string &name, const std::string &args) {
+  timeline.push_back({ t_ns / 1000, -1, pid, 0, 'C', name, args });
+}
+
+static std::string jsonArgs(const char *fmt, ...) __attribute__((format(printf, 1, 2)));
+static std::string jsonArgs(const char *fmt, ...) {
+  char buf[256];
+  va_list ap;
+  va_start(ap, fmt);
+  vsnprintf(buf, sizeof(buf), fmt, ap);
+  va_end(ap);
+  return buf;
+}
+
+static bool writeTimeline(const char *path) {
+  FILE *f = fopen(path, "w");
+  if (!f) return false;
+  std::stable_sort(timeline.begin(), timeline.end(),
+                   [](const TlEvent &x, const TlEvent &y) { return x.ts_us < y.ts_us; });
+
+  fprintf(f, "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n");
+  bool first = true;
+  auto sep = [&]() { if (!first) fputs(",\n", f); first = false; };
+  for (const TlTrack &t : tracks) {
+    sep();
+    fprintf(f, "{\"ph\":\"M\",\"pid\":%d,\"tid\":%d,\"name\":\"process_name\",\"args\":{\"name\":\"%s\"}}",
+            t.pid, t.tid, t.process.c_str());
+    sep();
+    fprintf(f, "{\"ph\":\"M\",\"pid\":%d,\"tid\":%d,\"name\":\"thread_name\",\"args\":{\"name\":\"%s\"}}",
+            t.pid, t.tid, t.thread.c_str());
+  }
+  for (const TlEvent &e : timeline) {
+    sep();
+    fprintf(f, "{\"ph\":\"%c\",\"pid\":%d,\"tid\":%d,\"ts\":%.3f,\"name\":\"%s\"",
+            e.ph, e.pid, e.tid, e.ts_us, e.name.c_str());
+    if (e.ph == 'X') fprintf(f, ",\"dur\":%.3f", e.dur_us);
+    if (e.ph == 'i') fputs(",\"s\":\"t\"", f);
+    if (!e.args.empty()) fprintf(f, ",\"args\":{%s}", e.args.c_str());
+    fputc('}', f);
+  }
+  fprintf(f, "\n]}\n");
+  return fclose(f) == 0;
+}
+
+// ============================================================================
+// Devices
+// ============================================================================
+static constexpr int HOST_PID  = 1;
+static constexpr int HOST_TID_SYNC = 1;
+static constexpr int HOST_TID_CMDS = 2;
+
+static const char *const TRACK_NAMES[] = { "board A", "board B", "acquisition", "usb" };
+
+struct Device {
+  std::string name;
+  int pid;
+  libusb_device_handle *h = nullptr;
+  int itf = -1;
+  uint8_t epIn = 0, epOut = 0;
+  uint32_t txSeq = 0;
+
+  // IN
+  libusb_transfer *xfer[IN_XFERS] = {};
+  uint8_t  buf[IN_XFERS][USB_XFER_BYTES];
+  int      inFlight = 0;
+  std::vector<uint8_t> frame;
+  uint32_t need = sizeof(UsbFrameHeader);
+  bool     haveHeader = false;
+
+  // Exchanges / replies
+  bool     replySeen = false;
+  uint32_t replyTag = 0;
+  UsbTimeReply reply = {};
+  int64_t  replyAt = 0;
+  bool     traceSeen = false;
+  uint64_t sampleFrames = 0;
+
+  ClockSync sync;
+  uint64_t events = 0;
+  uint32_t devDropped = 0;
+  uint32_t timeouts = 0;
+};
+
+static libusb_context *ctx = nullptr;
+static std::vector<Device *> devices;
+static int64_t runStartNs = 0;
+static bool    inStopping = false;
+
+static void addTracks(const Device &d) {
+  for (int t = 0; t < 4; t++) tracks.push_back({ d.pid, t + 1, d.name, TRACK_NAMES[t] });
+}
+
+// Every device with our VID that has a vendor-class bulk IN/OUT interface
+static void openDevices() {
+  if (libusb_init(&ctx) != 0) return;
+  libusb_device **list;
+  ssize_t n = libusb_get_device_list(ctx, &list);
+  for (ssize_t i = 0; i < n; i++) {
+    libusb_device_descriptor dd;
+    if (libusb_get_device_descriptor(list[i], &dd) != 0 || dd.idVendor != USB_BULK_VID) continue;
+
+    libusb_config_descriptor *cfg;
+    if (libusb_get_active_config_descriptor(list[i], &cfg) != 0) continue;
+    Device *d = nullptr;
+    for (int k = 0; k < cfg->bNumInterfaces && !d; k++) {
+      const libusb_interface_descriptor &id = cfg->interface[k].altsetting[0];
+      if (id.bInterfaceClass != 0xFF || id.bNumEndpoints != 2) continue;
+      uint8_t in = 0, out = 0;
+      for (int e = 0; e < 2; e++) {
+        const libusb_endpoint_descriptor &ed = id.endpoint[e];
+        if ((ed.bmAttributes & 3) != LIBUSB_TRANSFER_TYPE_BULK) continue;
+        if (ed.bEndpointAddress & LIBUSB_ENDPOINT_IN) in = ed.bEndpointAddress;
+        else                                         out = ed.bEndpointAddress;
+      }
+      libusb_device_handle *h;
+      if (!in || !out || libusb_open(list[i], &h) != 0) continue;
+      d = new Device;
+      d->h = h;
+      d->itf = id.bInterfaceNumber;
+      d->epIn = in;
+      d->epOut = out;
+    }
+    libusb_free_config_descriptor(cfg);
+    if (!d) continue;
+
+    // Serial number (unique per RP2040 flash chip), else bus/address
+    char name[64] = "";
+    if (dd.iSerialNumber)
+      libusb_get_string_descriptor_ascii(d->h, dd.iSerialNumber, (unsigned char *)name, sizeof(name));
+    if (!name[0])
+      snprintf(name, sizeof(name), "bus %u addr %u", libusb_get_bus_number(list[i]),
+               libusb_get_device_address(list[i]));
+    d->name = std::string("board ") + name;
+
+    libusb_set_auto_detach_kernel_driver(d->h, 1);
+    int r = libusb_claim_interface(d->h, d->itf);
+    if (r != 0) {
+      fprintf(stderr, "%s: claim interface %d: %s\n", d->name.c_str(), d->itf, libusb_error_name(r));
+      libusb_close(d->h);
+      delete d;
+      continue;
+    }
+    d->pid = HOST_PID + 1 + (int)devices.size();
+    devices.push_back(d);
+  }
+  libusb_free_device_list(list, 1);
+}
+
+static void closeDevices() {
+  for (Device *d : devices) {
+    libusb_release_interface(d->h, d->itf);
+    libusb_close(d->h);
+    delete d;
+  }
+  devices.clear();
+  if (ctx) libusb_exit(ctx);
+}
+
+static bool sendFrame(Device &d, uint8_t type, const void *payload, uint32_t len) {
+  std::vector<uint8_t> buf(sizeof(UsbFrameHeader) + len);
+  UsbFrameHeader fh = { USB_FRAME_MAGIC, type, 0, d.txSeq++, len };
+  memcpy(buf.data(), &fh, sizeof(fh));
+  if (len) memcpy(buf.data() + sizeof(fh), payload, len);
+  int done = 0;
+  int r = libusb_bulk_transfer(d.h, d.epOut, buf.data(), (int)buf.size(), &done, 2000);
+  if (r != 0) {
+    fprintf(stderr, "%s: bulk OUT: %s\n", d.name.c_str(), libusb_error_name(r));
+    return false;
+  }
+  if (buf.size() % 64 == 0) libusb_bulk_transfer(d.h, d.epOut, buf.data(), 0, &done, 2000);
+  return true;
+}
+
+// ============================================================================
+// Frames from the devices
+// ============================================================================
+static void onTrace(Device &d, const uint8_t *p, uint32_t len) {
+  UsbTraceHeader th;
+  if (len < sizeof(th)) return;
+  memcpy(&th, p, sizeof(th));
+  if (len < sizeof(th) + (uint64_t)th.count * sizeof(UsbTraceEvent)) return;
+  d.devDropped = th.dropped;
+
+  for (uint32_t i = 0; i < th.count; i++) {
+    UsbTraceEvent e;
+    memcpy(&e, p + sizeof(th) + i * sizeof(e), sizeof(e));
+    double t = syncToHost(d.sync, e.t_us);
+    int tid = (e.track < 4 ? (int)e.track : (int)USB_TRACK_USB) + 1;
+    switch (e.kind) {
+      case USB_EV_HOP:
+        tlSlice(d.pid, tid, t, e.dur_us * 1000.0, "hop", jsonArgs("\"hop\":%u", e.arg));
+        break;
+      case USB_EV_TABLE:
+        tlSlice(d.pid, tid, t, e.dur_us * 1000.0, "plan table", jsonArgs("\"points\":%u", e.arg));
+        break;
+      case USB_EV_ACQ_BLOCK:
+        tlSlice(d.pid, tid, t, e.dur_us * 1000.0, "block", jsonArgs("\"seq\":%u", e.arg));
+        break;
+      case USB_EV_FRAME_DROP:
+        tlInstant(d.pid, tid, t, "frame dropped", jsonArgs("\"sent\":%u", e.arg));
+        break;
+      case USB_EV_TIME:
+        tlSlice(d.pid, tid, t, e.dur_us * 1000.0, "time reply", jsonArgs("\"tag\":%u", e.arg));
+        break;
+      case USB_EV_STREAM:
+        tlInstant(d.pid, tid, t, e.arg ? "stream start" : "stream stop");
+        break;
+      case USB_EV_TABLE_SWAP:
+        tlInstant(d.pid, tid, t, "table swap", jsonArgs("\"table\":%u", e.arg));
+        break;
+      default:
+        tlInstant(d.pid, tid, t, "event", jsonArgs("\"kind\":%u,\"arg\":%u", e.kind, e.arg));
+        break;
+    }
+    d.events++;
+  }
+  d.traceSeen = true;
+}
+
+static void onFrame(Device &d, const UsbFrameHeader &fh, const uint8_t *p, int64_t at) {
+  if (fh.type == USB_T_TIME_REPLY && fh.len >= sizeof(UsbTimeReply)) {
+    memcpy(&d.reply, p, sizeof(d.reply));
+    if (d.reply.tag == d.replyTag) {
+      d.replyAt = at;
+      d.replySeen = true;
+    }
+  } else if (fh.type == USB_T_TRACE) {
+    onTrace(d, p, fh.len);
+  } else if (fh.type == USB_T_SAMPLES) {
+    d.sampleFrames++;
+  }
+}
+
+static void parseBytes(Device &d, const uint8_t *p, size_t n, int64_t at) {
+  while (n) {
+    size_t take = std::min<size_t>(n, d.need - d.frame.size());
+    d.frame.insert(d.frame.end(), p, p + take);
+    p += take;
+    n -= take;
+    if (d.frame.size() < d.need) break;
+
+    const UsbFrameHeader *fh = (const UsbFrameHeader *)d.frame.data();
+    if (!d.haveHeader) {
+      if (fh->magic != USB_FRAME_MAGIC || fh->len > USB_MAX_PAYLOAD) {
+        d.frame.erase(d.frame.begin());
+        continue;
+      }
+      d.haveHeader = true;
+      d.need = sizeof(UsbFrameHeader) + fh->len;
+      if (fh->len) continue;
+    }
+    fh = (const UsbFrameHeader *)d.frame.data();
+    onFrame(d, *fh, d.frame.data() + sizeof(UsbFrameHeader), at);
+    d.frame.clear();
+    d.need = sizeof(UsbFrameHeader);
+    d.haveHeader = false;
+  }
+}
+
+// t4 is taken here, as soon as libusb hands the transfer back
+static void inCallback(libusb_transfer *t) {
+  Device &d = *(Device *)t->user_data;
+  int64_t at = nowNs() - runStartNs;
+  if (t->status == LIBUSB_TRANSFER_COMPLETED) parseBytes(d, t->buffer, t->actual_length, at);
+  if (!inStopping && (t->status == LIBUSB_TRANSFER_COMPLETED ||
+                      t->status == LIBUSB_TRANSFER_TIMED_OUT)) {
+    if (libusb_submit_transfer(t) == 0) return;
+  }
+  d.inFlight--;
+}
+
+static void startIn() {
+  inStopping = false;
+  for (Device *d : devices) {
+    for (int k = 0; k < IN_XFERS; k++) {
+      d->xfer[k] = libusb_alloc_transfer(0);
+      libusb_fill_bulk_transfer(d->xfer[k], d->h, d->epIn, d->buf[k], USB_XFER_BYTES,
+                                inCallback, d, 0);
+      if (libusb_submit_transfer(d->xfer[k]) == 0) d->inFlight++;
+    }
+  }
+}
+
+static void stopIn() {
+  inStopping = true;
+  for (Device *d : devices)
+    for (int k = 0; k < IN_XFERS; k++) libusb_cancel_transfer(d->xfer[k]);
+  for (;;) {
+    int left = 0;
+    for (Device *d : devices) left += d->inFlight;
+    if (!left) break;
+    timeval tv = { 0, 50000 };
+    libusb_handle_events_timeout(ctx, &tv);
+  }
+  for (Device *d : devices)
+    for (int k = 0; k < IN_XFERS; k++) libusb_free_transfer(d->xfer[k]);
+}
+
+template <typename Done>
+static bool pumpUntil(Done done, double timeout_s) {
+  int64_t end = nowNs() + (int64_t)(timeout_s * 1e9);
+  while (!done() && nowNs() < end) {
+    timeval tv = { 0, 1000 };
+    libusb_handle_events_timeout(ctx, &tv);
+  }
+  return done();
+}
+
+// ============================================================================
+// Exchanges
+// ============================================================================
+static uint32_t nextTag = 1;
+
+static void recordExchange(Device &d, int64_t t1, const UsbTimeReply &r, int64_t t4) {
+  SyncSample s = syncAdd(d.sync, t1, r.dev_rx_us, r.dev_tx_us, t4);
+  tlSlice(HOST_PID, HOST_TID_SYNC, (double)t1, (double)(t4 - t1), "time " + d.name,
+          jsonArgs("\"delay_us\":%.1f", s.delay_ns / 1000));
+  tlCounter(HOST_PID, s.host_ns, "clock " + d.name,
+            jsonArgs("\"offset_resid_us\":%.2f,\"delay_us\":%.1f",
+                     (s.offset_ns - syncOffsetAt(d.sync, s.host_ns)) / 1000, s.delay_ns / 1000));
+}
+
+static void timeBurst(Device &d, int burst) {
+  for (int i = 0; i < burst; i++) {
+    UsbTimeRequest q = {};
+    q.tag = nextTag++;
+    d.replyTag = q.tag;
+    d.replySeen = false;
+    int64_t t1 = nowNs() - runStartNs;
+    q.host_tx_ns = (uint64_t)t1;
+    if (!sendFrame(d, USB_T_TIME, &q, sizeof(q))) return;
+    if (!pumpUntil([&]() { return d.replySeen; }, REPLY_TIMEOUT_S)) {
+      d.timeouts++;
+      continue;
+    }
+    recordExchange(d, (int64_t)d.reply.host_tx_ns, d.reply, d.replyAt);
+  }
+}
+
+static void readTrace(Device &d) {
+  d.traceSeen = false;
+  if (!sendFrame(d, USB_T_TRACE_READ, nullptr, 0)) return;
+  pumpUntil([&]() { return d.traceSeen; }, 0.5);
+}
+
+static void hostCommand(uint8_t type, const void *payload, uint32_t len, const char *what) {
+  for (Device *d : devices) {
+    int64_t t = nowNs() - runStartNs;
+    sendFrame(*d, type, payload, len);
+    tlInstant(HOST_PID, HOST_TID_CMDS, (double)t, what, "\"device\":\"" + d->name + "\"");
+  }
+}
+
+// ============================================================================
+// Reporting
+// ============================================================================
+static void printSync(const std::string &name, const ClockSync &cs, uint64_t events,
+                      uint32_t dropped, uint32_t timeouts) {
+  const ClockFit &f = cs.fit;
+  printf("%s: %llu exchanges (%u in fit, %u timeouts), min delay %.0f us | offset %.3f ms, "
+         "drift %+.2f ppm, residual %.1f us | %llu events, %u overwritten on the device\n",
+         name.c_str(), (unsigned long long)cs.samples, f.used, timeouts, cs.minDelay_ns / 1000,
+         (cs.base_ns + f.offset_ns) / 1e6, f.drift * 1e6, f.resid_ns / 1000,
+         (unsigned long long)events, dropped);
+}
+
+static void addHostTracks() {
+  tracks.push_back({ HOST_PID, HOST_TID_SYNC, "host", "time exchanges" });
+  tracks.push_back({ HOST_PID, HOST_TID_CMDS, "host", "commands" });
+}
+
+// ============================================================================
+// Live run
+// ============================================================================
+static int runDevices(double seconds, const char *outPath, bool stream, int periodMs, int burst) {
+  openDevices();
+  if (devices.empty()) {
+    fprintf(stderr, "no device with a vendor bulk interface (VID %04x) found\n", USB_BULK_VID);
+    closeDevices();
+    return 1;
+  }
+  runStartNs = nowNs();
+  addHostTracks();
+  for (Device *d : devices) addTracks(*d);
+  printf("%zu device%s:", devices.size(), devices.size() == 1 ? "" : "s");
+  for (Device *d : devices) printf(" [%s]", d->name.c_str());
+  printf("\n");
+
+  startIn();
+
+  // Some exchanges first so the first trace read already has a fit, and
+  // throw away whatever the ring held from before
+  for (Device *d : devices) timeBurst(*d, burst * 2);
+  for (Device *d : devices) {
+    readTrace(*d);
+    d->events = 0;
+  }
+  timeline.erase(std::remove_if(timeline.begin(), timeline.end(),
+                                [](const TlEvent &e) { return e.pid != HOST_PID; }),
+                 timeline.end());
+
+  UsbStreamStart ss = { USB_STREAM_SAMPLES, { 0, 0, 0 }, 0, 0, 0 };
+  if (stream) hostCommand(USB_T_STREAM_START, &ss, sizeof(ss), "stream start");
+
+  int64_t end = nowNs() + (int64_t)(seconds * 1e9);
+  int64_t next = nowNs();
+  while (nowNs() < end) {
+    for (Device *d : devices) {
+      timeBurst(*d, burst);
+      readTrace(*d);
+    }
+    next += (int64_t)periodMs * 1000000;
+    pumpUntil([&]() { return nowNs() >= next; }, periodMs / 1000.0);
+  }
+
+  if (stream) hostCommand(USB_T_STREAM_STOP, nullptr, 0, "stream stop");
+  for (Device *d : devices) {
+    timeBurst(*d, burst);
+    readTrace(*d);
+  }
+  stopIn();
+
+  for (Device *d : devices) printSync(d->name, d->sync, d->events, d->devDropped, d->timeouts);
+  bool ok = writeTimeline(outPath);
+  if (ok) printf("wrote %s (%zu events)\n", outPath, timeline.size());
+  else    fprintf(stderr, "can't write %s\n", outPath);
+  closeDevices();
+  return ok ? 0 : 2;
+}
+
+// ============================================================================
+// Simulation
+// ============================================================================
+//
+// Each fake device has its own boot offset and crystal error, quantizes to
+// 1 us, and sits behind a USB link whose delays are asymmetric: OUT a few
+// hundred us, IN aligned to 1 ms frames, and now and then stuck behind
+// stream frames for tens of ms. All devices "hop" at the same true host
+// instants, so after rebasing the hops should line up.
+
+struct SimDevice {
+  std::string name;
+  int pid;
+  double boot_ns;            // device time 0 in host time
+  double drift;
+  ClockSync sync;
+  uint64_t events = 0;
+};
+
+static uint64_t simDevUs(const SimDevice &s, double host_ns) {
+  return (uint64_t)(((host_ns - s.boot_ns) * (1 + s.drift)) / 1000);
+}
+
+static int runSimulation(double seconds, const char *outPath, int n, int periodMs, int burst) {
+  std::mt19937_64 rng(12345);
+  std::uniform_real_distribution<double> uni(0, 1);
+  std::exponential_distribution<double> expo(1.0);
+
+  std::vector<SimDevice> sims(n);
+  for (int i = 0; i < n; i++) {
+    SimDevice &s = sims[i];
+    s.name = "sim " + std::to_string(i);
+    s.pid = HOST_PID + 1 + i;
+    s.boot_ns = -(5 + 40 * uni(rng)) * 1e9;            // booted 5..45 s before the run
+    s.drift = (uni(rng) * 2 - 1) * 40e-6;              // +-40 ppm
+    tracks.push_back({ s.pid, 1, s.name, TRACK_NAMES[0] });
+  }
+  addHostTracks();
+
+  const double HOP_NS = 20e6;
+  double nextHop = HOP_NS;
+  std::vector<double> errs;
+  uint32_t tag = 1;
+
+  for (double now = 0; now < seconds * 1e9; now += periodMs * 1e6) {
+    for (SimDevice &s : sims) {
+      double t = now;
+      for (int k = 0; k < burst; k++) {
+        double out = 150e3 + 300e3 * expo(rng);
+        double turn = 20e3 + 10e3 * uni(rng);
+        double rx = t + out, tx = rx + turn;
+        double in = 150e3 + (1e6 - fmod(tx, 1e6)) + 200e3 * expo(rng);
+        if (uni(rng) < 0.1) in += 5e6 + 25e6 * uni(rng);           // queued behind stream frames
+        UsbTimeReply r = {};
+        r.tag = tag++;
+        r.dev_rx_us = simDevUs(s, rx);
+        r.dev_tx_us = simDevUs(s, tx);
+        SyncSample ss = syncAdd(s.sync, (int64_t)t, r.dev_rx_us, r.dev_tx_us, (int64_t)(tx + in));
+        tlCounter(HOST_PID, ss.host_ns, "clock " + s.name,
+                  jsonArgs("\"offset_resid_us\":%.2f,\"delay_us\":%.1f",
+                           (ss.offset_ns - syncOffsetAt(s.sync, ss.host_ns)) / 1000, ss.delay_ns / 1000));
+        t = tx + in;
+      }
+    }
+    // Hops since the last period, read back now and rebased with the current fit
+    for (; nextHop <= now; nextHop += HOP_NS) {
+      for (SimDevice &s : sims) {
+        double t = syncToHost(s.sync, simDevUs(s, nextHop));
+        tlSlice(s.pid, 1, t, 60e3, "hop");
+        errs.push_back(t - nextHop);
+        s.events++;
+      }
+    }
+  }
+
+  for (SimDevice &s : sims) {
+    printSync(s.name, s.sync, s.events, 0, 0);
+    printf("  true: offset %.3f ms, drift %+.2f ppm\n",
+           (simDevUs(s, s.sync.fit.ref_ns) * 1000.0 - s.sync.fit.ref_ns) / 1e6, s.drift * 1e6);
+  }
+  if (!errs.empty()) {
+    double ss = 0, worst = 0;
+    for (double e : errs) { ss += e * e; worst = std::max(worst, fabs(e)); }
+    printf("hop alignment after rebasing: rms %.1f us, max %.1f us over %zu hops\n",
+           sqrt(ss / errs.size()) / 1000, worst / 1000, errs.size());
+  }
+  bool ok = writeTimeline(outPath);
+  if (ok) printf("wrote %s (%zu events)\n", outPath, timeline.size());
+  else    fprintf(stderr, "can't write %s\n", outPath);
+  return ok ? 0 : 2;
+}
+
+// ============================================================================
+// main
+// ============================================================================
+static void usage() {
+  fprintf(stderr,
+    "usage: trace_timeline <seconds> <out.json> [--stream] [--period-ms N] [--burst N]\n"
+    "       trace_timeline --simulate <seconds> <out.json> [--devices N]\n"
+    "  --stream        stream samples on every device during the run\n"
+    "  --period-ms N   time exchanges + trace read every N ms (default 100)\n"
+    "  --burst N       time exchanges per device per period (default 4)\n"
+    "  --devices N     simulated devices (default 3)\n");
+}
+
+int main(int argc, char **argv) {
+  bool simulate = false, stream = false;
+  int periodMs = 100, burst = 4, simDevices = 3;
+  std::vector<const char *> pos;
+
+  for (int i = 1; i < argc; i++) {
+    std::string a = argv[i];
+    auto next = [&]() -> const char * {
+      if (i + 1 >= argc) { usage(); exit(2); }
+      return argv[++i];
+    };
+    if      (a == "--simulate")  simulate = true;
+    else if (a == "--stream")    stream = true;
+    else if (a == "--period-ms") periodMs = atoi(next());
+    else if (a == "--burst")     burst = atoi(next());
+    else if (a == "--devices")   simDevices = atoi(next());
+    else if (a[0] == '-')        { usage(); return 2; }
+    else pos.push_back(argv[i]);
+  }
+  if (pos.size() != 2 || periodMs <= 0 || burst <= 0 || simDevices <= 0) { usage(); return 2; }
+  double seconds = atof(pos[0]);
+
+  if (simulate) return runSimulation(seconds, pos[1], simDevices, periodMs, burst);
+  return runDevices(seconds, pos[1], stream, periodMs, burst);
+}
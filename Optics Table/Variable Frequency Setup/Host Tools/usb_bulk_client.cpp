@@ -0,0 +1,650 @@
+// ============================================================================
+// Host client for the vendor-class bulk interface (USB_Bulk_Transport_Sketch)
+// ============================================================================
+//
+// Build (from this folder, needs libusb-1.0 dev package):
+//   g++ -O2 -std=c++17 -Wall -I.. usb_bulk_client.cpp -o usb_bulk_client -lusb-1.0
+//
+// Commands:
+//   usb_bulk_client ping [n]                 round-trip time
+//   usb_bulk_client upload <freq list | ->   send a hop table (same list format
+//                                            as sweep_estimate)
+//   usb_bulk_client stream <seconds> [file]  acquisition frames, raw payloads
+//                                            (UsbSamplesHeader + data) to file
+//   usb_bulk_client bench <seconds>          device -> host throughput test
+//   usb_bulk_client average <passes> [every] [out.csv]
+//                                            run the uploaded table <passes>
+//                                            times, averaged on the device; a
+//                                            snapshot every <every> passes
+//                                            (0 = final only), CSV of all of them
+//   usb_bulk_client phases <seconds> [--next-hop] <list> <list> ...
+//                                            stream through several tables
+//                                            without stopping: each next one
+//                                            is staged while the current one
+//                                            runs, and swapped in after
+//                                            <seconds>, at the end of a pass
+//                                            (or at the next hop)
+//
+// IN runs as IN_XFERS queued async transfers, resubmitted from the
+// completion callback, so there's always a request waiting at the device
+// and the bus never idles on the host side.
+//
+// On Linux, add a udev rule (or run as root) for VID 2e8a.
+
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <libusb-1.0/libusb.h>
+#include "usb_protocol.h"
+
+static constexpr int IN_XFERS = 8;
+
+// ============================================================================
+// Device
+// ============================================================================
+static libusb_context       *ctx = nullptr;
+static libusb_device_handle *dev = nullptr;
+static int     itfNum = -1;
+static uint8_t epIn = 0, epOut = 0;
+
+static double nowSec() {
+  timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+// First device with our VID that has a vendor-class interface with a bulk
+// IN/OUT pair (the CDC console lives on other interfaces of the same device)
+static bool openDevice() {
+  if (libusb_init(&ctx) != 0) return false;
+
+  libusb_device **list;
+  ssize_t n = libusb_get_device_list(ctx, &list);
+  for (ssize_t i = 0; i < n && !dev; i++) {
+    libusb_device_descriptor dd;
+    if (libusb_get_device_descriptor(list[i], &dd) != 0 || dd.idVendor != USB_BULK_VID) continue;
+
+    libusb_config_descriptor *cfg;
+    if (libusb_get_active_config_descriptor(list[i], &cfg) != 0) continue;
+    for (int k = 0; k < cfg->bNumInterfaces && itfNum < 0; k++) {
+      const libusb_interface_descriptor &id = cfg->interface[k].altsetting[0];
+      if (id.bInterfaceClass != 0xFF || id.bNumEndpoints != 2) continue;
+      uint8_t in = 0, out = 0;
+      for (int e = 0; e < 2; e++) {
+        const libusb_endpoint_descriptor &ed = id.endpoint[e];
+        if ((ed.bmAttributes & 3) != LIBUSB_TRANSFER_TYPE_BULK) continue;
+        if (ed.bEndpointAddress & LIBUSB_ENDPOINT_IN) in = ed.bEndpointAddress;
+        else                                         out = ed.bEndpointAddress;
+      }
+      if (in && out && libusb_open(list[i], &dev) == 0) {
+        itfNum = id.bInterfaceNumber;
+        epIn = in;
+        epOut = out;
+      }
+    }
+    libusb_free_config_descriptor(cfg);
+  }
+  libusb_free_device_list(list, 1);
+  if (!dev) return false;
+
+  libusb_set_auto_detach_kernel_driver(dev, 1);
+  int r = libusb_claim_interface(dev, itfNum);
+  if (r != 0) {
+    fprintf(stderr, "claim interface %d: %s\n", itfNum, libusb_error_name(r));
+    return false;
+  }
+  return true;
+}
+
+static void closeDevice() {
+  if (dev) {
+    libusb_release_interface(dev, itfNum);
+    libusb_close(dev);
+  }
+  if (ctx) libusb_exit(ctx);
+}
+
+// ============================================================================
+// OUT
+// ============================================================================
+static uint32_t txSeq = 0;
+
+static bool sendFrame(uint8_t type, const void *payload, uint32_t len) {
+  std::vector<uint8_t> buf(sizeof(UsbFrameHeader) + len);
+  UsbFrameHeader h = { USB_FRAME_MAGIC, type, 0, txSeq++, len };
+  memcpy(buf.data(), &h, sizeof(h));
+  if (len) memcpy(buf.data() + sizeof(h), payload, len);
+
+  // Big chunks, the host controller splits them into packets
+  size_t off = 0;
+  while (off < buf.size()) {
+    int chunk = (int)std::min<size_t>(buf.size() - off, 16384);
+    int done = 0;
+    int r = libusb_bulk_transfer(dev, epOut, buf.data() + off, chunk, &done, 2000);
+    if (r != 0) {
+      fprintf(stderr, "bulk OUT: %s\n", libusb_error_name(r));
+      return false;
+    }
+    off += done;
+  }
+  // A multiple of the packet size needs a ZLP to end the device's transfer
+  if (buf.size() % 64 == 0) {
+    int done;
+    libusb_bulk_transfer(dev, epOut, buf.data(), 0, &done, 2000);
+  }
+  return true;
+}
+
+// ============================================================================
+// IN (async, stream parser)
+// ============================================================================
+struct RxState {
+  std::vector<uint8_t> frame;            // header + payload being assembled
+  uint32_t need = sizeof(UsbFrameHeader);
+  bool     haveHeader = false;
+  uint32_t lastSeq = 0;
+  bool     seqValid = false;
+  uint32_t seqGaps = 0;
+  uint32_t resyncs = 0;
+  uint64_t bytes = 0;
+  void (*onFrame)(const UsbFrameHeader &, const uint8_t *) = nullptr;
+};
+static RxState rx;
+static libusb_transfer *inXfer[IN_XFERS];
+static uint8_t inBuf[IN_XFERS][USB_XFER_BYTES];
+static int inFlight = 0;
+static bool inStopping = false;
+
+static void parseBytes(const uint8_t *p, size_t n) {
+  rx.bytes += n;
+  while (n) {
+    size_t take = std::min<size_t>(n, rx.need - rx.frame.size());
+    rx.frame.insert(rx.frame.end(), p, p + take);
+    p += take;
+    n -= take;
+    if (rx.frame.size() < rx.need) break;
+
+    const UsbFrameHeader *h = (const UsbFrameHeader *)rx.frame.data();
+    if (!rx.haveHeader) {
+      if (h->magic != USB_FRAME_MAGIC || h->len > USB_MAX_PAYLOAD) {
+        rx.frame.erase(rx.frame.begin());      // slide one byte and retry
+        rx.resyncs++;
+        continue;
+      }
+      rx.haveHeader = true;
+      rx.need = sizeof(UsbFrameHeader) + h->len;
+      if (h->len) continue;
+    }
+
+    h = (const UsbFrameHeader *)rx.frame.data();
+    if (rx.seqValid && h->seq != rx.lastSeq + 1) rx.seqGaps++;
+    rx.lastSeq = h->seq;
+    rx.seqValid = true;
+    if (rx.onFrame) rx.onFrame(*h, rx.frame.data() + sizeof(UsbFrameHeader));
+
+    rx.frame.clear();
+    rx.need = sizeof(UsbFrameHeader);
+    rx.haveHeader = false;
+  }
+}
+
+static void inCallback(libusb_transfer *t) {
+  if (t->status == LIBUSB_TRANSFER_COMPLETED) parseBytes(t->buffer, t->actual_length);
+  if (!inStopping && (t->status == LIBUSB_TRANSFER_COMPLETED ||
+                      t->status == LIBUSB_TRANSFER_TIMED_OUT)) {
+    if (libusb_submit_transfer(t) == 0) return;
+  }
+  inFlight--;
+}
+
+static void startIn() {
+  inStopping = false;
+  for (int k = 0; k < IN_XFERS; k++) {
+    inXfer[k] = libusb_alloc_transfer(0);
+    libusb_fill_bulk_transfer(inXfer[k], dev, epIn, inBuf[k], USB_XFER_BYTES, inCallback, nullptr, 0);
+    if (libusb_submit_transfer(inXfer[k]) == 0) inFlight++;
+  }
+}
+
+static void pumpEvents(double seconds) {
+  double end = nowSec() + seconds;
+  while (nowSec() < end && inFlight > 0) {
+    timeval tv = { 0, 50000 };
+    libusb_handle_events_timeout(ctx, &tv);
+  }
+}
+
+static void stopIn() {
+  inStopping = true;
+  for (int k = 0; k < IN_XFERS; k++) libusb_cancel_transfer(inXfer[k]);
+  while (inFlight > 0) {
+    timeval tv = { 0, 50000 };
+    libusb_handle_events_timeout(ctx, &tv);
+  }
+  for (int k = 0; k < IN_XFERS; k++) libusb_free_transfer(inXfer[k]);
+}
+
+// Waiting for one particular ack while other frames keep arriving
+static bool     ackSeen = false;
+static uint8_t  ackFor = 0;
+static UsbAck   lastAck;
+
+static bool waitAck(uint8_t type, double timeout_s) {
+  ackFor = type;
+  ackSeen = false;
+  double end = nowSec() + timeout_s;
+  while (!ackSeen && nowSec() < end && inFlight > 0) {
+    timeval tv = { 0, 20000 };
+    libusb_handle_events_timeout(ctx, &tv);
+  }
+  return ackSeen;
+}
+
+static void noteAck(const UsbFrameHeader &h, const uint8_t *p) {
+  if (h.type != USB_T_ACK || h.len < sizeof(UsbAck)) return;
+  UsbAck a;
+  memcpy(&a, p, sizeof(a));
+  if (a.type == ackFor) {
+    lastAck = a;
+    ackSeen = true;
+  }
+}
+
+// ============================================================================
+// Commands
+// ============================================================================
+static double pongAt = 0;
+
+static void onPingFrame(const UsbFrameHeader &h, const uint8_t *) {
+  if (h.type == USB_T_PONG) pongAt = nowSec();
+}
+
+static int cmdPing(int count) {
+  rx.onFrame = onPingFrame;
+  startIn();
+  double sum = 0, worst = 0;
+  int ok = 0;
+  for (int i = 0; i < count; i++) {
+    uint32_t tag = i;
+    pongAt = 0;
+    double t0 = nowSec();
+    sendFrame(USB_T_PING, &tag, sizeof(tag));
+    while (pongAt == 0 && nowSec() - t0 < 1.0) {
+      timeval tv = { 0, 1000 };
+      libusb_handle_events_timeout(ctx, &tv);
+    }
+    if (pongAt == 0) { printf("ping %d: timeout\n", i); continue; }
+    double rtt = (pongAt - t0) * 1e6;
+    sum += rtt;
+    if (rtt > worst) worst = rtt;
+    ok++;
+  }
+  stopIn();
+  if (ok) printf("%d/%d pongs, rtt avg %.0f us, max %.0f us\n", ok, count, sum / ok, worst);
+  return ok == count ? 0 : 1;
+}
+
+static bool readFreqList(const char *path, std::vector<uint64_t> &out) {
+  FILE *f = strcmp(path, "-") == 0 ? stdin : fopen(path, "r");
+  if (!f) { fprintf(stderr, "can't open %s\n", path); return false; }
+  char line[256];
+  while (fgets(line, sizeof(line), f)) {
+    char *hash = strchr(line, '#');
+    if (hash) *hash = 0;
+    double a, b, c;
+    if (sscanf(line, " sweep %lf %lf %lf", &a, &b, &c) == 3 && b > 0) {
+      for (double x = a; x <= c + b / 2; x += b) out.push_back((uint64_t)(x + 0.5));
+    } else if (sscanf(line, " %lf", &a) == 1) {
+      out.push_back((uint64_t)(a + 0.5));
+    }
+  }
+  if (f != stdin) fclose(f);
+  return true;
+}
+
+static void onAckFrame(const UsbFrameHeader &h, const uint8_t *p) { noteAck(h, p); }
+
+static int cmdUpload(const char *path) {
+  std::vector<uint64_t> freqs;
+  if (!readFreqList(path, freqs)) return 2;
+  if (freqs.size() > USB_TABLE_SLOT_MAX) {
+    fprintf(stderr, "%zu points, device takes at most %u\n", freqs.size(), USB_TABLE_SLOT_MAX);
+    return 2;
+  }
+
+  rx.onFrame = onAckFrame;
+  startIn();
+  double t0 = nowSec();
+  bool sent = sendFrame(USB_T_TABLE, freqs.data(), (uint32_t)(freqs.size() * 8));
+  double t1 = nowSec();
+  bool acked = sent && waitAck(USB_T_TABLE, 5.0);
+  double t2 = nowSec();
+  stopIn();
+
+  if (!acked) { fprintf(stderr, "no ack from device\n"); return 1; }
+  double kb = freqs.size() * 8 / 1024.0;
+  printf("Uploaded %zu points (%.1f KB) in %.1f ms (%.0f KB/s), acked after %.1f ms\n",
+         freqs.size(), kb, (t1 - t0) * 1e3, kb / (t1 - t0), (t2 - t0) * 1e3);
+  printf("Device: %u planned, %u failed, %u us on the device\n",
+         lastAck.value, lastAck.value2, lastAck.elapsed_us);
+  return lastAck.status == USB_ACK_OK ? 0 : 1;
+}
+
+// --- stream ---
+static FILE    *streamOut = nullptr;
+static uint64_t sampleFrames = 0, samples = 0;
+static uint32_t lastBlock = 0;
+static bool     blockValid = false;
+static uint64_t blockGaps = 0;
+
+static void onSampleFrame(const UsbFrameHeader &h, const uint8_t *p) {
+  noteAck(h, p);
+  if (h.type != USB_T_SAMPLES || h.len < sizeof(UsbSamplesHeader)) return;
+  UsbSamplesHeader sh;
+  memcpy(&sh, p, sizeof(sh));
+  if (blockValid && sh.block_seq != lastBlock + 1) blockGaps += sh.block_seq - lastBlock - 1;
+  lastBlock = sh.block_seq;
+  blockValid = true;
+  sampleFrames++;
+  samples += (uint64_t)sh.channels * sh.per_channel;
+  if (streamOut) fwrite(p, 1, h.len, streamOut);
+}
+
+static int cmdStream(double seconds, const char *outPath) {
+  if (outPath) {
+    streamOut = fopen(outPath, "wb");
+    if (!streamOut) { fprintf(stderr, "can't write %s\n", outPath); return 2; }
+  }
+  rx.onFrame = onSampleFrame;
+  startIn();
+
+  UsbStreamStart s = { USB_STREAM_SAMPLES, { 0, 0, 0 }, 0, 0, 0 };
+  sendFrame(USB_T_STREAM_START, &s, sizeof(s));
+  if (!waitAck(USB_T_STREAM_START, 2.0)) fprintf(stderr, "no ack for stream start\n");
+
+  double t0 = nowSec();
+  uint64_t b0 = rx.bytes;
+  pumpEvents(seconds);
+  double dt = nowSec() - t0;
+  uint64_t bytes = rx.bytes - b0;
+
+  sendFrame(USB_T_STREAM_STOP, nullptr, 0);
+  bool acked = waitAck(USB_T_STREAM_STOP, 2.0);
+  stopIn();
+  if (streamOut) fclose(streamOut);
+
+  printf("%.1f s: %llu frames, %llu samples, %.1f KB/s (%.0f samples/s)\n", dt,
+         (unsigned long long)sampleFrames, (unsigned long long)samples,
+         bytes / 1024.0 / dt, samples / dt);
+  printf("acquisition blocks missing: %llu, frame seq gaps: %u, resyncs: %u\n",
+         (unsigned long long)blockGaps, rx.seqGaps, rx.resyncs);
+  if (acked) printf("device: %u frames sent, %u dropped (ring full)\n", lastAck.value, lastAck.value2);
+  return 0;
+}
+
+// --- bench ---
+static uint32_t nextWord = 0;
+static bool     wordValid = false;
+static uint64_t wordErrors = 0;
+
+static void onPatternFrame(const UsbFrameHeader &h, const uint8_t *p) {
+  noteAck(h, p);
+  if (h.type != USB_T_PATTERN) return;
+  uint32_t n = h.len / 4;
+  for (uint32_t i = 0; i < n; i++) {
+    uint32_t w;
+    memcpy(&w, p + i * 4, 4);
+    if (wordValid && w != nextWord) wordErrors++;
+    nextWord = w + 1;
+    wordValid = true;
+  }
+}
+
+static int cmdBench(double seconds) {
+  rx.onFrame = onPatternFrame;
+  startIn();
+
+  UsbStreamStart s = { USB_STREAM_PATTERN, { 0, 0, 0 }, 0, 0, 0 };
+  sendFrame(USB_T_STREAM_START, &s, sizeof(s));
+  waitAck(USB_T_STREAM_START, 2.0);
+
+  double t0 = nowSec();
+  uint64_t b0 = rx.bytes;
+  pumpEvents(seconds);
+  double dt = nowSec() - t0;
+  uint64_t bytes = rx.bytes - b0;
+
+  sendFrame(USB_T_STREAM_STOP, nullptr, 0);
+  waitAck(USB_T_STREAM_STOP, 2.0);
+  stopIn();
+
+  printf("%.1f s: %.1f KB/s device -> host (full speed bulk tops out near 1100 KB/s)\n",
+         dt, bytes / 1024.0 / dt);
+  printf("pattern errors: %llu, frame seq gaps: %u\n", (unsigned long long)wordErrors, rx.seqGaps);
+  return wordErrors ? 1 : 0;
+}
+
+// --- average ---
+static FILE    *avgOut = nullptr;
+static uint32_t avgSnapshots = 0;
+static uint32_t avgFrames = 0;
+static bool     avgFinal = false;
+
+static void onAverageFrame(const UsbFrameHeader &h, const uint8_t *p) {
+  noteAck(h, p);
+  if (h.type != USB_T_AVERAGE || h.len < sizeof(UsbAverageHeader)) return;
+  UsbAverageHeader ah;
+  memcpy(&ah, p, sizeof(ah));
+  if (h.len < sizeof(ah) + (uint32_t)ah.count * ah.channels * sizeof(UsbAverageCell)) return;
+  avgFrames++;
+  if (avgOut) {
+    for (uint32_t i = 0; i < ah.count; i++) {
+      for (uint8_t ch = 0; ch < ah.channels; ch++) {
+        UsbAverageCell c;
+        memcpy(&c, p + sizeof(ah) + ((size_t)i * ah.channels + ch) * sizeof(c), sizeof(c));
+        fprintf(avgOut, "%u,%u,%u,%u,%.4f,%.4f,%u\n", avgSnapshots, ah.passes_done,
+                ah.first_point + i, ch, c.mean_q8 / 256.0, sqrt(c.var_q8 / 256.0), c.n);
+      }
+    }
+  }
+  if (ah.flags & USB_AVG_LAST) {
+    printf("%s %u/%u passes, %u points x %u receivers\n",
+           (ah.flags & USB_AVG_FINAL) ? "final" : "snapshot", ah.passes_done, ah.passes,
+           ah.points, ah.channels);
+    avgSnapshots++;
+    if (ah.flags & USB_AVG_FINAL) avgFinal = true;
+  }
+}
+
+static int cmdAverage(uint32_t passes, uint32_t every, const char *outPath) {
+  if (outPath) {
+    avgOut = fopen(outPath, "w");
+    if (!avgOut) { fprintf(stderr, "can't write %s\n", outPath); return 2; }
+    fprintf(avgOut, "snapshot,passes,point,receiver,mean_counts,std_counts,n\n");
+  }
+  rx.onFrame = onAverageFrame;
+  startIn();
+
+  UsbStreamStart s = { USB_STREAM_AVERAGE, { 0, 0, 0 }, passes, every, 200 };
+  sendFrame(USB_T_STREAM_START, &s, sizeof(s));
+  if (!waitAck(USB_T_STREAM_START, 2.0) || lastAck.status != USB_ACK_OK) {
+    fprintf(stderr, "device refused (no table uploaded, table too long for averaging, "
+                    "or passes out of 1..65535)\n");
+    stopIn();
+    if (avgOut) fclose(avgOut);
+    return 1;
+  }
+
+  // The device ends the stream itself after the final result. If that
+  // frame is lost, give up a while after the run should have ended.
+  double runSec = (double)passes * lastAck.value * lastAck.value2 / 1e6;
+  double t0 = nowSec();
+  while (!avgFinal && inFlight > 0 && nowSec() - t0 < runSec * 1.25 + 10) pumpEvents(0.5);
+  double dt = nowSec() - t0;
+  if (!avgFinal) fprintf(stderr, "no final result after %.1f s (run should take %.1f s)\n", dt, runSec);
+
+  sendFrame(USB_T_STREAM_STOP, nullptr, 0);
+  waitAck(USB_T_STREAM_STOP, 2.0);
+  stopIn();
+  if (avgOut) fclose(avgOut);
+
+  printf("%.1f s, %u snapshots in %u frames, %.1f KB received (%.1f KB per pass)\n", dt,
+         avgSnapshots, avgFrames, rx.bytes / 1024.0, rx.bytes / 1024.0 / passes);
+  printf("frame seq gaps: %u\n", rx.seqGaps);
+  return avgFinal ? 0 : 1;
+}
+
+// --- phases ---
+static bool         liveSeen = false;
+static UsbTableLive lastLive;
+
+static void onPhaseFrame(const UsbFrameHeader &h, const uint8_t *p) {
+  onSampleFrame(h, p);
+  if (h.type != USB_T_TABLE_LIVE || h.len < sizeof(UsbTableLive)) return;
+  memcpy(&lastLive, p, sizeof(lastLive));
+  liveSeen = true;
+}
+
+static bool stageList(const std::vector<uint64_t> &freqs, uint16_t id, uint8_t when) {
+  std::vector<uint8_t> buf(sizeof(UsbTableStage) + freqs.size() * 8);
+  UsbTableStage st = {};
+  st.table_id = id;
+  st.crc = crc16(freqs.data(), (uint32_t)(freqs.size() * 8));
+  st.swap = when;
+  memcpy(buf.data(), &st, sizeof(st));
+  memcpy(buf.data() + sizeof(st), freqs.data(), freqs.size() * 8);
+  liveSeen = false;
+  if (!sendFrame(USB_T_TABLE_STAGE, buf.data(), (uint32_t)buf.size()) ||
+      !waitAck(USB_T_TABLE_STAGE, 5.0)) {
+    fprintf(stderr, "table %u: no ack\n", id);
+    return false;
+  }
+  if (lastAck.status != USB_ACK_OK) {
+    fprintf(stderr, "table %u: refused (status %u, %u planned, %u failed)\n", id,
+            lastAck.status, lastAck.value, lastAck.value2);
+    return false;
+  }
+  printf("table %u: %u points staged in %.1f ms on the device\n", id, lastAck.value,
+         lastAck.elapsed_us / 1e3);
+  return true;
+}
+
+static int cmdPhases(double seconds, bool nextHop, const std::vector<const char *> &paths) {
+  std::vector<std::vector<uint64_t>> lists(paths.size());
+  for (size_t k = 0; k < paths.size(); k++) {
+    if (!readFreqList(paths[k], lists[k])) return 2;
+    if (lists[k].empty() || lists[k].size() > USB_TABLE_SLOT_MAX) {
+      fprintf(stderr, "%s: %zu points, device takes 1..%u\n", paths[k], lists[k].size(),
+              USB_TABLE_SLOT_MAX);
+      return 2;
+    }
+  }
+
+  rx.onFrame = onPhaseFrame;
+  startIn();
+  int rc = 0;
+  sendFrame(USB_T_TABLE, lists[0].data(), (uint32_t)(lists[0].size() * 8));
+  UsbStreamStart s = { USB_STREAM_SAMPLES, { 0, 0, 0 }, 0, 0, 0 };
+  if (!waitAck(USB_T_TABLE, 5.0) || lastAck.status != USB_ACK_OK) {
+    fprintf(stderr, "first table refused\n");
+    rc = 1;
+  } else {
+    sendFrame(USB_T_STREAM_START, &s, sizeof(s));
+    if (!waitAck(USB_T_STREAM_START, 2.0)) fprintf(stderr, "no ack for stream start\n");
+    printf("table 0 live, %zu points\n", lists[0].size());
+  }
+
+  // Phase k + 1 is staged on hold as soon as phase k is live, and only
+  // armed once phase k has had its <seconds>
+  double phaseStart = nowSec();
+  for (size_t k = 1; k < lists.size() && rc == 0; k++) {
+    if (!stageList(lists[k], (uint16_t)k, USB_SWAP_HOLD)) {
+      rc = 1;
+      break;
+    }
+    double left = seconds - (nowSec() - phaseStart);
+    if (left > 0) pumpEvents(left);
+
+    UsbTableSwap sw = { (uint16_t)k, (uint8_t)(nextHop ? USB_SWAP_NEXT_HOP : USB_SWAP_PASS_END), 0 };
+    double t0 = nowSec();
+    if (!sendFrame(USB_T_TABLE_SWAP, &sw, sizeof(sw)) || !waitAck(USB_T_TABLE_SWAP, 2.0) ||
+        lastAck.status != USB_ACK_OK) {
+      fprintf(stderr, "table %zu: swap refused\n", k);
+      rc = 1;
+      break;
+    }
+    while (!liveSeen && inFlight > 0 && nowSec() - t0 < 60) pumpEvents(0.05);
+    if (!liveSeen) {
+      fprintf(stderr, "table %zu never went live\n", k);
+      rc = 1;
+      break;
+    }
+    phaseStart = nowSec();
+    printf("table %u live at hop %u (%u points), hop gap across the swap %u us\n",
+           lastLive.table_id, lastLive.first_hop, lastLive.points, lastLive.gap_us);
+  }
+  if (rc == 0) pumpEvents(seconds);
+
+  sendFrame(USB_T_STREAM_STOP, nullptr, 0);
+  bool acked = waitAck(USB_T_STREAM_STOP, 2.0);
+  stopIn();
+
+  printf("%llu frames, %llu samples, acquisition blocks missing: %llu, frame seq gaps: %u\n",
+         (unsigned long long)sampleFrames, (unsigned long long)samples,
+         (unsigned long long)blockGaps, rx.seqGaps);
+  if (acked) printf("device: %u frames sent, %u dropped (ring full)\n", lastAck.value, lastAck.value2);
+  return rc;
+}
+
+// ============================================================================
+// main
+// ============================================================================
+static void usage() {
+  fprintf(stderr,
+    "usage: usb_bulk_client ping [n]\n"
+    "       usb_bulk_client upload <freq list | ->\n"
+    "       usb_bulk_client stream <seconds> [out.bin]\n"
+    "       usb_bulk_client bench <seconds>\n"
+    "       usb_bulk_client average <passes> [snapshot every N passes] [out.csv]\n"
+    "       usb_bulk_client phases <seconds> [--next-hop] <list> <list> ...\n");
+}
+
+int main(int argc, char **argv) {
+  if (argc < 2) { usage(); return 2; }
+  std::string cmd = argv[1];
+
+  if (!openDevice()) {
+    fprintf(stderr, "no device with a vendor bulk interface (VID %04x) found\n", USB_BULK_VID);
+    closeDevice();
+    return 1;
+  }
+
+  int rc = 2;
+  if      (cmd == "ping")                rc = cmdPing(argc > 2 ? atoi(argv[2]) : 10);
+  else if (cmd == "upload" && argc > 2)  rc = cmdUpload(argv[2]);
+  else if (cmd == "stream" && argc > 2)  rc = cmdStream(atof(argv[2]), argc > 3 ? argv[3] : nullptr);
+  else if (cmd == "bench" && argc > 2)   rc = cmdBench(atof(argv[2]));
+  else if (cmd == "average" && argc > 2) rc = cmdAverage((uint32_t)atoi(argv[2]),
+                                                         argc > 3 ? (uint32_t)atoi(argv[3]) : 0,
+                                                         argc > 4 ? argv[4] : nullptr);
+  else if (cmd == "phases" && argc > 3) {
+    std::vector<const char *> paths;
+    bool nextHop = false;
+    for (int i = 3; i < argc; i++) {
+      if (strcmp(argv[i], "--next-hop") == 0) nextHop = true;
+      else paths.push_back(argv[i]);
+    }
+    if (paths.empty()) usage();
+    else rc = cmdPhases(atof(argv[2]), nextHop, paths);
+  }
+  else usage();
+
+  closeDevice();
+  return rc;
+}
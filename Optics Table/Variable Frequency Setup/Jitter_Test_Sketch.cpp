@@ -0,0 +1,522 @@
+#include <Arduino.h>
+#include <SPI.h>
+#include "hardware/clocks.h"
+#include "hardware/dma.h"
+#include "hardware/gpio.h"
+#include "hardware/irq.h"
+#include "hardware/pio.h"
+#include "hardware/spi.h"
+#include "hardware/timer.h"
+#include "adf5355_plan.h"
+#include "flash_log.h"
+#include "hot_path.h"
+
+// ============================================================================
+// USER SETTINGS
+// ============================================================================
+//
+// Timing-determinism test for the hot path (hot_path.h). Board A hops on a
+// timer, board B's CE is keyed on a second timer, and PIO measures both
+// edges against clk_sys while the loop stresses everything that used to
+// disturb them: USB traffic, printf-heavy logging, flash writes. Each mode
+// runs for TEST_SECONDS and gets a PASS/FAIL line.
+//
+// Wiring: the dual-board sketch pins. HOP_MARK_PIN needs nothing external
+// (PIO reads it back); for lock latency wire board A's MUXOUT to LD_PIN.
+// Send 'r' to run the suite again.
+
+static constexpr uint32_t HOP_PERIOD_US    = 500;    // hop edge every 500 us
+static constexpr uint32_t KEY_HALF_US      = 250;    // B_CE toggles every 250 us
+static constexpr uint32_t TEST_SECONDS     = 10;     // per stress mode
+static constexpr uint32_t JITTER_LIMIT_NS  = 200;    // p-p, per edge stream
+
+static constexpr uint32_t PFD_HZ          = 10000000;   // must match R4 in the image
+static constexpr uint32_t CHANNEL_STEP_HZ = 10000;
+static constexpr bool     USE_RFOUTB      = true;
+
+// Far apart on purpose, so every hop is a real relock with autocal
+static const uint64_t HOP_FREQS_HZ[] = {
+  10500000000ull, 11000000000ull, 10200000000ull, 11400000000ull,
+};
+
+// ============================================================================
+// PIN DEFINITIONS (dual-board sketch wiring)
+// ============================================================================
+static const int A_SCLK = 18;
+static const int A_MOSI = 19;
+static const int A_LE   = 20;
+static const int A_CE   = 17;
+
+static const int B_CE   = 13;    // keyed; board B only needs to be powered
+
+static const int A_MISO_UNUSED = 16;
+static const int A_CS_UNUSED   = 21;
+
+static const int HOP_MARK_PIN = 4;    // toggles on every hop edge
+static const int LD_PIN       = -1;   // board A MUXOUT (digital lock detect), -1 = not wired
+
+SPIClassRP2040 spiA(spi0, A_MISO_UNUSED, A_CS_UNUSED, A_SCLK, A_MOSI);
+SPISettings pllSPI(1000000, MSBFIRST, SPI_MODE0);
+
+static constexpr PlanConfig planCfg = { PFD_HZ, CHANNEL_STEP_HZ, USE_RFOUTB };
+static constexpr uint32_t HOP_COUNT = sizeof(HOP_FREQS_HZ) / sizeof(HOP_FREQS_HZ[0]);
+
+// ============================================================================
+// SPI
+// ============================================================================
+static inline void pulseLE(int pinLE) {
+  digitalWrite(pinLE, HIGH);
+  delayMicroseconds(2);
+  digitalWrite(pinLE, LOW);
+  delayMicroseconds(2);
+}
+
+static void writeReg(SPIClassRP2040 &spi, int pinLE, uint32_t reg) {
+  spi.beginTransaction(pllSPI);
+  spi.transfer((reg >> 24) & 0xFF);
+  spi.transfer((reg >> 16) & 0xFF);
+  spi.transfer((reg >>  8) & 0xFF);
+  spi.transfer((reg >>  0) & 0xFF);
+  spi.endTransaction();
+  pulseLE(pinLE);
+}
+
+static void HOT_PATH(shiftRaw)(uint32_t reg) {
+  hotSpiWrite32(spi0_hw, reg);
+}
+
+static void HOT_PATH(latchLE)() {
+  hotGpioPut(A_LE, 1);
+  hotBusyWaitUs(1);
+  hotGpioPut(A_LE, 0);
+}
+
+static const uint32_t baseRegs[13] = {
+  0x0001040C, // R12
+  0x0061300B, // R11
+  0x00C0000A, // R10
+  0x00000009, // R9
+  0x102D0428, // R8
+  0x12000007, // R7
+  0x35000006, // R6
+  0x00800005, // R5
+  0x00000004, // R4
+  0x00000003, // R3
+  0x00001002, // R2
+  0x00000A41, // R1
+  0x00550000  // R0 LAST
+};
+
+static constexpr int IDX_R6 = 12 - 6;
+static constexpr int IDX_R4 = 12 - 4;
+static constexpr int IDX_R1 = 12 - 1;
+static constexpr int IDX_R0 = 12 - 0;
+
+static constexpr uint32_t R4_MUXOUT_DLD = 0x30000000;   // MUXOUT = digital lock detect
+
+static void programPLL() {
+  for (int i = 0; i < 13; i++) {
+    uint32_t w = baseRegs[i];
+    if (i == IDX_R4 && LD_PIN >= 0) w |= R4_MUXOUT_DLD;
+    writeReg(spiA, A_LE, w);
+    delay(2);
+  }
+}
+
+// ============================================================================
+// Hot handlers under test
+// ============================================================================
+//
+// Same structure as the hop sketches: R0 for the next hop is shifted in
+// ahead of time and the alarm only latches it, so the edge is the LE pulse
+// (HOP_MARK_PIN toggles right next to it). Hops change the VCO divider, so
+// R6 goes in with the preload too.
+
+struct HopWords { uint32_t r6, r2, r1, r0; };
+static HopWords hopTable[HOP_COUNT];
+
+static int      hopAlarm = -1;
+static int      keyAlarm = -1;
+static uint32_t hopDeadline = 0;
+static uint32_t keyDeadline = 0;
+static uint32_t hopIdx = 0;
+static bool     markLevel = false;
+static bool     keyLevel = true;
+
+// Lock detect (LD_PIN): time from the LE edge to LD going high again
+struct LockStats {
+  uint32_t locks;
+  uint32_t missed;          // next hop came before LD did
+  uint32_t max_us;
+  uint64_t sum_us;
+};
+static volatile LockStats lockStats;
+static volatile uint32_t  lastHopUs = 0;
+static volatile bool      awaitLock = false;
+
+static void buildHopTable() {
+  for (uint32_t i = 0; i < HOP_COUNT; i++) {
+    PllPlan p = planFrequencyInt(planCfg, HOP_FREQS_HZ[i]);
+    hopTable[i].r6 = packR6Div(baseRegs[IDX_R6], p);
+    hopTable[i].r2 = packR2(p);
+    hopTable[i].r1 = packR1(baseRegs[IDX_R1], p);
+    hopTable[i].r0 = packR0(baseRegs[IDX_R0], p) | ADF_R0_AUTOCAL;
+  }
+}
+
+static void HOT_PATH(preloadHop)(uint32_t idx) {
+  const HopWords &w = hopTable[idx];
+  shiftRaw(w.r6); latchLE();
+  shiftRaw(w.r2); latchLE();
+  shiftRaw(w.r1); latchLE();
+  shiftRaw(w.r0);             // latched at the deadline
+}
+
+static void HOT_PATH(hopAlarmIrq)() {
+  hotAlarmAck(hopAlarm);
+  latchLE();                                      // <- the hop edge
+  markLevel = !markLevel;
+  hotGpioPut(HOP_MARK_PIN, markLevel);
+  uint32_t now = hotTimeUs32();
+
+  if (LD_PIN >= 0) {
+    if (awaitLock) lockStats.missed++;
+    lastHopUs = now;
+    awaitLock = true;
+  }
+
+  uint32_t idx = hopIdx + 1;
+  if (idx == HOP_COUNT) idx = 0;
+  hopIdx = idx;
+  preloadHop(idx);
+
+  hopDeadline += HOP_PERIOD_US;
+  hotAlarmArm(hopAlarm, hopDeadline);
+}
+
+static void HOT_PATH(keyAlarmIrq)() {
+  hotAlarmAck(keyAlarm);
+  keyLevel = !keyLevel;
+  hotGpioPut(B_CE, keyLevel);                     // <- the keying edge
+  keyDeadline += KEY_HALF_US;
+  hotAlarmArm(keyAlarm, keyDeadline);
+}
+
+static void HOT_PATH(lockDetectIrq)() {
+  if (!(hotGpioTakeEvents(LD_PIN) & GPIO_IRQ_EDGE_RISE)) return;
+  if (!awaitLock) return;
+  uint32_t us = hotTimeUs32() - lastHopUs;
+  awaitLock = false;
+  lockStats.locks++;
+  lockStats.sum_us += us;
+  if (us > lockStats.max_us) lockStats.max_us = us;
+}
+
+// ============================================================================
+// PIO period counters
+// ============================================================================
+//
+// One state machine per measured pin counts clk_sys cycles from rising edge
+// to rising edge and pushes the count; DMA drains each RX FIFO into a ring
+// so the loop can be as busy as it likes. Two cycles per count:
+//
+//   0:  wait 1 pin 0          ; once, start on a high level
+//   1:  mov x, ~null          ; <- wrap target
+//   2:  jmp x-- 3             ; high: count
+//   3:  jmp pin 2
+//   4:  jmp pin 6             ; low: count until it rises
+//   5:  jmp x-- 4
+//   6:  mov isr, ~x
+//   7:  push noblock          ; -> wrap
+//
+// period = 2 * count + 3 cycles (the constant drops out of the jitter).
+
+static constexpr uint32_t RING_WORDS = 1024;
+static constexpr uint32_t RING_BITS  = 12;            // log2(RING_WORDS * 4)
+
+struct EdgeMeter {
+  const char *name;
+  int      pin;
+  uint32_t nominal_ns;
+  uint     sm;
+  int      dma;
+  uint32_t *ring;
+  uint32_t readIdx = 0;
+  // results for the current mode
+  uint32_t n = 0, missed = 0;
+  uint32_t min_ns = 0, max_ns = 0;
+  int64_t  sum_dev = 0;     // vs nominal, for mean/RMS
+  uint64_t sum_dev2 = 0;
+  bool     primed = false;  // first period after a reset is partial, skip it
+};
+
+static uint32_t hopRing[RING_WORDS] __attribute__((aligned(RING_WORDS * 4)));
+static uint32_t keyRing[RING_WORDS] __attribute__((aligned(RING_WORDS * 4)));
+
+static EdgeMeter meters[2] = {
+  { "hop", HOP_MARK_PIN, 2 * HOP_PERIOD_US * 1000, 0, -1, hopRing },
+  { "key", B_CE,         2 * KEY_HALF_US * 1000,  0, -1, keyRing },
+};
+
+static uint32_t clkSysHz = 125000000;
+static uint     counterOffset = 0;
+
+static void counterLoad() {
+  static uint16_t prog[8];
+  prog[0] = pio_encode_wait_pin(true, 0);
+  prog[1] = pio_encode_mov_not(pio_x, pio_null);
+  prog[2] = pio_encode_jmp_x_dec(3);
+  prog[3] = pio_encode_jmp_pin(2);
+  prog[4] = pio_encode_jmp_pin(6);
+  prog[5] = pio_encode_jmp_x_dec(4);
+  prog[6] = pio_encode_mov_not(pio_isr, pio_x);
+  prog[7] = pio_encode_push(false, false);
+  // absolute jump targets: load at offset 0
+  pio_program_t p = { prog, 8, 0 };
+  counterOffset = pio_add_program(pio0, &p);
+}
+
+static void counterStart(EdgeMeter &m) {
+  m.sm = pio_claim_unused_sm(pio0, true);
+  pio_sm_config c = pio_get_default_sm_config();
+  sm_config_set_in_pins(&c, m.pin);
+  sm_config_set_jmp_pin(&c, m.pin);
+  sm_config_set_wrap(&c, counterOffset + 1, counterOffset + 7);
+  sm_config_set_fifo_join(&c, PIO_FIFO_JOIN_RX);
+  sm_config_set_clkdiv(&c, 1.0f);
+  pio_sm_init(pio0, m.sm, counterOffset, &c);   // reads the pin, doesn't drive it
+
+  m.dma = dma_claim_unused_channel(true);
+  dma_channel_config d = dma_channel_get_default_config(m.dma);
+  channel_config_set_transfer_data_size(&d, DMA_SIZE_32);
+  channel_config_set_read_increment(&d, false);
+  channel_config_set_write_increment(&d, true);
+  channel_config_set_ring(&d, true, RING_BITS);
+  channel_config_set_dreq(&d, pio_get_dreq(pio0, m.sm, false));
+  dma_channel_configure(m.dma, &d, m.ring, &pio0->rxf[m.sm], 0xFFFFFFFFu, true);
+  m.readIdx = 0;
+
+  pio_sm_set_enabled(pio0, m.sm, true);
+}
+
+static void meterReset(EdgeMeter &m) {
+  m.readIdx = (uint32_t)((uint32_t *)dma_hw->ch[m.dma].write_addr - m.ring);
+  m.n = m.missed = 0;
+  m.min_ns = 0xFFFFFFFFu;
+  m.max_ns = 0;
+  m.sum_dev = 0;
+  m.sum_dev2 = 0;
+  m.primed = false;
+}
+
+// Fold in everything DMA has written since last time
+static void meterDrain(EdgeMeter &m) {
+  uint32_t w = (uint32_t)((uint32_t *)dma_hw->ch[m.dma].write_addr - m.ring);
+  uint32_t avail = (w - m.readIdx) & (RING_WORDS - 1);
+  // If we were away longer than a ring, the oldest entries are gone; a
+  // whole-ring lap can't be detected, so keep the loop faster than that.
+  // An entry is one full period of the pin (two hops, two key toggles), so
+  // the hop ring holds ~1 s and the key ring ~0.5 s -- the key ring is the
+  // limit.
+  while (avail--) {
+    uint32_t count = m.ring[m.readIdx];
+    m.readIdx = (m.readIdx + 1) & (RING_WORDS - 1);
+    if (!m.primed) { m.primed = true; continue; }
+
+    uint32_t ns = (uint32_t)((uint64_t)(2 * count + 3) * 1000000000ull / clkSysHz);
+    if (ns > m.nominal_ns + m.nominal_ns / 2) { m.missed++; continue; }   // a whole edge went missing
+
+    m.n++;
+    if (ns < m.min_ns) m.min_ns = ns;
+    if (ns > m.max_ns) m.max_ns = ns;
+    int64_t dev = (int64_t)ns - m.nominal_ns;
+    m.sum_dev += dev;
+    m.sum_dev2 += (uint64_t)(dev * dev);
+  }
+}
+
+static uint32_t meterPpNs(const EdgeMeter &m) {
+  return m.n ? m.max_ns - m.min_ns : 0;
+}
+
+static uint32_t meterRmsNs(const EdgeMeter &m) {
+  if (m.n < 2) return 0;
+  double mean = (double)m.sum_dev / m.n;
+  double var = (double)m.sum_dev2 / m.n - mean * mean;
+  return var > 0 ? (uint32_t)sqrt(var) : 0;
+}
+
+// ============================================================================
+// Stress modes
+// ============================================================================
+enum StressMode : uint8_t {
+  STRESS_NONE, STRESS_USB, STRESS_LOG, STRESS_FLASH, STRESS_ALL, STRESS_COUNT
+};
+
+static const char *const STRESS_NAMES[STRESS_COUNT] = {
+  "idle", "usb flood", "log flood", "flash writes", "all",
+};
+
+static uint32_t stressOps = 0;
+
+// Bulk CDC writes: USB IRQs, TinyUSB task in the loop, XIP misses
+static void stressUsb() {
+  static uint8_t junk[64];
+  int room = Serial.availableForWrite();
+  if (room > 0) {
+    Serial.write(junk, (size_t)room < sizeof(junk) ? (size_t)room : sizeof(junk));
+    stressOps++;
+  }
+}
+
+// Float formatting pulls in lots of cold libc code
+static void stressLog() {
+  static char line[128];
+  float x = (float)stressOps * 0.001f;
+  int n = snprintf(line, sizeof(line), "log %lu %.6f %.3e %08lx\n", (unsigned long)stressOps,
+                   (double)x, (double)(x * x), (unsigned long)micros());
+  Serial.write((const uint8_t *)line, (size_t)n);
+  stressOps++;
+}
+
+// Real checkpoint commits: page programs, and an erase every 256
+static void stressFlash() {
+  flashLogCommit(0xBEEF, stressOps, 0);
+  stressOps++;
+}
+
+static void stressStep(StressMode mode) {
+  switch (mode) {
+    case STRESS_USB:   stressUsb(); break;
+    case STRESS_LOG:   stressLog(); break;
+    case STRESS_FLASH: stressFlash(); break;
+    case STRESS_ALL:   stressUsb(); stressLog(); stressFlash(); break;
+    default: break;
+  }
+}
+
+// ============================================================================
+// Test suite
+// ============================================================================
+static bool runMode(StressMode mode) {
+  for (EdgeMeter &m : meters) meterReset(m);
+  noInterrupts();
+  memset((void *)&lockStats, 0, sizeof(lockStats));
+  interrupts();
+  stressOps = 0;
+
+  uint32_t t0 = millis();
+  while (millis() - t0 < TEST_SECONDS * 1000) {
+    stressStep(mode);
+    for (EdgeMeter &m : meters) meterDrain(m);
+  }
+  for (EdgeMeter &m : meters) meterDrain(m);
+  Serial.flush();
+
+  bool pass = true;
+  Serial.printf("\n[%s] %lu stress ops\n", STRESS_NAMES[mode], (unsigned long)stressOps);
+  for (const EdgeMeter &m : meters) {
+    uint32_t pp = meterPpNs(m);
+    bool ok = m.n > 0 && m.missed == 0 && pp <= JITTER_LIMIT_NS;
+    pass = pass && ok;
+    Serial.printf("  %-4s %6lu edges | p-p %5lu ns | rms %4lu ns | mean %+ld ns | missed %lu  %s\n",
+                  m.name, (unsigned long)m.n, (unsigned long)pp, (unsigned long)meterRmsNs(m),
+                  (long)(m.n ? m.sum_dev / (int64_t)m.n : 0), (unsigned long)m.missed,
+                  ok ? "PASS" : "FAIL");
+  }
+  if (LD_PIN >= 0) {
+    LockStats l;
+    noInterrupts();
+    memcpy(&l, (const void *)&lockStats, sizeof(l));
+    interrupts();
+    Serial.printf("  lock %6lu locks | mean %lu us | max %lu us | missed %lu\n",
+                  (unsigned long)l.locks,
+                  (unsigned long)(l.locks ? l.sum_us / l.locks : 0),
+                  (unsigned long)l.max_us, (unsigned long)l.missed);
+  }
+  if (mode == STRESS_FLASH || mode == STRESS_ALL) {
+    Serial.printf("  flash: %lu commits, %lu erases, max %lu us with cold IRQs masked\n",
+                  (unsigned long)flashLogStats.commits, (unsigned long)flashLogStats.erases,
+                  (unsigned long)flashLogStats.max_commit_us);
+  }
+  return pass;
+}
+
+static void runSuite() {
+  Serial.printf("\nJitter suite: hop %lu us, key %lu us, %lu s per mode, limit %lu ns p-p\n",
+                (unsigned long)HOP_PERIOD_US, (unsigned long)KEY_HALF_US,
+                (unsigned long)TEST_SECONDS, (unsigned long)JITTER_LIMIT_NS);
+  uint32_t passed = 0;
+  for (uint8_t mode = 0; mode < STRESS_COUNT; mode++) {
+    if (runMode((StressMode)mode)) passed++;
+  }
+  Serial.printf("\n%lu/%u modes PASS -> %s\n", (unsigned long)passed, STRESS_COUNT,
+                passed == STRESS_COUNT ? "PASS" : "FAIL");
+}
+
+// ============================================================================
+// Arduino setup/loop
+// ============================================================================
+void setup() {
+  Serial.begin(115200);
+  delay(1000);
+
+  Serial.println("Hot path jitter test");
+
+  pinMode(A_LE, OUTPUT); pinMode(A_CE, OUTPUT);
+  digitalWrite(A_LE, LOW); digitalWrite(A_CE, LOW);
+  pinMode(B_CE, OUTPUT);
+  digitalWrite(B_CE, HIGH);
+  pinMode(HOP_MARK_PIN, OUTPUT);
+  spiA.begin();
+  programPLL();
+  digitalWrite(A_CE, HIGH);
+
+  buildHopTable();
+  preloadHop(0);
+
+  clkSysHz = clock_get_hz(clk_sys);
+  counterLoad();
+  for (EdgeMeter &m : meters) counterStart(m);
+
+  // The checkpoint ring is only used as a flash load here; clear it so
+  // the real sweep sketch doesn't resume from test records
+  flashLogReset();
+
+  if (LD_PIN >= 0) {
+    pinMode(LD_PIN, INPUT);
+    gpio_set_irq_enabled(LD_PIN, GPIO_IRQ_EDGE_RISE, true);
+    irq_set_exclusive_handler(IO_IRQ_BANK0, lockDetectIrq);
+    irq_set_enabled(IO_IRQ_BANK0, true);
+    hotIrqAllow(IO_IRQ_BANK0);
+  }
+
+  hopAlarm = hardware_alarm_claim_unused(true);
+  keyAlarm = hardware_alarm_claim_unused(true);
+  hotAlarmInit(hopAlarm, hopAlarmIrq);
+  hotAlarmInit(keyAlarm, keyAlarmIrq);
+  // The hop IRQ spends ~140 us preloading the next hop over SPI; keying
+  // preempts it instead of waiting. The key handler is a few cycles, and
+  // the edges are phased apart so it never delays a hop edge.
+  irq_set_priority(TIMER_IRQ_0 + keyAlarm, PICO_HIGHEST_IRQ_PRIORITY);
+
+  uint32_t now = hotTimeUs32();
+  hopDeadline = now + 1000;
+  keyDeadline = now + 1000 + KEY_HALF_US / 2;
+  hotAlarmArm(hopAlarm, hopDeadline);
+  hotAlarmArm(keyAlarm, keyDeadline);
+
+  delay(100);
+  runSuite();
+}
+
+void loop() {
+  if (Serial.available()) {
+    int c = Serial.read();
+    if (c == 'r') {
+      flashLogReset();
+      runSuite();
+    }
+  }
+  for (EdgeMeter &m : meters) meterDrain(m);
+}
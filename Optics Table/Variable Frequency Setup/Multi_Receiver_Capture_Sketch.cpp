@@ -0,0 +1,263 @@
+#include <Arduino.h>
+#include <SPI.h>
+#include "adf5355_plan.h"
+#include "acquisition.h"
+#include "stream_codec.h"
+
+// ============================================================================
+// USER SETTINGS
+// ============================================================================
+
+static constexpr uint32_t PFD_HZ          = 10000000;   // must match R4 in the image
+static constexpr uint32_t CHANNEL_STEP_HZ = 10000;
+static constexpr bool     USE_RFOUTB      = true;
+
+// Hop board A through this list, one hop every HOP_PERIOD_US
+static const uint64_t HOP_FREQS_HZ[] = {
+  10500000000ull, 10510000000ull, 10520000000ull, 10525000000ull,
+  10530000000ull, 10540000000ull, 10550000000ull,
+};
+static constexpr uint32_t HOP_PERIOD_US = 20000;
+
+// Receivers on ADC0.. (GPIO26..). ADC3/GPIO29 is VSYS sense on a stock Pico.
+static constexpr uint8_t  RX_FIRST_INPUT = 0;
+static constexpr uint8_t  RX_COUNT       = 3;
+static constexpr uint32_t RX_RATE_HZ     = 50000;   // per receiver
+
+// Ignore samples this soon after a hop edge (lock + detector settle)
+static constexpr uint32_t SETTLE_US = 2000;
+
+// Per-hop results as compressed blocks (stream_codec.h) instead of CSV
+// lines: index = hop number, t = hop edge, one amplitude per receiver as
+// the settled mean in Q4. Decode with Host Tools/stream_decode.
+static constexpr bool     STREAM_COMPRESSED = false;
+static constexpr uint8_t  STREAM_FRAC_BITS  = 4;
+static constexpr uint32_t STREAM_FLUSH_MS   = 100;
+
+// ============================================================================
+// PIN DEFINITIONS (board A of the dual-board sketch)
+// ============================================================================
+static const int A_SCLK = 18;
+static const int A_MOSI = 19;
+static const int A_LE   = 20;
+static const int A_CE   = 17;
+
+static const int A_MISO_UNUSED = 16;
+static const int A_CS_UNUSED   = 21;
+
+SPIClassRP2040 spiA(spi0, A_MISO_UNUSED, A_CS_UNUSED, A_SCLK, A_MOSI);
+SPISettings pllSPI(1000000, MSBFIRST, SPI_MODE0);
+
+static constexpr PlanConfig planCfg = { PFD_HZ, CHANNEL_STEP_HZ, USE_RFOUTB };
+static constexpr uint32_t HOP_COUNT = sizeof(HOP_FREQS_HZ) / sizeof(HOP_FREQS_HZ[0]);
+
+// ============================================================================
+// SPI
+// ============================================================================
+static inline void pulseLE(int pinLE) {
+  digitalWrite(pinLE, HIGH);
+  delayMicroseconds(2);
+  digitalWrite(pinLE, LOW);
+  delayMicroseconds(2);
+}
+
+static void writeReg(SPIClassRP2040 &spi, int pinLE, uint32_t reg) {
+  spi.beginTransaction(pllSPI);
+  spi.transfer((reg >> 24) & 0xFF);
+  spi.transfer((reg >> 16) & 0xFF);
+  spi.transfer((reg >>  8) & 0xFF);
+  spi.transfer((reg >>  0) & 0xFF);
+  spi.endTransaction();
+  pulseLE(pinLE);
+}
+
+static const uint32_t baseRegs[13] = {
+  0x0001040C, // R12
+  0x0061300B, // R11
+  0x00C0000A, // R10
+  0x00000009, // R9
+  0x102D0428, // R8
+  0x12000007, // R7
+  0x35000006, // R6
+  0x00800005, // R5
+  0x00000004, // R4
+  0x00000003, // R3
+  0x00001002, // R2
+  0x00000A41, // R1
+  0x00550000  // R0 LAST
+};
+
+static constexpr int IDX_R6 = 12 - 6;
+static constexpr int IDX_R1 = 12 - 1;
+static constexpr int IDX_R0 = 12 - 0;
+
+static void programPLL() {
+  for (int i = 0; i < 13; i++) {
+    writeReg(spiA, A_LE, baseRegs[i]);
+    delay(2);
+  }
+}
+
+// ============================================================================
+// Hopping
+// ============================================================================
+struct HopWords {
+  uint32_t r6, r2, r1, r0;
+};
+static HopWords hopTable[HOP_COUNT];
+
+static void buildHopTable() {
+  for (uint32_t i = 0; i < HOP_COUNT; i++) {
+    PllPlan p = planFrequencyInt(planCfg, HOP_FREQS_HZ[i]);
+    if (!p.ok) Serial.printf("WARNING: hop %lu can't be planned\n", (unsigned long)i);
+    hopTable[i].r6 = packR6Div(baseRegs[IDX_R6], p);
+    hopTable[i].r2 = packR2(p);
+    hopTable[i].r1 = packR1(baseRegs[IDX_R1], p);
+    hopTable[i].r0 = packR0(baseRegs[IDX_R0], p) | ADF_R0_AUTOCAL;
+  }
+}
+
+static uint32_t hopNumber = 0;
+static uint32_t nextHopUs = 0;
+
+// R0's LE edge is the hop; mark it on the acquisition timeline right away
+static void doHop() {
+  const HopWords &w = hopTable[hopNumber % HOP_COUNT];
+  writeReg(spiA, A_LE, w.r6);
+  writeReg(spiA, A_LE, w.r2);
+  writeReg(spiA, A_LE, w.r1);
+  writeReg(spiA, A_LE, w.r0);
+  acqMarkHop(hopNumber);
+  hopNumber++;
+}
+
+// ============================================================================
+// Per-hop aggregation of the deinterleaved streams
+// ============================================================================
+//
+// Every sample has an exact time on the hop timeline, so each one is
+// attributed to the hop it actually belongs to even when a block straddles
+// a hop edge. Per hop and receiver we keep a sum over the settled part.
+
+struct HopAccum {
+  uint32_t hop;
+  uint64_t edge_ns;
+  uint32_t n[ACQ_MAX_CH];
+  uint32_t sum[ACQ_MAX_CH];
+  bool     active;
+};
+static HopAccum cur;
+static StreamEncoder streamEnc;
+static uint32_t streamLastFlushMs = 0;
+
+static void streamFlush() {
+  uint32_t n = streamEncFinish(streamEnc);
+  if (n) Serial.write(streamEnc.block, n);
+  streamLastFlushMs = millis();
+}
+
+static void emitHopCompressed(const HopAccum &h) {
+  int32_t amp[ACQ_MAX_CH];
+  for (uint8_t ch = 0; ch < RX_COUNT; ch++) {
+    amp[ch] = h.n[ch] ? (int32_t)(((uint64_t)h.sum[ch] << STREAM_FRAC_BITS) / h.n[ch]) : 0;
+  }
+  uint64_t t_us = h.edge_ns / 1000;
+  if (!streamEncAdd(streamEnc, h.hop, t_us, amp)) {
+    streamFlush();
+    streamEncAdd(streamEnc, h.hop, t_us, amp);
+  }
+}
+
+static void emitHop(const HopAccum &h) {
+  if (STREAM_COMPRESSED) {
+    emitHopCompressed(h);
+    return;
+  }
+  Serial.printf("%lu,%llu", (unsigned long)h.hop,
+                (unsigned long long)HOP_FREQS_HZ[h.hop % HOP_COUNT]);
+  for (uint8_t ch = 0; ch < RX_COUNT; ch++) {
+    uint32_t mean100 = h.n[ch] ? (uint32_t)((uint64_t)h.sum[ch] * 100 / h.n[ch]) : 0;
+    Serial.printf(",%lu,%lu.%02lu", (unsigned long)h.n[ch],
+                  (unsigned long)(mean100 / 100), (unsigned long)(mean100 % 100));
+  }
+  Serial.println();
+}
+
+static void consumeBlock(const RxBlock &b) {
+  const uint64_t settle_ns = (uint64_t)SETTLE_US * 1000u;
+
+  for (uint16_t i = 0; i < b.per_channel; i++) {
+    for (uint8_t ch = 0; ch < b.channels; ch++) {
+      uint64_t t = acqSampleTimeNs(b, ch, i);
+
+      HopMark m;
+      if (!acqHopAt(t, &m)) continue;         // before the first hop
+      if (!cur.active || m.hop != cur.hop) {
+        if (cur.active) emitHop(cur);
+        memset(&cur, 0, sizeof(cur));
+        cur.active = true;
+        cur.hop = m.hop;
+        cur.edge_ns = m.t_ns;
+      }
+      if (t - cur.edge_ns < settle_ns) continue;
+      cur.sum[ch] += b.data[ch][i];
+      cur.n[ch]++;
+    }
+  }
+}
+
+// ============================================================================
+// Arduino setup/loop
+// ============================================================================
+void setup() {
+  Serial.begin(115200);
+  delay(1000);
+
+  Serial.printf("Multi-receiver capture: %u receivers @ %lu Hz each, hop every %lu us\n",
+                RX_COUNT, (unsigned long)RX_RATE_HZ, (unsigned long)HOP_PERIOD_US);
+
+  pinMode(A_LE, OUTPUT); pinMode(A_CE, OUTPUT);
+  digitalWrite(A_LE, LOW); digitalWrite(A_CE, LOW);
+  spiA.begin();
+  programPLL();
+  digitalWrite(A_CE, HIGH);
+
+  buildHopTable();
+
+  AcqConfig cfg = { RX_FIRST_INPUT, RX_COUNT, RX_RATE_HZ };
+  acqBegin(cfg);
+  acqStart();
+
+  if (STREAM_COMPRESSED) {
+    streamEncInit(streamEnc, RX_COUNT, STREAM_FRAC_BITS);
+  } else {
+    Serial.print("hop,freq_hz");
+    for (uint8_t ch = 0; ch < RX_COUNT; ch++) Serial.printf(",rx%u_n,rx%u_mean", ch, ch);
+    Serial.println();
+  }
+
+  doHop();
+  nextHopUs = micros() + HOP_PERIOD_US;
+}
+
+void loop() {
+  if ((int32_t)(micros() - nextHopUs) >= 0) {
+    doHop();
+    nextHopUs += HOP_PERIOD_US;
+  }
+
+  static RxBlock blk;
+  while (acqRead(blk)) consumeBlock(blk);
+  if (STREAM_COMPRESSED && !streamEncEmpty(streamEnc) &&
+      millis() - streamLastFlushMs >= STREAM_FLUSH_MS) {
+    streamFlush();
+  }
+
+  static uint32_t lastReport = 0;
+  if (millis() - lastReport > 10000) {
+    lastReport = millis();
+    Serial.printf("# blocks %lu, dropped %lu, fifo overflows %lu\n",
+                  (unsigned long)acqStats.blocks, (unsigned long)acqStats.dropped,
+                  (unsigned long)acqStats.fifo_overflows);
+  }
+}
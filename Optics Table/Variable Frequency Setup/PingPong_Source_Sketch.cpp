@@ -0,0 +1,274 @@
+#include <Arduino.h>
+#include <SPI.h>
+#include "hardware/gpio.h"
+#include "hardware/spi.h"
+#include "hardware/timer.h"
+#include "adf5355_plan.h"
+#include "hot_path.h"
+
+// ============================================================================
+// USER SETTINGS
+// ============================================================================
+
+static constexpr uint32_t PFD_HZ          = 10000000;   // must match R4 in the image
+static constexpr uint32_t CHANNEL_STEP_HZ = 10000;
+static constexpr bool     USE_RFOUTB      = true;
+
+// Hop list, played in order and repeated. Boards take turns: A gets hops
+// 0, 2, 4..., B gets 1, 3, 5...
+static const uint64_t HOP_FREQS_HZ[] = {
+  10500000000ull, 10510000000ull, 10520000000ull, 10525000000ull,
+  10530000000ull, 10540000000ull, 10550000000ull,
+};
+
+// Time at the output per hop. The idle board has one period (minus its SPI
+// time) to lock, so this must stay above the lock time with autocal.
+static constexpr uint32_t HOP_PERIOD_US = 1000;
+static constexpr uint32_t LOCK_US       = 400;    // worst case lock incl. autocal
+
+// ============================================================================
+// PIN DEFINITIONS (same wiring as the dual-board sketch, plus the switch)
+// ============================================================================
+static const int A_SCLK = 18;
+static const int A_MOSI = 19;
+static const int A_LE   = 20;
+static const int A_CE   = 17;
+
+static const int B_SCLK = 10;
+static const int B_MOSI = 11;
+static const int B_LE   = 12;
+static const int B_CE   = 13;
+
+static const int A_MISO_UNUSED = 16;
+static const int A_CS_UNUSED   = 21;
+static const int B_MISO_UNUSED = 14;
+static const int B_CS_UNUSED   = 15;
+
+// SPDT RF switch: LOW selects board A, HIGH selects board B. Switches that
+// want complementary controls get the inverse on RF_SW_N_PIN (-1 = unused).
+static const int RF_SW_PIN   = 6;
+static const int RF_SW_N_PIN = 7;
+
+SPIClassRP2040 spiA(spi0, A_MISO_UNUSED, A_CS_UNUSED, A_SCLK, A_MOSI);
+SPIClassRP2040 spiB(spi1, B_MISO_UNUSED, B_CS_UNUSED, B_SCLK, B_MOSI);
+
+SPISettings pllSPI(1000000, MSBFIRST, SPI_MODE0);
+
+static constexpr PlanConfig planCfg = { PFD_HZ, CHANNEL_STEP_HZ, USE_RFOUTB };
+static constexpr uint32_t HOP_COUNT = sizeof(HOP_FREQS_HZ) / sizeof(HOP_FREQS_HZ[0]);
+
+// ============================================================================
+// SPI
+// ============================================================================
+static inline void pulseLE(int pinLE) {
+  digitalWrite(pinLE, HIGH);
+  delayMicroseconds(2);
+  digitalWrite(pinLE, LOW);
+  delayMicroseconds(2);
+}
+
+static void writeReg(SPIClassRP2040 &spi, int pinLE, uint32_t reg) {
+  spi.beginTransaction(pllSPI);
+  spi.transfer((reg >> 24) & 0xFF);
+  spi.transfer((reg >> 16) & 0xFF);
+  spi.transfer((reg >>  8) & 0xFF);
+  spi.transfer((reg >>  0) & 0xFF);
+  spi.endTransaction();
+  pulseLE(pinLE);
+}
+
+// IRQ-safe version: raw SPI registers + LE, no transaction bookkeeping (RAM)
+static void HOT_PATH(shiftLatch)(spi_hw_t *spi, int pinLE, uint32_t reg) {
+  hotSpiWrite32(spi, reg);
+  hotGpioPut(pinLE, 1);
+  hotBusyWaitUs(1);
+  hotGpioPut(pinLE, 0);
+}
+
+static const uint32_t baseRegs[13] = {
+  0x0001040C, // R12
+  0x0061300B, // R11
+  0x00C0000A, // R10
+  0x00000009, // R9
+  0x102D0428, // R8
+  0x12000007, // R7
+  0x35000006, // R6
+  0x00800005, // R5
+  0x00000004, // R4
+  0x00000003, // R3
+  0x00001002, // R2
+  0x00000A41, // R1
+  0x00550000  // R0 LAST
+};
+
+static constexpr int IDX_R6 = 12 - 6;
+static constexpr int IDX_R2 = 12 - 2;
+static constexpr int IDX_R1 = 12 - 1;
+static constexpr int IDX_R0 = 12 - 0;
+
+// Full image with the frequency words of plan p
+static void programPLL(SPIClassRP2040 &spi, int pinLE, const PllPlan &p) {
+  for (int i = 0; i < 13; i++) {
+    uint32_t w = baseRegs[i];
+    if (i == IDX_R6) w = packR6Div(baseRegs[IDX_R6], p);
+    if (i == IDX_R2) w = packR2(p);
+    if (i == IDX_R1) w = packR1(baseRegs[IDX_R1], p);
+    if (i == IDX_R0) w = packR0(baseRegs[IDX_R0], p) | ADF_R0_AUTOCAL;
+    writeReg(spi, pinLE, w);
+    delay(2);
+  }
+}
+
+// ============================================================================
+// Ping-pong schedule
+// ============================================================================
+//
+// Hop n is output by board (n & 1). At the edge for hop n the switch flips
+// to that board -- it was tuned a whole period ago and is locked -- and the
+// board that just went idle is retuned to hop n+1. The output never sees a
+// lock gap, only the switch transition.
+//
+// A board's previous frequency is always two hops back, so the words for
+// every hop are pre-packed as a delta against hop n-2 (usually R1 + R0).
+//
+// The alarm handler and everything it calls is HOT_PATH (RAM, see
+// hot_path.h): no 64-bit math, no `%`, timer/SPI/GPIO by register.
+
+static PllPlan  hopPlan[HOP_COUNT];
+static HopDelta hopDelta[HOP_COUNT];     // [i] = words taking a board from hop i-2 to hop i
+
+static int      hopAlarm = -1;
+static uint32_t deadlineUs = 0;          // deadline of the next hop (timer low word)
+static uint32_t nextIdx = 0;             // (hopNumber + 1) % HOP_COUNT
+static volatile uint32_t hopNumber = 0;  // hop currently at the output
+
+struct PingPongStats {
+  uint32_t hops;
+  uint32_t late;            // IRQ ran more than LATE_US after its deadline
+  uint32_t short_lock;      // idle board got less than LOCK_US before its edge
+  uint32_t max_late_us;
+  uint32_t min_margin_us;   // smallest time left for lock after a retune
+  uint32_t max_tune_us;
+};
+static volatile PingPongStats ppStats;
+static constexpr uint32_t LATE_US = 5;
+
+static bool buildHopTable() {
+  for (uint32_t i = 0; i < HOP_COUNT; i++) {
+    hopPlan[i] = planFrequencyInt(planCfg, HOP_FREQS_HZ[i]);
+    if (!hopPlan[i].ok) {
+      Serial.printf("ERROR: hop %lu (%llu Hz) can't be planned\n", (unsigned long)i,
+                    (unsigned long long)HOP_FREQS_HZ[i]);
+      return false;
+    }
+  }
+  for (uint32_t i = 0; i < HOP_COUNT; i++) {
+    const PllPlan &prev = hopPlan[(i + 2 * HOP_COUNT - 2) % HOP_COUNT];
+    hopDelta[i] = packHopDelta(prev, hopPlan[i], baseRegs[IDX_R6], baseRegs[IDX_R1],
+                               baseRegs[IDX_R0], true);
+  }
+  return true;
+}
+
+static __force_inline void selectBoard(uint32_t board) {
+  hotGpioPut(RF_SW_PIN, board);
+  if (RF_SW_N_PIN >= 0) hotGpioPut(RF_SW_N_PIN, !board);
+}
+
+static void HOT_PATH(tuneBoard)(uint32_t board, uint32_t idx) {
+  const HopDelta &d = hopDelta[idx];
+  spi_hw_t *spi = board ? spi1_hw : spi0_hw;
+  int le = board ? B_LE : A_LE;
+  for (uint8_t i = 0; i < d.n; i++) shiftLatch(spi, le, d.words[i]);
+}
+
+static void HOT_PATH(hopAlarmIrq)() {
+  hotAlarmAck(hopAlarm);
+  uint32_t n = hopNumber + 1;
+  selectBoard(n & 1);                              // <- the hop edge
+  uint32_t now = hotTimeUs32();
+  hopNumber = n;
+
+  uint32_t late = now - deadlineUs;
+  if (late > ppStats.max_late_us) ppStats.max_late_us = late;
+  if (late > LATE_US) ppStats.late++;
+
+  // The board that just went idle gets hop n+1
+  uint32_t idx = nextIdx + 1;
+  if (idx == HOP_COUNT) idx = 0;
+  nextIdx = idx;
+  tuneBoard((n + 1) & 1, idx);
+  uint32_t tuned = hotTimeUs32();
+  uint32_t tune_us = tuned - now;
+  if (tune_us > ppStats.max_tune_us) ppStats.max_tune_us = tune_us;
+
+  deadlineUs += HOP_PERIOD_US;
+  int32_t margin = (int32_t)(deadlineUs - tuned);
+  uint32_t m = margin < 0 ? 0 : (uint32_t)margin;
+  if (m < ppStats.min_margin_us) ppStats.min_margin_us = m;
+  if (m < LOCK_US) ppStats.short_lock++;
+
+  ppStats.hops++;
+  hotAlarmArm(hopAlarm, deadlineUs);
+}
+
+static void printStats() {
+  Serial.printf("hops %lu | late %lu (max %lu us) | tune max %lu us | "
+                "lock margin min %lu us, %lu short of %lu us\n",
+                (unsigned long)ppStats.hops, (unsigned long)ppStats.late,
+                (unsigned long)ppStats.max_late_us, (unsigned long)ppStats.max_tune_us,
+                (unsigned long)ppStats.min_margin_us, (unsigned long)ppStats.short_lock,
+                (unsigned long)LOCK_US);
+}
+
+// ============================================================================
+// Arduino setup/loop
+// ============================================================================
+void setup() {
+  Serial.begin(115200);
+  delay(1000);
+
+  Serial.printf("Ping-pong source: %lu hops, %lu us per hop, switch on GPIO %d\n",
+                (unsigned long)HOP_COUNT, (unsigned long)HOP_PERIOD_US, RF_SW_PIN);
+
+  pinMode(A_LE, OUTPUT); pinMode(A_CE, OUTPUT);
+  pinMode(B_LE, OUTPUT); pinMode(B_CE, OUTPUT);
+  digitalWrite(A_LE, LOW); digitalWrite(A_CE, LOW);
+  digitalWrite(B_LE, LOW); digitalWrite(B_CE, LOW);
+
+  pinMode(RF_SW_PIN, OUTPUT);
+  if (RF_SW_N_PIN >= 0) pinMode(RF_SW_N_PIN, OUTPUT);
+  selectBoard(0);
+
+  spiA.begin();
+  spiB.begin();
+
+  if (!buildHopTable()) {
+    while (true) delay(1000);
+  }
+
+  // Both boards stay powered the whole time; only the switch changes
+  digitalWrite(A_CE, HIGH);
+  digitalWrite(B_CE, HIGH);
+  programPLL(spiA, A_LE, hopPlan[0]);
+  programPLL(spiB, B_LE, hopPlan[1 % HOP_COUNT]);
+
+  ppStats.min_margin_us = 0xFFFFFFFFu;
+
+  hopAlarm = hardware_alarm_claim_unused(true);
+  hotAlarmInit(hopAlarm, hopAlarmIrq);
+
+  // Hop 0 is already at the output (board A); the timer takes over from hop 1
+  hopNumber = 0;
+  nextIdx = 1 % HOP_COUNT;
+  deadlineUs = hotTimeUs32() + 1000 + HOP_PERIOD_US;
+  hotAlarmArm(hopAlarm, deadlineUs);
+}
+
+void loop() {
+  static uint32_t lastReport = 0;
+  if ((Serial.available() && Serial.read() == 's') || millis() - lastReport > 5000) {
+    lastReport = millis();
+    printStats();
+  }
+}
@@ -0,0 +1,515 @@
+#include <Arduino.h>
+#include <SPI.h>
+#include "hardware/timer.h"
+#include "adf5355_plan.h"
+#include "sweep_engine.h"
+#include "flash_log.h"
+
+// ============================================================================
+// USER SETTINGS
+// ============================================================================
+
+static constexpr uint32_t PFD_HZ          = 10000000;   // must match R4 in the image
+static constexpr uint32_t CHANNEL_STEP_HZ = 10000;
+static constexpr bool     USE_RFOUTB      = true;
+
+// Raster: serpentine, so every move is one pitch (row ends: one pitch in Y)
+static constexpr uint16_t GRID_NX    = 20;
+static constexpr uint16_t GRID_NY    = 20;
+static constexpr int32_t  GRID_X0_UM = 0;
+static constexpr int32_t  GRID_Y0_UM = 0;
+static constexpr int32_t  PITCH_UM   = 500;
+
+// The sweep at every position. 124 points = exactly two result pages, so
+// 400 positions use 800 of the 1024 pages in the results area.
+static constexpr uint64_t SWEEP_START_HZ = 10000000000ull;
+static constexpr uint64_t SWEEP_STEP_HZ  =     1000000ull;
+static constexpr uint32_t SWEEP_POINTS   =         124;
+static constexpr uint32_t DWELL_US       =         500;   // lock + detector settle
+
+static const int     RX_ADC_PIN = 26;   // A0
+static constexpr int ADC_AVG    = 8;
+
+// Stage. The real one takes an absolute move on Serial1 (stageSendMove --
+// edit the command for your controller) and raises STAGE_DONE_PIN when it's
+// in position. STAGE_MOCK replaces it with a timer that models the move, so
+// the whole pipeline runs on a bare board.
+static constexpr bool     STAGE_MOCK       = true;
+static constexpr uint32_t STAGE_BAUD       = 115200;
+static constexpr uint32_t STAGE_SETTLE_US  = 20000;   // ring-down after in-position
+static constexpr uint32_t STAGE_TIMEOUT_MS = 5000;
+
+// Mock kinematics: trapezoidal profile plus command latency
+static constexpr uint32_t MOCK_SPEED_UM_S  = 10000;
+static constexpr uint32_t MOCK_ACCEL_UM_S2 = 100000;
+static constexpr uint32_t MOCK_LATENCY_US  = 2000;
+// >= 0: the mock drives this pin instead of setting the flag directly.
+// Jumper it to STAGE_DONE_PIN to exercise the real IRQ path.
+static const int MOCK_LOOPBACK_PIN = -1;
+
+static constexpr bool SCAN_AT_BOOT = STAGE_MOCK;    // real stage: wait for 'g'
+
+// ============================================================================
+// PIN DEFINITIONS (board A of the dual-board sketch, plus the stage)
+// ============================================================================
+static const int A_SCLK = 18;
+static const int A_MOSI = 19;
+static const int A_LE   = 20;
+static const int A_CE   = 17;
+
+static const int A_MISO_UNUSED = 16;
+static const int A_CS_UNUSED   = 21;
+
+// Serial1 (GPIO0 TX / GPIO1 RX) carries the move commands
+static const int STAGE_DONE_PIN = 2;   // in-position / motion complete, active high
+
+SPIClassRP2040 spiA(spi0, A_MISO_UNUSED, A_CS_UNUSED, A_SCLK, A_MOSI);
+SPISettings pllSPI(1000000, MSBFIRST, SPI_MODE0);
+
+static constexpr PlanConfig planCfg = { PFD_HZ, CHANNEL_STEP_HZ, USE_RFOUTB };
+static constexpr uint32_t POSITIONS = (uint32_t)GRID_NX * GRID_NY;
+static constexpr uint32_t PAGES_PER_POSITION = (SWEEP_POINTS + RESULTS_PER_PAGE - 1) / RESULTS_PER_PAGE;
+
+static_assert(POSITIONS * PAGES_PER_POSITION * FLASH_PAGE_SIZE <= FLASH_RESULTS_SIZE,
+              "scan doesn't fit in the results area");
+static_assert(PAGES_PER_POSITION <= 16, "one position's pages are held in RAM until the next move");
+
+// ============================================================================
+// SPI
+// ============================================================================
+static inline void pulseLE(int pinLE) {
+  digitalWrite(pinLE, HIGH);
+  delayMicroseconds(2);
+  digitalWrite(pinLE, LOW);
+  delayMicroseconds(2);
+}
+
+static void writeReg(SPIClassRP2040 &spi, int pinLE, uint32_t reg) {
+  spi.beginTransaction(pllSPI);
+  spi.transfer((reg >> 24) & 0xFF);
+  spi.transfer((reg >> 16) & 0xFF);
+  spi.transfer((reg >>  8) & 0xFF);
+  spi.transfer((reg >>  0) & 0xFF);
+  spi.endTransaction();
+  pulseLE(pinLE);
+}
+
+static const uint32_t baseRegs[13] = {
+  0x0001040C, // R12
+  0x0061300B, // R11
+  0x00C0000A, // R10
+  0x00000009, // R9
+  0x102D0428, // R8
+  0x12000007, // R7
+  0x35000006, // R6
+  0x00800005, // R5
+  0x00000004, // R4
+  0x00000003, // R3
+  0x00001002, // R2
+  0x00000A41, // R1
+  0x00550000  // R0 LAST
+};
+
+static constexpr int IDX_R6 = 12 - 6;
+static constexpr int IDX_R1 = 12 - 1;
+static constexpr int IDX_R0 = 12 - 0;
+
+static void programPLL() {
+  for (int i = 0; i < 13; i++) {
+    Serial.printf("Writing R%d = 0x%08lX\n", 12 - i, (unsigned long)baseRegs[i]);
+    writeReg(spiA, A_LE, baseRegs[i]);
+    delay(2);
+  }
+}
+
+// ============================================================================
+// Positions
+// ============================================================================
+struct Position {
+  uint16_t ix, iy;
+  int32_t  x_um, y_um;
+};
+
+static Position positionOf(uint32_t k) {
+  Position p;
+  p.iy = k / GRID_NX;
+  p.ix = k % GRID_NX;
+  if (p.iy & 1) p.ix = GRID_NX - 1 - p.ix;
+  p.x_um = GRID_X0_UM + (int32_t)p.ix * PITCH_UM;
+  p.y_um = GRID_Y0_UM + (int32_t)p.iy * PITCH_UM;
+  return p;
+}
+
+// The table swept at position k. Same everywhere here; this is the place to
+// narrow or shift it per position.
+static SweepTable table = { 0, SWEEP_START_HZ, SWEEP_STEP_HZ, SWEEP_POINTS, DWELL_US };
+
+static void positionTable(uint32_t k, SweepTable &t) {
+  (void)k;
+  t.start_hz = SWEEP_START_HZ;
+  t.step_hz  = SWEEP_STEP_HZ;
+  t.count    = SWEEP_POINTS;
+  t.dwell_us = DWELL_US;
+}
+
+// ============================================================================
+// Stage (real or mock)
+// ============================================================================
+static volatile bool     stageDone = false;
+static volatile uint32_t stageDoneUs = 0;
+static Position stageAt = { 0, 0, GRID_X0_UM, GRID_Y0_UM };
+static int mockAlarm = -1;
+
+static void stageDoneIsr() {
+  if (stageDone) return;
+  stageDoneUs = time_us_32();
+  stageDone = true;
+}
+
+static void mockAlarmIrq(uint alarm) {
+  (void)alarm;
+  if (MOCK_LOOPBACK_PIN >= 0) digitalWrite(MOCK_LOOPBACK_PIN, HIGH);
+  else stageDoneIsr();
+}
+
+static uint32_t mockMoveUs(int32_t dx, int32_t dy) {
+  uint32_t ax = (uint32_t)abs(dx), ay = (uint32_t)abs(dy);
+  uint32_t d = ax > ay ? ax : ay;                          // axes move together
+  // accelerate to speed if the move is long enough, else a triangle
+  uint64_t rampUm = (uint64_t)MOCK_SPEED_UM_S * MOCK_SPEED_UM_S / MOCK_ACCEL_UM_S2;
+  uint64_t us;
+  if (d >= rampUm) us = (uint64_t)d * 1000000 / MOCK_SPEED_UM_S + (uint64_t)MOCK_SPEED_UM_S * 1000000 / MOCK_ACCEL_UM_S2;
+  else             us = 2 * (uint64_t)(sqrtf((float)d / MOCK_ACCEL_UM_S2) * 1e6f);
+  return MOCK_LATENCY_US + (uint32_t)us;
+}
+
+static void stageSendMove(const Position &p) {
+  if (STAGE_MOCK) {
+    if (MOCK_LOOPBACK_PIN >= 0) digitalWrite(MOCK_LOOPBACK_PIN, LOW);
+    uint32_t us = mockMoveUs(p.x_um - stageAt.x_um, p.y_um - stageAt.y_um);
+    hardware_alarm_set_target(mockAlarm, from_us_since_boot(time_us_64() + us));
+    return;
+  }
+  Serial1.printf("G90 G0 X%.3f Y%.3f\n", p.x_um / 1000.0f, p.y_um / 1000.0f);
+}
+
+static void stageMove(const Position &p) {
+  stageDone = false;
+  stageSendMove(p);
+  stageAt = p;
+}
+
+static void stageBegin() {
+  pinMode(STAGE_DONE_PIN, INPUT_PULLDOWN);
+  if (!STAGE_MOCK || MOCK_LOOPBACK_PIN >= 0) {
+    attachInterrupt(digitalPinToInterrupt(STAGE_DONE_PIN), stageDoneIsr, RISING);
+  }
+  if (STAGE_MOCK) {
+    if (MOCK_LOOPBACK_PIN >= 0) {
+      pinMode(MOCK_LOOPBACK_PIN, OUTPUT);
+      digitalWrite(MOCK_LOOPBACK_PIN, LOW);
+    }
+    mockAlarm = hardware_alarm_claim_unused(true);
+    hardware_alarm_set_callback(mockAlarm, mockAlarmIrq);
+  } else {
+    Serial1.begin(STAGE_BAUD);
+  }
+}
+
+// ============================================================================
+// Sweep engine hooks
+// ============================================================================
+//
+// Registers already holding the right value aren't rewritten, and settling
+// counts from the last write -- so point 0, tuned while the stage was still
+// moving, costs nothing once the sweep starts.
+
+static uint32_t lastWords[4] = { 0, 0, 0, 0 };   // R6, R2, R1, R0 as last written
+static uint32_t lastTuneUs = 0;
+
+static bool writeIfChanged(int slot, uint32_t w) {
+  if (lastWords[slot] == w) return false;
+  writeReg(spiA, A_LE, w);
+  lastWords[slot] = w;
+  lastTuneUs = micros();
+  return true;
+}
+
+static void sweepTune(const PllPlan &p) {
+  bool changed = writeIfChanged(0, packR6Div(baseRegs[IDX_R6], p));
+  changed |= writeIfChanged(1, packR2(p));
+  changed |= writeIfChanged(2, packR1(baseRegs[IDX_R1], p));
+  // R0 latches the others and starts the autocal: always after a change
+  if (changed) lastWords[3] = 0;
+  writeIfChanged(3, packR0(baseRegs[IDX_R0], p) | ADF_R0_AUTOCAL);
+}
+
+static void sweepSettle(uint32_t us) {
+  uint32_t since = micros() - lastTuneUs;
+  if (since >= us) return;
+  us -= since;
+  if (us >= 1000) delay(us / 1000);
+  delayMicroseconds(us % 1000);
+}
+
+static uint32_t sweepMeasure() {
+  uint32_t acc = 0;
+  for (int i = 0; i < ADC_AVG; i++) acc += analogRead(RX_ADC_PIN);
+  return acc;   // sum, not mean -- keeps the extra bits
+}
+
+static uint32_t sweepMicros() {
+  return micros();
+}
+
+// Pages are held in RAM and written to flash during the next move, never
+// in the middle of a sweep. Indices are made global: position * points + i.
+static ResultPage pendingPages[PAGES_PER_POSITION];
+static uint32_t   pendingCount = 0;
+static uint32_t   pendingBase = 0;
+
+static bool sweepStorePage(const ResultPage &page) {
+  if (pendingCount >= PAGES_PER_POSITION) return false;
+  ResultPage &pg = pendingPages[pendingCount++];
+  pg = page;
+  pg.first_index += pendingBase;
+  pg.crc = resultPageCrc(pg);
+  return true;
+}
+
+// Checkpoints are per position (scanStore), not per page
+static void sweepCheckpoint(uint16_t table_id, uint32_t next_index) {
+  (void)table_id;
+  (void)next_index;
+}
+
+// ============================================================================
+// Scan pipeline
+// ============================================================================
+//
+//   position k:  [ move k ...... ][settle][ sweep k ]
+//   overlapped:   store k-1, checkpoint,     |
+//                 plan + tune point 0 of k   |
+//                                            +-> move k+1 issued the moment
+//                                                the last point is measured
+//
+// Results of sweep k and preparation of sweep k+1 happen while the stage
+// travels; the sweep starts on the in-position edge + STAGE_SETTLE_US.
+
+enum ScanState : uint8_t { SCAN_IDLE, SCAN_MOVING, SCAN_SWEEPING, SCAN_DONE, SCAN_FAULT };
+
+struct ScanStats {
+  uint32_t positions;
+  uint64_t move_us;         // move issued -> in position
+  uint64_t settle_wait_us;  // in position -> sweep start
+  uint64_t sweep_us;
+  uint64_t hidden_us;       // store + prepare, done while moving
+  uint32_t max_move_us;
+  uint32_t started_ms;
+  uint32_t finished_ms;
+};
+
+static ScanState  scanState = SCAN_IDLE;
+static ScanStats  scanStats;
+static SweepEngine engine;
+static uint32_t   scanPos = 0;            // position being moved to / swept
+static uint32_t   moveStartUs = 0;
+static uint32_t   sweepStartUs = 0;
+static uint32_t   resultsOff = 0;
+static uint16_t   scanId = 0;
+
+static uint16_t computeScanId() {
+  struct { uint16_t nx, ny; int32_t x0, y0, pitch; uint64_t start, step; uint32_t n, dwell; } s = {
+    GRID_NX, GRID_NY, GRID_X0_UM, GRID_Y0_UM, PITCH_UM, SWEEP_START_HZ, SWEEP_STEP_HZ,
+    SWEEP_POINTS, DWELL_US };
+  uint16_t id = crc16((const uint8_t *)&s, sizeof(s));
+  return id ? id : 1;
+}
+
+// Sweep k's pages to flash, then a checkpoint saying "resume at k + 1"
+static bool scanStore(uint32_t k) {
+  for (uint32_t i = 0; i < pendingCount; i++) {
+    if (!flashResultsAppend(&resultsOff, pendingPages[i])) return false;
+  }
+  pendingCount = 0;
+  flashLogCommit(scanId, k + 1, resultsOff);
+  return true;
+}
+
+// Engine set up for position k and its first point tuned
+static void scanPrepare(uint32_t k) {
+  positionTable(k, table);
+  sweepBegin(engine, planCfg, table, 0);
+  pendingBase = k * SWEEP_POINTS;
+  PllPlan p = planFrequencyInt(planCfg, sweepTableFreq(table, 0));
+  if (p.ok) sweepTune(p);
+}
+
+static void scanFault(const char *why) {
+  scanState = SCAN_FAULT;
+  Serial.printf("Scan stopped at position %lu: %s\n", (unsigned long)scanPos, why);
+}
+
+// Issue the move to k, then do everything that can overlap it. `stored` is
+// the position whose results are still in RAM (or -1).
+static void scanMoveTo(uint32_t k, int32_t stored) {
+  moveStartUs = micros();
+  stageMove(positionOf(k));
+  scanPos = k;
+  scanState = SCAN_MOVING;
+
+  uint32_t t0 = micros();
+  if (stored >= 0 && !scanStore((uint32_t)stored)) { scanFault("results area full"); return; }
+  scanPrepare(k);
+  scanStats.hidden_us += micros() - t0;
+}
+
+static void scanStart(uint32_t fromPos) {
+  memset(&scanStats, 0, sizeof(scanStats));
+  scanStats.started_ms = millis();
+  pendingCount = 0;
+  Serial.printf("Raster scan %ux%u, %lu points per position, from position %lu\n",
+                GRID_NX, GRID_NY, (unsigned long)SWEEP_POINTS, (unsigned long)fromPos);
+  scanMoveTo(fromPos, -1);
+}
+
+static void scanPoll() {
+  if (scanState == SCAN_MOVING) {
+    if (!stageDone) {
+      if (micros() - moveStartUs > STAGE_TIMEOUT_MS * 1000) scanFault("stage timeout");
+      return;
+    }
+    uint32_t doneUs = stageDoneUs;
+    if (micros() - doneUs < STAGE_SETTLE_US) return;
+
+    uint32_t now = micros();
+    uint32_t moveUs = doneUs - moveStartUs;
+    scanStats.move_us += moveUs;
+    if (moveUs > scanStats.max_move_us) scanStats.max_move_us = moveUs;
+    scanStats.settle_wait_us += now - doneUs;
+    sweepStartUs = now;
+    scanState = SCAN_SWEEPING;
+    return;
+  }
+
+  if (scanState != SCAN_SWEEPING) return;
+  if (sweepStep(engine)) return;                 // one point per loop() pass
+
+  if (engine.storageFull) { scanFault("result buffer overflow"); return; }
+  scanStats.sweep_us += micros() - sweepStartUs;
+  scanStats.positions++;
+
+  uint32_t k = scanPos;
+  if (k + 1 < POSITIONS) {
+    scanMoveTo(k + 1, (int32_t)k);
+    return;
+  }
+
+  if (!scanStore(k)) { scanFault("results area full"); return; }
+  scanStats.finished_ms = millis();
+  scanState = SCAN_DONE;
+  Serial.println("Scan complete.");
+}
+
+// ============================================================================
+// Reporting
+// ============================================================================
+static void printStats() {
+  const ScanStats &s = scanStats;
+  uint32_t n = s.positions ? s.positions : 1;
+  uint32_t endMs = s.finished_ms ? s.finished_ms : millis();
+  uint64_t elapsedMs = endMs - s.started_ms;
+  // The same work one step after another: move, settle, sweep, store/prepare
+  uint64_t serialMs = (s.move_us + s.settle_wait_us + s.sweep_us + s.hidden_us) / 1000;
+  uint64_t idleUs = s.move_us > s.hidden_us ? s.move_us - s.hidden_us : 0;
+
+  Serial.printf("Position %lu/%lu | per position: move %lu us (max %lu), settle %lu us, "
+                "sweep %lu us, store+prepare %lu us hidden in the move (%lu us left idle)\n",
+                (unsigned long)s.positions, (unsigned long)POSITIONS,
+                (unsigned long)(s.move_us / n), (unsigned long)s.max_move_us,
+                (unsigned long)(s.settle_wait_us / n), (unsigned long)(s.sweep_us / n),
+                (unsigned long)(s.hidden_us / n), (unsigned long)(idleUs / n));
+  Serial.printf("Elapsed %llu ms, serialized would be ~%llu ms | %lu pages, %lu erases\n",
+                (unsigned long long)elapsedMs, (unsigned long long)serialMs,
+                (unsigned long)(resultsOff / FLASH_PAGE_SIZE),
+                (unsigned long)flashLogStats.erases);
+}
+
+// CSV of everything stored: pos,ix,iy,x_um,y_um,freq_hz,adc_sum
+static void dumpResults() {
+  Serial.println("pos,ix,iy,x_um,y_um,freq_hz,adc_sum");
+  for (uint32_t off = 0; off + FLASH_PAGE_SIZE <= resultsOff; off += FLASH_PAGE_SIZE) {
+    const ResultPage &pg = *(const ResultPage *)flashResultsPtr(off);
+    if (!resultPageValid(pg)) continue;
+    for (uint32_t i = 0; i < pg.count; i++) {
+      uint32_t idx = pg.first_index + i;
+      uint32_t k = idx / SWEEP_POINTS;
+      Position p = positionOf(k);
+      SweepTable t = table;
+      positionTable(k, t);
+      Serial.printf("%lu,%u,%u,%ld,%ld,%llu,%lu\n", (unsigned long)k, p.ix, p.iy,
+                    (long)p.x_um, (long)p.y_um,
+                    (unsigned long long)sweepTableFreq(t, idx % SWEEP_POINTS),
+                    (unsigned long)pg.samples[i]);
+    }
+  }
+}
+
+// ============================================================================
+// Arduino setup/loop
+// ============================================================================
+
+// Resume where the last checkpoint left off if it belongs to this scan
+static void scanGo() {
+  Checkpoint cp;
+  if (flashLogLoad(&cp) && cp.table_id == scanId && cp.index < POSITIONS) {
+    resultsOff = cp.results_off;
+    scanStart(cp.index);
+  } else {
+    flashLogReset();
+    resultsOff = 0;
+    scanStart(0);
+  }
+}
+
+void setup() {
+  Serial.begin(115200);
+  delay(1000);
+  Serial.printf("Raster scan: %s stage\n", STAGE_MOCK ? "MOCK" : "real");
+
+  pinMode(A_LE, OUTPUT); pinMode(A_CE, OUTPUT);
+  digitalWrite(A_LE, LOW); digitalWrite(A_CE, LOW);
+  spiA.begin();
+  programPLL();
+  digitalWrite(A_CE, HIGH);
+
+  stageBegin();
+  scanId = computeScanId();
+  table.id = scanId;
+  if (SCAN_AT_BOOT) scanGo();
+  else Serial.println("'g' to start (or resume), 'r' to restart from position 0");
+}
+
+void loop() {
+  if (Serial.available()) {
+    char c = Serial.read();
+    if (c == 's') printStats();
+    if (c == 'd') dumpResults();
+    if (c == 'g' && (scanState == SCAN_IDLE || scanState == SCAN_FAULT)) scanGo();
+    if (c == 'r' && scanState != SCAN_MOVING && scanState != SCAN_SWEEPING) {
+      flashLogReset();
+      resultsOff = 0;
+      scanStart(0);
+    }
+  }
+
+  ScanState before = scanState;
+  scanPoll();
+  if (before != SCAN_DONE && scanState == SCAN_DONE) printStats();
+
+  static uint32_t lastReport = 0;
+  if ((scanState == SCAN_MOVING || scanState == SCAN_SWEEPING) && millis() - lastReport > 5000) {
+    lastReport = millis();
+    printStats();
+  }
+}
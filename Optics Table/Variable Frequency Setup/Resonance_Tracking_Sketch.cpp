@@ -0,0 +1,225 @@
+#include <Arduino.h>
+#include <SPI.h>
+#include "adf5355_plan.h"
+#include "tracker.h"
+
+// ============================================================================
+// USER SETTINGS
+// ============================================================================
+
+static constexpr uint32_t PFD_HZ          = 10000000;   // must match R4 in the image
+static constexpr uint32_t CHANNEL_STEP_HZ = 10000;
+static constexpr bool     USE_RFOUTB      = true;
+
+// The resonance. Probe spacing ~ FWHM / 4 keeps all probes on the curved
+// part of the dip; the coarse scan has to be wide enough to catch it again
+// after it jumps.
+static constexpr uint64_t START_HZ        = 10250000000ull;
+static constexpr bool     TRACK_DIP       = true;        // false: a peak
+static constexpr uint32_t PROBE_STEP_HZ   =     1000000;
+static constexpr uint8_t  PROBES          =           5;
+static constexpr uint64_t MIN_HZ          =  9800000000ull;
+static constexpr uint64_t MAX_HZ          = 10700000000ull;
+static constexpr uint32_t ACQUIRE_SPAN_HZ =   100000000;
+static constexpr uint16_t ACQUIRE_POINTS  =         101;
+static constexpr uint8_t  LOST_ROUNDS     =           8;
+
+// Per probe: lock + detector settle. 5 probes at 200 us is ~1.2 ms a round,
+// so ~800 updates/s.
+static constexpr uint32_t DWELL_US = 200;
+
+// Filter gains /256. Higher alpha follows faster but passes more noise into
+// the centre; beta sets how quickly a drift rate is picked up.
+static constexpr uint8_t ALPHA_Q8 = 128;
+static constexpr uint8_t BETA_Q8  = 32;
+
+static const int     RX_ADC_PIN = 26;   // A0
+static constexpr int ADC_AVG    = 4;
+
+// Print every Nth update (the serial line, not the tracker, is the limit)
+static constexpr uint16_t REPORT_EVERY = 1;
+
+// ============================================================================
+// PIN DEFINITIONS (board A of the dual-board sketch)
+// ============================================================================
+static const int A_SCLK = 18;
+static const int A_MOSI = 19;
+static const int A_LE   = 20;
+static const int A_CE   = 17;
+
+static const int A_MISO_UNUSED = 16;
+static const int A_CS_UNUSED   = 21;
+
+SPIClassRP2040 spiA(spi0, A_MISO_UNUSED, A_CS_UNUSED, A_SCLK, A_MOSI);
+SPISettings pllSPI(1000000, MSBFIRST, SPI_MODE0);
+
+static constexpr PlanConfig planCfg = { PFD_HZ, CHANNEL_STEP_HZ, USE_RFOUTB };
+
+static_assert(PROBES >= 3 && PROBES <= TRACK_MAX_PROBES && (PROBES & 1), "PROBES: odd, 3..9");
+static_assert(PROBE_STEP_HZ % (USE_RFOUTB ? 2 * CHANNEL_STEP_HZ : CHANNEL_STEP_HZ) == 0,
+              "probe spacing must be on the channel grid");
+
+// ============================================================================
+// SPI
+// ============================================================================
+static inline void pulseLE(int pinLE) {
+  digitalWrite(pinLE, HIGH);
+  delayMicroseconds(2);
+  digitalWrite(pinLE, LOW);
+  delayMicroseconds(2);
+}
+
+static void writeReg(SPIClassRP2040 &spi, int pinLE, uint32_t reg) {
+  spi.beginTransaction(pllSPI);
+  spi.transfer((reg >> 24) & 0xFF);
+  spi.transfer((reg >> 16) & 0xFF);
+  spi.transfer((reg >>  8) & 0xFF);
+  spi.transfer((reg >>  0) & 0xFF);
+  spi.endTransaction();
+  pulseLE(pinLE);
+}
+
+static const uint32_t baseRegs[13] = {
+  0x0001040C, // R12
+  0x0061300B, // R11
+  0x00C0000A, // R10
+  0x00000009, // R9
+  0x102D0428, // R8
+  0x12000007, // R7
+  0x35000006, // R6
+  0x00800005, // R5
+  0x00000004, // R4
+  0x00000003, // R3
+  0x00001002, // R2
+  0x00000A41, // R1
+  0x00550000  // R0 LAST
+};
+
+static constexpr int IDX_R6 = 12 - 6;
+static constexpr int IDX_R1 = 12 - 1;
+static constexpr int IDX_R0 = 12 - 0;
+
+static void programPLL() {
+  for (int i = 0; i < 13; i++) {
+    Serial.printf("Writing R%d = 0x%08lX\n", 12 - i, (unsigned long)baseRegs[i]);
+    writeReg(spiA, A_LE, baseRegs[i]);
+    delay(2);
+  }
+}
+
+// ============================================================================
+// Tracker hooks
+// ============================================================================
+//
+// Probes one spacing apart on the same divider mostly differ in R1/R0 only,
+// so a hop is two or three words. Settling counts from the last write.
+
+static uint32_t lastWords[4] = { 0, 0, 0, 0 };   // R6, R2, R1, R0 as last written
+static uint32_t lastTuneUs = 0;
+
+static bool writeIfChanged(int slot, uint32_t w) {
+  if (lastWords[slot] == w) return false;
+  writeReg(spiA, A_LE, w);
+  lastWords[slot] = w;
+  lastTuneUs = micros();
+  return true;
+}
+
+static void trackTune(const PllPlan &p) {
+  bool changed = writeIfChanged(0, packR6Div(baseRegs[IDX_R6], p));
+  changed |= writeIfChanged(1, packR2(p));
+  changed |= writeIfChanged(2, packR1(baseRegs[IDX_R1], p));
+  // R0 latches the others and starts the autocal: always after a change
+  if (changed) lastWords[3] = 0;
+  writeIfChanged(3, packR0(baseRegs[IDX_R0], p) | ADF_R0_AUTOCAL);
+}
+
+static void trackSettle(uint32_t us) {
+  uint32_t since = micros() - lastTuneUs;
+  if (since >= us) return;
+  delayMicroseconds(us - since);
+}
+
+static uint32_t trackMeasure() {
+  uint32_t acc = 0;
+  for (int i = 0; i < ADC_AVG; i++) acc += analogRead(RX_ADC_PIN);
+  return acc;   // sum, not mean -- keeps the extra bits
+}
+
+static uint32_t trackMicros() {
+  return micros();
+}
+
+// ============================================================================
+// Tracking
+// ============================================================================
+static const TrackConfig trackCfg = {
+  planCfg, START_HZ, PROBE_STEP_HZ, PROBES, DWELL_US, TRACK_DIP, MIN_HZ, MAX_HZ,
+  ACQUIRE_SPAN_HZ, ACQUIRE_POINTS, LOST_ROUNDS, ALPHA_Q8, BETA_Q8
+};
+
+static Tracker  tracker;
+static bool     tracking = false;
+static bool     quiet = false;
+static uint16_t reportCount = 0;
+
+static void trackStart() {
+  tracking = trackBegin(tracker, trackCfg);
+  if (!tracking) {
+    Serial.println("Tracker setup failed: start frequency or probe offsets not plannable");
+    return;
+  }
+  Serial.printf("Tracking from %llu Hz\n", (unsigned long long)tracker.center_hz);
+}
+
+static void printStats() {
+  const TrackStats &s = tracker.stats;
+  uint32_t n = s.rounds ? s.rounds : 1;
+  uint32_t avg = (uint32_t)(s.round_us_total / n);
+  Serial.printf("Rounds %lu | round %lu us avg (%lu updates/s), max %lu us | "
+                "clamped %lu, no curve %lu, reacquired %lu | plans: %lu derived, %lu full\n",
+                (unsigned long)s.rounds, (unsigned long)avg,
+                (unsigned long)(avg ? 1000000 / avg : 0), (unsigned long)s.round_us_max,
+                (unsigned long)s.clamped, (unsigned long)s.no_curve, (unsigned long)s.reacquires,
+                (unsigned long)s.derived, (unsigned long)s.planned);
+  Serial.printf("Centre %llu Hz, drift %ld Hz/s\n",
+                (unsigned long long)tracker.center_hz, (long)tracker.velocity_hz_s);
+}
+
+// ============================================================================
+// Arduino setup/loop
+// ============================================================================
+void setup() {
+  Serial.begin(115200);
+  delay(1000);
+  Serial.println("Resonance tracker");
+
+  pinMode(A_LE, OUTPUT); pinMode(A_CE, OUTPUT);
+  digitalWrite(A_LE, LOW); digitalWrite(A_CE, LOW);
+  spiA.begin();
+  programPLL();
+  digitalWrite(A_CE, HIGH);
+
+  trackStart();
+  Serial.println("'s' stats, 'r' reacquire, 'q' toggle the T lines");
+  Serial.println("T,t_us,center_hz,drift_hz_s,extreme,flags");
+}
+
+void loop() {
+  if (Serial.available()) {
+    char c = Serial.read();
+    if (c == 's') printStats();
+    if (c == 'r') trackStart();
+    if (c == 'q') quiet = !quiet;
+  }
+
+  if (!tracking) return;
+
+  TrackUpdate u;
+  trackStep(tracker, u);
+  if (quiet || ++reportCount < REPORT_EVERY) return;
+  reportCount = 0;
+  Serial.printf("T,%lu,%llu,%ld,%lu,%u\n", (unsigned long)u.t_us,
+                (unsigned long long)u.center_hz, (long)u.velocity_hz_s,
+                (unsigned long)u.extreme, u.flags);
+}
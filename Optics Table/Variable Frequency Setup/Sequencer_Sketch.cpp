@@ -0,0 +1,335 @@
+#include <Arduino.h>
+#include <SPI.h>
+#include "adf5355_plan.h"
+#include "sequencer.h"
+
+// ============================================================================
+// USER SETTINGS
+// ============================================================================
+//
+// Runs experiment programs (sequencer.h) on the board. Assemble and upload
+// with Host Tools/seq_asm:
+//
+//   seq_asm scan.s --sim                 try it on fake hardware first
+//   seq_asm scan.s --port /dev/ttyACM0   upload ('u' + image), then 'g'
+//
+// Emitted values come back as "E,tag,t_us,value" lines while it runs.
+
+static constexpr uint32_t PFD_HZ          = 10000000;   // must match R4 in the image
+static constexpr uint32_t CHANNEL_STEP_HZ = 10000;
+static constexpr bool     USE_RFOUTB      = true;
+
+// ACQ channel n reads ADC input n (GPIO 26 + n)
+static const int     ADC_BASE_PIN     = 26;
+static constexpr int ADC_CHANNELS     = 3;
+
+// Lock detect on board A's MUXOUT. Not wired (-1): WAIT_LOCK reports lock
+// LOCK_FALLBACK_US after the last register write instead.
+static const int          LD_PIN           = -1;
+static constexpr uint32_t LOCK_FALLBACK_US = 200;
+
+// Ops per seqRun() call; serial commands and emits are serviced in between
+static constexpr uint32_t RUN_SLICE_OPS     = 256;
+static constexpr uint32_t UPLOAD_TIMEOUT_MS = 2000;
+
+// ============================================================================
+// PIN DEFINITIONS (board A of the dual-board sketch)
+// ============================================================================
+static const int A_SCLK = 18;
+static const int A_MOSI = 19;
+static const int A_LE   = 20;
+static const int A_CE   = 17;
+
+static const int A_MISO_UNUSED = 16;
+static const int A_CS_UNUSED   = 21;
+
+SPIClassRP2040 spiA(spi0, A_MISO_UNUSED, A_CS_UNUSED, A_SCLK, A_MOSI);
+SPISettings pllSPI(1000000, MSBFIRST, SPI_MODE0);
+
+static constexpr PlanConfig planCfg = { PFD_HZ, CHANNEL_STEP_HZ, USE_RFOUTB };
+
+// ============================================================================
+// SPI
+// ============================================================================
+static inline void pulseLE(int pinLE) {
+  digitalWrite(pinLE, HIGH);
+  delayMicroseconds(2);
+  digitalWrite(pinLE, LOW);
+  delayMicroseconds(2);
+}
+
+static void writeReg(SPIClassRP2040 &spi, int pinLE, uint32_t reg) {
+  spi.beginTransaction(pllSPI);
+  spi.transfer((reg >> 24) & 0xFF);
+  spi.transfer((reg >> 16) & 0xFF);
+  spi.transfer((reg >>  8) & 0xFF);
+  spi.transfer((reg >>  0) & 0xFF);
+  spi.endTransaction();
+  pulseLE(pinLE);
+}
+
+static const uint32_t baseRegs[13] = {
+  0x0001040C, // R12
+  0x0061300B, // R11
+  0x00C0000A, // R10
+  0x00000009, // R9
+  0x102D0428, // R8
+  0x12000007, // R7
+  0x35000006, // R6
+  0x00800005, // R5
+  0x00000004, // R4
+  0x00000003, // R3
+  0x00001002, // R2
+  0x00000A41, // R1
+  0x00550000  // R0 LAST
+};
+
+static constexpr int IDX_R6 = 12 - 6;
+static constexpr int IDX_R4 = 12 - 4;
+static constexpr int IDX_R1 = 12 - 1;
+static constexpr int IDX_R0 = 12 - 0;
+
+static constexpr uint32_t R4_MUXOUT_DLD = 0x30000000;   // MUXOUT = digital lock detect
+
+static void programPLL() {
+  for (int i = 0; i < 13; i++) {
+    uint32_t w = baseRegs[i];
+    if (i == IDX_R4 && LD_PIN >= 0) w |= R4_MUXOUT_DLD;
+    writeReg(spiA, A_LE, w);
+    delay(2);
+  }
+}
+
+// ============================================================================
+// Sequencer hooks
+// ============================================================================
+//
+// Same register cache as the raster sketch: words already in the chip
+// aren't rewritten, R0 always goes after a change (it latches the rest and
+// starts the autocal).
+
+static uint32_t lastWords[4] = { 0, 0, 0, 0 };   // R6, R2, R1, R0 as last written
+static uint32_t lastTuneUs = 0;
+
+static bool writeIfChanged(int slot, uint32_t w) {
+  if (lastWords[slot] == w) return false;
+  writeReg(spiA, A_LE, w);
+  lastWords[slot] = w;
+  lastTuneUs = micros();
+  return true;
+}
+
+static void seqTune(const PllPlan &p) {
+  bool changed = writeIfChanged(0, packR6Div(baseRegs[IDX_R6], p));
+  changed |= writeIfChanged(1, packR2(p));
+  changed |= writeIfChanged(2, packR1(baseRegs[IDX_R1], p));
+  if (changed) lastWords[3] = 0;
+  writeIfChanged(3, packR0(baseRegs[IDX_R0], p) | ADF_R0_AUTOCAL);
+}
+
+static void seqKey(bool on) {
+  digitalWrite(A_CE, on ? HIGH : LOW);
+}
+
+static bool seqLocked() {
+  if (LD_PIN >= 0) return digitalRead(LD_PIN) == HIGH;
+  return micros() - lastTuneUs >= LOCK_FALLBACK_US;
+}
+
+static int32_t seqAcquire(uint8_t channel, uint32_t samples) {
+  if (channel >= ADC_CHANNELS) return 0;
+  int32_t acc = 0;
+  for (uint32_t i = 0; i < samples; i++) acc += analogRead(ADC_BASE_PIN + channel);
+  return acc;   // sum, not mean -- keeps the extra bits
+}
+
+// Emits go into a ring that loop() drains between slices, so a program
+// never waits on USB. A full ring drops (and counts) rather than blocks.
+struct EmitRecord {
+  uint16_t tag;
+  uint32_t t_us;
+  int64_t  value;
+};
+
+static constexpr uint16_t EMIT_RING = 256;   // power of two
+static EmitRecord emitRing[EMIT_RING];
+static uint32_t   emitHead = 0, emitTail = 0;
+static uint32_t   emitDropped = 0;
+
+static void seqEmit(uint16_t tag, uint32_t t_us, int64_t value) {
+  if (emitHead - emitTail >= EMIT_RING) { emitDropped++; return; }
+  emitRing[emitHead & (EMIT_RING - 1)] = { tag, t_us, value };
+  emitHead++;
+}
+
+static uint32_t seqMicros() {
+  return micros();
+}
+
+// Polled inside WAIT / WAIT_LOCK, where loop() doesn't get a look in. Only
+// an 'x' is taken; anything else stays for loop().
+static bool seqAbortPending() {
+  if (Serial.available() && Serial.peek() == 'x') {
+    Serial.read();
+    return true;
+  }
+  return false;
+}
+
+static void drainEmits() {
+  while (emitTail != emitHead && Serial.availableForWrite() >= 48) {
+    const EmitRecord &e = emitRing[emitTail & (EMIT_RING - 1)];
+    Serial.printf("E,%u,%lu,%lld\n", e.tag, (unsigned long)e.t_us, (long long)e.value);
+    emitTail++;
+  }
+}
+
+// ============================================================================
+// Upload / run control
+// ============================================================================
+static SeqVm vm;
+static uint8_t  uploadBuf[sizeof(SeqHeader) + SEQ_MAX_OPS * sizeof(SeqOp) + SEQ_MAX_CONSTS * 8];
+static uint32_t runStartUs = 0;
+static uint32_t runUs = 0;
+static bool     runPending = false;   // 'g' seen, first slice not run yet
+
+static const char *const STATE_NAMES[] = { "empty", "ready", "running", "halted", "aborted", "fault" };
+
+static bool readExact(uint8_t *dst, size_t n) {
+  uint32_t t0 = millis();
+  size_t got = 0;
+  while (got < n) {
+    if (Serial.available()) {
+      dst[got++] = (uint8_t)Serial.read();
+      t0 = millis();
+    } else if (millis() - t0 > UPLOAD_TIMEOUT_MS) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// 'u' has been read: header, then the rest of the image. The reply line
+// starts with "Loaded" on success (seq_asm checks for it).
+static void receiveProgram() {
+  if (runPending || vm.state == SEQ_RUNNING) {
+    Serial.println("Upload refused: program running ('x' first)");
+    return;
+  }
+  SeqHeader h;
+  if (!readExact(uploadBuf, sizeof(h))) { Serial.println("Upload timed out"); return; }
+  memcpy(&h, uploadBuf, sizeof(h));
+  if (h.magic != SEQ_MAGIC || h.n_ops > SEQ_MAX_OPS || h.n_consts > SEQ_MAX_CONSTS) {
+    Serial.println("Upload rejected: bad header");
+    return;
+  }
+  size_t len = seqImageSize(h);
+  if (!readExact(uploadBuf + sizeof(h), len - sizeof(h))) { Serial.println("Upload timed out"); return; }
+
+  const char *err = seqLoad(vm, planCfg, uploadBuf, len);
+  if (err) {
+    Serial.printf("Upload rejected: %s\n", err);
+    return;
+  }
+  Serial.printf("Loaded %u ops, %u constants\n", vm.n_ops, vm.n_consts);
+}
+
+static void startRun() {
+  if (vm.state == SEQ_EMPTY) { Serial.println("No program"); return; }
+  if (vm.state == SEQ_RUNNING) return;
+  seqReset(vm);
+  emitHead = emitTail = emitDropped = 0;
+  runStartUs = micros();
+  runUs = 0;
+  runPending = true;
+  Serial.println("Running");
+}
+
+// Halted, aborted or faulted: RF off unless the program ended cleanly
+static void finishRun(SeqState st) {
+  runUs = micros() - runStartUs;
+  if (st != SEQ_HALTED) seqKey(false);
+  drainEmits();
+  Serial.printf("Program %s at pc %u after %llu ops, %lu us | plan cache %lu hits, %lu misses | "
+                "%lu emits dropped\n",
+                STATE_NAMES[st], st == SEQ_FAULT ? vm.fault_pc : vm.pc,
+                (unsigned long long)vm.opsRun, (unsigned long)runUs,
+                (unsigned long)vm.cacheHits, (unsigned long)vm.cacheMisses,
+                (unsigned long)emitDropped);
+}
+
+// ============================================================================
+// Reporting
+// ============================================================================
+static void printOpStats() {
+  Serial.println("op,count,total_us,mean_us,max_us");
+  for (int i = 0; i < SEQ_OP_COUNT; i++) {
+    const SeqOpStats &s = vm.opStats[i];
+    if (!s.count) continue;
+    Serial.printf("%s,%lu,%llu,%lu,%lu\n", SEQ_OP_NAMES[i], (unsigned long)s.count,
+                  (unsigned long long)s.total_us, (unsigned long)(s.total_us / s.count),
+                  (unsigned long)s.max_us);
+  }
+}
+
+// Last ops run (trace on): t_us,dt_us,pc,op,value
+static void printTrace() {
+  if (!vm.trace) { Serial.println("Trace is off ('T' toggles)"); return; }
+  uint32_t n = vm.traceCount < SEQ_TRACE_LEN ? vm.traceCount : SEQ_TRACE_LEN;
+  Serial.println("t_us,dt_us,pc,op,value");
+  for (uint32_t i = vm.traceCount - n; i != vm.traceCount; i++) {
+    const SeqTrace &t = vm.traceBuf[i & (SEQ_TRACE_LEN - 1)];
+    char txt[64];
+    seqFormatOp(&vm, vm.ops[t.pc], txt, sizeof(txt));
+    Serial.printf("%lu,%lu,%u,%s,%ld\n", (unsigned long)t.t_us, (unsigned long)t.dt_us, t.pc,
+                  txt, (long)t.value);
+  }
+}
+
+static void printListing() {
+  if (vm.state == SEQ_EMPTY) { Serial.println("No program"); return; }
+  for (uint16_t i = 0; i < vm.n_ops; i++) {
+    char txt[64];
+    seqFormatOp(&vm, vm.ops[i], txt, sizeof(txt));
+    Serial.printf("%4u  %s\n", i, txt);
+  }
+}
+
+// ============================================================================
+// Arduino setup/loop
+// ============================================================================
+void setup() {
+  Serial.begin(115200);
+  delay(1000);
+  Serial.println("Sequencer: 'u' upload, 'g' run, 'x' abort, 'p' op timing, 't' trace, "
+                 "'T' trace on/off, 'l' listing");
+
+  pinMode(A_LE, OUTPUT); pinMode(A_CE, OUTPUT);
+  digitalWrite(A_LE, LOW); digitalWrite(A_CE, LOW);
+  if (LD_PIN >= 0) pinMode(LD_PIN, INPUT);
+  spiA.begin();
+  programPLL();
+}
+
+void loop() {
+  if (Serial.available()) {
+    char c = Serial.read();
+    if (c == 'u') receiveProgram();
+    if (c == 'g') startRun();
+    if (c == 'x' && vm.state == SEQ_RUNNING) vm.abort = true;
+    if (c == 'p') printOpStats();
+    if (c == 't') printTrace();
+    if (c == 'l') printListing();
+    if (c == 'T') {
+      vm.trace = !vm.trace;
+      Serial.printf("Trace %s\n", vm.trace ? "on" : "off");
+    }
+  }
+
+  if (runPending || vm.state == SEQ_RUNNING) {
+    runPending = false;
+    SeqState st = seqRun(vm, RUN_SLICE_OPS);
+    if (st != SEQ_RUNNING) finishRun(st);
+  }
+  drainEmits();
+}
@@ -0,0 +1,319 @@
+#include <Arduino.h>
+#include <SPI.h>
+#include "hardware/gpio.h"
+#include "hardware/spi.h"
+#include "adf5355_plan.h"
+#include "le_expander.h"
+
+// ============================================================================
+// USER SETTINGS
+// ============================================================================
+
+static constexpr uint32_t PFD_HZ          = 10000000;   // must match R4 in the image
+static constexpr uint32_t CHANNEL_STEP_HZ = 10000;
+static constexpr bool     USE_RFOUTB      = true;
+
+// Boards 0..HALF-1 hang off bus A, the rest off bus B (buffered fan-out of
+// SCLK/MOSI). Every board on a bus sees every word; LE decides who keeps it.
+static constexpr uint16_t BOARD_COUNT = 64;
+static constexpr uint16_t HALF        = BOARD_COUNT / 2;
+
+// 'h': all boards hop together. 'p': board i at BASE + i * SPACING.
+static constexpr uint64_t HOP_LO_HZ     = 10400000000ull;
+static constexpr uint64_t HOP_HI_HZ     = 10600000000ull;
+static constexpr uint64_t BASE_HZ       = 10000000000ull;
+static constexpr uint32_t SPACING_HZ    =     5000000;
+
+// 74HC595 chain. 16 chips for 64 boards.
+static constexpr uint32_t SRCLK_HZ = 10000000;
+
+// Benchmark length
+static constexpr uint32_t BENCH_WRITES = 2000;
+
+// ============================================================================
+// PIN DEFINITIONS
+// ============================================================================
+static const int A_SCLK = 18;
+static const int A_MOSI = 19;
+static const int B_SCLK = 10;
+static const int B_MOSI = 11;
+
+static const int A_MISO_UNUSED = 16;
+static const int A_CS_UNUSED   = 21;
+static const int B_MISO_UNUSED = 14;
+static const int B_CS_UNUSED   = 15;
+
+static const int SR_SER   = 6;
+static const int SR_SRCLK = 7;
+static const int SR_RCLK  = 8;
+static const int SR_OE    = 9;
+
+// Direct-LE reference for the benchmark: a plain GPIO, scope it against RCLK
+static const int BENCH_LE = 20;
+
+SPIClassRP2040 spiA(spi0, A_MISO_UNUSED, A_CS_UNUSED, A_SCLK, A_MOSI);
+SPIClassRP2040 spiB(spi1, B_MISO_UNUSED, B_CS_UNUSED, B_SCLK, B_MOSI);
+
+// Fast enough that the chain shift is the part worth hiding
+SPISettings pllSPI(10000000, MSBFIRST, SPI_MODE0);
+
+static constexpr PlanConfig planCfg = { PFD_HZ, CHANNEL_STEP_HZ, USE_RFOUTB };
+
+static_assert(BOARD_COUNT >= 2 && BOARD_COUNT <= LX_MAX_BOARDS && (BOARD_COUNT & 1) == 0,
+              "BOARD_COUNT: even, up to LX_MAX_BOARDS");
+
+// ============================================================================
+// SPI
+// ============================================================================
+
+// Shift one word out on each bus (either may be skipped); both SPI blocks
+// run at once off their FIFOs. No LE here -- the caller strobes the chain.
+static void shiftWords(bool onA, uint32_t wa, bool onB, uint32_t wb) {
+  spi_hw_t *ha = onA ? spi_get_hw(spi0) : nullptr;
+  spi_hw_t *hb = onB ? spi_get_hw(spi1) : nullptr;
+
+  for (int s = 24; s >= 0; s -= 8) {
+    if (ha) ha->dr = (wa >> s) & 0xFF;
+    if (hb) hb->dr = (wb >> s) & 0xFF;
+  }
+  while ((ha && (ha->sr & SPI_SSPSR_BSY_BITS)) || (hb && (hb->sr & SPI_SSPSR_BSY_BITS))) {}
+
+  // Keep RX empty so later SPI.transfer() calls don't read stale bytes
+  while (ha && (ha->sr & SPI_SSPSR_RNE_BITS)) (void)ha->dr;
+  while (hb && (hb->sr & SPI_SSPSR_RNE_BITS)) (void)hb->dr;
+}
+
+// Stage the LE pattern first so the chain fills while SPI shifts, then
+// latch every board in `le` on one RCLK edge
+static void writeSet(const LxSet &le, uint32_t wa, uint32_t wb) {
+  bool onA = false, onB = false;
+  for (uint16_t i = 0; i < BOARD_COUNT; i++) {
+    if (!lxSetHas(le, i)) continue;
+    if (i < HALF) onA = true; else onB = true;
+  }
+  lxStage(le);
+  shiftWords(onA, wa, onB, wb);
+  lxLatch();
+}
+
+static void broadcast(const LxSet &le, uint32_t w) {
+  writeSet(le, w, w);
+}
+
+// ============================================================================
+// Register images
+// ============================================================================
+static const uint32_t baseRegs[13] = {
+  0x0001040C, // R12
+  0x0061300B, // R11
+  0x00C0000A, // R10
+  0x00000009, // R9
+  0x102D0428, // R8
+  0x12000007, // R7
+  0x35000006, // R6
+  0x00800005, // R5
+  0x00000004, // R4
+  0x00000003, // R3
+  0x00001002, // R2
+  0x00000A41, // R1
+  0x00550000  // R0 LAST
+};
+
+static constexpr int IDX_R6 = 12 - 6;
+static constexpr int IDX_R1 = 12 - 1;
+static constexpr int IDX_R0 = 12 - 0;
+
+static LxSet allBoards;
+
+// Same image everywhere: 13 words, 13 strobes for the whole array
+static void programPLL() {
+  for (int i = 0; i < 13; i++) {
+    Serial.printf("Writing R%d = 0x%08lX to all %u boards\n", 12 - i,
+                  (unsigned long)baseRegs[i], BOARD_COUNT);
+    broadcast(allBoards, baseRegs[i]);
+    delay(2);
+  }
+  lxWait();
+}
+
+// ============================================================================
+// Array operations
+// ============================================================================
+static uint32_t lastOpUs = 0;
+static uint32_t lastOpStrobes = 0;
+
+static void opBegin() {
+  lxWait();
+  lastOpStrobes = lxStats.strobes;
+  lastOpUs = micros();
+}
+
+static void opEnd(const char *what) {
+  lxWait();
+  uint32_t us = micros() - lastOpUs;
+  Serial.printf("%s: %lu us, %lu strobes\n", what, (unsigned long)us,
+                (unsigned long)(lxStats.strobes - lastOpStrobes));
+}
+
+// Every board to the same frequency: 4 broadcast words
+static bool hopAll(uint64_t f) {
+  PllPlan p = planFrequencyInt(planCfg, f);
+  if (!p.ok) return false;
+  broadcast(allBoards, packR6Div(baseRegs[IDX_R6], p));
+  broadcast(allBoards, packR2(p));
+  broadcast(allBoards, packR1(baseRegs[IDX_R1], p));
+  broadcast(allBoards, packR0(baseRegs[IDX_R0], p) | ADF_R0_AUTOCAL);
+  return true;
+}
+
+// Board i on bus A and board HALF + i on bus B take their words together:
+// 32 pairs x 4 words, one strobe per pair-word
+static bool programOffsets() {
+  PllPlan plans[BOARD_COUNT];
+  for (uint16_t i = 0; i < BOARD_COUNT; i++) {
+    plans[i] = planFrequencyInt(planCfg, BASE_HZ + (uint64_t)i * SPACING_HZ);
+    if (!plans[i].ok) {
+      Serial.printf("Board %u: %llu Hz not plannable\n", i,
+                    (unsigned long long)(BASE_HZ + (uint64_t)i * SPACING_HZ));
+      return false;
+    }
+  }
+  for (uint16_t i = 0; i < HALF; i++) {
+    const PllPlan &a = plans[i];
+    const PllPlan &b = plans[HALF + i];
+    LxSet pair = lxOne(i);
+    lxSetAdd(pair, HALF + i);
+    writeSet(pair, packR6Div(baseRegs[IDX_R6], a), packR6Div(baseRegs[IDX_R6], b));
+    writeSet(pair, packR2(a), packR2(b));
+    writeSet(pair, packR1(baseRegs[IDX_R1], a), packR1(baseRegs[IDX_R1], b));
+    writeSet(pair, packR0(baseRegs[IDX_R0], a) | ADF_R0_AUTOCAL,
+             packR0(baseRegs[IDX_R0], b) | ADF_R0_AUTOCAL);
+  }
+  return true;
+}
+
+// ============================================================================
+// Benchmark
+// ============================================================================
+//
+// Per 32-bit register write, SPI included:
+//   gpio    SPI word, then LE straight from a GPIO (one board per pin)
+//   pulse   SPI word, then lxPulse + wait (chain shifted after SPI)
+//   staged  chain shifted during SPI, lxLatch right after (writeSet)
+// The difference to gpio is what the chain costs.
+
+static void bench() {
+  const uint32_t w = baseRegs[IDX_R0] & ~ADF_R0_AUTOCAL;   // harmless: no autocal
+  LxSet one = lxOne(0);
+  lxWait();
+
+  uint32_t t0 = micros();
+  for (uint32_t i = 0; i < BENCH_WRITES; i++) {
+    shiftWords(true, w, false, 0);
+    gpio_set_mask(1u << BENCH_LE);
+    gpio_clr_mask(1u << BENCH_LE);
+  }
+  uint32_t usGpio = micros() - t0;
+
+  t0 = micros();
+  for (uint32_t i = 0; i < BENCH_WRITES; i++) {
+    shiftWords(true, w, false, 0);
+    lxPulse(one);
+    lxWait();
+  }
+  uint32_t usPulse = micros() - t0;
+
+  t0 = micros();
+  for (uint32_t i = 0; i < BENCH_WRITES; i++) writeSet(one, w, 0);
+  lxWait();
+  uint32_t usStaged = micros() - t0;
+
+  // Staged, all boards at once: the same cost for 1 or 64
+  t0 = micros();
+  for (uint32_t i = 0; i < BENCH_WRITES; i++) broadcast(allBoards, w);
+  lxWait();
+  uint32_t usAll = micros() - t0;
+
+  auto perWrite = [](uint32_t us) { return (float)us / BENCH_WRITES; };
+  Serial.printf("Chain: %u outputs in %u words, SRCLK %lu Hz (PIO %lu Hz)\n",
+                BOARD_COUNT * 2, lxWords, (unsigned long)(lxSmHz / 3), (unsigned long)lxSmHz);
+  Serial.printf("Pattern + strobe: %lu ns (theory)\n", (unsigned long)lxShiftNs());
+  Serial.printf("Per write: gpio %.2f us | pulse %.2f us (+%.2f) | staged %.2f us (+%.2f) | "
+                "staged, all %u boards %.2f us\n",
+                perWrite(usGpio), perWrite(usPulse), perWrite(usPulse) - perWrite(usGpio),
+                perWrite(usStaged), perWrite(usStaged) - perWrite(usGpio),
+                BOARD_COUNT, perWrite(usAll));
+}
+
+static void printStats() {
+  Serial.printf("Expander: %lu strobes, %lu pulses, %lu words to PIO\n",
+                (unsigned long)lxStats.strobes, (unsigned long)lxStats.pulses,
+                (unsigned long)lxStats.words);
+}
+
+// ============================================================================
+// Arduino setup/loop
+// ============================================================================
+static bool hopHigh = false;
+static bool halfOff = false;
+
+void setup() {
+  Serial.begin(115200);
+  delay(1000);
+  Serial.printf("Shift-register LE/CE array, %u boards\n", BOARD_COUNT);
+
+  pinMode(BENCH_LE, OUTPUT);
+  digitalWrite(BENCH_LE, LOW);
+
+  allBoards = lxAll(BOARD_COUNT);
+  const LxConfig lxc = { SR_SER, SR_SRCLK, SR_RCLK, SR_OE, BOARD_COUNT, SRCLK_HZ };
+  if (!lxBegin(lxc)) {
+    Serial.println("Expander setup failed");
+    while (true) delay(1000);
+  }
+
+  spiA.begin();
+  spiB.begin();
+  spiA.beginTransaction(pllSPI);
+  spiB.beginTransaction(pllSPI);
+
+  programPLL();
+  lxEnable(allBoards);
+  lxWait();
+
+  Serial.println("'b' benchmark, 'h' hop all, 'p' per-board offsets, "
+                 "'e' CE off/on for the odd boards, 's' stats");
+}
+
+void loop() {
+  if (!Serial.available()) return;
+  char c = Serial.read();
+
+  if (c == 'b') bench();
+
+  if (c == 'h') {
+    hopHigh = !hopHigh;
+    opBegin();
+    bool ok = hopAll(hopHigh ? HOP_HI_HZ : HOP_LO_HZ);
+    opEnd(ok ? "Hop all" : "Hop all (not plannable)");
+  }
+
+  if (c == 'p') {
+    opBegin();
+    bool ok = programOffsets();
+    opEnd(ok ? "Offsets" : "Offsets (aborted)");
+  }
+
+  if (c == 'e') {
+    halfOff = !halfOff;
+    LxSet ce = allBoards;
+    if (halfOff) {
+      for (uint16_t i = 1; i < BOARD_COUNT; i += 2) ce.w[i >> 5] &= ~(1u << (i & 31));
+    }
+    opBegin();
+    lxEnable(ce);
+    opEnd(halfOff ? "Odd boards off" : "All boards on");
+  }
+
+  if (c == 's') printStats();
+}
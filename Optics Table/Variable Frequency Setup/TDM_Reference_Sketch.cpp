@@ -0,0 +1,329 @@
+#include <Arduino.h>
+#include <SPI.h>
+#include "adf5355_plan.h"
+#include "acquisition.h"
+
+// ============================================================================
+// USER SETTINGS
+// ============================================================================
+
+static constexpr uint32_t PFD_HZ          = 10000000;   // must match R4 in the image
+static constexpr uint32_t CHANNEL_STEP_HZ = 10000;
+static constexpr bool     USE_RFOUTB      = true;
+
+// Virtual channels. Channel 0 is the reference; the synth visits every
+// channel once per frame, reference first, then the next frame starts
+// with the reference again.
+static const uint64_t VCH_FREQS_HZ[] = {
+  10525000000ull,   // reference
+  10500000000ull,
+  10550000000ull,
+};
+
+// Time on each channel, and how much of it to throw away after the switch
+static constexpr uint32_t SLOT_US   = 2000;
+static constexpr uint32_t SETTLE_US = 600;
+
+// Autocal on every switch. Channels this close together can usually skip it
+// (faster lock), but leave it on unless you've checked the lock time.
+static constexpr bool SWITCH_AUTOCAL = true;
+
+// Receiver on ADC0 (GPIO26)
+static constexpr uint8_t  RX_INPUT   = 0;
+static constexpr uint32_t RX_RATE_HZ = 50000;
+
+// Print the drift-corrected channel means every this many frames
+static constexpr uint32_t REPORT_FRAMES = 100;
+
+// ============================================================================
+// PIN DEFINITIONS (board A of the dual-board sketch)
+// ============================================================================
+static const int A_SCLK = 18;
+static const int A_MOSI = 19;
+static const int A_LE   = 20;
+static const int A_CE   = 17;
+
+static const int A_MISO_UNUSED = 16;
+static const int A_CS_UNUSED   = 21;
+
+SPIClassRP2040 spiA(spi0, A_MISO_UNUSED, A_CS_UNUSED, A_SCLK, A_MOSI);
+SPISettings pllSPI(1000000, MSBFIRST, SPI_MODE0);
+
+static constexpr PlanConfig planCfg = { PFD_HZ, CHANNEL_STEP_HZ, USE_RFOUTB };
+static constexpr uint8_t VCH_COUNT = sizeof(VCH_FREQS_HZ) / sizeof(VCH_FREQS_HZ[0]);
+
+// ============================================================================
+// SPI
+// ============================================================================
+static inline void pulseLE(int pinLE) {
+  digitalWrite(pinLE, HIGH);
+  delayMicroseconds(2);
+  digitalWrite(pinLE, LOW);
+  delayMicroseconds(2);
+}
+
+static void writeReg(SPIClassRP2040 &spi, int pinLE, uint32_t reg) {
+  spi.beginTransaction(pllSPI);
+  spi.transfer((reg >> 24) & 0xFF);
+  spi.transfer((reg >> 16) & 0xFF);
+  spi.transfer((reg >>  8) & 0xFF);
+  spi.transfer((reg >>  0) & 0xFF);
+  spi.endTransaction();
+  pulseLE(pinLE);
+}
+
+static const uint32_t baseRegs[13] = {
+  0x0001040C, // R12
+  0x0061300B, // R11
+  0x00C0000A, // R10
+  0x00000009, // R9
+  0x102D0428, // R8
+  0x12000007, // R7
+  0x35000006, // R6
+  0x00800005, // R5
+  0x00000004, // R4
+  0x00000003, // R3
+  0x00001002, // R2
+  0x00000A41, // R1
+  0x00550000  // R0 LAST
+};
+
+static constexpr int IDX_R6 = 12 - 6;
+static constexpr int IDX_R2 = 12 - 2;
+static constexpr int IDX_R1 = 12 - 1;
+static constexpr int IDX_R0 = 12 - 0;
+
+// Full image, but with the frequency words of the first channel so the
+// delta chain starts from a known state
+static void programPLL(const PllPlan &p) {
+  for (int i = 0; i < 13; i++) {
+    uint32_t w = baseRegs[i];
+    if (i == IDX_R6) w = packR6Div(baseRegs[IDX_R6], p);
+    if (i == IDX_R2) w = packR2(p);
+    if (i == IDX_R1) w = packR1(baseRegs[IDX_R1], p);
+    if (i == IDX_R0) w = packR0(baseRegs[IDX_R0], p) | ADF_R0_AUTOCAL;
+    writeReg(spiA, A_LE, w);
+    delay(2);
+  }
+}
+
+// ============================================================================
+// Channel switching
+// ============================================================================
+//
+// Channel order is fixed, so every transition (k -> k+1, last -> 0) is
+// packed once at startup. A switch is then just shifting out those words.
+
+static PllPlan  vchPlan[VCH_COUNT];
+static HopDelta vchDelta[VCH_COUNT];     // [k] = deltas to get INTO channel k
+
+static bool buildDeltas() {
+  for (uint8_t k = 0; k < VCH_COUNT; k++) {
+    vchPlan[k] = planFrequencyInt(planCfg, VCH_FREQS_HZ[k]);
+    if (!vchPlan[k].ok) {
+      Serial.printf("ERROR: channel %u (%llu Hz) can't be planned\n", k,
+                    (unsigned long long)VCH_FREQS_HZ[k]);
+      return false;
+    }
+  }
+  for (uint8_t k = 0; k < VCH_COUNT; k++) {
+    const PllPlan &from = vchPlan[(k + VCH_COUNT - 1) % VCH_COUNT];
+    vchDelta[k] = packHopDelta(from, vchPlan[k], baseRegs[IDX_R6], baseRegs[IDX_R1],
+                               baseRegs[IDX_R0], SWITCH_AUTOCAL);
+    Serial.printf("  -> ch%u %llu Hz: %u words\n", k,
+                  (unsigned long long)VCH_FREQS_HZ[k], vchDelta[k].n);
+  }
+  return true;
+}
+
+static uint32_t slotNumber = 0;          // every switch, channel = slot % VCH_COUNT
+static uint32_t nextSlotUs = 0;
+
+static void switchChannel() {
+  const HopDelta &d = vchDelta[slotNumber % VCH_COUNT];
+  for (uint8_t i = 0; i < d.n; i++) writeReg(spiA, A_LE, d.words[i]);
+  acqMarkHop(slotNumber);
+  slotNumber++;
+}
+
+// ============================================================================
+// Per-channel accumulators
+// ============================================================================
+//
+// Samples are attributed to the slot they fall in (acquisition timeline),
+// settled samples summed per slot. A frame's slot means are held until the
+// NEXT frame's reference slot is in, then each channel is referenced
+// against the reference linearly interpolated to its own slot time:
+//
+//   ref(k) = ref_now + (ref_next - ref_now) * k / VCH_COUNT
+//
+// so slow receiver drift (gain, offset, detector temperature) cancels
+// continuously instead of needing a separate calibration pass.
+
+struct SlotAccum {
+  uint32_t slot;
+  uint64_t edge_ns;
+  uint32_t n;
+  uint32_t sum;
+  bool     active;
+};
+
+struct TdmStats {
+  uint32_t frames;
+  uint32_t short_slots;                  // slot with no settled samples
+  int64_t  diff_sum_milli[VCH_COUNT];    // sum of (ch - interpolated ref), codes x 1000
+  int64_t  raw_sum_milli[VCH_COUNT];     // sum of raw means, codes x 1000
+  int32_t  ref_first_milli;
+  int32_t  ref_last_milli;
+};
+
+static SlotAccum slotAcc;
+static int32_t   frameMean[VCH_COUNT];   // codes x 1000, frame being collected
+static uint32_t  frameMask = 0;          // which slots of that frame came in
+static int32_t   heldMean[VCH_COUNT];    // previous complete frame
+static bool      heldValid = false;
+static uint32_t  reportFrames = 0;
+static TdmStats  tdm;
+
+static void finishFrame(int32_t refNext) {
+  // held frame referenced against ref interpolated to each slot
+  int32_t ref0 = heldMean[0];
+  for (uint8_t k = 0; k < VCH_COUNT; k++) {
+    int32_t ref = ref0 + (int32_t)((int64_t)(refNext - ref0) * k / VCH_COUNT);
+    tdm.diff_sum_milli[k] += heldMean[k] - ref;
+    tdm.raw_sum_milli[k]  += heldMean[k];
+  }
+  if (tdm.frames == 0) tdm.ref_first_milli = ref0;
+  tdm.ref_last_milli = ref0;
+  tdm.frames++;
+  reportFrames++;
+}
+
+// codes x 1000 -> "+12.345"
+static void printMilli(int32_t v, bool sign) {
+  char c = v < 0 ? '-' : '+';
+  uint32_t a = (uint32_t)(v < 0 ? -v : v);
+  if (sign || v < 0) Serial.print(c);
+  Serial.printf("%lu.%03lu", (unsigned long)(a / 1000), (unsigned long)(a % 1000));
+}
+
+static void printReport() {
+  Serial.printf("frames %lu, ref drift ", (unsigned long)tdm.frames);
+  printMilli(tdm.ref_last_milli - tdm.ref_first_milli, true);
+  Serial.print(" codes since start");
+  if (tdm.short_slots) Serial.printf(", %lu short slots", (unsigned long)tdm.short_slots);
+  Serial.println();
+  for (uint8_t k = 1; k < VCH_COUNT; k++) {
+    Serial.printf("  ch%u %llu Hz: raw ", k, (unsigned long long)VCH_FREQS_HZ[k]);
+    printMilli((int32_t)(tdm.raw_sum_milli[k] / reportFrames), false);
+    Serial.print(", vs ref ");
+    printMilli((int32_t)(tdm.diff_sum_milli[k] / reportFrames), true);
+    Serial.println();
+  }
+  memset(tdm.diff_sum_milli, 0, sizeof(tdm.diff_sum_milli));
+  memset(tdm.raw_sum_milli, 0, sizeof(tdm.raw_sum_milli));
+  reportFrames = 0;
+}
+
+static void closeSlot(const SlotAccum &s) {
+  uint8_t  k = s.slot % VCH_COUNT;
+  uint32_t frame = s.slot / VCH_COUNT;
+  static uint32_t curFrame = 0xFFFFFFFFu;
+
+  if (s.n == 0) {                        // nothing settled, frame is unusable
+    tdm.short_slots++;
+    frameMask = 0;
+    if (k == 0) heldValid = false;       // no ref to close the held frame with
+    return;
+  }
+  int32_t mean = (int32_t)((uint64_t)s.sum * 1000u / s.n);
+
+  if (frame != curFrame) {               // new frame starts (at its reference)
+    curFrame = frame;
+    frameMask = 0;
+  }
+  if (k == 0) {
+    if (heldValid) finishFrame(mean);
+    heldValid = false;
+  }
+  frameMean[k] = mean;
+  frameMask |= 1u << k;
+
+  if (frameMask == (1u << VCH_COUNT) - 1) {
+    memcpy(heldMean, frameMean, sizeof(heldMean));
+    heldValid = true;
+    frameMask = 0;
+  }
+}
+
+static void consumeBlock(const RxBlock &b) {
+  const uint64_t settle_ns = (uint64_t)SETTLE_US * 1000u;
+
+  for (uint16_t i = 0; i < b.per_channel; i++) {
+    uint64_t t = acqSampleTimeNs(b, 0, i);
+
+    HopMark m;
+    if (!acqHopAt(t, &m)) continue;      // before the first switch
+    if (!slotAcc.active || m.hop != slotAcc.slot) {
+      if (slotAcc.active) closeSlot(slotAcc);
+      slotAcc.active = true;
+      slotAcc.slot = m.hop;
+      slotAcc.edge_ns = m.t_ns;
+      slotAcc.n = 0;
+      slotAcc.sum = 0;
+    }
+    if (t - slotAcc.edge_ns < settle_ns) continue;
+    slotAcc.sum += b.data[0][i];
+    slotAcc.n++;
+  }
+}
+
+// ============================================================================
+// Arduino setup/loop
+// ============================================================================
+void setup() {
+  Serial.begin(115200);
+  delay(1000);
+
+  Serial.printf("TDM: %u virtual channels, %lu us slots (%lu us settle)\n",
+                VCH_COUNT, (unsigned long)SLOT_US, (unsigned long)SETTLE_US);
+
+  pinMode(A_LE, OUTPUT); pinMode(A_CE, OUTPUT);
+  digitalWrite(A_LE, LOW); digitalWrite(A_CE, LOW);
+  spiA.begin();
+
+  if (!buildDeltas()) {
+    while (true) delay(1000);
+  }
+
+  // Start parked on the last channel, so the first switch goes to the reference
+  programPLL(vchPlan[VCH_COUNT - 1]);
+  digitalWrite(A_CE, HIGH);
+
+  AcqConfig cfg = { RX_INPUT, 1, RX_RATE_HZ };
+  acqBegin(cfg);
+  acqStart();
+
+  switchChannel();
+  nextSlotUs = micros() + SLOT_US;
+}
+
+void loop() {
+  if ((int32_t)(micros() - nextSlotUs) >= 0) {
+    switchChannel();
+    nextSlotUs += SLOT_US;
+  }
+
+  static RxBlock blk;
+  while (acqRead(blk)) consumeBlock(blk);
+
+  if (reportFrames >= REPORT_FRAMES) printReport();
+
+  static uint32_t lastReport = 0;
+  if (millis() - lastReport > 10000) {
+    lastReport = millis();
+    Serial.printf("# blocks %lu, dropped %lu, fifo overflows %lu\n",
+                  (unsigned long)acqStats.blocks, (unsigned long)acqStats.dropped,
+                  (unsigned long)acqStats.fifo_overflows);
+  }
+}
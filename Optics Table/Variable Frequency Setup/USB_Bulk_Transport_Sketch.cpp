@@ -0,0 +1,670 @@
+#include <Arduino.h>
+#include <SPI.h>
+#include "adf5355_plan.h"
+#include "acquisition.h"
+#include "usb_bulk.h"
+#include "trace_ring.h"
+#include "sweep_average.h"
+
+// ============================================================================
+// USER SETTINGS
+// ============================================================================
+//
+// Tools -> USB Stack -> "Adafruit TinyUSB". The Serial console keeps
+// working as before; the bulk interface shows up next to it and is driven
+// by Host Tools/usb_bulk_client. Host Tools/trace_timeline reads the trace
+// ring (hops, acquisition blocks, drops) and lines it up with the host and
+// any other boards. `usb_bulk_client average` runs the table N times and
+// gets back only the averaged result (sweep_average.h). `usb_bulk_client
+// phases` stages each next table while the current one runs and swaps on
+// a pass boundary, so one stream covers several experiment phases.
+
+static constexpr uint32_t PFD_HZ          = 10000000;   // must match R4 in the image
+static constexpr uint32_t CHANNEL_STEP_HZ = 10000;
+static constexpr bool     USE_RFOUTB      = true;
+
+// Uploaded tables are hopped through at this rate while streaming
+static constexpr uint32_t HOP_PERIOD_US = 20000;
+
+// Averaged passes hop faster: nothing is streamed, so the dwell only has to
+// cover settling plus enough samples. Must stay longer than one acquisition
+// block (1.6 ms at 3 x 50 ksps) so a block holds at most one hop edge.
+static constexpr uint32_t AVG_HOP_PERIOD_US = 2000;
+
+// Receivers on ADC0.. (GPIO26..). 3 x 50 ksps of 16-bit samples = 300 kB/s,
+// well inside the ~1 MB/s full-speed bulk sustains in practice.
+static constexpr uint8_t  RX_FIRST_INPUT = 0;
+static constexpr uint8_t  RX_COUNT       = 3;
+static constexpr uint32_t RX_RATE_HZ     = 50000;   // per receiver
+
+// ============================================================================
+// PIN DEFINITIONS (board A of the dual-board sketch)
+// ============================================================================
+static const int A_SCLK = 18;
+static const int A_MOSI = 19;
+static const int A_LE   = 20;
+static const int A_CE   = 17;
+
+static const int A_MISO_UNUSED = 16;
+static const int A_CS_UNUSED   = 21;
+
+SPIClassRP2040 spiA(spi0, A_MISO_UNUSED, A_CS_UNUSED, A_SCLK, A_MOSI);
+SPISettings pllSPI(1000000, MSBFIRST, SPI_MODE0);
+
+static constexpr PlanConfig planCfg = { PFD_HZ, CHANNEL_STEP_HZ, USE_RFOUTB };
+
+static_assert((uint64_t)AVG_HOP_PERIOD_US * RX_RATE_HZ * RX_COUNT > ACQ_BLOCK_SAMPLES * 1000000ull,
+              "averaging hops must be longer than an acquisition block");
+
+// ============================================================================
+// SPI
+// ============================================================================
+static inline void pulseLE(int pinLE) {
+  digitalWrite(pinLE, HIGH);
+  delayMicroseconds(2);
+  digitalWrite(pinLE, LOW);
+  delayMicroseconds(2);
+}
+
+static void writeReg(SPIClassRP2040 &spi, int pinLE, uint32_t reg) {
+  spi.beginTransaction(pllSPI);
+  spi.transfer((reg >> 24) & 0xFF);
+  spi.transfer((reg >> 16) & 0xFF);
+  spi.transfer((reg >>  8) & 0xFF);
+  spi.transfer((reg >>  0) & 0xFF);
+  spi.endTransaction();
+  pulseLE(pinLE);
+}
+
+static const uint32_t baseRegs[13] = {
+  0x0001040C, // R12
+  0x0061300B, // R11
+  0x00C0000A, // R10
+  0x00000009, // R9
+  0x102D0428, // R8
+  0x12000007, // R7
+  0x35000006, // R6
+  0x00800005, // R5
+  0x00000004, // R4
+  0x00000003, // R3
+  0x00001002, // R2
+  0x00000A41, // R1
+  0x00550000  // R0 LAST
+};
+
+static constexpr int IDX_R6 = 12 - 6;
+static constexpr int IDX_R1 = 12 - 1;
+static constexpr int IDX_R0 = 12 - 0;
+
+static void programPLL() {
+  for (int i = 0; i < 13; i++) {
+    writeReg(spiA, A_LE, baseRegs[i]);
+    delay(2);
+  }
+}
+
+// ============================================================================
+// Hop tables (live + standby)
+// ============================================================================
+//
+// USB_T_TABLE stops the stream and replaces the live table. USB_T_TABLE_STAGE
+// plans into standby while the live table keeps hopping, and the swap is
+// done by doHop() on a hop boundary -- nothing is planned or copied there.
+// Both slots together take the RAM one full-size table used to.
+//
+// Averaging counts points by hop number, so a swap armed during an
+// averaged run waits for the run to end.
+
+static constexpr uint32_t HOP_SLOT_MAX = USB_TABLE_SLOT_MAX;
+
+// Planning hands control back to the stream every this many points
+static constexpr uint32_t PLAN_CHUNK = 32;
+
+struct HopWords {
+  uint32_t r6, r2, r1, r0;
+};
+
+struct HopSlot {
+  HopWords words[HOP_SLOT_MAX];
+  uint32_t count;
+  uint16_t id;
+  bool     ready;             // complete and CRC-checked
+};
+
+static HopSlot  slots[2];
+static uint8_t  liveSlot = 0;
+static uint8_t  swapWhen = USB_SWAP_HOLD;   // armed swap of the standby slot
+static uint32_t hopPos = 0;                 // next point of the live table
+static uint32_t hopNumber = 0;
+static uint32_t nextHopUs = 0;
+static uint64_t lastHopUs = 0;
+
+static bool         liveNoticeDue = false;
+static UsbTableLive liveNotice;
+
+static inline uint32_t hopCount() { return slots[liveSlot].count; }
+
+static void serviceStream();
+static bool swapAllowed();
+static bool hopsRunning();
+
+// Plan straight out of the frame buffer into the standby slot. Unplannable
+// points are dropped and counted. The stream is serviced every PLAN_CHUNK
+// points so hops stay on time during a long table.
+static void planStandby(const uint8_t *freqs, uint32_t n, uint16_t id,
+                        uint16_t *crc, uint32_t *failed) {
+  HopSlot &s = slots[liveSlot ^ 1];
+  s.ready = false;
+  s.count = 0;
+  s.id = id;
+  swapWhen = USB_SWAP_HOLD;
+  *crc = 0xFFFF;
+  *failed = 0;
+
+  for (uint32_t i = 0; i < n; i++) {
+    if (i % PLAN_CHUNK == 0) serviceStream();
+    uint64_t f;
+    memcpy(&f, freqs + i * 8, 8);
+    *crc = crc16(&f, 8, *crc);
+    PllPlan p = planFrequencyInt(planCfg, f);
+    if (!p.ok) { (*failed)++; continue; }
+    HopWords &w = s.words[s.count++];
+    w.r6 = packR6Div(baseRegs[IDX_R6], p);
+    w.r2 = packR2(p);
+    w.r1 = packR1(baseRegs[IDX_R1], p);
+    w.r0 = packR0(baseRegs[IDX_R0], p) | ADF_R0_AUTOCAL;
+  }
+}
+
+// Standby becomes live; the old live table stays in standby
+static void swapTables(uint64_t hopUs) {
+  liveSlot ^= 1;
+  hopPos = 0;
+  swapWhen = USB_SWAP_HOLD;
+
+  const HopSlot &s = slots[liveSlot];
+  liveNotice = {};
+  liveNotice.table_id = s.id;
+  liveNotice.points = s.count;
+  liveNotice.first_hop = hopNumber;
+  liveNotice.gap_us = lastHopUs ? (uint32_t)(hopUs - lastHopUs) : 0;
+  liveNotice.t_us = hopUs;
+  liveNoticeDue = true;
+  traceEvent(USB_TRACK_BOARD_A, USB_EV_TABLE_SWAP, hopUs, 0, s.id);
+}
+
+static void loadTable(const uint8_t *payload, uint32_t len, UsbAck &ack) {
+  uint64_t t0 = time_us_64();
+  if (len % 8) {
+    ack.status = USB_ACK_BAD;     // neither slot touched
+    return;
+  }
+  uint32_t n = len / 8;
+  if (n > HOP_SLOT_MAX) {
+    ack.status = USB_ACK_TOO_BIG;
+    return;
+  }
+  uint16_t crc;
+  uint32_t failed;
+  planStandby(payload, n, 0, &crc, &failed);
+  // An empty table goes live (no hops) but is never swapped back to
+  slots[liveSlot ^ 1].ready = slots[liveSlot ^ 1].count > 0;
+  lastHopUs = 0;
+  swapTables(t0);
+  liveNoticeDue = false;          // acked below, no notice needed
+
+  ack.status = USB_ACK_OK;
+  ack.value = hopCount();
+  ack.value2 = failed;
+  ack.elapsed_us = (uint32_t)(time_us_64() - t0);
+  traceEvent(USB_TRACK_BOARD_A, USB_EV_TABLE, t0, ack.elapsed_us, hopCount());
+}
+
+static void stageTable(const uint8_t *payload, uint32_t len, UsbAck &ack) {
+  uint64_t t0 = time_us_64();
+  UsbTableStage st;
+  if (len < sizeof(st) || (len - sizeof(st)) % 8) {
+    ack.status = USB_ACK_BAD;
+    return;
+  }
+  memcpy(&st, payload, sizeof(st));
+  uint32_t n = (len - sizeof(st)) / 8;
+  if (n > HOP_SLOT_MAX) {
+    ack.status = USB_ACK_TOO_BIG;
+    return;
+  }
+
+  uint16_t crc;
+  uint32_t failed;
+  planStandby(payload + sizeof(st), n, st.table_id, &crc, &failed);
+  HopSlot &s = slots[liveSlot ^ 1];
+
+  ack.value = s.count;
+  ack.value2 = failed;
+  ack.elapsed_us = (uint32_t)(time_us_64() - t0);
+  traceEvent(USB_TRACK_BOARD_A, USB_EV_TABLE, t0, ack.elapsed_us, s.count);
+
+  if (crc != st.crc || !s.count) {
+    s.count = 0;
+    ack.status = USB_ACK_BAD;
+    return;
+  }
+  s.ready = true;
+  if (failed) {
+    ack.status = USB_ACK_PARTIAL;   // host decides whether to swap to it anyway
+    return;
+  }
+  ack.status = USB_ACK_OK;
+  if (st.swap == USB_SWAP_HOLD || st.swap > USB_SWAP_NEXT_HOP) return;
+  if (hopsRunning()) {
+    swapWhen = st.swap;
+  } else {
+    lastHopUs = 0;
+    swapTables(time_us_64());
+  }
+}
+
+// Not hopping: swap right away. Otherwise arm it for doHop().
+static void swapCommand(const uint8_t *payload, uint32_t len, UsbAck &ack) {
+  UsbTableSwap sw = {};
+  memcpy(&sw, payload, len < sizeof(sw) ? len : sizeof(sw));
+  const HopSlot &s = slots[liveSlot ^ 1];
+  if (len < sizeof(sw) || !s.ready || !s.count || s.id != sw.table_id || sw.when > USB_SWAP_NEXT_HOP) {
+    ack.status = USB_ACK_BAD;
+    return;
+  }
+  ack.status = USB_ACK_OK;
+  if (!hopsRunning() && sw.when != USB_SWAP_HOLD) {
+    lastHopUs = 0;
+    swapTables(time_us_64());
+    ack.value = 1;                  // live now
+    return;
+  }
+  swapWhen = sw.when;
+}
+
+static void doHop() {
+  uint64_t t0 = time_us_64();
+  if (swapWhen != USB_SWAP_HOLD && (hopPos == 0 || swapWhen == USB_SWAP_NEXT_HOP) && swapAllowed()) {
+    swapTables(t0);
+  }
+
+  const HopWords &w = slots[liveSlot].words[hopPos];
+  writeReg(spiA, A_LE, w.r6);
+  writeReg(spiA, A_LE, w.r2);
+  writeReg(spiA, A_LE, w.r1);
+  writeReg(spiA, A_LE, w.r0);
+  acqMarkHop(hopNumber);
+  traceEvent(USB_TRACK_BOARD_A, USB_EV_HOP, t0, (uint32_t)(time_us_64() - t0), hopNumber);
+  lastHopUs = t0;
+  hopNumber++;
+  if (++hopPos >= hopCount()) hopPos = 0;
+}
+
+// ============================================================================
+// Streaming
+// ============================================================================
+static bool     streaming = false;
+static uint8_t  streamMode = USB_STREAM_SAMPLES;
+static uint32_t streamFrames = 0;
+static uint32_t streamDropped = 0;
+static uint32_t patternCounter = 0;
+
+// Averaging: hops left to run, and the snapshot being sent (point cursor)
+static uint32_t avgHopsTotal = 0;
+static bool     avgSending = false;
+static uint16_t avgSendPoint = 0;
+static uint8_t  avgSendFlags = 0;
+
+static bool swapAllowed() {
+  return !(streaming && streamMode == USB_STREAM_AVERAGE);
+}
+
+static bool hopsRunning() {
+  return streaming && streamMode != USB_STREAM_PATTERN && hopCount();
+}
+
+static uint8_t startStream(const UsbStreamStart &s) {
+  // A run starts from the first point; a swap still armed happens now
+  hopPos = 0;
+  if (swapWhen != USB_SWAP_HOLD) {
+    lastHopUs = 0;
+    swapTables(time_us_64());
+  }
+
+  if (s.mode == USB_STREAM_AVERAGE) {
+    if (!hopCount()) return USB_ACK_BAD;
+    if (hopCount() > avgMaxPoints(RX_COUNT)) return USB_ACK_TOO_BIG;
+    AvgConfig ac = { (uint16_t)hopCount(), RX_COUNT, s.passes, s.snapshot_every, s.settle_us * 1000 };
+    if (!avgBegin(ac)) return USB_ACK_BAD;
+    avgHopsTotal = s.passes * hopCount();
+    avgSending = false;
+  }
+
+  streamMode = s.mode;
+  streamFrames = streamDropped = 0;
+  patternCounter = 0;
+  streaming = true;
+  traceEvent(USB_TRACK_USB, USB_EV_STREAM, time_us_64(), 0, 1);
+
+  if (s.mode == USB_STREAM_SAMPLES || s.mode == USB_STREAM_AVERAGE) {
+    acqStart();
+    hopNumber = 0;
+    lastHopUs = 0;
+    if (hopCount()) {
+      doHop();
+      nextHopUs = micros() + (s.mode == USB_STREAM_AVERAGE ? AVG_HOP_PERIOD_US : HOP_PERIOD_US);
+    }
+  }
+  return USB_ACK_OK;
+}
+
+static void stopStream(UsbAck &ack) {
+  if (streaming && streamMode != USB_STREAM_PATTERN) acqStop();
+  if (streaming) traceEvent(USB_TRACK_USB, USB_EV_STREAM, time_us_64(), 0, 0);
+  streaming = false;
+  usbBulkFlush();
+  ack.status = USB_ACK_OK;
+  ack.value = streamFrames;
+  ack.value2 = streamDropped;
+}
+
+// One acquisition block per frame: header + data[ch][0..per_channel)
+static void streamSamples() {
+  static RxBlock blk;
+  while (acqRead(blk)) {
+    UsbSamplesHeader h = {};
+    h.block_seq = blk.seq;
+    h.t0_ns = blk.t0_ns;
+    h.sample_ns = blk.sample_ns;
+    h.hop = blk.hop;
+    h.hop_offset_ns = blk.hop_offset_ns;
+    h.channels = blk.channels;
+    h.per_channel = blk.per_channel;
+
+    // data rows are contiguous only when the block is full width; send
+    // each receiver's row as the second piece when it isn't
+    bool ok;
+    if (blk.per_channel == ACQ_BLOCK_SAMPLES) {
+      ok = usbBulkSend(USB_T_SAMPLES, &h, sizeof(h),
+                       blk.data, (uint32_t)blk.channels * ACQ_BLOCK_SAMPLES * 2);
+    } else {
+      static uint16_t packed[ACQ_BLOCK_SAMPLES];
+      uint32_t k = 0;
+      for (uint8_t ch = 0; ch < blk.channels; ch++) {
+        memcpy(packed + k, blk.data[ch], blk.per_channel * 2);
+        k += blk.per_channel;
+      }
+      ok = usbBulkSend(USB_T_SAMPLES, &h, sizeof(h), packed, k * 2);
+    }
+    if (ok) streamFrames++;
+    else    streamDropped++;
+
+    // Block span on the device clock (acquisition time is ns since acqStart)
+    uint64_t spanNs = acqConversionsToNs((uint64_t)blk.channels * blk.per_channel);
+    traceEvent(USB_TRACK_ACQ, USB_EV_ACQ_BLOCK, acqStartUs + blk.t0_ns / 1000,
+               (uint32_t)(spanNs / 1000), blk.seq);
+    if (!ok) traceEvent(USB_TRACK_USB, USB_EV_FRAME_DROP, time_us_64(), 0, streamFrames);
+  }
+}
+
+// Hops back to back until every pass is done, then one more mark (no
+// register writes) to close the last dwell for the averager
+static void hopAverage() {
+  if (hopNumber > avgHopsTotal || (int32_t)(micros() - nextHopUs) < 0) return;
+  if (hopNumber < avgHopsTotal) doHop();
+  else acqMarkHop(hopNumber++);
+  nextHopUs += AVG_HOP_PERIOD_US;
+}
+
+// Snapshot chunks go out while the ring has room; the rest waits for the
+// next loop() pass. The final result ends the stream.
+static void sendAverageChunks() {
+  static UsbAverageCell cells[(USB_XFER_BYTES - sizeof(UsbFrameHeader) - sizeof(UsbAverageHeader))
+                             / sizeof(UsbAverageCell)];
+  const uint16_t perFrame = (uint16_t)(sizeof(cells) / sizeof(cells[0]) / RX_COUNT);
+
+  while (avgSending && usbBulkFreeBufs() >= 2) {
+    UsbAverageHeader ah = {};
+    ah.passes_done = avgPassesDone;
+    ah.passes = avgCfg.passes;
+    ah.points = avgCfg.points;
+    ah.first_point = avgSendPoint;
+    ah.count = avgCfg.points - avgSendPoint < perFrame ? avgCfg.points - avgSendPoint : perFrame;
+    ah.channels = RX_COUNT;
+    ah.flags = avgSendFlags;
+    if (avgSendPoint + ah.count == avgCfg.points) ah.flags |= USB_AVG_LAST;
+    for (uint16_t i = 0; i < ah.count; i++) avgCells(avgSendPoint + i, &cells[i * RX_COUNT]);
+
+    if (!usbBulkSend(USB_T_AVERAGE, &ah, sizeof(ah), cells, ah.count * RX_COUNT * sizeof(UsbAverageCell))) break;
+    streamFrames++;
+    avgSendPoint += ah.count;
+    if (avgSendPoint < avgCfg.points) continue;
+
+    avgSending = false;
+    if (avgSendFlags & USB_AVG_FINAL) {
+      acqStop();
+      streaming = false;
+      traceEvent(USB_TRACK_USB, USB_EV_STREAM, time_us_64(), 0, 0);
+      Serial.printf("Average done: %lu passes x %u points, %lu hops used, %lu empty, %lu frames\n",
+                    (unsigned long)avgCfg.passes, avgCfg.points, (unsigned long)avgStats.hops,
+                    (unsigned long)avgStats.hops_empty, (unsigned long)streamFrames);
+    }
+  }
+}
+
+static void streamAverage() {
+  static RxBlock blk;
+  hopAverage();
+  while (acqRead(blk)) {
+    avgAddBlock(blk);
+    traceEvent(USB_TRACK_ACQ, USB_EV_ACQ_BLOCK, acqStartUs + blk.t0_ns / 1000,
+               (uint32_t)(acqConversionsToNs((uint64_t)blk.channels * blk.per_channel) / 1000),
+               blk.seq);
+  }
+  // A snapshot still going out when the next is due just carries on: every
+  // cell has its own pass count
+  if (avgTakeSnapshot() && !avgSending) {
+    avgSending = true;
+    avgSendPoint = 0;
+    avgSendFlags = avgDone() ? USB_AVG_FINAL : 0;
+  } else if (avgDone() && !avgSending && !(avgSendFlags & USB_AVG_FINAL)) {
+    avgSending = true;              // final fell due while a snapshot was going out
+    avgSendPoint = 0;
+    avgSendFlags = USB_AVG_FINAL;
+  }
+  sendAverageChunks();
+}
+
+// Counter words, one transfer-sized frame at a time, while there's room
+static void streamPattern() {
+  static uint32_t words[(USB_XFER_BYTES - sizeof(UsbFrameHeader)) / 4];
+  const uint32_t n = sizeof(words) / 4;
+  while (usbBulkFreeBufs() >= 2) {
+    for (uint32_t i = 0; i < n; i++) words[i] = patternCounter++;
+    if (!usbBulkSend(USB_T_PATTERN, words, sizeof(words))) break;
+    streamFrames++;
+  }
+}
+
+// Hops and outgoing frames; also called while a staged table is planned
+static void serviceStream() {
+  if (!streaming) return;
+  if (streamMode == USB_STREAM_SAMPLES) {
+    if (hopCount() && (int32_t)(micros() - nextHopUs) >= 0) {
+      doHop();
+      nextHopUs += HOP_PERIOD_US;
+    }
+    streamSamples();
+  } else if (streamMode == USB_STREAM_AVERAGE) {
+    streamAverage();
+  } else {
+    streamPattern();
+  }
+}
+
+// ============================================================================
+// Host commands
+// ============================================================================
+// Replies must get through: wait for the ring rather than drop
+// false = not queued (host gone or no room for 500 ms)
+static bool sendReply(uint8_t type, const void *a, uint32_t alen,
+                      const void *b = nullptr, uint32_t blen = 0) {
+  uint32_t t0 = millis();
+  while (!usbBulkSend(type, a, alen, b, blen)) {
+    if (!usbBulkConnected() || millis() - t0 > 500) return false;
+    usbBulkFlush();
+    yield();
+  }
+  usbBulkFlush();
+  return true;
+}
+
+static void sendAck(uint8_t type, UsbAck &ack) {
+  ack.type = type;
+  sendReply(USB_T_ACK, &ack, sizeof(ack));
+}
+
+// t2 is when the request finished arriving (stamped by the USB driver),
+// t3 as late as possible before the reply is queued
+static void answerTime(const uint8_t *payload, uint32_t len) {
+  UsbTimeRequest q = {};
+  if (len >= sizeof(q)) memcpy(&q, payload, sizeof(q));
+  UsbTimeReply r = {};
+  r.tag = q.tag;
+  r.host_tx_ns = q.host_tx_ns;
+  r.dev_rx_us = usbRxDoneUs;
+  r.dev_tx_us = time_us_64();
+  sendReply(USB_T_TIME_REPLY, &r, sizeof(r));
+  traceEvent(USB_TRACK_USB, USB_EV_TIME, r.dev_rx_us, (uint32_t)(r.dev_tx_us - r.dev_rx_us), q.tag);
+}
+
+static void sendTrace() {
+  static UsbTraceEvent events[TRACE_RING_LEN];
+  UsbTraceHeader th;
+  th.dev_now_us = time_us_64();
+  uint32_t from;
+  th.count = tracePeek(events, TRACE_RING_LEN, &from);
+  th.dropped = traceDropped;
+  if (sendReply(USB_T_TRACE, &th, sizeof(th), events, th.count * sizeof(UsbTraceEvent)))
+    traceCommit(from, th.count);
+}
+
+static void handleFrame(const UsbFrameHeader &h, const uint8_t *payload) {
+  UsbAck ack = {};
+  switch (h.type) {
+    case USB_T_PING:
+      usbBulkSend(USB_T_PONG, payload, h.len);
+      usbBulkFlush();
+      break;
+
+    case USB_T_TIME:
+      answerTime(payload, h.len);
+      break;
+
+    case USB_T_TRACE_READ:
+      sendTrace();
+      break;
+
+    case USB_T_TABLE:
+      if (streaming) stopStream(ack);
+      loadTable(payload, h.len, ack);
+      Serial.printf("Table: %lu points (%lu failed) in %lu us\n", (unsigned long)ack.value,
+                    (unsigned long)ack.value2, (unsigned long)ack.elapsed_us);
+      sendAck(USB_T_TABLE, ack);
+      break;
+
+    case USB_T_TABLE_STAGE:
+      stageTable(payload, h.len, ack);
+      Serial.printf("Staged table: %lu points (%lu failed) in %lu us, status %u\n",
+                    (unsigned long)ack.value, (unsigned long)ack.value2,
+                    (unsigned long)ack.elapsed_us, ack.status);
+      sendAck(USB_T_TABLE_STAGE, ack);
+      break;
+
+    case USB_T_TABLE_SWAP:
+      swapCommand(payload, h.len, ack);
+      sendAck(USB_T_TABLE_SWAP, ack);
+      break;
+
+    case USB_T_STREAM_START: {
+      UsbStreamStart s = {};
+      memcpy(&s, payload, h.len < sizeof(s) ? h.len : sizeof(s));
+      if (streaming) { UsbAck tmp = {}; stopStream(tmp); }
+      ack.status = startStream(s);
+      ack.value = hopCount();
+      ack.value2 = s.mode == USB_STREAM_AVERAGE ? AVG_HOP_PERIOD_US : HOP_PERIOD_US;
+      sendAck(USB_T_STREAM_START, ack);
+      break;
+    }
+
+    case USB_T_STREAM_STOP:
+      stopStream(ack);
+      Serial.printf("Stream stopped: %lu frames, %lu dropped\n",
+                    (unsigned long)ack.value, (unsigned long)ack.value2);
+      sendAck(USB_T_STREAM_STOP, ack);
+      break;
+
+    default:
+      ack.status = USB_ACK_BAD;
+      sendAck(h.type, ack);
+      break;
+  }
+}
+
+static void printStats() {
+  Serial.printf("USB %s | tx %lu frames, %lu xfers, %llu bytes, %lu dropped | "
+                "rx %lu frames, %llu bytes, %lu bad\n",
+                usbBulkConnected() ? "up" : "down",
+                (unsigned long)usbStats.tx_frames, (unsigned long)usbStats.tx_xfers,
+                (unsigned long long)usbStats.tx_bytes, (unsigned long)usbStats.tx_dropped,
+                (unsigned long)usbStats.rx_frames, (unsigned long long)usbStats.rx_bytes,
+                (unsigned long)usbStats.rx_bad);
+  Serial.printf("acq: blocks %lu, dropped %lu, fifo overflows %lu | trace: %lu pending, %lu overwritten\n",
+                (unsigned long)acqStats.blocks, (unsigned long)acqStats.dropped,
+                (unsigned long)acqStats.fifo_overflows,
+                (unsigned long)tracePending(), (unsigned long)traceDropped);
+}
+
+// ============================================================================
+// Arduino setup/loop
+// ============================================================================
+void setup() {
+  usbBulkBegin();          // before Serial, so it's in the first enumeration
+  Serial.begin(115200);
+  delay(1000);
+
+  Serial.println("USB bulk transport: vendor interface + Serial console");
+
+  pinMode(A_LE, OUTPUT); pinMode(A_CE, OUTPUT);
+  digitalWrite(A_LE, LOW); digitalWrite(A_CE, LOW);
+  spiA.begin();
+  programPLL();
+  digitalWrite(A_CE, HIGH);
+
+  AcqConfig cfg = { RX_FIRST_INPUT, RX_COUNT, RX_RATE_HZ };
+  acqBegin(cfg);
+}
+
+void loop() {
+  const UsbFrameHeader *h;
+  const uint8_t *payload;
+  if (usbBulkReceive(&h, &payload)) handleFrame(*h, payload);
+
+  if (streaming && !usbBulkConnected()) {
+    UsbAck tmp = {};
+    stopStream(tmp);
+    Serial.println("Host went away, stream stopped");
+  }
+
+  serviceStream();
+  if (liveNoticeDue && usbBulkSend(USB_T_TABLE_LIVE, &liveNotice, sizeof(liveNotice))) {
+    liveNoticeDue = false;
+    Serial.printf("Table %u live at hop %lu (%lu points), gap %lu us\n", liveNotice.table_id,
+                  (unsigned long)liveNotice.first_hop, (unsigned long)liveNotice.points,
+                  (unsigned long)liveNotice.gap_us);
+  }
+  usbBulkFlush();
+
+  if (Serial.available() && Serial.read() == 's') printStats();
+}
@@ -0,0 +1,260 @@
+#pragma once
+#include <Arduino.h>
+#include "hardware/adc.h"
+#include "hardware/dma.h"
+#include "hardware/irq.h"
+#include "hardware/timer.h"
+#include "hot_path.h"
+
+// ============================================================================
+// Multi-receiver acquisition (RP2040 ADC round robin + DMA)
+// ============================================================================
+//
+// The ADC free-runs in round-robin over `channels` consecutive inputs
+// (GPIO26.. = ADC0..), and two chained DMA channels ping-pong it into a ring
+// of blocks. Because the ADC clock and the microsecond timer both come off
+// the same crystal, sample n was taken at exactly  start + n * sample_ns,
+// so block timestamps are computed rather than read in the IRQ (no IRQ
+// latency in the timestamps). Within a frame, receiver k is k * sample_ns
+// behind receiver 0 -- that's the per-channel phase.
+//
+// The sketch calls acqMarkHop() right after each LE edge, which puts hops on
+// the same nanosecond timeline; every block comes out tagged with the hop
+// that was active at its first sample and the offset from that hop's edge.
+//
+// acqMarkHop() and the DMA IRQ are HOT_PATH (RAM), so they're safe to call
+// from hop alarm handlers and keep running during flash writes.
+
+static constexpr uint8_t  ACQ_MAX_CH        = 4;
+static constexpr uint16_t ACQ_BLOCK_SAMPLES = 240;   // divisible by 1..4 channels
+static constexpr uint8_t  ACQ_RING_BLOCKS   = 8;
+static constexpr uint8_t  ACQ_HOP_HISTORY   = 32;
+static constexpr uint32_t ACQ_ADC_CLOCK_HZ  = 48000000;
+static constexpr uint32_t ACQ_MIN_CYCLES    = 96;    // 500 ksps max
+
+struct AcqConfig {
+  uint8_t  first_input;          // ADC input of receiver 0
+  uint8_t  channels;             // number of receivers (consecutive inputs)
+  uint32_t rate_per_channel_hz;
+};
+
+// One block after deinterleaving
+struct RxBlock {
+  uint32_t seq;                  // block number since acqStart()
+  uint64_t t0_ns;                // receiver 0, first sample (ns since acqStart)
+  uint32_t sample_ns;            // spacing between conversions (rounded, for display)
+  uint32_t hop;                  // hop active at t0 (0xFFFFFFFF = before first hop)
+  int64_t  hop_offset_ns;        // t0 - that hop's LE edge
+  uint8_t  channels;
+  uint16_t per_channel;
+  uint16_t data[ACQ_MAX_CH][ACQ_BLOCK_SAMPLES];
+};
+
+struct AcqStats {
+  uint32_t blocks;
+  uint32_t dropped;              // ring overrun, consumer too slow
+  uint32_t fifo_overflows;       // ADC FIFO overflowed (DMA starved)
+};
+
+struct HopMark {
+  uint32_t hop;
+  uint64_t t_ns;
+};
+
+static AcqConfig acqCfg;
+static AcqStats  acqStats;
+static uint16_t  acqRing[ACQ_RING_BLOCKS][ACQ_BLOCK_SAMPLES];
+static int       acqDma[2] = { -1, -1 };
+static uint32_t  acqCycles = ACQ_MIN_CYCLES;   // ADC clocks per conversion
+static uint64_t  acqStartUs = 0;
+
+static volatile uint32_t acqDone = 0;     // blocks completed by DMA
+static uint32_t acqReadSeq = 0;           // next block the consumer gets
+
+// Marks are stored as raw timer µs (no 64-bit multiply in the IRQ) and put
+// on the ns timeline by acqHopAt().
+struct AcqHopRaw {
+  uint32_t hop;
+  uint64_t t_us;
+};
+
+static AcqHopRaw acqHops[ACQ_HOP_HISTORY];
+static volatile uint32_t acqHopCount = 0;
+
+static inline uint64_t acqNowNs() {
+  return (time_us_64() - acqStartUs) * 1000u;
+}
+
+// n conversions in ns, exact (1e9 / 48 MHz = 125/6 ns per ADC clock)
+static inline uint64_t acqConversionsToNs(uint64_t n) {
+  return n * acqCycles * 125u / 6u;
+}
+
+// Time of receiver ch, sample i in a block
+static inline uint64_t acqSampleTimeNs(const RxBlock &b, uint8_t ch, uint16_t i) {
+  return b.t0_ns + acqConversionsToNs((uint64_t)i * b.channels + ch);
+}
+
+// ============================================================================
+// Hop timeline
+// ============================================================================
+static void HOT_PATH(acqMarkHop)(uint32_t hop) {
+  uint32_t n = acqHopCount;
+  acqHops[n % ACQ_HOP_HISTORY].hop  = hop;
+  acqHops[n % ACQ_HOP_HISTORY].t_us = hotTimeUs64();
+  acqHopCount = n + 1;
+}
+
+// Latest hop whose edge is at or before t_ns. false if none is in history.
+static bool acqHopAt(uint64_t t_ns, HopMark *out) {
+  uint32_t n = acqHopCount;
+  uint32_t oldest = (n > ACQ_HOP_HISTORY) ? n - ACQ_HOP_HISTORY : 0;
+  for (uint32_t k = n; k > oldest; k--) {
+    const AcqHopRaw &m = acqHops[(k - 1) % ACQ_HOP_HISTORY];
+    if (m.t_us < acqStartUs) break;              // from before acqStart()
+    uint64_t m_ns = (m.t_us - acqStartUs) * 1000u;
+    if (m_ns <= t_ns) { out->hop = m.hop; out->t_ns = m_ns; return true; }
+  }
+  return false;
+}
+
+// ============================================================================
+// DMA
+// ============================================================================
+// Registers directly: the dma_channel_* helpers are only `static inline`
+// and may not be inlined into a RAM function.
+static void HOT_PATH(acqDmaIrq)() {
+  for (int k = 0; k < 2; k++) {
+    int ch = acqDma[k];
+    if (!(dma_hw->ints0 & (1u << ch))) continue;
+    dma_hw->ints0 = 1u << ch;
+
+    // This channel just filled block `acqDone`; its next turn is two on
+    uint32_t next = acqDone + 2;
+    dma_hw->ch[ch].write_addr = (uintptr_t)acqRing[next % ACQ_RING_BLOCKS];
+    dma_hw->ch[ch].transfer_count = ACQ_BLOCK_SAMPLES;
+    acqDone++;
+  }
+  if (adc_hw->fcs & (1u << 11)) {          // FCS.OVER, write 1 to clear
+    adc_hw->fcs |= (1u << 11);
+    acqStats.fifo_overflows++;
+  }
+}
+
+static void acqBegin(const AcqConfig &cfg) {
+  acqCfg = cfg;
+  if (acqCfg.channels < 1) acqCfg.channels = 1;
+  if (acqCfg.channels > ACQ_MAX_CH) acqCfg.channels = ACQ_MAX_CH;
+
+  adc_init();
+  for (uint8_t k = 0; k < acqCfg.channels; k++) adc_gpio_init(26 + acqCfg.first_input + k);
+
+  uint32_t total_hz = acqCfg.rate_per_channel_hz * acqCfg.channels;
+  uint32_t cycles = ACQ_ADC_CLOCK_HZ / total_hz;
+  if (cycles < ACQ_MIN_CYCLES) cycles = ACQ_MIN_CYCLES;
+  adc_set_clkdiv((float)(cycles - 1));
+  acqCycles = cycles;
+
+  uint32_t mask = ((1u << acqCfg.channels) - 1) << acqCfg.first_input;
+  adc_select_input(acqCfg.first_input);
+  adc_set_round_robin(acqCfg.channels > 1 ? mask : 0);
+  adc_fifo_setup(true, true, 1, false, false);
+
+  acqDma[0] = dma_claim_unused_channel(true);
+  acqDma[1] = dma_claim_unused_channel(true);
+  for (int k = 0; k < 2; k++) {
+    dma_channel_config c = dma_channel_get_default_config(acqDma[k]);
+    channel_config_set_transfer_data_size(&c, DMA_SIZE_16);
+    channel_config_set_read_increment(&c, false);
+    channel_config_set_write_increment(&c, true);
+    channel_config_set_dreq(&c, DREQ_ADC);
+    channel_config_set_chain_to(&c, acqDma[k ^ 1]);
+    dma_channel_configure(acqDma[k], &c, acqRing[k], &adc_hw->fifo, ACQ_BLOCK_SAMPLES, false);
+    dma_channel_set_irq0_enabled(acqDma[k], true);
+  }
+  irq_add_shared_handler(DMA_IRQ_0, acqDmaIrq, PICO_SHARED_IRQ_HANDLER_DEFAULT_ORDER_PRIORITY);
+  irq_set_enabled(DMA_IRQ_0, true);
+  // Only true while every shared handler on DMA_IRQ_0 is HOT_PATH too
+  hotIrqAllow(DMA_IRQ_0);
+}
+
+// Start free-running capture. Everything on the timeline is relative to this.
+static void acqStart() {
+  adc_run(false);
+  adc_fifo_drain();
+  adc_select_input(acqCfg.first_input);   // round robin restarts at receiver 0
+
+  acqDone = 0;
+  acqReadSeq = 0;
+  acqHopCount = 0;
+  memset(&acqStats, 0, sizeof(acqStats));
+
+  for (int k = 0; k < 2; k++) {
+    dma_channel_set_write_addr(acqDma[k], acqRing[k], false);
+    dma_channel_set_trans_count(acqDma[k], ACQ_BLOCK_SAMPLES, false);
+  }
+  dma_channel_start(acqDma[0]);
+  acqStartUs = time_us_64();
+  adc_run(true);
+}
+
+static void acqStop() {
+  adc_run(false);
+  dma_channel_abort(acqDma[0]);
+  dma_channel_abort(acqDma[1]);
+  adc_fifo_drain();
+}
+
+// ============================================================================
+// Consumer side
+// ============================================================================
+
+// Next finished block, deinterleaved into per-receiver streams.
+static bool acqRead(RxBlock &out) {
+  uint32_t done = acqDone;
+  if (acqReadSeq == done) return false;
+
+  // DMA may already be writing block done+1 (and done+2 is queued):
+  // anything older than that window has been overwritten
+  if (done - acqReadSeq > ACQ_RING_BLOCKS - 2) {
+    uint32_t keep = done - (ACQ_RING_BLOCKS - 2);
+    acqStats.dropped += keep - acqReadSeq;
+    acqReadSeq = keep;
+  }
+
+  const uint16_t *src = acqRing[acqReadSeq % ACQ_RING_BLOCKS];
+  uint8_t nch = acqCfg.channels;
+  uint16_t per = ACQ_BLOCK_SAMPLES / nch;
+
+  out.seq = acqReadSeq;
+  out.channels = nch;
+  out.per_channel = per;
+  out.sample_ns = (uint32_t)acqConversionsToNs(1);
+  out.t0_ns = acqConversionsToNs((uint64_t)acqReadSeq * ACQ_BLOCK_SAMPLES);
+
+  for (uint16_t i = 0; i < per; i++) {
+    for (uint8_t ch = 0; ch < nch; ch++) {
+      out.data[ch][i] = src[i * nch + ch] & 0x0FFF;
+    }
+  }
+
+  // If DMA lapped us while copying, the copy is torn -- drop it
+  if (acqDone - acqReadSeq > ACQ_RING_BLOCKS - 2) {
+    acqStats.dropped++;
+    acqReadSeq++;
+    return false;
+  }
+
+  HopMark m;
+  if (acqHopAt(out.t0_ns, &m)) {
+    out.hop = m.hop;
+    out.hop_offset_ns = (int64_t)(out.t0_ns - m.t_ns);
+  } else {
+    out.hop = 0xFFFFFFFFu;
+    out.hop_offset_ns = 0;
+  }
+
+  acqReadSeq++;
+  acqStats.blocks++;
+  return true;
+}
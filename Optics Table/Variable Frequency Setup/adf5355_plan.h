@@ -0,0 +1,261 @@
+#pragma once
+#include <stdint.h>
+
+// ============================================================================
+// ADF5355 integer frequency planner
+// ============================================================================
+//
+// Integer-only version of planFrequency() from test.cpp, with the real
+// ADF5355 N-divider layout:
+//
+//   VCO = PFD * (INT + (FRAC1 + FRAC2/MOD2) / MOD1),   MOD1 = 2^24
+//
+// VCO runs 3.4..6.8 GHz. RFOUTB is the doubled VCO (6.8..13.6 GHz), RFOUTA
+// is VCO / RF_DIV (1..64).
+//
+// MOD2 is fixed per configuration (PFD / gcd(PFD, channel step at the VCO))
+// so every on-grid frequency has an exact N, and N can be treated as one
+// big integer "units" count:
+//
+//   units = (INT * MOD1 + FRAC1) * MOD2 + FRAC2
+//
+// That's what makes offset arithmetic (derivePlan) exact.
+//
+// No Arduino dependencies in here -- host tools include this file too.
+
+static constexpr uint64_t ADF_VCO_MIN_HZ = 3400000000ull;
+static constexpr uint64_t ADF_VCO_MAX_HZ = 6800000000ull;
+static constexpr uint32_t ADF_MOD1       = 1u << 24;
+static constexpr uint32_t ADF_MOD2_MAX   = 16383;     // 14-bit field
+static constexpr uint8_t  ADF_RFDIV_MAX  = 64;
+
+struct PlanConfig {
+  uint32_t pfd_hz;         // after doubler / R counter / div2
+  uint32_t chan_step_hz;   // output resolution we need to hit exactly
+  bool     use_rfoutb;
+};
+
+struct PllPlan {
+  uint64_t rf_hz;
+  uint64_t vco_hz;
+  uint16_t INT;
+  uint32_t FRAC1;          // 24-bit
+  uint16_t FRAC2;          // 14-bit
+  uint16_t MOD2;           // 14-bit
+  uint8_t  out_div;        // RFOUTA divider, 1 when using RFOUTB
+  bool     ok;
+};
+
+static inline uint32_t planGcd(uint32_t a, uint32_t b) {
+  while (b) { uint32_t t = a % b; a = b; b = t; }
+  return a;
+}
+
+// Channel step seen at the VCO for a given divider
+static inline uint32_t vcoStepHz(const PlanConfig &cfg, uint8_t out_div) {
+  if (cfg.use_rfoutb) return cfg.chan_step_hz / 2;   // RFOUTB = 2 * VCO
+  return cfg.chan_step_hz * out_div;
+}
+
+static inline uint16_t planMod2(const PlanConfig &cfg, uint8_t out_div) {
+  uint32_t step = vcoStepHz(cfg, out_div);
+  if (step == 0) return 0;
+  uint32_t mod2 = cfg.pfd_hz / planGcd(cfg.pfd_hz, step);
+  return (mod2 > ADF_MOD2_MAX) ? 0 : (uint16_t)mod2;  // 0 = step too fine for this PFD
+}
+
+// Pick RFOUTA divider so the VCO lands in range. 0 if it can't.
+static inline uint8_t planOutDiv(uint64_t rf_hz) {
+  for (uint8_t div = 1; div <= ADF_RFDIV_MAX; div *= 2) {
+    uint64_t vco = rf_hz * div;
+    if (vco >= ADF_VCO_MIN_HZ && vco <= ADF_VCO_MAX_HZ) return div;
+  }
+  return 0;
+}
+
+// ============================================================================
+// Full plan
+// ============================================================================
+static inline PllPlan planFrequencyInt(const PlanConfig &cfg, uint64_t rf_hz) {
+  PllPlan p = {};
+  p.rf_hz = rf_hz;
+
+  if (cfg.use_rfoutb) {
+    p.out_div = 1;
+    p.vco_hz = rf_hz / 2;
+  } else {
+    p.out_div = planOutDiv(rf_hz);
+    p.vco_hz = rf_hz * p.out_div;
+  }
+  if (p.out_div == 0 || p.vco_hz < ADF_VCO_MIN_HZ || p.vco_hz > ADF_VCO_MAX_HZ) {
+    return p;   // ok = false
+  }
+
+  p.MOD2 = planMod2(cfg, p.out_div);
+  if (p.MOD2 == 0) return p;
+
+  // N = vco / pfd, split into INT, FRAC1 (of 2^24) and FRAC2 (of MOD2)
+  uint64_t n_int = p.vco_hz / cfg.pfd_hz;
+  uint64_t rem   = p.vco_hz % cfg.pfd_hz;                 // < pfd < 2^27
+  uint64_t x     = rem << 24;                             // < 2^51
+  uint64_t r1    = x % cfg.pfd_hz;
+
+  if (n_int > 0xFFFF) return p;
+  p.INT   = (uint16_t)n_int;
+  p.FRAC1 = (uint32_t)(x / cfg.pfd_hz);
+  p.FRAC2 = (uint16_t)((r1 * p.MOD2 + cfg.pfd_hz / 2) / cfg.pfd_hz);
+  if (p.FRAC2 == p.MOD2) {   // rounding overflow (off-grid request)
+    p.FRAC2 = 0;
+    if (++p.FRAC1 == ADF_MOD1) { p.FRAC1 = 0; p.INT++; }
+  }
+
+  p.ok = true;
+  return p;
+}
+
+// ============================================================================
+// Derived plans (fixed offset from an already-planned board)
+// ============================================================================
+//
+// An offset of D Hz at the output is a constant number of N units as long as
+// both frequencies share the same divider band: D * (div or 1/2) / PFD * MOD1
+// * MOD2. It's precomputed once as a mixed-radix (INT, FRAC1, FRAC2) step, so
+// deriving is an add with carries -- no division, no rounding.
+
+struct PlanOffset {
+  int64_t  offset_hz;
+  int64_t  dvco_hz;
+  uint8_t  out_div;        // divider band this step is valid for
+  uint16_t MOD2;
+  bool     negative;
+  uint16_t dINT;
+  uint32_t dFRAC1;
+  uint16_t dFRAC2;
+  bool     ok;             // false: offset isn't on the channel grid
+};
+
+static inline PlanOffset makePlanOffset(const PlanConfig &cfg, int64_t offset_hz,
+                                        uint8_t out_div) {
+  PlanOffset o = {};
+  o.offset_hz = offset_hz;
+  o.out_div = out_div;
+  o.MOD2 = planMod2(cfg, out_div);
+  o.negative = offset_hz < 0;
+  if (o.MOD2 == 0) return o;
+
+  uint64_t mag = (uint64_t)(o.negative ? -offset_hz : offset_hz);
+  uint64_t dvco;
+  if (cfg.use_rfoutb) {
+    if (mag & 1) return o;
+    dvco = mag / 2;
+  } else {
+    dvco = mag * out_div;
+  }
+  o.dvco_hz = o.negative ? -(int64_t)dvco : (int64_t)dvco;
+
+  // units = dvco * MOD1 * MOD2 / pfd = (dvco / g) * MOD1, with g = pfd / MOD2
+  uint32_t g = cfg.pfd_hz / o.MOD2;
+  if (dvco % g) return o;
+  uint64_t units = (dvco / g) << 24;
+  uint64_t rest  = units / o.MOD2;
+
+  o.dFRAC2 = (uint16_t)(units % o.MOD2);
+  o.dFRAC1 = (uint32_t)(rest % ADF_MOD1);
+  o.dINT   = (uint16_t)(rest / ADF_MOD1);
+  o.ok = true;
+  return o;
+}
+
+// Derive b from a. Returns false if b would leave a's divider band (or the
+// offset doesn't apply to that band) -- caller then does a full plan.
+static inline bool derivePlan(const PllPlan &a, const PlanOffset &o, PllPlan &b) {
+  if (!a.ok || !o.ok || a.out_div != o.out_div || a.MOD2 != o.MOD2) return false;
+
+  b = a;
+  b.rf_hz = a.rf_hz + o.offset_hz;
+
+  b.vco_hz = a.vco_hz + o.dvco_hz;
+  if (b.vco_hz < ADF_VCO_MIN_HZ || b.vco_hz > ADF_VCO_MAX_HZ) { b.ok = false; return false; }
+
+  if (!o.negative) {
+    uint32_t f2 = (uint32_t)a.FRAC2 + o.dFRAC2;
+    uint32_t c2 = (f2 >= a.MOD2);
+    if (c2) f2 -= a.MOD2;
+    uint32_t f1 = a.FRAC1 + o.dFRAC1 + c2;
+    uint32_t c1 = (f1 >= ADF_MOD1);
+    if (c1) f1 -= ADF_MOD1;
+    b.FRAC2 = (uint16_t)f2;
+    b.FRAC1 = f1;
+    b.INT   = (uint16_t)(a.INT + o.dINT + c1);
+  } else {
+    int32_t f2 = (int32_t)a.FRAC2 - o.dFRAC2;
+    int32_t b2 = (f2 < 0);
+    if (b2) f2 += a.MOD2;
+    int32_t f1 = (int32_t)a.FRAC1 - (int32_t)o.dFRAC1 - b2;
+    int32_t b1 = (f1 < 0);
+    if (b1) f1 += ADF_MOD1;
+    b.FRAC2 = (uint16_t)f2;
+    b.FRAC1 = (uint32_t)f1;
+    b.INT   = (uint16_t)(a.INT - o.dINT - b1);
+  }
+  b.ok = true;
+  return true;
+}
+
+// ============================================================================
+// Register packing (frequency fields only)
+// ============================================================================
+//
+// R0: DB19:4 INT, DB20 prescaler, DB21 autocal
+// R1: DB27:4 FRAC1
+// R2: DB31:18 FRAC2, DB17:4 MOD2
+// R6: DB23:21 RF divider select (log2 of RFOUTA divider)
+//
+// Everything else comes from the base image so the board's known-good
+// settings are kept.
+
+static constexpr uint32_t ADF_R0_AUTOCAL = 1u << 21;
+
+static inline uint32_t packR0(uint32_t base, const PllPlan &p) {
+  return (base & ~0x000FFFFFu) | ((uint32_t)p.INT << 4) | 0u;
+}
+
+static inline uint32_t packR1(uint32_t base, const PllPlan &p) {
+  return (base & 0xF0000000u) | ((p.FRAC1 & 0xFFFFFFu) << 4) | 1u;
+}
+
+static inline uint32_t packR2(const PllPlan &p) {
+  return ((uint32_t)(p.FRAC2 & 0x3FFF) << 18) | ((uint32_t)(p.MOD2 & 0x3FFF) << 4) | 2u;
+}
+
+static inline uint32_t packR6Div(uint32_t base, const PllPlan &p) {
+  uint32_t sel = 0;
+  while ((1u << sel) < p.out_div) sel++;
+  return (base & ~(7u << 21)) | (sel << 21);
+}
+
+// ============================================================================
+// Pre-packed hop deltas
+// ============================================================================
+//
+// Only the words that differ between two plans, in write order (R0 last --
+// its LE edge is what latches the double-buffered R1/R2). R6 only on a
+// divider change, R2 only if FRAC2/MOD2 moved, R1 only if FRAC1 moved. For
+// two channels on the same grid that's usually just R1 + R0.
+
+struct HopDelta {
+  uint8_t  n;
+  uint32_t words[4];
+};
+
+static inline HopDelta packHopDelta(const PllPlan &from, const PllPlan &to,
+                                    uint32_t baseR6, uint32_t baseR1, uint32_t baseR0,
+                                    bool autocal) {
+  HopDelta d;
+  d.n = 0;
+  if (to.out_div != from.out_div) d.words[d.n++] = packR6Div(baseR6, to);
+  if (to.FRAC2 != from.FRAC2 || to.MOD2 != from.MOD2) d.words[d.n++] = packR2(to);
+  if (to.FRAC1 != from.FRAC1) d.words[d.n++] = packR1(baseR1, to);
+  d.words[d.n++] = packR0(baseR0, to) | (autocal ? ADF_R0_AUTOCAL : 0u);
+  return d;
+}
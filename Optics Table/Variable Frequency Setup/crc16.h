@@ -0,0 +1,22 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+
+// ============================================================================
+// CRC-16/CCITT (poly 0x1021, init 0xFFFF, no reflection)
+// ============================================================================
+//
+// The one CRC behind result pages, checkpoints, sequence images and table
+// uploads. Bitwise: nothing checked with it is in a hot path. Pass the last
+// result as `crc` to carry on over another buffer.
+//
+// No Arduino dependencies -- host tools include this too.
+
+static inline uint16_t crc16(const void *data, size_t n, uint16_t crc = 0xFFFF) {
+  const uint8_t *p = (const uint8_t *)data;
+  while (n--) {
+    crc ^= (uint16_t)(*p++) << 8;
+    for (int b = 0; b < 8; b++) crc = (crc & 0x8000) ? (crc << 1) ^ 0x1021 : (crc << 1);
+  }
+  return crc;
+}
@@ -0,0 +1,200 @@
+#pragma once
+#include <Arduino.h>
+#include "hardware/flash.h"
+#include "hardware/sync.h"
+#include "hot_path.h"
+#include "result_page.h"
+
+// ============================================================================
+// Wear-levelled checkpoint log + results area in RP2040 flash
+// ============================================================================
+//
+// Layout (offsets from start of flash, NOT XIP addresses):
+//
+//   FLASH_RESULTS_OFFSET  .. +FLASH_RESULTS_SIZE   raw result pages
+//   FLASH_LOG_OFFSET      .. +FLASH_LOG_SECTORS*4K  checkpoint ring
+//
+// Both sit below the last 64 KB so they stay clear of the EEPROM emulation
+// sector and a small LittleFS partition. If you give the filesystem more
+// room in the board menu, move these down.
+//
+// Checkpoints are 16-byte records appended into a ring of sectors. NOR flash
+// can program a page more than once as long as bits only go 1 -> 0, so each
+// append programs one 256-byte page that is 0xFF everywhere except the new
+// record -- no read/modify/write, no erase. A sector is erased only when the
+// ring wraps into it, i.e. once per 256 checkpoints.
+//
+// Boot finds the newest record by sequence number (torn writes fail the CRC
+// and are skipped).
+
+static constexpr uint32_t FLASH_LOG_SECTORS   = 4;
+static constexpr uint32_t FLASH_LOG_SIZE      = FLASH_LOG_SECTORS * FLASH_SECTOR_SIZE;
+static constexpr uint32_t FLASH_LOG_OFFSET    = PICO_FLASH_SIZE_BYTES - 64 * 1024 - FLASH_LOG_SIZE;
+
+static constexpr uint32_t FLASH_RESULTS_SIZE   = 256 * 1024;
+static constexpr uint32_t FLASH_RESULTS_OFFSET = FLASH_LOG_OFFSET - FLASH_RESULTS_SIZE;
+
+struct Checkpoint {
+  uint32_t seq;          // 0xFFFFFFFF = erased slot
+  uint16_t table_id;
+  uint16_t crc;          // CRC-16 over the other 14 bytes
+  uint32_t index;        // next point to measure
+  uint32_t results_off;  // bytes of results committed in the results area
+};
+static_assert(sizeof(Checkpoint) == 16, "checkpoint record must stay 16 bytes");
+
+static constexpr uint32_t FLASH_LOG_SLOTS = FLASH_LOG_SIZE / sizeof(Checkpoint);
+static constexpr uint32_t SLOTS_PER_SECTOR = FLASH_SECTOR_SIZE / sizeof(Checkpoint);
+
+struct FlashLogStats {
+  uint32_t commits;
+  uint32_t erases;
+  uint32_t commit_us;    // total time spent programming/erasing
+  uint32_t max_commit_us;
+};
+
+static uint32_t flashLogNextSlot = 0;
+static uint32_t flashLogNextSeq  = 1;
+static FlashLogStats flashLogStats;
+
+static uint16_t checkpointCrc(const Checkpoint &c) {
+  Checkpoint tmp = c;
+  tmp.crc = 0;
+  return crc16((const uint8_t *)&tmp, sizeof(tmp));
+}
+
+static inline const Checkpoint *flashLogSlot(uint32_t i) {
+  return (const Checkpoint *)(XIP_BASE + FLASH_LOG_OFFSET + i * sizeof(Checkpoint));
+}
+
+static bool flashBlank(const void *p, uint32_t len) {
+  const uint32_t *w = (const uint32_t *)p;
+  for (uint32_t i = 0; i < len / 4; i++) if (w[i] != 0xFFFFFFFFu) return false;
+  return true;
+}
+
+// Flash can't be read (XIP) while it's being written, so nothing in flash may
+// run. Only the cold IRQ lines are masked: HOT_PATH handlers (hop alarms,
+// acquisition DMA) keep running from RAM. If you start core 1, idle it
+// around these calls.
+static void flashErase(uint32_t offset, uint32_t len) {
+  uint32_t irq = hotMaskColdIrqs();
+  flash_range_erase(offset, len);
+  hotRestoreIrqs(irq);
+}
+
+static void flashProgram(uint32_t offset, const uint8_t *data, uint32_t len) {
+  uint32_t irq = hotMaskColdIrqs();
+  flash_range_program(offset, data, len);
+  hotRestoreIrqs(irq);
+}
+
+// Scan the ring. Returns true and fills *out if a valid checkpoint exists.
+static bool flashLogLoad(Checkpoint *out) {
+  bool found = false;
+  uint32_t bestSlot = 0;
+  Checkpoint best = {};
+
+  for (uint32_t i = 0; i < FLASH_LOG_SLOTS; i++) {
+    const Checkpoint *c = flashLogSlot(i);
+    if (c->seq == 0xFFFFFFFFu) continue;
+    if (checkpointCrc(*c) != c->crc) continue;
+    if (!found || c->seq > best.seq) {
+      best = *c;
+      bestSlot = i;
+      found = true;
+    }
+  }
+
+  if (found) {
+    *out = best;
+    flashLogNextSeq  = best.seq + 1;
+    flashLogNextSlot = (bestSlot + 1) % FLASH_LOG_SLOTS;
+  } else {
+    flashLogNextSeq  = 1;
+    flashLogNextSlot = 0;
+  }
+  return found;
+}
+
+static void flashLogCommit(uint16_t table_id, uint32_t index, uint32_t results_off) {
+  uint32_t t0 = micros();
+
+  // Step over anything a torn write left behind (can't program over it)
+  while (flashLogNextSlot % SLOTS_PER_SECTOR != 0 &&
+         !flashBlank(flashLogSlot(flashLogNextSlot), sizeof(Checkpoint))) {
+    flashLogNextSlot = (flashLogNextSlot + 1) % FLASH_LOG_SLOTS;
+  }
+
+  // Entering a sector: it holds the oldest records, wipe it
+  if (flashLogNextSlot % SLOTS_PER_SECTOR == 0) {
+    uint32_t sector = flashLogNextSlot / SLOTS_PER_SECTOR;
+    flashErase(FLASH_LOG_OFFSET + sector * FLASH_SECTOR_SIZE, FLASH_SECTOR_SIZE);
+    flashLogStats.erases++;
+  }
+
+  Checkpoint c;
+  c.seq = flashLogNextSeq++;
+  c.table_id = table_id;
+  c.index = index;
+  c.results_off = results_off;
+  c.crc = checkpointCrc(c);
+
+  static uint8_t page[FLASH_PAGE_SIZE];
+  memset(page, 0xFF, sizeof(page));
+  uint32_t byteOff = flashLogNextSlot * sizeof(Checkpoint);
+  uint32_t pageOff = byteOff & ~(FLASH_PAGE_SIZE - 1);
+  memcpy(page + (byteOff - pageOff), &c, sizeof(c));
+  flashProgram(FLASH_LOG_OFFSET + pageOff, page, FLASH_PAGE_SIZE);
+
+  flashLogNextSlot = (flashLogNextSlot + 1) % FLASH_LOG_SLOTS;
+
+  uint32_t dt = micros() - t0;
+  flashLogStats.commits++;
+  flashLogStats.commit_us += dt;
+  if (dt > flashLogStats.max_commit_us) flashLogStats.max_commit_us = dt;
+}
+
+// Invalidate everything (new table, or operator asked for a fresh start)
+static void flashLogReset() {
+  flashErase(FLASH_LOG_OFFSET, FLASH_LOG_SIZE);
+  flashLogNextSlot = 0;
+  flashLogNextSeq  = 1;
+}
+
+// ============================================================================
+// Results area
+// ============================================================================
+//
+// Append-only, one ResultPage (256 bytes) at a time. Sectors are erased as
+// the write pointer enters them, so a fresh run costs one erase per 16 pages.
+
+static inline const uint8_t *flashResultsPtr(uint32_t off) {
+  return (const uint8_t *)(XIP_BASE + FLASH_RESULTS_OFFSET + off);
+}
+
+// Append at *off (advanced past the page). A page that isn't blank was
+// written after the last checkpoint before a reset; it's left alone and
+// skipped -- pages carry their own first_index, readers keep the newest.
+// Returns false when the area is full.
+static bool flashResultsAppend(uint32_t *off, const ResultPage &page) {
+  uint32_t t0 = micros();
+
+  while (*off + FLASH_PAGE_SIZE <= FLASH_RESULTS_SIZE) {
+    if (*off % FLASH_SECTOR_SIZE == 0) {
+      flashErase(FLASH_RESULTS_OFFSET + *off, FLASH_SECTOR_SIZE);
+      flashLogStats.erases++;
+    }
+    if (flashBlank(flashResultsPtr(*off), FLASH_PAGE_SIZE)) break;
+    *off += FLASH_PAGE_SIZE;
+  }
+  if (*off + FLASH_PAGE_SIZE > FLASH_RESULTS_SIZE) return false;
+
+  flashProgram(FLASH_RESULTS_OFFSET + *off, (const uint8_t *)&page, FLASH_PAGE_SIZE);
+  *off += FLASH_PAGE_SIZE;
+
+  uint32_t dt = micros() - t0;
+  flashLogStats.commit_us += dt;
+  if (dt > flashLogStats.max_commit_us) flashLogStats.max_commit_us = dt;
+  return true;
+}
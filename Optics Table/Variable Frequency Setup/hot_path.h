@@ -0,0 +1,195 @@
+#pragma once
+
+// ============================================================================
+// RAM-resident hot path
+// ============================================================================
+//
+// Code that runs from flash goes through the XIP cache; a miss costs a QSPI
+// fetch (~µs), and while flash is being erased/programmed it can't run at
+// all. Anything that decides *when* an edge happens (hop alarms, keying,
+// sync/lock-detect GPIO IRQs, DMA completion) is therefore marked HOT_PATH
+// and lives in RAM, and only calls other RAM code or inline register access.
+//
+//   void HOT_PATH(myIrq)(uint alarm) { ... }
+//   static uint32_t HOT_DATA(myTable)[16];      // const tables too
+//
+// SDK helpers like time_us_64(), busy_wait_us_32(), spi_write_blocking() and
+// the hardware_alarm callback dispatcher are in flash, so the RP2040
+// versions below are used instead. Host Tools/check_hot_path verifies the
+// result on the built ELF: every HOT_PATH/HOT_DATA symbol in RAM, and no
+// call from a hot function into flash (veneers included).
+//
+// On ESP32 the same macros map to IRAM_ATTR / DRAM_ATTR.
+
+#if defined(ARDUINO_ARCH_RP2040)
+
+#include "pico/stdlib.h"
+#include "hardware/irq.h"
+#include "hardware/spi.h"
+#include "hardware/structs/iobank0.h"
+#include "hardware/structs/sio.h"
+#include "hardware/regs/m0plus.h"
+
+#define HOT_PATH(fn)   __not_in_flash_func(fn)
+#define HOT_DATA(name) __not_in_flash("hot_data") name
+
+// --- time (1 µs timer, read raw so nothing latches) ------------------------
+static __force_inline uint32_t hotTimeUs32() {
+  return timer_hw->timerawl;
+}
+
+static __force_inline uint64_t hotTimeUs64() {
+  uint32_t hi = timer_hw->timerawh;
+  for (;;) {
+    uint32_t lo = timer_hw->timerawl;
+    uint32_t hi2 = timer_hw->timerawh;
+    if (hi == hi2) return ((uint64_t)hi << 32) | lo;
+    hi = hi2;
+  }
+}
+
+static __force_inline void hotBusyWaitUs(uint32_t us) {
+  uint32_t t0 = timer_hw->timerawl;
+  while (timer_hw->timerawl - t0 < us) {}
+}
+
+// --- GPIO (SIO directly; gpio_put() is only `static inline`) --------------
+static __force_inline void hotGpioPut(uint gpio, bool v) {
+  if (v) sio_hw->gpio_set = 1u << gpio;
+  else   sio_hw->gpio_clr = 1u << gpio;
+}
+
+// --- arithmetic ------------------------------------------------------------
+// Cortex-M0+ has no long multiply or divide instruction, so int64 `*` and
+// any `/` or `%` by a non-power-of-two become calls into the runtime
+// helpers, which are in flash. Use these (or precompute) instead.
+
+// 32 x 32 -> 64 from four single-cycle 16-bit multiplies
+static __force_inline uint64_t hotMulU32(uint32_t a, uint32_t b) {
+  uint32_t al = a & 0xFFFF, ah = a >> 16;
+  uint32_t bl = b & 0xFFFF, bh = b >> 16;
+  uint64_t mid = (uint64_t)(al * bh) + (ah * bl);
+  return ((uint64_t)(ah * bh) << 32) + (mid << 16) + (al * bl);
+}
+
+// Unsigned divide on the SIO divider. The divider is shared with whatever
+// code we interrupted, so its state is saved/restored if it was in use
+// (same dance as the SDK's wrappers).
+static __force_inline uint32_t hotDivU32(uint32_t a, uint32_t b, uint32_t *rem) {
+  bool dirty = sio_hw->div_csr & SIO_DIV_CSR_DIRTY_BITS;
+  uint32_t sd = 0, ss = 0, sr = 0, sq = 0;
+  if (dirty) {
+    while (!(sio_hw->div_csr & SIO_DIV_CSR_READY_BITS)) {}
+    sd = sio_hw->div_udividend;
+    ss = sio_hw->div_udivisor;
+    sr = sio_hw->div_remainder;
+    sq = sio_hw->div_quotient;
+  }
+  sio_hw->div_udividend = a;
+  sio_hw->div_udivisor = b;
+  while (!(sio_hw->div_csr & SIO_DIV_CSR_READY_BITS)) {}
+  if (rem) *rem = sio_hw->div_remainder;
+  uint32_t q = sio_hw->div_quotient;
+  if (dirty) {
+    sio_hw->div_udividend = sd;
+    sio_hw->div_udivisor = ss;
+    sio_hw->div_remainder = sr;
+    sio_hw->div_quotient = sq;
+  }
+  return q;
+}
+
+static __force_inline int32_t hotDivS32(int32_t a, uint32_t b) {
+  uint32_t q = hotDivU32(a < 0 ? 0u - (uint32_t)a : (uint32_t)a, b, nullptr);
+  return a < 0 ? -(int32_t)q : (int32_t)q;
+}
+
+// --- SPI: one 32-bit register word, 8-bit frames, blocking ----------------
+static __force_inline void hotSpiWrite32(spi_hw_t *hw, uint32_t w) {
+  for (int s = 24; s >= 0; s -= 8) {
+    while (!(hw->sr & SPI_SSPSR_TNF_BITS)) {}
+    hw->dr = (w >> s) & 0xFF;
+  }
+  while (hw->sr & SPI_SSPSR_BSY_BITS) {}
+  while (hw->sr & SPI_SSPSR_RNE_BITS) (void)hw->dr;   // drain, keeps RX from overrunning
+}
+
+// --- hardware alarms without the SDK dispatcher ---------------------------
+//
+// Claim the alarm as usual, then hotAlarmInit() installs the handler
+// directly on TIMER_IRQ_n (the vector table is in RAM). The handler must
+// call hotAlarmAck() first thing.
+
+static uint32_t hotIrqMask = 0;     // NVIC lines whose every handler is HOT_PATH
+
+static inline void hotIrqAllow(uint irq) {
+  hotIrqMask |= 1u << irq;
+}
+
+static inline void hotAlarmInit(uint alarm, irq_handler_t handler) {
+  uint irq = TIMER_IRQ_0 + alarm;
+  irq_set_exclusive_handler(irq, handler);
+  hw_set_bits(&timer_hw->inte, 1u << alarm);
+  irq_set_enabled(irq, true);
+  hotIrqAllow(irq);
+}
+
+static __force_inline void hotAlarmAck(uint alarm) {
+  hw_clear_bits(&timer_hw->intf, 1u << alarm);   // in case it was forced
+  timer_hw->intr = 1u << alarm;
+}
+
+// Arm for target_us (low 32 bits of the timer). If that's already gone by
+// without the alarm matching, fire now instead of 71 minutes from now.
+static __force_inline void hotAlarmArm(uint alarm, uint32_t target_us) {
+  uint32_t mask = 1u << alarm;
+  timer_hw->alarm[alarm] = target_us;
+  if ((int32_t)(target_us - timer_hw->timerawl) <= 0 && (timer_hw->armed & mask)) {
+    timer_hw->armed = mask;                      // disarm (write 1 to clear)
+    hw_set_bits(&timer_hw->intf, mask);          // force the IRQ
+  }
+}
+
+// --- GPIO IRQ without the SDK dispatcher ----------------------------------
+// Events pending for `gpio` on this core, acknowledged (edge events).
+static __force_inline uint32_t hotGpioTakeEvents(uint gpio) {
+  uint32_t shift = 4 * (gpio % 8);
+  uint32_t ev = (iobank0_hw->proc0_irq_ctrl.ints[gpio / 8] >> shift) & 0xF;
+  iobank0_hw->intr[gpio / 8] = ev << shift;
+  return ev;
+}
+
+// --- flash writes without stopping the hot path ---------------------------
+//
+// While flash is erased/programmed nothing may execute from XIP, so the
+// usual answer is to disable every interrupt -- which also stalls hops for
+// the whole erase (tens of ms). Instead, mask only the NVIC lines that
+// aren't all-RAM and leave the hot ones running.
+// (SysTick/PendSV aren't NVIC lines; plain arduino-pico doesn't use them.)
+
+static __force_inline uint32_t hotMaskColdIrqs() {
+  volatile uint32_t *iser = (volatile uint32_t *)(PPB_BASE + M0PLUS_NVIC_ISER_OFFSET);
+  volatile uint32_t *icer = (volatile uint32_t *)(PPB_BASE + M0PLUS_NVIC_ICER_OFFSET);
+  uint32_t enabled = *iser;
+  *icer = enabled & ~hotIrqMask;
+  __dsb();
+  __isb();
+  return enabled;
+}
+
+static __force_inline void hotRestoreIrqs(uint32_t enabled) {
+  volatile uint32_t *iser = (volatile uint32_t *)(PPB_BASE + M0PLUS_NVIC_ISER_OFFSET);
+  *iser = enabled;
+}
+
+#elif defined(ESP32)
+
+#define HOT_PATH(fn)   IRAM_ATTR fn
+#define HOT_DATA(name) DRAM_ATTR name
+
+#else
+
+#define HOT_PATH(fn)   fn
+#define HOT_DATA(name) name
+
+#endif
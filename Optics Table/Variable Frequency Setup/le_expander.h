@@ -0,0 +1,271 @@
+#pragma once
+#include <Arduino.h>
+#include "hardware/pio.h"
+#include "hardware/dma.h"
+#include "hardware/clocks.h"
+
+// ============================================================================
+// LE / CE expander (chained 74HC595s, loaded by PIO + DMA)
+// ============================================================================
+//
+// Every board needs an LE and a CE line; with dedicated GPIOs that stops at
+// a handful of boards. Here they come off a chain of 74HC595s instead:
+// board i's LE is chain output 2i, its CE output 2i + 1 (output 0 = QA of
+// the first '595 after the Pico). 16 chips = 64 boards. Wiring:
+//
+//   SER   -> SER of the first '595, QH' -> SER of the next, ...
+//   SRCLK -> every SRCLK      RCLK -> every RCLK      SRCLR tied high
+//   OE    -> every OE (optional; held high until the first clean pattern,
+//            since a '595 powers up with random outputs -- add pull-downs
+//            on LE/CE at the boards)
+//
+// RCLK copies the whole chain to the outputs at once, so any subset of
+// boards gets its LE edge (or CE change) in the same instant: one strobe.
+//
+// A PIO state machine shifts 32 * LX_WORDS bits, MSB first, then waits for
+// a trigger word before strobing RCLK. DMA feeds it, so a full
+// LE-high / strobe / LE-low / strobe pulse runs without the CPU:
+//
+//   0:  mov x, y              side 0   ; x = bits - 1
+//   1:  pull ifempty block    side 0   ; next word every 32 bits
+//   2:  out pins, 1           side 0   ; SER
+//   3:  jmp x-- 1             side 1   ; SRCLK rise
+//   4:  pull block            side 0   ; trigger: latch now
+//   5:  out null, 32          side 0   ; drop it, OSR empty again
+//   6:  set pins, 1           side 0 [3] ; RCLK
+//   7:  set pins, 0           side 0   ; -> wrap
+//
+// Three PIO cycles per bit. A chain shorter than 32 * LX_WORDS outputs is
+// fine: the extra leading bits fall off the end.
+//
+// The ADF5355 takes its word on LE's rising edge, so the usual pattern is
+// lxStage(set) while SPI shifts the register word (hides the chain shift),
+// then lxLatch() the moment SPI is done. Only the LE-low pattern that
+// follows costs time before the next word can start -- lxShiftNs().
+
+static constexpr uint8_t  LX_MAX_WORDS  = 8;                   // 256 outputs
+static constexpr uint16_t LX_MAX_BOARDS = LX_MAX_WORDS * 16;
+static constexpr uint8_t  LX_SET_WORDS  = LX_MAX_BOARDS / 32;
+
+struct LxConfig {
+  uint8_t  pin_ser;
+  uint8_t  pin_srclk;
+  uint8_t  pin_rclk;
+  int8_t   pin_oe;            // -1 = OE tied low
+  uint16_t boards;
+  uint32_t srclk_hz;          // 74HC595 at 3.3 V: keep <= ~20 MHz
+};
+
+// A subset of boards, one bit each
+struct LxSet {
+  uint32_t w[LX_SET_WORDS];
+};
+
+static inline void lxSetClear(LxSet &s) { memset(&s, 0, sizeof(s)); }
+static inline void lxSetAdd(LxSet &s, uint16_t board) { s.w[board >> 5] |= 1u << (board & 31); }
+static inline bool lxSetHas(const LxSet &s, uint16_t board) { return s.w[board >> 5] & (1u << (board & 31)); }
+
+static inline LxSet lxOne(uint16_t board) {
+  LxSet s;
+  lxSetClear(s);
+  lxSetAdd(s, board);
+  return s;
+}
+
+static inline LxSet lxAll(uint16_t boards) {
+  LxSet s;
+  lxSetClear(s);
+  for (uint16_t i = 0; i < boards; i++) lxSetAdd(s, i);
+  return s;
+}
+
+struct LxStats {
+  uint32_t strobes;
+  uint32_t pulses;
+  uint32_t words;            // words handed to DMA
+};
+
+static LxConfig lxCfg;
+static LxStats  lxStats;
+static uint8_t  lxWords = 1;               // 32-bit words per pattern
+static uint     lxSm = 0;
+static int      lxDma = -1;
+static uint32_t lxSmHz = 0;
+static LxSet    lxCe;                      // CE state, applied with every pattern
+// One sequence in flight: up to two patterns, each followed by a trigger
+static uint32_t lxBuf[2 * (LX_MAX_WORDS + 1)];
+
+static constexpr uint32_t LX_TRIGGER = 0;
+static constexpr uint     LX_PC_IDLE = 1;     // waiting for the next pattern
+static constexpr uint     LX_PC_STAGED = 4;   // pattern in, waiting for the trigger
+
+// 16 board bits -> 32 output bits, board k at bit 2k
+static inline uint32_t lxSpread(uint32_t x) {
+  x &= 0xFFFF;
+  x = (x | (x << 8)) & 0x00FF00FF;
+  x = (x | (x << 4)) & 0x0F0F0F0F;
+  x = (x | (x << 2)) & 0x33333333;
+  x = (x | (x << 1)) & 0x55555555;
+  return x;
+}
+
+// Pattern in shift order: highest outputs first, MSB first
+static uint32_t *lxBuild(uint32_t *out, const LxSet &le) {
+  for (int8_t k = lxWords - 1; k >= 0; k--) {
+    uint32_t leHalf = le.w[k >> 1] >> ((k & 1) * 16);
+    uint32_t ceHalf = lxCe.w[k >> 1] >> ((k & 1) * 16);
+    *out++ = lxSpread(leHalf) | (lxSpread(ceHalf) << 1);
+  }
+  return out;
+}
+
+static inline bool lxIdle() {
+  return !dma_channel_is_busy(lxDma) && pio_sm_is_tx_fifo_empty(pio1, lxSm) &&
+         pio_sm_get_pc(pio1, lxSm) == LX_PC_IDLE;
+}
+
+// Last strobe done: outputs are what was asked for
+static void lxWait() {
+  while (!lxIdle()) tight_loop_contents();
+}
+
+static void lxSend(uint32_t *end) {
+  lxWait();
+  uint32_t n = (uint32_t)(end - lxBuf);
+  dma_channel_transfer_from_buffer_now(lxDma, lxBuf, n);
+  lxStats.words += n;
+}
+
+// ============================================================================
+// API
+// ============================================================================
+
+// Chain time for one pattern (plus the strobe), what each LE edge costs
+static inline uint32_t lxShiftNs() {
+  uint64_t cycles = 3ull * 32 * lxWords + 1 + 2 + 4 + 1;
+  return (uint32_t)(cycles * 1000000000ull / lxSmHz);
+}
+
+static bool lxBegin(const LxConfig &cfg) {
+  if (cfg.boards == 0 || cfg.boards > LX_MAX_BOARDS) return false;
+  lxCfg = cfg;
+  lxWords = (uint8_t)((cfg.boards * 2 + 31) / 32);
+  lxSetClear(lxCe);
+  memset(&lxStats, 0, sizeof(lxStats));
+
+  if (cfg.pin_oe >= 0) {
+    pinMode(cfg.pin_oe, OUTPUT);
+    digitalWrite(cfg.pin_oe, HIGH);          // outputs off until they're known
+  }
+
+  static uint16_t prog[8];
+  prog[0] = pio_encode_mov(pio_x, pio_y)     | pio_encode_sideset(1, 0);
+  prog[1] = pio_encode_pull(true, true)      | pio_encode_sideset(1, 0);
+  prog[2] = pio_encode_out(pio_pins, 1)      | pio_encode_sideset(1, 0);
+  prog[3] = pio_encode_jmp_x_dec(1)          | pio_encode_sideset(1, 1);
+  prog[4] = pio_encode_pull(false, true)     | pio_encode_sideset(1, 0);
+  prog[5] = pio_encode_out(pio_null, 32)     | pio_encode_sideset(1, 0);
+  prog[6] = pio_encode_set(pio_pins, 1)      | pio_encode_sideset(1, 0) | pio_encode_delay(3);
+  prog[7] = pio_encode_set(pio_pins, 0)      | pio_encode_sideset(1, 0);
+  // absolute jump targets (and the PCs lxIdle looks for): load at offset 0
+  pio_program_t p = { prog, 8, 0 };
+  pio_add_program(pio1, &p);
+
+  lxSm = pio_claim_unused_sm(pio1, true);
+  const uint8_t pins[3] = { cfg.pin_ser, cfg.pin_srclk, cfg.pin_rclk };
+  for (uint8_t pin : pins) {
+    pio_gpio_init(pio1, pin);
+    pio_sm_set_consecutive_pindirs(pio1, lxSm, pin, 1, true);
+  }
+
+  pio_sm_config c = pio_get_default_sm_config();
+  sm_config_set_out_pins(&c, cfg.pin_ser, 1);
+  sm_config_set_set_pins(&c, cfg.pin_rclk, 1);
+  sm_config_set_sideset_pins(&c, cfg.pin_srclk);
+  sm_config_set_sideset(&c, 1, false, false);
+  sm_config_set_out_shift(&c, false, false, 32);     // MSB first, explicit pulls
+  sm_config_set_fifo_join(&c, PIO_FIFO_JOIN_TX);
+  sm_config_set_wrap(&c, 0, 7);
+  uint32_t sys = clock_get_hz(clk_sys);
+  float div = (float)sys / (3.0f * cfg.srclk_hz);
+  if (div < 1.0f) div = 1.0f;
+  sm_config_set_clkdiv(&c, div);
+  lxSmHz = (uint32_t)(sys / div);
+  pio_sm_init(pio1, lxSm, 0, &c);
+
+  // y = bits - 1, and leave the OSR empty so the first `pull ifempty` pulls
+  pio_sm_put_blocking(pio1, lxSm, 32u * lxWords - 1);
+  pio_sm_exec(pio1, lxSm, pio_encode_pull(false, true));
+  pio_sm_exec(pio1, lxSm, pio_encode_mov(pio_y, pio_osr));
+  pio_sm_exec(pio1, lxSm, pio_encode_out(pio_null, 32));
+  pio_sm_set_enabled(pio1, lxSm, true);
+
+  lxDma = dma_claim_unused_channel(true);
+  dma_channel_config d = dma_channel_get_default_config(lxDma);
+  channel_config_set_transfer_data_size(&d, DMA_SIZE_32);
+  channel_config_set_read_increment(&d, true);
+  channel_config_set_write_increment(&d, false);
+  channel_config_set_dreq(&d, pio_get_dreq(pio1, lxSm, true));
+  dma_channel_configure(lxDma, &d, &pio1->txf[lxSm], lxBuf, 0, false);
+
+  // Everything low, then let the outputs drive
+  LxSet none;
+  lxSetClear(none);
+  uint32_t *e = lxBuild(lxBuf, none);
+  *e++ = LX_TRIGGER;
+  dma_channel_transfer_from_buffer_now(lxDma, lxBuf, (uint32_t)(e - lxBuf));
+  lxWait();
+  if (cfg.pin_oe >= 0) digitalWrite(cfg.pin_oe, LOW);
+  return true;
+}
+
+// LE high on `le`, then low again, CE unchanged. Returns at once; the
+// next call (or lxWait) waits for it.
+static void lxPulse(const LxSet &le) {
+  LxSet none;
+  lxSetClear(none);
+  uint32_t *e = lxBuild(lxBuf, le);
+  *e++ = LX_TRIGGER;
+  e = lxBuild(e, none);
+  *e++ = LX_TRIGGER;
+  lxSend(e);
+  lxStats.pulses++;
+  lxStats.strobes += 2;
+}
+
+// Shift the LE-high pattern in without latching it (overlaps SPI)
+static void lxStage(const LxSet &le) {
+  uint32_t *e = lxBuild(lxBuf, le);
+  lxSend(e);
+}
+
+// Strobe the staged pattern now, then queue LE low behind it. The rising
+// LE edges come one trigger word after the call -- a few PIO cycles, if
+// the pattern is already in.
+static void lxLatch() {
+  while (dma_channel_is_busy(lxDma) || pio_sm_get_pc(pio1, lxSm) != LX_PC_STAGED) {
+    tight_loop_contents();
+  }
+  pio1->txf[lxSm] = LX_TRIGGER;
+
+  LxSet none;
+  lxSetClear(none);
+  uint32_t *e = lxBuild(lxBuf, none);
+  *e++ = LX_TRIGGER;
+  dma_channel_transfer_from_buffer_now(lxDma, lxBuf, (uint32_t)(e - lxBuf));
+  lxStats.words += (uint32_t)(e - lxBuf) + 1;
+  lxStats.pulses++;
+  lxStats.strobes += 2;
+}
+
+// New CE state for every board, applied in one strobe
+static void lxEnable(const LxSet &ce) {
+  lxWait();
+  lxCe = ce;
+  LxSet none;
+  lxSetClear(none);
+  uint32_t *e = lxBuild(lxBuf, none);
+  *e++ = LX_TRIGGER;
+  lxSend(e);
+  lxStats.strobes++;
+}
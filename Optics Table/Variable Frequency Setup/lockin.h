@@ -0,0 +1,107 @@
+#pragma once
+#include <stdint.h>
+#include <math.h>
+
+// ============================================================================
+// Fixed-point Goertzel bank
+// ============================================================================
+//
+// One resonator per keyed channel, all fed the same receiver samples. Over a
+// block of N samples each one pulls out the amplitude at its own bin k
+// (f = k * fs / N). Channels keyed on distinct integer bins are orthogonal
+// over the block, so one receiver sees every board's contribution at once.
+//
+//   s[n] = x[n] + c * s[n-1] - s[n-2],   c = 2 cos(2 pi k / N)   (Q30)
+//   |X|^2 = s1^2 + s2^2 - c * s1 * s2
+//
+// Samples are 12-bit ADC codes; mid-scale is subtracted so the state stays
+// small. Per sample it's one 64x64 multiply per channel (__aeabi_lmul on
+// the M0+, a handful of 32-bit multiplies): on a low bin of a long block
+// the state outgrows 32 bits, so the operands can't be narrowed.
+//
+// No Arduino dependencies -- the host simulator runs this too.
+
+static constexpr uint8_t DEMOD_MAX_CH = 8;
+
+struct Goertzel {
+  int64_t coeff_q30;
+  int64_t s1;
+  int64_t s2;
+};
+
+struct DemodBank {
+  uint8_t  channels;
+  uint16_t block;                 // N
+  uint16_t count;                 // samples so far in this block
+  uint32_t blocks_done;
+  uint16_t bin[DEMOD_MAX_CH];
+  Goertzel g[DEMOD_MAX_CH];
+  uint64_t power[DEMOD_MAX_CH];   // |X|^2 of the last complete block
+};
+
+// Bins come from the keying setup; coefficients are computed once (float is
+// fine here, nothing in the per-sample path touches it).
+static void demodInit(DemodBank &d, uint16_t block, const uint16_t *bins, uint8_t channels) {
+  d.channels = channels > DEMOD_MAX_CH ? DEMOD_MAX_CH : channels;
+  d.block = block;
+  d.count = 0;
+  d.blocks_done = 0;
+  for (uint8_t k = 0; k < d.channels; k++) {
+    d.bin[k] = bins[k];
+    float w = 6.2831853f * (float)bins[k] / (float)block;
+    d.g[k].coeff_q30 = (int64_t)lroundf(2.0f * cosf(w) * (float)(1 << 30));
+    d.g[k].s1 = d.g[k].s2 = 0;
+    d.power[k] = 0;
+  }
+}
+
+// Nearest integer bin for a keying frequency
+static inline uint16_t demodBinFor(uint32_t f_hz, uint32_t fs_hz, uint16_t block) {
+  return (uint16_t)(((uint64_t)f_hz * block + fs_hz / 2) / fs_hz);
+}
+
+static inline void demodFinishBlock(DemodBank &d) {
+  for (uint8_t k = 0; k < d.channels; k++) {
+    Goertzel &g = d.g[k];
+    // c*s1*s2 in Q30: do the multiply in two steps to stay inside 64 bits
+    int64_t cs1 = (g.coeff_q30 * g.s1) >> 30;
+    int64_t p = g.s1 * g.s1 + g.s2 * g.s2 - cs1 * g.s2;
+    d.power[k] = p < 0 ? 0 : (uint64_t)p;
+    g.s1 = g.s2 = 0;
+  }
+  d.count = 0;
+  d.blocks_done++;
+}
+
+// Feed one sample. Returns true when a block just completed (results ready).
+static inline bool demodPush(DemodBank &d, uint16_t sample) {
+  int32_t x = (int32_t)sample - 2048;
+  for (uint8_t k = 0; k < d.channels; k++) {
+    Goertzel &g = d.g[k];
+    int64_t s = x + ((g.coeff_q30 * g.s1) >> 30) - g.s2;
+    g.s2 = g.s1;
+    g.s1 = s;
+  }
+  if (++d.count < d.block) return false;
+  demodFinishBlock(d);
+  return true;
+}
+
+static uint32_t isqrt64(uint64_t v) {
+  uint64_t r = 0, bit = 1ull << 62;
+  while (bit > v) bit >>= 2;
+  while (bit) {
+    if (v >= r + bit) { v -= r + bit; r = (r >> 1) + bit; }
+    else r >>= 1;
+    bit >>= 2;
+  }
+  return (uint32_t)r;
+}
+
+// Step height of a 50% square-wave keyed channel, in ADC codes x 1000.
+// A sine of amplitude a gives |X| = a N / 2; a square wave of height A has
+// a fundamental of 2 A / pi, so A = pi |X| / N.
+static inline uint32_t demodKeyedAmplitudeMilli(const DemodBank &d, uint8_t k) {
+  uint64_t mag = isqrt64(d.power[k]);
+  return (uint32_t)(mag * 3141593u / 1000u / d.block);
+}
@@ -0,0 +1,61 @@
+#pragma once
+#include <stdint.h>
+#include "crc16.h"
+
+// ============================================================================
+// Result pages
+// ============================================================================
+//
+// What the sweep engine stores and the results area (flash_log.h) holds.
+// Kept apart from sweep_engine.h so readers -- the flash log, host tools --
+// get the layout without the engine's hooks.
+
+static constexpr uint32_t RESULTS_PER_PAGE = 62;
+
+// Exactly one flash page. Self-describing, so a reader can walk the results
+// area and skip anything torn or stale.
+struct ResultPage {
+  uint32_t first_index;
+  uint16_t count;
+  uint16_t crc;                       // CRC-16 over everything else
+  uint32_t samples[RESULTS_PER_PAGE];
+};
+static_assert(sizeof(ResultPage) == 256, "result page must match a flash page");
+
+static inline uint16_t resultPageCrc(const ResultPage &pg) {
+  ResultPage tmp = pg;
+  tmp.crc = 0;
+  return crc16(&tmp, sizeof(tmp));
+}
+
+static inline bool resultPageValid(const ResultPage &pg) {
+  return pg.count > 0 && pg.count <= RESULTS_PER_PAGE && resultPageCrc(pg) == pg.crc;
+}
+
+// After a reset the board writes the pages since its last checkpoint again,
+// so a results area can hold an old copy of a stretch of pages followed by
+// the new one. A page is current unless a later page of the same sweep
+// starts at or before it; a page at index 0 starts a new sweep. With the
+// stale copies left out, first_index only goes back at a sweep start.
+//
+// Marks the valid, current pages in keep (bit i = page i, LSB first, so
+// (n + 7) / 8 bytes) in one backward pass without allocating, which works
+// on the mapped flash as well as on a host file. Returns the pages that
+// failed the check and aren't erased flash.
+static inline uint32_t resultPagesCurrent(const ResultPage *pages, uint32_t n, uint8_t *keep) {
+  uint32_t bad = 0;
+  uint64_t after = UINT64_MAX;        // lowest first_index later in this sweep
+  for (uint32_t i = n; i-- > 0;) {
+    const ResultPage &pg = pages[i];
+    bool valid = resultPageValid(pg);
+    if (!valid && pg.count != 0xFFFF) bad++;
+    if (valid && pg.first_index < after) keep[i >> 3] |= (uint8_t)(1u << (i & 7));
+    else                                 keep[i >> 3] &= (uint8_t)~(1u << (i & 7));
+    if (valid) after = pg.first_index == 0 ? UINT64_MAX : pg.first_index < after ? pg.first_index : after;
+  }
+  return bad;
+}
+
+static inline bool resultPageKept(const uint8_t *keep, uint32_t i) {
+  return (keep[i >> 3] >> (i & 7)) & 1;
+}
@@ -0,0 +1,390 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+#include "adf5355_plan.h"
+#include "crc16.h"
+
+// ============================================================================
+// Experiment sequencer: a small bytecode VM
+// ============================================================================
+//
+// Tune / key / wait-for-lock / acquire / compare / loop / emit, uploaded
+// once and run on the board, so an experiment that branches on its own
+// measurements doesn't pay a USB round trip per step.
+//
+// Program image (little-endian), as produced by Host Tools/seq_asm:
+//
+//   SeqHeader (12 bytes) | SeqOp ops[n_ops] (8 bytes each) | uint64 consts[n_consts]
+//
+// Every op is the same 8 bytes (opcode, three register/flag bytes, int32
+// immediate), so fetch/decode is one load. Registers are 16 x int64 so a
+// frequency in Hz fits; 64-bit constants (frequencies) live in the pool.
+//
+// seqLoad() checks everything once -- opcodes, register numbers, jump
+// targets, pool indices, and that every constant TUNE target plans -- so
+// the run loop does no checking at all. Constant tunes are planned at load;
+// register tunes go through a small direct-mapped plan cache.
+//
+// Per-op timing: every op is timed with seqMicros(); totals/max per opcode
+// always, plus a ring of the last SEQ_TRACE_LEN ops (pc, start, duration,
+// resulting register value) when tracing is on.
+//
+// Nothing in here touches hardware. The including file provides the hooks
+// (the sketch drives SPI/CE/ADC, Host Tools/seq_asm --sim fakes them).
+// A WAIT can hold a slice for up to 2^31 us, so seqAbortPending() is polled
+// inside the waits: the caller's loop doesn't run until the slice ends.
+
+static void     seqTune(const PllPlan &p);
+static void     seqKey(bool on);
+static bool     seqLocked();
+static int32_t  seqAcquire(uint8_t channel, uint32_t samples);
+static void     seqEmit(uint16_t tag, uint32_t t_us, int64_t value);
+static uint32_t seqMicros();
+static bool     seqAbortPending();    // true = abort now
+
+static constexpr uint16_t SEQ_MAGIC      = 0x5E9A;
+static constexpr uint8_t  SEQ_VERSION    = 1;
+static constexpr uint16_t SEQ_MAX_OPS    = 1024;
+static constexpr uint16_t SEQ_MAX_CONSTS = 256;
+static constexpr uint8_t  SEQ_REGS       = 16;
+static constexpr uint16_t SEQ_TRACE_LEN  = 256;     // power of two
+static constexpr uint16_t SEQ_PLAN_CACHE = 32;      // power of two
+
+// ============================================================================
+// Instruction set
+// ============================================================================
+//
+//   op          operands            effect
+//   HALT                            stop
+//   TUNE        k                   tune to consts[k] (planned at load)
+//   TUNE_R      ra                  tune to ra Hz (plan cache)
+//   KEY         a                   RF on (a = 1) / off (a = 0)
+//   WAIT        imm                 busy-wait imm us
+//   WAIT_R      ra                  busy-wait ra us
+//   WAIT_LOCK   ra, imm             wait for lock, up to imm us; ra = us waited, -1 on timeout
+//   ACQ         ra, ch, imm         ra = acquire(ch, imm samples)
+//   LDI         ra, imm             ra = imm
+//   LDK         ra, k               ra = consts[k]
+//   MOV         ra, rb              ra = rb
+//   ADD/SUB     ra, rb, rc          ra = rb +/- rc
+//   ADDI        ra, rb, imm         ra = rb + imm
+//   MULI        ra, rb, imm         ra = rb * imm
+//   SHRI        ra, rb, imm         ra = rb >> imm (arithmetic)
+//   JMP         imm                 pc = imm
+//   JCMP        ra, rb, cond, imm   if (ra cond rb) pc = imm
+//   LOOP        ra, imm             if (--ra > 0) pc = imm
+//   EMIT        ra, imm             emit (tag imm, now, ra)
+//   TIME        ra                  ra = seqMicros()
+
+enum SeqOpcode : uint8_t {
+  SEQ_HALT, SEQ_TUNE, SEQ_TUNE_R, SEQ_KEY, SEQ_WAIT, SEQ_WAIT_R, SEQ_WAIT_LOCK, SEQ_ACQ,
+  SEQ_LDI, SEQ_LDK, SEQ_MOV, SEQ_ADD, SEQ_SUB, SEQ_ADDI, SEQ_MULI, SEQ_SHRI,
+  SEQ_JMP, SEQ_JCMP, SEQ_LOOP, SEQ_EMIT, SEQ_TIME,
+  SEQ_OP_COUNT
+};
+
+static const char *const SEQ_OP_NAMES[SEQ_OP_COUNT] = {
+  "halt", "tune", "tune_r", "key", "wait", "wait_r", "waitlock", "acq",
+  "ldi", "ldk", "mov", "add", "sub", "addi", "muli", "shri",
+  "jmp", "jcmp", "loop", "emit", "time",
+};
+
+enum SeqCond : uint8_t { SEQ_LT, SEQ_LE, SEQ_EQ, SEQ_NE, SEQ_GE, SEQ_GT, SEQ_COND_COUNT };
+
+static const char *const SEQ_COND_NAMES[SEQ_COND_COUNT] = { "lt", "le", "eq", "ne", "ge", "gt" };
+
+#pragma pack(push, 1)
+struct SeqOp {
+  uint8_t op;
+  uint8_t a, b, c;
+  int32_t imm;
+};
+
+struct SeqHeader {
+  uint16_t magic;
+  uint8_t  version;
+  uint8_t  reserved;
+  uint16_t n_ops;
+  uint16_t n_consts;
+  uint16_t crc;             // crc16 over ops + consts
+  uint16_t reserved2;
+};
+#pragma pack(pop)
+
+static_assert(sizeof(SeqOp) == 8, "op layout");
+static_assert(sizeof(SeqHeader) == 12, "sequence header layout");
+
+static inline size_t seqImageSize(const SeqHeader &h) {
+  return sizeof(SeqHeader) + (size_t)h.n_ops * sizeof(SeqOp) + (size_t)h.n_consts * 8;
+}
+
+// ============================================================================
+// VM state
+// ============================================================================
+enum SeqState : uint8_t {
+  SEQ_EMPTY,                // nothing loaded
+  SEQ_READY,                // loaded, not started (or reset)
+  SEQ_RUNNING,
+  SEQ_HALTED,
+  SEQ_ABORTED,
+  SEQ_FAULT,                // TUNE_R to something that doesn't plan
+};
+
+struct SeqTrace {
+  uint32_t t_us;            // op start
+  uint32_t dt_us;
+  uint16_t pc;
+  uint8_t  op;
+  uint8_t  reg;             // ra of the op
+  int32_t  value;           // ra afterwards (low 32 bits)
+};
+
+struct SeqOpStats {
+  uint32_t count;
+  uint32_t max_us;
+  uint64_t total_us;
+};
+
+struct SeqPlanSlot {
+  uint64_t hz;              // 0 = empty
+  PllPlan  plan;
+};
+
+struct SeqVm {
+  PlanConfig cfg;
+  SeqOp    ops[SEQ_MAX_OPS + 1];      // +1: implicit HALT after the last op
+  uint64_t consts[SEQ_MAX_CONSTS];
+  PllPlan  constPlans[SEQ_MAX_CONSTS];
+  uint16_t n_ops, n_consts;
+
+  int64_t  r[SEQ_REGS];
+  uint16_t pc;
+  uint16_t fault_pc;
+  SeqState state;
+  bool     abort;                     // from the caller or seqAbortPending()
+
+  bool     trace;
+  uint32_t traceCount;                // total ever written; ring index = count % LEN
+  SeqTrace traceBuf[SEQ_TRACE_LEN];
+  SeqOpStats opStats[SEQ_OP_COUNT];
+
+  SeqPlanSlot cache[SEQ_PLAN_CACHE];
+  uint32_t cacheHits, cacheMisses;
+  uint64_t opsRun;
+};
+
+// ============================================================================
+// Load + verify
+// ============================================================================
+// Back to the start, registers and stats cleared (program and cache kept)
+static void seqReset(SeqVm &vm) {
+  if (vm.state == SEQ_EMPTY) return;
+  memset(vm.r, 0, sizeof(vm.r));
+  memset(vm.opStats, 0, sizeof(vm.opStats));
+  vm.pc = 0;
+  vm.fault_pc = 0;
+  vm.traceCount = 0;
+  vm.opsRun = 0;
+  vm.abort = false;
+  vm.state = SEQ_READY;
+}
+
+// Returns nullptr if the image is good (vm then SEQ_READY), else why not.
+// A rejected image leaves the loaded program as it was: everything is
+// checked against the image before vm is touched.
+static const char *seqLoad(SeqVm &vm, const PlanConfig &cfg, const uint8_t *img, size_t len) {
+  SeqHeader h;
+  if (len < sizeof(h)) return "short image";
+  memcpy(&h, img, sizeof(h));
+  if (h.magic != SEQ_MAGIC || h.version != SEQ_VERSION) return "not a sequence image";
+  if (h.n_ops == 0 || h.n_ops > SEQ_MAX_OPS || h.n_consts > SEQ_MAX_CONSTS) return "too big";
+  if (len != seqImageSize(h)) return "length mismatch";
+  const uint8_t *body = img + sizeof(h);
+  const uint8_t *constBytes = body + h.n_ops * sizeof(SeqOp);
+  if (crc16(body, len - sizeof(h)) != h.crc) return "CRC mismatch";
+
+  for (uint16_t i = 0; i < h.n_ops; i++) {
+    SeqOp o;
+    memcpy(&o, body + i * sizeof(SeqOp), sizeof(o));
+    if (o.op >= SEQ_OP_COUNT) return "bad opcode";
+    bool usesA = o.op != SEQ_HALT && o.op != SEQ_TUNE && o.op != SEQ_KEY && o.op != SEQ_WAIT &&
+                 o.op != SEQ_JMP;
+    bool usesB = o.op == SEQ_MOV || o.op == SEQ_ADD || o.op == SEQ_SUB || o.op == SEQ_ADDI ||
+                 o.op == SEQ_MULI || o.op == SEQ_SHRI || o.op == SEQ_JCMP;
+    bool usesC = o.op == SEQ_ADD || o.op == SEQ_SUB;
+    if ((usesA && o.a >= SEQ_REGS) || (usesB && o.b >= SEQ_REGS) || (usesC && o.c >= SEQ_REGS))
+      return "bad register";
+    bool jumps = o.op == SEQ_JMP || o.op == SEQ_JCMP || o.op == SEQ_LOOP;
+    if (jumps && (o.imm < 0 || o.imm > h.n_ops)) return "jump out of range";
+    if (o.op == SEQ_JCMP && o.c >= SEQ_COND_COUNT) return "bad condition";
+    if ((o.op == SEQ_TUNE || o.op == SEQ_LDK) && (o.imm < 0 || o.imm >= h.n_consts))
+      return "constant out of range";
+    if (o.op == SEQ_TUNE) {
+      uint64_t hz;
+      memcpy(&hz, constBytes + o.imm * 8, 8);
+      if (!planFrequencyInt(cfg, hz).ok) return "TUNE target doesn't plan";
+    }
+    if ((o.op == SEQ_WAIT || o.op == SEQ_WAIT_LOCK || o.op == SEQ_ACQ) && o.imm < 0)
+      return "negative time/count";
+    if (o.op == SEQ_SHRI && (o.imm < 0 || o.imm > 63)) return "bad shift";
+  }
+
+  vm.state = SEQ_EMPTY;
+  vm.cfg = cfg;
+  vm.n_ops = h.n_ops;
+  vm.n_consts = h.n_consts;
+  memcpy(vm.ops, body, h.n_ops * sizeof(SeqOp));
+  memcpy(vm.consts, constBytes, h.n_consts * 8);
+  memset(&vm.ops[h.n_ops], 0, sizeof(SeqOp));           // SEQ_HALT
+  for (uint16_t i = 0; i < h.n_consts; i++) vm.constPlans[i] = planFrequencyInt(cfg, vm.consts[i]);
+
+  memset(vm.cache, 0, sizeof(vm.cache));
+  vm.cacheHits = vm.cacheMisses = 0;
+  vm.state = SEQ_READY;
+  seqReset(vm);
+  return nullptr;
+}
+
+// ============================================================================
+// Run
+// ============================================================================
+static const PllPlan *seqPlanCached(SeqVm &vm, uint64_t hz) {
+  uint32_t k = (uint32_t)(hz ^ (hz >> 32)) * 2654435761u;
+  SeqPlanSlot &s = vm.cache[(k >> 16) & (SEQ_PLAN_CACHE - 1)];
+  if (s.hz == hz) {
+    vm.cacheHits++;
+  } else {
+    vm.cacheMisses++;
+    s.hz = hz;
+    s.plan = planFrequencyInt(vm.cfg, hz);
+  }
+  return &s.plan;
+}
+
+static inline bool seqCompare(uint8_t cond, int64_t x, int64_t y) {
+  switch (cond) {
+    case SEQ_LT: return x <  y;
+    case SEQ_LE: return x <= y;
+    case SEQ_EQ: return x == y;
+    case SEQ_NE: return x != y;
+    case SEQ_GE: return x >= y;
+    default:     return x >  y;
+  }
+}
+
+static inline bool seqStopping(SeqVm &vm) {
+  if (!vm.abort && seqAbortPending()) vm.abort = true;
+  return vm.abort;
+}
+
+// Busy-wait, still abortable
+static inline void seqSpin(SeqVm &vm, uint32_t t0, uint32_t us) {
+  while (seqMicros() - t0 < us && !seqStopping(vm)) {}
+}
+
+// Run up to maxOps ops (the caller's loop stays responsive between
+// slices). Returns the state afterwards.
+static SeqState seqRun(SeqVm &vm, uint32_t maxOps) {
+  if (vm.state == SEQ_READY) vm.state = SEQ_RUNNING;
+  int64_t *r = vm.r;
+
+  while (maxOps-- && vm.state == SEQ_RUNNING) {
+    if (vm.abort) { vm.state = SEQ_ABORTED; break; }
+    const uint16_t pc = vm.pc++;
+    const SeqOp o = vm.ops[pc];
+    const uint32_t t0 = seqMicros();
+
+    switch (o.op) {
+      case SEQ_HALT:   vm.state = SEQ_HALTED; vm.pc = pc; break;
+      case SEQ_TUNE:   seqTune(vm.constPlans[o.imm]); break;
+      case SEQ_TUNE_R: {
+        const PllPlan *p = seqPlanCached(vm, (uint64_t)r[o.a]);
+        if (!p->ok) { vm.state = SEQ_FAULT; vm.fault_pc = pc; break; }
+        seqTune(*p);
+        break;
+      }
+      case SEQ_KEY:    seqKey(o.a != 0); break;
+      case SEQ_WAIT:   seqSpin(vm, t0, (uint32_t)o.imm); break;
+      case SEQ_WAIT_R: seqSpin(vm, t0, r[o.a] > 0 ? (uint32_t)r[o.a] : 0); break;
+      case SEQ_WAIT_LOCK: {
+        bool locked;
+        while (!(locked = seqLocked()) && seqMicros() - t0 < (uint32_t)o.imm && !seqStopping(vm)) {}
+        r[o.a] = locked ? (int64_t)(seqMicros() - t0) : -1;
+        break;
+      }
+      case SEQ_ACQ:    r[o.a] = seqAcquire(o.b, (uint32_t)o.imm); break;
+      case SEQ_LDI:    r[o.a] = o.imm; break;
+      case SEQ_LDK:    r[o.a] = (int64_t)vm.consts[o.imm]; break;
+      case SEQ_MOV:    r[o.a] = r[o.b]; break;
+      case SEQ_ADD:    r[o.a] = r[o.b] + r[o.c]; break;
+      case SEQ_SUB:    r[o.a] = r[o.b] - r[o.c]; break;
+      case SEQ_ADDI:   r[o.a] = r[o.b] + o.imm; break;
+      case SEQ_MULI:   r[o.a] = r[o.b] * o.imm; break;
+      case SEQ_SHRI:   r[o.a] = r[o.b] >> o.imm; break;
+      case SEQ_JMP:    vm.pc = (uint16_t)o.imm; break;
+      case SEQ_JCMP:   if (seqCompare(o.c, r[o.a], r[o.b])) vm.pc = (uint16_t)o.imm; break;
+      case SEQ_LOOP:   if (--r[o.a] > 0) vm.pc = (uint16_t)o.imm; break;
+      case SEQ_EMIT:   seqEmit((uint16_t)o.imm, t0, r[o.a]); break;
+      case SEQ_TIME:   r[o.a] = t0; break;
+    }
+
+    const uint32_t dt = seqMicros() - t0;
+    SeqOpStats &s = vm.opStats[o.op];
+    s.count++;
+    s.total_us += dt;
+    if (dt > s.max_us) s.max_us = dt;
+    vm.opsRun++;
+    if (vm.trace) {
+      SeqTrace &t = vm.traceBuf[vm.traceCount++ & (SEQ_TRACE_LEN - 1)];
+      t.t_us = t0;
+      t.dt_us = dt;
+      t.pc = pc;
+      t.op = o.op;
+      t.reg = o.a;
+      t.value = o.a < SEQ_REGS ? (int32_t)r[o.a] : 0;
+    }
+  }
+  return vm.state;
+}
+
+// ============================================================================
+// Disassembly (trace printouts here, listings in seq_asm)
+// ============================================================================
+static void seqFormatOp(const SeqVm *vm, const SeqOp &o, char *out, size_t n) {
+  const char *name = o.op < SEQ_OP_COUNT ? SEQ_OP_NAMES[o.op] : "?";
+  switch (o.op) {
+    case SEQ_HALT:      snprintf(out, n, "%s", name); break;
+    case SEQ_TUNE:
+      if (vm && o.imm >= 0 && o.imm < vm->n_consts)
+        snprintf(out, n, "%s %llu", name, (unsigned long long)vm->consts[o.imm]);
+      else
+        snprintf(out, n, "%s k%ld", name, (long)o.imm);
+      break;
+    case SEQ_KEY:       snprintf(out, n, "%s %s", name, o.a ? "on" : "off"); break;
+    case SEQ_WAIT:
+    case SEQ_JMP:       snprintf(out, n, "%s %ld", name, (long)o.imm); break;
+    case SEQ_TUNE_R:
+    case SEQ_WAIT_R:
+    case SEQ_TIME:      snprintf(out, n, "%s r%u", name, o.a); break;
+    case SEQ_ACQ:       snprintf(out, n, "%s r%u, %u, %ld", name, o.a, o.b, (long)o.imm); break;
+    case SEQ_MOV:       snprintf(out, n, "%s r%u, r%u", name, o.a, o.b); break;
+    case SEQ_ADD:
+    case SEQ_SUB:       snprintf(out, n, "%s r%u, r%u, r%u", name, o.a, o.b, o.c); break;
+    case SEQ_ADDI:
+    case SEQ_MULI:
+    case SEQ_SHRI:      snprintf(out, n, "%s r%u, r%u, %ld", name, o.a, o.b, (long)o.imm); break;
+    case SEQ_JCMP:
+      snprintf(out, n, "j%s r%u, r%u, %ld", o.c < SEQ_COND_COUNT ? SEQ_COND_NAMES[o.c] : "?",
+               o.a, o.b, (long)o.imm);
+      break;
+    case SEQ_LDK:
+      if (vm && o.imm >= 0 && o.imm < vm->n_consts)
+        snprintf(out, n, "%s r%u, %llu", name, o.a, (unsigned long long)vm->consts[o.imm]);
+      else
+        snprintf(out, n, "%s r%u, k%ld", name, o.a, (long)o.imm);
+      break;
+    default:            snprintf(out, n, "%s r%u, %ld", name, o.a, (long)o.imm); break;
+  }
+}
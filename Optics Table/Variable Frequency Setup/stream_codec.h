@@ -0,0 +1,330 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+// ============================================================================
+// Compressed result stream (sweep points / per-hop receiver results)
+// ============================================================================
+//
+// A record is (frequency index, timestamp in µs, 1..4 fixed-point
+// amplitudes). Raw that's 16-28 bytes; a steady sweep packs it into ~3-6.
+// Records go out in self-contained blocks:
+//
+//   StreamBlockHeader (28 bytes) | payload (payload_len bytes)
+//
+// Each record in the payload is varints, against predictors that reset at
+// every block start (so any block decodes on its own, and a lost block only
+// loses its own records):
+//
+//   zigzag(index - prev_index - 1)       steady sweep/hop counter -> 1 byte
+//   zigzag(dt - prev_dt)                 constant dwell -> 1 byte
+//   zigzag(amp[ch] - prev_amp[ch])       per channel, usually 1-2 bytes
+//
+// with prev_index = first_index - 1, prev_t = first_t_us, prev_dt = 0 and
+// prev_amp = 0 at the start of a block. Everything is exact integers -- the
+// stream is lossless; amplitudes are whatever fixed point the sketch picks
+// (amp_frac_bits tells the reader where the point is).
+//
+// Blocks can share a byte stream with text (the serial console): readers
+// scan for the magic and only take a block whose checksum matches.
+// Little-endian. No Arduino dependencies -- the host decoder includes this
+// file too.
+
+static constexpr uint16_t STREAM_MAGIC      = 0x5EC0;
+static constexpr uint8_t  STREAM_VERSION    = 1;
+static constexpr uint8_t  STREAM_MAX_CH     = 4;
+static constexpr uint32_t STREAM_BLOCK_MAX  = 1024;   // header + payload
+
+#pragma pack(push, 1)
+struct StreamBlockHeader {
+  uint16_t magic;
+  uint8_t  version;
+  uint8_t  channels;          // amplitudes per record, 1..STREAM_MAX_CH
+  uint8_t  amp_frac_bits;     // amplitude = value / 2^amp_frac_bits
+  uint8_t  flags;             // reserved, 0
+  uint16_t count;             // records in this block
+  uint16_t payload_len;
+  uint16_t seq;               // per stream, gaps = lost blocks
+  uint32_t check;             // streamChecksum() with this field zeroed
+  uint32_t first_index;
+  uint64_t first_t_us;
+};
+#pragma pack(pop)
+
+static_assert(sizeof(StreamBlockHeader) == 28, "stream block header layout");
+
+static constexpr uint32_t STREAM_PAYLOAD_MAX = STREAM_BLOCK_MAX - sizeof(StreamBlockHeader);
+// index (5) + time (10) + amplitudes (5 each)
+static constexpr uint32_t STREAM_RECORD_MAX  = 5 + 10 + 5 * STREAM_MAX_CH;
+
+// ============================================================================
+// Primitives
+// ============================================================================
+static inline uint32_t streamZig32(int32_t v) { return ((uint32_t)v << 1) ^ (uint32_t)(v >> 31); }
+static inline uint64_t streamZig64(int64_t v) { return ((uint64_t)v << 1) ^ (uint64_t)(v >> 63); }
+static inline int32_t  streamUnzig32(uint32_t u) { return (int32_t)(u >> 1) ^ -(int32_t)(u & 1); }
+static inline int64_t  streamUnzig64(uint64_t u) { return (int64_t)(u >> 1) ^ -(int64_t)(u & 1); }
+
+static inline uint8_t *streamPutVar(uint8_t *p, uint64_t v) {
+  while (v >= 0x80) {
+    *p++ = (uint8_t)v | 0x80;
+    v >>= 7;
+  }
+  *p++ = (uint8_t)v;
+  return p;
+}
+
+// nullptr on a truncated or over-long varint
+static inline const uint8_t *streamGetVar(const uint8_t *p, const uint8_t *end, uint64_t *v) {
+  if (p < end && *p < 0x80) { *v = *p; return p + 1; }    // the common case
+  uint64_t r = 0;
+  for (int s = 0; s < 64 && p < end; s += 7) {
+    uint8_t b = *p++;
+    r |= (uint64_t)(b & 0x7F) << s;
+    if (!(b & 0x80)) { *v = r; return p; }
+  }
+  return nullptr;
+}
+
+// Unchecked versions for the decoder's inner loop: the caller guarantees
+// STREAM_RECORD_MAX bytes are left, and these never read more than their
+// field's maximum (5 / 10 bytes), so a corrupt record can't run off the end.
+static inline const uint8_t *streamGetVar32Raw(const uint8_t *p, uint32_t *v) {
+  uint32_t b = *p++;
+  if (b < 0x80) { *v = b; return p; }
+  uint32_t r = b & 0x7F;
+  for (int s = 7; s < 35; s += 7) {
+    b = *p++;
+    r |= (b & 0x7F) << s;
+    if (b < 0x80) break;
+  }
+  *v = r;
+  return p;
+}
+
+static inline const uint8_t *streamGetVar64Raw(const uint8_t *p, uint64_t *v) {
+  uint64_t b = *p++;
+  if (b < 0x80) { *v = b; return p; }
+  uint64_t r = b & 0x7F;
+  for (int s = 7; s < 70; s += 7) {
+    b = *p++;
+    r |= (b & 0x7F) << s;
+    if (b < 0x80) break;
+  }
+  *v = r;
+  return p;
+}
+
+// Fletcher-style sums. Blocks are <= 1 KB, so the 32-bit sums can't
+// overflow and the modulo happens once at the end (cheap on both sides).
+// Eight bytes at a time: s2 gains 8 * s1 plus the bytes weighted by how many
+// of the eight running sums they're in, which breaks the byte-to-byte
+// dependency of the plain loop (twice the speed on the host).
+static inline uint32_t streamChecksum(const uint8_t *p, uint32_t n, uint32_t s1 = 0, uint32_t s2 = 0) {
+  uint32_t i = 0;
+  for (; i + 8 <= n; i += 8) {
+    const uint8_t *q = p + i;
+    s2 += 8 * s1 + 8 * q[0] + 7 * q[1] + 6 * q[2] + 5 * q[3] + 4 * q[4] + 3 * q[5] + 2 * q[6] + q[7];
+    s1 += q[0] + q[1] + q[2] + q[3] + q[4] + q[5] + q[6] + q[7];
+  }
+  for (; i < n; i++) { s1 += p[i]; s2 += s1; }
+  return ((s2 % 65535u) << 16) | (s1 % 65535u);
+}
+
+static inline uint32_t streamBlockChecksum(const StreamBlockHeader &h, const uint8_t *payload) {
+  StreamBlockHeader tmp = h;
+  tmp.check = 0;
+  const uint8_t *hp = (const uint8_t *)&tmp;
+  uint32_t s1 = 0, s2 = 0;
+  for (uint32_t i = 0; i < sizeof(tmp); i++) { s1 += hp[i]; s2 += s1; }
+  return streamChecksum(payload, h.payload_len, s1, s2);
+}
+
+// ============================================================================
+// Encoder (firmware side)
+// ============================================================================
+//
+//   StreamEncoder enc;
+//   streamEncInit(enc, 1, 0);
+//   ...
+//   if (!streamEncAdd(enc, idx, t_us, &amp)) {       // block full
+//     send(enc.block, streamEncFinish(enc));
+//     streamEncAdd(enc, idx, t_us, &amp);
+//   }
+//   ...flush with streamEncFinish() when idle so partial blocks don't sit.
+
+struct StreamEncoder {
+  uint8_t  block[STREAM_BLOCK_MAX];    // header + payload, ready to send after finish
+  uint8_t  channels;
+  uint8_t  amp_frac_bits;
+  uint16_t seq;
+  uint16_t count;
+  uint32_t len;                         // payload bytes so far
+  uint32_t first_index;
+  uint64_t first_t_us;
+  uint32_t prev_index;
+  uint64_t prev_t;
+  int64_t  prev_dt;
+  int32_t  prev_amp[STREAM_MAX_CH];
+  // totals, for the compression ratio
+  uint32_t records;
+  uint32_t blocks;
+  uint64_t bytes_out;
+};
+
+static inline void streamEncInit(StreamEncoder &e, uint8_t channels, uint8_t amp_frac_bits) {
+  memset(&e, 0, sizeof(e));
+  if (channels < 1) channels = 1;
+  if (channels > STREAM_MAX_CH) channels = STREAM_MAX_CH;
+  e.channels = channels;
+  e.amp_frac_bits = amp_frac_bits;
+}
+
+static inline bool streamEncEmpty(const StreamEncoder &e) {
+  return e.count == 0;
+}
+
+// Uncompressed size of what's been encoded so far, for comparison
+static inline uint64_t streamRawBytes(const StreamEncoder &e) {
+  return (uint64_t)e.records * (4 + 8 + 4 * e.channels);
+}
+
+// false = no room in this block; finish it and add again
+static inline bool streamEncAdd(StreamEncoder &e, uint32_t index, uint64_t t_us, const int32_t *amp) {
+  if (e.len + STREAM_RECORD_MAX > STREAM_PAYLOAD_MAX || e.count == 0xFFFF) return false;
+
+  if (e.count == 0) {
+    e.first_index = index;
+    e.first_t_us = t_us;
+    e.prev_index = index - 1;
+    e.prev_t = t_us;
+    e.prev_dt = 0;
+    memset(e.prev_amp, 0, sizeof(e.prev_amp));
+  }
+
+  uint8_t *p = e.block + sizeof(StreamBlockHeader) + e.len;
+  uint8_t *start = p;
+
+  p = streamPutVar(p, streamZig32((int32_t)(index - e.prev_index - 1)));
+  int64_t dt = (int64_t)(t_us - e.prev_t);
+  p = streamPutVar(p, streamZig64(dt - e.prev_dt));
+  for (uint8_t ch = 0; ch < e.channels; ch++) {
+    p = streamPutVar(p, streamZig32((int32_t)((uint32_t)amp[ch] - (uint32_t)e.prev_amp[ch])));
+    e.prev_amp[ch] = amp[ch];
+  }
+
+  e.prev_index = index;
+  e.prev_t = t_us;
+  e.prev_dt = dt;
+  e.len += (uint32_t)(p - start);
+  e.count++;
+  e.records++;
+  return true;
+}
+
+// Seal the current block into e.block and start the next one. Returns the
+// block size in bytes, 0 if there was nothing to send.
+static inline uint32_t streamEncFinish(StreamEncoder &e) {
+  if (e.count == 0) return 0;
+  StreamBlockHeader h;
+  h.magic = STREAM_MAGIC;
+  h.version = STREAM_VERSION;
+  h.channels = e.channels;
+  h.amp_frac_bits = e.amp_frac_bits;
+  h.flags = 0;
+  h.count = e.count;
+  h.payload_len = (uint16_t)e.len;
+  h.seq = e.seq++;
+  h.check = 0;
+  h.first_index = e.first_index;
+  h.first_t_us = e.first_t_us;
+  h.check = streamBlockChecksum(h, e.block + sizeof(h));
+  memcpy(e.block, &h, sizeof(h));
+
+  uint32_t n = sizeof(h) + e.len;
+  e.count = 0;
+  e.len = 0;
+  e.blocks++;
+  e.bytes_out += n;
+  return n;
+}
+
+// ============================================================================
+// Decoder (host side, but plain C++)
+// ============================================================================
+
+enum StreamScan : uint8_t {
+  STREAM_BLOCK_OK,       // *blockLen bytes at p are a valid block
+  STREAM_NEED_MORE,      // looks like a block, not all here yet
+  STREAM_NOT_BLOCK,      // skip a byte and try again
+};
+
+static inline StreamScan streamCheckBlock(const uint8_t *p, size_t avail, uint32_t *blockLen) {
+  if (avail < sizeof(StreamBlockHeader)) {
+    // only a prefix: worth waiting for if what's there matches
+    uint16_t m = STREAM_MAGIC;
+    size_t k = avail < 2 ? avail : 2;
+    return memcmp(p, &m, k) == 0 ? STREAM_NEED_MORE : STREAM_NOT_BLOCK;
+  }
+  StreamBlockHeader h;
+  memcpy(&h, p, sizeof(h));
+  if (h.magic != STREAM_MAGIC || h.version != STREAM_VERSION ||
+      h.channels < 1 || h.channels > STREAM_MAX_CH ||
+      h.payload_len > STREAM_PAYLOAD_MAX || h.count == 0) {
+    return STREAM_NOT_BLOCK;
+  }
+  uint32_t n = sizeof(h) + h.payload_len;
+  if (avail < n) return STREAM_NEED_MORE;
+  if (streamBlockChecksum(h, p + sizeof(h)) != h.check) return STREAM_NOT_BLOCK;
+  *blockLen = n;
+  return STREAM_BLOCK_OK;
+}
+
+// Decode a checked block into caller arrays (index[count], t_us[count],
+// amp[count * channels], record-major). Returns records decoded, or -1 if
+// the payload doesn't parse (can't happen for a block that passed the
+// checksum unless the encoder is broken).
+static inline int streamDecodeBlock(const uint8_t *blk, uint32_t *index, uint64_t *t_us, int32_t *amp) {
+  StreamBlockHeader h;
+  memcpy(&h, blk, sizeof(h));
+  const uint8_t *p = blk + sizeof(h);
+  const uint8_t *end = p + h.payload_len;
+
+  uint32_t pi = h.first_index - 1;
+  uint64_t pt = h.first_t_us;
+  int64_t  pdt = 0;
+  int32_t  pa[STREAM_MAX_CH] = {};
+  const uint8_t nch = h.channels;
+
+  for (uint32_t r = 0; r < h.count; r++) {
+    if (end - p >= (ptrdiff_t)STREAM_RECORD_MAX) {
+      // fast path, one bounds check per record
+      uint32_t u;
+      uint64_t v;
+      p = streamGetVar32Raw(p, &u);
+      pi += (uint32_t)streamUnzig32(u) + 1;
+      p = streamGetVar64Raw(p, &v);
+      pdt += streamUnzig64(v);
+      for (uint8_t ch = 0; ch < nch; ch++) {
+        p = streamGetVar32Raw(p, &u);
+        pa[ch] = (int32_t)((uint32_t)pa[ch] + (uint32_t)streamUnzig32(u));
+      }
+    } else {
+      uint64_t v;
+      if (!(p = streamGetVar(p, end, &v))) return -1;
+      pi += (uint32_t)streamUnzig32((uint32_t)v) + 1;
+      if (!(p = streamGetVar(p, end, &v))) return -1;
+      pdt += streamUnzig64(v);
+      for (uint8_t ch = 0; ch < nch; ch++) {
+        if (!(p = streamGetVar(p, end, &v))) return -1;
+        pa[ch] = (int32_t)((uint32_t)pa[ch] + (uint32_t)streamUnzig32((uint32_t)v));
+      }
+    }
+    pt += (uint64_t)pdt;
+    index[r] = pi;
+    t_us[r] = pt;
+    for (uint8_t ch = 0; ch < nch; ch++) amp[r * nch + ch] = pa[ch];
+  }
+  return p == end ? (int)h.count : -1;
+}
@@ -0,0 +1,188 @@
+#pragma once
+#include <stdint.h>
+#include <string.h>
+#include "acquisition.h"
+#include "usb_protocol.h"
+
+// ============================================================================
+// On-device sweep averaging
+// ============================================================================
+//
+// The hop table runs back to back for N passes. Each hop gives one value per
+// receiver, the mean of its samples taken at least settle_ns after the LE
+// edge, in ADC counts Q4. Those values are summed into per-point integer
+// accumulators (sum and sum of squares, exact), so mean and pass-to-pass
+// variance can be read out at any time without streaming a single pass.
+//
+// Hop h is point h % points of pass h / points. A hop's value is taken when
+// the first sample of a later hop shows up, so the sketch marks one extra
+// hop (number passes * points, no register writes) at the end of the last
+// dwell to close it.
+//
+// Blocks arrive from acqRead() in the sketch's loop; a block may straddle
+// one hop edge (the sketch keeps hops longer than a block).
+
+static constexpr uint32_t AVG_MAX_CELLS  = 2048;      // points x receivers
+static constexpr uint32_t AVG_MAX_PASSES = 65535;     // Q4 sums stay in 32 bits
+
+struct AvgConfig {
+  uint16_t points;
+  uint8_t  channels;
+  uint32_t passes;
+  uint32_t snapshot_every;   // passes, 0 = final only
+  uint32_t settle_ns;
+};
+
+struct AvgStats {
+  uint32_t hops;             // hops added to the accumulators
+  uint32_t hops_empty;       // no settled samples (blocks dropped, hop too short)
+  uint32_t samples;          // samples used
+};
+
+static AvgConfig avgCfg;
+static AvgStats  avgStats;
+static uint32_t  avgSum[AVG_MAX_CELLS];       // Q4
+static uint64_t  avgSumSq[AVG_MAX_CELLS];     // Q8
+static uint16_t  avgN[AVG_MAX_CELLS];         // per point
+
+// Hop being collected
+static uint32_t avgHop = 0xFFFFFFFFu;
+static uint32_t avgHopSum[ACQ_MAX_CH];
+static uint32_t avgHopCnt[ACQ_MAX_CH];
+
+static uint32_t avgPassesDone = 0;
+static bool     avgSnapshotDue = false;
+
+static inline uint32_t avgMaxPoints(uint8_t channels) {
+  return AVG_MAX_CELLS / (channels ? channels : 1);
+}
+
+static bool avgBegin(const AvgConfig &cfg) {
+  if (!cfg.points || !cfg.channels || cfg.channels > ACQ_MAX_CH) return false;
+  if (cfg.points > avgMaxPoints(cfg.channels)) return false;
+  if (!cfg.passes || cfg.passes > AVG_MAX_PASSES) return false;
+  avgCfg = cfg;
+  memset(&avgStats, 0, sizeof(avgStats));
+  memset(avgSum, 0, sizeof(avgSum));
+  memset(avgSumSq, 0, sizeof(avgSumSq));
+  memset(avgN, 0, sizeof(avgN));
+  avgHop = 0xFFFFFFFFu;
+  avgPassesDone = 0;
+  avgSnapshotDue = false;
+  return true;
+}
+
+static inline bool avgDone() {
+  return avgPassesDone >= avgCfg.passes;
+}
+
+// Close the hop being collected and fold it into its point
+static void avgCloseHop() {
+  uint32_t h = avgHop;
+  if (h == 0xFFFFFFFFu || h >= avgCfg.passes * avgCfg.points) return;
+  uint32_t point = h % avgCfg.points;
+
+  bool full = true;
+  for (uint8_t ch = 0; ch < avgCfg.channels; ch++) full &= avgHopCnt[ch] > 0;
+  if (full) {
+    uint32_t *sum = &avgSum[point * avgCfg.channels];
+    uint64_t *sq = &avgSumSq[point * avgCfg.channels];
+    for (uint8_t ch = 0; ch < avgCfg.channels; ch++) {
+      uint32_t n = avgHopCnt[ch];
+      uint32_t v = (uint32_t)(((uint64_t)avgHopSum[ch] * 16 + n / 2) / n);
+      sum[ch] += v;
+      sq[ch] += (uint64_t)v * v;
+    }
+    avgN[point]++;
+    avgStats.hops++;
+  } else {
+    avgStats.hops_empty++;
+  }
+}
+
+// Every hop before `hop` is over, so passes are counted from it (a pass
+// still completes if its last hop's blocks were dropped)
+static void avgStartHop(uint32_t hop) {
+  avgCloseHop();
+  uint32_t done = hop / avgCfg.points;
+  if (done > avgCfg.passes) done = avgCfg.passes;
+  if (done > avgPassesDone) {
+    avgPassesDone = done;
+    if (avgDone() || (avgCfg.snapshot_every && done % avgCfg.snapshot_every == 0)) {
+      avgSnapshotDue = true;
+    }
+  }
+  avgHop = hop;
+  memset(avgHopSum, 0, sizeof(avgHopSum));
+  memset(avgHopCnt, 0, sizeof(avgHopCnt));
+}
+
+// Samples [i0[ch], i1[ch]) of each receiver belong to `hop`, whose edge is
+// at edge_ns
+static void avgAddRange(const RxBlock &b, uint32_t hop, uint64_t edge_ns,
+                        const uint16_t *i0, const uint16_t *i1) {
+  if (hop != avgHop) avgStartHop(hop);
+  for (uint8_t ch = 0; ch < b.channels && ch < avgCfg.channels; ch++) {
+    uint32_t sum = 0, n = 0;
+    for (uint16_t i = i0[ch]; i < i1[ch]; i++) {
+      if (acqSampleTimeNs(b, ch, i) < edge_ns + avgCfg.settle_ns) continue;
+      sum += b.data[ch][i];
+      n++;
+    }
+    avgHopSum[ch] += sum;
+    avgHopCnt[ch] += n;
+    avgStats.samples += n;
+  }
+}
+
+static void avgAddBlock(const RxBlock &b) {
+  uint16_t per = b.per_channel;
+  uint64_t tEnd = acqSampleTimeNs(b, b.channels - 1, per - 1);
+
+  uint16_t zero[ACQ_MAX_CH] = { 0, 0, 0, 0 };
+  uint16_t all[ACQ_MAX_CH] = { per, per, per, per };
+
+  HopMark last;
+  if (!acqHopAt(tEnd, &last)) return;                    // before the first hop
+  if (b.hop == last.hop) {
+    avgAddRange(b, b.hop, b.t0_ns - b.hop_offset_ns, zero, all);
+    return;
+  }
+
+  // An edge inside the block: split each receiver at its first sample on
+  // or after it (receivers are sampled a conversion apart)
+  uint16_t split[ACQ_MAX_CH] = { 0, 0, 0, 0 };
+  for (uint8_t ch = 0; ch < b.channels; ch++) {
+    while (split[ch] < per && acqSampleTimeNs(b, ch, split[ch]) < last.t_ns) split[ch]++;
+  }
+  if (b.hop != 0xFFFFFFFFu) avgAddRange(b, b.hop, b.t0_ns - b.hop_offset_ns, zero, split);
+  avgAddRange(b, last.hop, last.t_ns, split, all);
+}
+
+// Takes the pending "send a snapshot" flag
+static inline bool avgTakeSnapshot() {
+  bool due = avgSnapshotDue;
+  avgSnapshotDue = false;
+  return due;
+}
+
+// Mean and variance across passes for one point, all receivers
+static void avgCells(uint16_t point, UsbAverageCell *out) {
+  uint32_t n = avgN[point];
+  for (uint8_t ch = 0; ch < avgCfg.channels; ch++) {
+    UsbAverageCell &c = out[ch];
+    c.n = (uint16_t)n;
+    c.reserved = 0;
+    c.mean_q8 = c.var_q8 = 0;
+    if (!n) continue;
+    uint32_t k = point * avgCfg.channels + ch;
+    // Q4 values: mean Q4 * 16 = Q8, and var of Q4 values is var of counts in Q8
+    double mean = (double)avgSum[k] / n;
+    c.mean_q8 = (uint32_t)(mean * 16 + 0.5);
+    if (n > 1) {
+      double var = ((double)avgSumSq[k] - mean * avgSum[k]) / (n - 1);
+      if (var < 0) var = 0;
+      c.var_q8 = var >= 4294967295.0 ? 0xFFFFFFFFu : (uint32_t)(var + 0.5);
+    }
+  }
+}
@@ -0,0 +1,130 @@
+#pragma once
+#include <stdint.h>
+#include <string.h>
+#include "adf5355_plan.h"
+#include "result_page.h"
+
+// ============================================================================
+// Sweep engine
+// ============================================================================
+//
+// Steps through a sweep table one point at a time: plan, tune, settle,
+// measure, buffer the reading. Full pages of results are handed off to be
+// stored, and every CHECKPOINT_PAGES pages the engine asks for a checkpoint
+// so a long run can pick up where it left off after a reset.
+//
+// Nothing in here touches hardware. The including file provides the hooks
+// below (the RP2040 sketches drive SPI/ADC/flash, a host build can fake them).
+
+static void     sweepTune(const PllPlan &p);
+static void     sweepSettle(uint32_t us);
+static uint32_t sweepMeasure();
+static uint32_t sweepMicros();
+static bool     sweepStorePage(const ResultPage &page);      // false = storage full
+static void     sweepCheckpoint(uint16_t table_id, uint32_t next_index);
+
+// ============================================================================
+// Tables
+// ============================================================================
+
+// Linear table, planned point by point (long runs don't fit in RAM as
+// precompiled words). The id goes into every checkpoint so a reboot never
+// resumes into a different table.
+struct SweepTable {
+  uint16_t id;
+  uint64_t start_hz;
+  uint64_t step_hz;
+  uint32_t count;
+  uint32_t dwell_us;
+};
+
+static inline uint64_t sweepTableFreq(const SweepTable &t, uint32_t i) {
+  return t.start_hz + (uint64_t)i * t.step_hz;
+}
+
+// ============================================================================
+// Engine
+// ============================================================================
+static constexpr uint32_t CHECKPOINT_PAGES = 1;   // checkpoint after every N stored pages
+
+struct SweepStats {
+  uint32_t points;
+  uint32_t pages;
+  uint32_t checkpoints;
+  uint32_t plan_fail;
+  uint64_t run_us;          // wall time inside sweepStep()
+  uint64_t store_us;        // of which: storing pages + checkpoints
+};
+
+struct SweepEngine {
+  PlanConfig cfg;
+  const SweepTable *table;
+  uint32_t index;           // next point to measure
+  ResultPage page;
+  uint32_t pagesSinceCheckpoint;
+  bool storageFull;
+  SweepStats stats;
+};
+
+static inline void sweepBegin(SweepEngine &e, const PlanConfig &cfg, const SweepTable &t,
+                       uint32_t start_index) {
+  memset(&e, 0, sizeof(e));
+  e.cfg = cfg;
+  e.table = &t;
+  e.index = start_index;
+  e.page.first_index = start_index;
+}
+
+static inline bool sweepDone(const SweepEngine &e) {
+  return e.table == nullptr || e.index >= e.table->count || e.storageFull;
+}
+
+static inline void sweepFlushPage(SweepEngine &e) {
+  if (e.page.count == 0) return;
+
+  uint32_t t0 = sweepMicros();
+  e.page.crc = resultPageCrc(e.page);
+  if (!sweepStorePage(e.page)) {
+    e.storageFull = true;
+    return;
+  }
+  e.stats.pages++;
+
+  // Checkpoint only covers what's actually stored
+  if (++e.pagesSinceCheckpoint >= CHECKPOINT_PAGES || e.index >= e.table->count) {
+    sweepCheckpoint(e.table->id, e.index);
+    e.pagesSinceCheckpoint = 0;
+    e.stats.checkpoints++;
+  }
+  e.stats.store_us += sweepMicros() - t0;
+
+  memset(&e.page, 0, sizeof(e.page));
+  e.page.first_index = e.index;
+}
+
+// One point. Returns false once the table is finished.
+static inline bool sweepStep(SweepEngine &e) {
+  if (sweepDone(e)) return false;
+  uint32_t t0 = sweepMicros();
+
+  PllPlan p = planFrequencyInt(e.cfg, sweepTableFreq(*e.table, e.index));
+  uint32_t sample = 0xFFFFFFFFu;     // marks an unplannable point in the results
+  if (p.ok) {
+    sweepTune(p);
+    sweepSettle(e.table->dwell_us);
+    sample = sweepMeasure();
+  } else {
+    e.stats.plan_fail++;
+  }
+
+  e.page.samples[e.page.count++] = sample;
+  e.index++;
+  e.stats.points++;
+
+  if (e.page.count == RESULTS_PER_PAGE || e.index >= e.table->count) {
+    sweepFlushPage(e);
+  }
+
+  e.stats.run_us += sweepMicros() - t0;
+  return !sweepDone(e);
+}
@@ -0,0 +1,63 @@
+#pragma once
+#include <stdint.h>
+#include "usb_protocol.h"
+
+// ============================================================================
+// Device trace ring
+// ============================================================================
+//
+// Timestamped events (hops, acquisition blocks, USB drops, ...) kept on the
+// device until the host reads them with USB_T_TRACE_READ. Times are the
+// device's time_us_64(); Host Tools/trace_timeline maps them onto the host
+// clock using the USB_T_TIME exchanges, so several boards and controllers
+// end up on one timeline.
+//
+// Written from the sketch's loop only (single producer, no locking). When
+// the host doesn't read for a while the oldest events are overwritten and
+// counted -- recent history is what's worth keeping.
+
+static constexpr uint16_t TRACE_RING_LEN = 512;   // power of two
+
+static UsbTraceEvent traceRing[TRACE_RING_LEN];
+static uint32_t traceHead = 0;       // next write
+static uint32_t traceTail = 0;       // oldest unread
+static uint32_t traceDropped = 0;
+
+static inline void traceEvent(uint8_t track, uint8_t kind, uint64_t t_us,
+                              uint32_t dur_us = 0, uint32_t arg = 0) {
+  if (traceHead - traceTail == TRACE_RING_LEN) {
+    traceTail++;
+    traceDropped++;
+  }
+  UsbTraceEvent &e = traceRing[traceHead & (TRACE_RING_LEN - 1)];
+  e.t_us = t_us;
+  e.dur_us = dur_us;
+  e.arg = arg;
+  e.track = track;
+  e.kind = kind;
+  e.reserved = 0;
+  traceHead++;
+}
+
+static inline uint32_t tracePending() {
+  return traceHead - traceTail;
+}
+
+// Copy out up to max events, oldest first, without marking them read.
+// *from is the position to hand to traceCommit() once they're delivered;
+// until then a failed send loses nothing.
+static inline uint32_t tracePeek(UsbTraceEvent *out, uint32_t max, uint32_t *from) {
+  uint32_t n = 0;
+  *from = traceTail;
+  while (n < max && traceTail + n != traceHead) {
+    out[n] = traceRing[(traceTail + n) & (TRACE_RING_LEN - 1)];
+    n++;
+  }
+  return n;
+}
+
+// Mark n events from tracePeek() read. If the ring overflowed meanwhile the
+// tail may already be past them.
+static inline void traceCommit(uint32_t from, uint32_t n) {
+  if (traceTail - from < n) traceTail = from + n;
+}
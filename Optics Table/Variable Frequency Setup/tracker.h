@@ -0,0 +1,300 @@
+#pragma once
+#include <stdint.h>
+#include <string.h>
+#include "adf5355_plan.h"
+
+// ============================================================================
+// Resonance tracker
+// ============================================================================
+//
+// Follows one resonance (dip or peak) as it moves, without full sweeps:
+// each round probes a few points around the current estimate, fits a
+// parabola through them, and recentres on its vertex. An alpha-beta filter
+// on the centre gives a velocity, so the next round is already placed where
+// the resonance is heading. One round is a handful of hops, so updates come
+// hundreds of times a second.
+//
+// Plans: the centre is planned once per round, the probes are derived from
+// it with precomputed PlanOffsets (an add with carries, no division). Probes
+// alternate direction every round so the first hop of a round is the short
+// one back from where the last round ended.
+//
+// The probe window is kept inside min_hz..max_hz, so every probe is a real
+// reading; near a band edge the window stops at the edge and a resonance
+// beyond it shows up as a clamped (or no-curve) round.
+//
+// If the vertex keeps landing outside the probe window (or there's no
+// curvature, e.g. the resonance moved out of reach) for lost_rounds rounds,
+// the tracker falls back to a coarse scan around the last estimate.
+//
+// Nothing in here touches hardware. The including file provides the hooks
+// (the tracking sketch drives SPI/ADC, Host Tools/lab_twin --track runs it
+// against the bench model).
+
+static void     trackTune(const PllPlan &p);
+static void     trackSettle(uint32_t us);
+static uint32_t trackMeasure();
+static uint32_t trackMicros();
+
+static constexpr uint8_t TRACK_MAX_PROBES = 9;
+
+struct TrackConfig {
+  PlanConfig plan;
+  uint64_t start_hz;          // initial guess (centre of the first coarse scan)
+  uint32_t probe_step_hz;     // spacing between probes, ~ FWHM / 4
+  uint8_t  probes;            // odd, 3..TRACK_MAX_PROBES
+  uint32_t dwell_us;
+  bool     dip;               // true: track a minimum, false: a maximum
+  uint64_t min_hz, max_hz;    // never tune outside these
+  uint32_t acquire_span_hz;   // coarse scan width
+  uint16_t acquire_points;
+  uint8_t  lost_rounds;       // consecutive bad rounds before rescanning
+  uint8_t  alpha_q8;          // filter gains, /256
+  uint8_t  beta_q8;
+};
+
+enum TrackFlags : uint8_t {
+  TRACK_CLAMPED    = 1,       // vertex outside the probe window, moved by the max step
+  TRACK_NO_CURVE   = 2,       // readings not shaped like a dip/peak
+  TRACK_REACQUIRED = 4,       // coarse scan this round
+};
+
+struct TrackUpdate {
+  uint32_t t_us;              // end of the round
+  uint64_t center_hz;         // filtered estimate
+  int32_t  velocity_hz_s;
+  uint32_t extreme;           // fitted reading at the vertex
+  uint32_t round_us;
+  uint8_t  flags;
+};
+
+struct TrackStats {
+  uint32_t rounds;
+  uint32_t clamped;
+  uint32_t no_curve;
+  uint32_t reacquires;
+  uint32_t derived;           // probe plans derived from the centre
+  uint32_t planned;           // full plans (centres, fallbacks, scans)
+  uint32_t round_us_max;
+  uint64_t round_us_total;
+};
+
+struct Tracker {
+  TrackConfig cfg;
+  uint32_t grid_hz;           // centres are snapped to this
+  PlanOffset offs[TRACK_MAX_PROBES];
+  int64_t  center_hz;         // filter state, at lastUs
+  int64_t  velocity_hz_s;
+  int64_t  probe_hz;          // where this round's probes are centred
+  uint32_t lastUs;
+  uint32_t lastRoundUs;
+  bool     forward;           // probe order this round
+  uint8_t  bad;               // consecutive clamped / no-curve rounds
+  uint32_t readings[TRACK_MAX_PROBES];
+  TrackStats stats;
+};
+
+// ============================================================================
+// Helpers
+// ============================================================================
+static inline int64_t trackClamp(const Tracker &t, int64_t f) {
+  if (f < (int64_t)t.cfg.min_hz) f = (int64_t)t.cfg.min_hz;
+  if (f > (int64_t)t.cfg.max_hz) f = (int64_t)t.cfg.max_hz;
+  return f;
+}
+
+static inline int64_t trackSnap(const Tracker &t, int64_t f) {
+  int64_t g = t.grid_hz;
+  return ((f + g / 2) / g) * g;
+}
+
+// Centre for the probe window: on the grid, with all probes inside the band
+static inline int64_t trackProbeCenter(const Tracker &t, int64_t f) {
+  int64_t g = t.grid_hz;
+  int64_t half = (int64_t)(t.cfg.probes / 2) * t.cfg.probe_step_hz;
+  int64_t lo = ((int64_t)t.cfg.min_hz + half + g - 1) / g * g;
+  int64_t hi = ((int64_t)t.cfg.max_hz - half) / g * g;
+  f = trackSnap(t, f);
+  if (f < lo) f = lo;
+  if (f > hi) f = hi;
+  return f;
+}
+
+// num * step / den without the product overflowing: the quotient part is
+// exact, the remainder part loses low bits only when den is huge
+static inline int64_t trackMulDiv(int64_t num, uint32_t step, int64_t den) {
+  int64_t q = num / den, r = num % den;
+  while (den > INT64_MAX / step || den < -INT64_MAX / step) { r /= 2; den /= 2; }
+  return q * step + r * (int64_t)step / den;
+}
+
+static inline uint32_t trackMeasureAt(Tracker &t, uint64_t f) {
+  PllPlan p = planFrequencyInt(t.cfg.plan, f);
+  t.stats.planned++;
+  if (!p.ok) return t.cfg.dip ? 0xFFFFFFFFu : 0;
+  trackTune(p);
+  trackSettle(t.cfg.dwell_us);
+  return trackMeasure();
+}
+
+// Coarse scan around the current centre; the extreme becomes the new centre
+static inline void trackAcquire(Tracker &t) {
+  const TrackConfig &c = t.cfg;
+  uint16_t n = c.acquire_points < 2 ? 2 : c.acquire_points;
+  int64_t step = trackSnap(t, c.acquire_span_hz / (n - 1));
+  if (step < t.grid_hz) step = t.grid_hz;
+  int64_t f = trackSnap(t, t.center_hz - step * (n - 1) / 2);
+
+  int64_t best = t.center_hz;
+  uint32_t bestVal = c.dip ? 0xFFFFFFFFu : 0;
+  for (uint16_t i = 0; i < n; i++, f += step) {
+    int64_t fc = trackClamp(t, f);
+    uint32_t v = trackMeasureAt(t, (uint64_t)fc);
+    if (c.dip ? v < bestVal : v > bestVal) { bestVal = v; best = fc; }
+  }
+  t.center_hz = trackSnap(t, best);
+  t.velocity_hz_s = 0;
+  t.bad = 0;
+  t.stats.reacquires++;
+}
+
+// ============================================================================
+// API
+// ============================================================================
+
+// Returns false if the probe spacing isn't a nonzero multiple of the channel
+// grid or the probe window doesn't fit between min_hz and max_hz. Does the first coarse scan.
+static inline bool trackBegin(Tracker &t, const TrackConfig &cfg) {
+  memset(&t, 0, sizeof(t));
+  t.cfg = cfg;
+  if (t.cfg.probes < 3) t.cfg.probes = 3;
+  if (t.cfg.probes > TRACK_MAX_PROBES) t.cfg.probes = TRACK_MAX_PROBES;
+  t.cfg.probes |= 1;
+  t.grid_hz = cfg.plan.use_rfoutb ? 2 * cfg.plan.chan_step_hz : cfg.plan.chan_step_hz;
+  if (!cfg.probe_step_hz || cfg.min_hz >= cfg.max_hz) return false;
+  int64_t half = (int64_t)(t.cfg.probes / 2) * cfg.probe_step_hz;
+  if (((int64_t)cfg.max_hz - half) / t.grid_hz * t.grid_hz <
+      ((int64_t)cfg.min_hz + half + t.grid_hz - 1) / t.grid_hz * t.grid_hz) return false;
+
+  PllPlan ref = planFrequencyInt(cfg.plan, cfg.start_hz);
+  if (!ref.ok) return false;
+  int m = t.cfg.probes / 2;
+  for (int k = -m; k <= m; k++) {
+    t.offs[k + m] = makePlanOffset(cfg.plan, (int64_t)k * cfg.probe_step_hz, ref.out_div);
+    if (!t.offs[k + m].ok) return false;
+  }
+
+  t.center_hz = trackSnap(t, (int64_t)cfg.start_hz);
+  t.forward = true;
+  trackAcquire(t);
+  t.lastUs = trackMicros();
+  return true;
+}
+
+// One round: probe, fit, recentre. Fills u; returns u.flags == 0.
+static inline bool trackStep(Tracker &t, TrackUpdate &u) {
+  const TrackConfig &c = t.cfg;
+  const int m = c.probes / 2;
+  const int n = c.probes;
+  uint32_t t0 = trackMicros();
+  memset(&u, 0, sizeof(u));
+
+  // Probes go where the resonance should be half way through this round,
+  // all derived from one plan
+  int64_t ahead = (int64_t)(t0 - t.lastUs) + t.lastRoundUs / 2;
+  t.probe_hz = trackProbeCenter(t, t.center_hz + t.velocity_hz_s * ahead / 1000000);
+  PllPlan center = planFrequencyInt(c.plan, (uint64_t)t.probe_hz);
+  t.stats.planned++;
+  for (int i = 0; i < n; i++) {
+    int k = t.forward ? i - m : m - i;
+    int64_t f = t.probe_hz + (int64_t)k * c.probe_step_hz;
+    PllPlan p;
+    if (derivePlan(center, t.offs[k + m], p)) {
+      t.stats.derived++;
+      trackTune(p);
+      trackSettle(c.dwell_us);
+      t.readings[k + m] = trackMeasure();
+    } else {
+      t.readings[k + m] = trackMeasureAt(t, (uint64_t)f);
+    }
+  }
+  t.forward = !t.forward;
+
+  // Least-squares parabola y = a + b k + cc k^2 over k = -m..m:
+  //   b = sum(k y) / S2,  cc = (n sum(k^2 y) - S2 sum(y)) / D,  D = n S4 - S2^2
+  int64_t S2 = 0, S4 = 0, sy = 0, sky = 0, sk2y = 0;
+  for (int k = -m; k <= m; k++) {
+    int64_t y = t.readings[k + m];
+    S2 += k * k;
+    S4 += (int64_t)k * k * k * k;
+    sy += y;
+    sky += k * y;
+    sk2y += (int64_t)k * k * y;
+  }
+  int64_t D = n * S4 - S2 * S2;
+  int64_t Bn = sky;                         // b  = Bn / S2
+  int64_t Cn = n * sk2y - S2 * sy;          // cc = Cn / D
+
+  // Vertex at k* = -b / (2 cc) = -Bn D / (2 S2 Cn)
+  int64_t shift;
+  bool curved = c.dip ? Cn > 0 : Cn < 0;
+  if (curved) {
+    int64_t num = -Bn * D;
+    int64_t den = 2 * S2 * Cn;
+    // |k*| > m: outside what the probes can see
+    if (num / den > m || num / den < -m) {
+      shift = (num > 0) == (den > 0) ? (int64_t)m * c.probe_step_hz : -(int64_t)m * c.probe_step_hz;
+      u.flags |= TRACK_CLAMPED;
+    } else {
+      shift = trackMulDiv(num, c.probe_step_hz, den);
+    }
+    // a - b^2 / (4 cc), a = (sy - cc S2) / n
+    double b = (double)Bn / S2, cc = (double)Cn / D;
+    double a = ((double)sy - cc * S2) / n;
+    double ext = a - b * b / (4 * cc);
+    u.extreme = ext < 0 ? 0 : (uint32_t)ext;
+  } else {
+    // No dip/peak shape: head for the best-looking end
+    int best = 0;
+    for (int k = 1; k < n; k++) {
+      if (c.dip ? t.readings[k] < t.readings[best] : t.readings[k] > t.readings[best]) best = k;
+    }
+    shift = (int64_t)(best - m) * c.probe_step_hz;
+    u.extreme = t.readings[best];
+    u.flags |= TRACK_NO_CURVE;
+  }
+
+  // Alpha-beta filter. The vertex is where the resonance was mid-round;
+  // carry it to now before comparing with the prediction.
+  uint32_t now = trackMicros();
+  uint32_t dt = now - t.lastUs;
+  if (dt == 0) dt = 1;
+  int64_t predicted = t.center_hz + t.velocity_hz_s * (int64_t)dt / 1000000;
+  int64_t measured = t.probe_hz + shift + t.velocity_hz_s * (int64_t)((now - t0) / 2) / 1000000;
+  int64_t r = measured - predicted;
+  t.center_hz = trackClamp(t, predicted + r * c.alpha_q8 / 256);
+  t.velocity_hz_s += r * c.beta_q8 / 256 * 1000000 / dt;
+  t.lastUs = now;
+
+  if (u.flags) {
+    if (u.flags & TRACK_CLAMPED) t.stats.clamped++;
+    if (u.flags & TRACK_NO_CURVE) t.stats.no_curve++;
+    if (++t.bad >= c.lost_rounds) {
+      trackAcquire(t);
+      t.lastUs = trackMicros();
+      u.flags |= TRACK_REACQUIRED;
+    }
+  } else {
+    t.bad = 0;
+  }
+
+  u.t_us = trackMicros();
+  u.center_hz = (uint64_t)t.center_hz;
+  u.velocity_hz_s = (int32_t)t.velocity_hz_s;
+  u.round_us = u.t_us - t0;
+  t.lastRoundUs = u.round_us;
+  t.stats.rounds++;
+  t.stats.round_us_total += u.round_us;
+  if (u.round_us > t.stats.round_us_max) t.stats.round_us_max = u.round_us;
+  return u.flags == 0;
+}
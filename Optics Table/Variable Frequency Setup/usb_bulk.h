@@ -0,0 +1,325 @@
+#pragma once
+#include <Arduino.h>
+#include <Adafruit_TinyUSB.h>
+#include "device/usbd_pvt.h"
+#include "usb_protocol.h"
+
+// ============================================================================
+// Vendor-class bulk interface (TinyUSB, next to the CDC Serial console)
+// ============================================================================
+//
+// Needs Tools -> USB Stack -> "Adafruit TinyUSB" in arduino-pico.
+//
+// TinyUSB's stock vendor class goes through a 64-byte FIFO, which caps it
+// well below full speed. This is a small app-level class driver instead:
+// every transfer is a multi-packet usbd_edpt_xfer() straight from/to a
+// USB_XFER_BYTES buffer, and the controller moves it packet by packet
+// without any per-packet work in the sketch.
+//
+// TX: ring of USB_TX_BUFS transfer buffers. The sketch fills them with
+// usbBulkSend(); each full buffer is queued, and the completion callback
+// starts the next one immediately so the endpoint never idles while data
+// is waiting. If the ring is full, usbBulkSend() returns false (caller
+// decides: stream frames get dropped, acks retry).
+//
+// RX: one staging buffer re-armed after each transfer. Bytes are parsed
+// into a frame buffer; once a frame is complete OUT is left un-armed (the
+// host gets NAKs) until the sketch has taken it with usbBulkReceive().
+
+static constexpr uint8_t USB_TX_BUFS = 8;
+
+struct UsbBulkStats {
+  uint32_t tx_frames;
+  uint32_t tx_dropped;       // usbBulkSend() found the ring full
+  uint32_t tx_xfers;
+  uint64_t tx_bytes;
+  uint32_t rx_frames;
+  uint32_t rx_bad;           // bad magic / oversize, parser resynced
+  uint64_t rx_bytes;
+};
+
+static UsbBulkStats usbStats;
+
+// TX ring. Slots [tail, head) are queued for the host; slot `head` is the
+// one being filled by the sketch.
+static uint8_t  usbTxBuf[USB_TX_BUFS][USB_XFER_BYTES];
+static uint16_t usbTxLen[USB_TX_BUFS];
+static volatile uint8_t usbTxHead = 0;
+static volatile uint8_t usbTxTail = 0;
+static volatile bool    usbTxBusy = false;
+static uint32_t usbTxSeq = 0;
+
+// RX
+static uint8_t  usbRxXfer[USB_XFER_BYTES];
+static uint8_t  usbRxFrame[sizeof(UsbFrameHeader) + USB_MAX_PAYLOAD];
+static uint32_t usbRxHave = 0;                // bytes of the current frame
+static volatile bool usbRxReady = false;      // complete frame waiting for the sketch
+static volatile uint64_t usbRxDoneUs = 0;     // time_us_64() when it completed
+static uint8_t  usbRxPending[USB_XFER_BYTES]; // leftover bytes after a complete frame
+static uint32_t usbRxPendingLen = 0;
+
+static uint8_t usbRhport = 0;
+static uint8_t usbEpIn = 0;
+static uint8_t usbEpOut = 0;
+static uint8_t usbItf = 0;
+static volatile bool usbOpened = false;
+
+// ============================================================================
+// Transfers (called from the USB task and from the sketch)
+// ============================================================================
+static void usbTxKick() {
+  if (!usbOpened) return;
+  if (usbTxTail == usbTxHead) return;
+  if (!usbd_edpt_claim(usbRhport, usbEpIn)) return;   // someone else is starting one
+  if (usbTxBusy || usbTxTail == usbTxHead) {
+    usbd_edpt_release(usbRhport, usbEpIn);
+    return;
+  }
+  uint8_t slot = usbTxTail;
+  usbTxBusy = true;
+  if (!usbd_edpt_xfer(usbRhport, usbEpIn, usbTxBuf[slot], usbTxLen[slot])) {
+    usbTxBusy = false;
+    usbd_edpt_release(usbRhport, usbEpIn);
+  }
+}
+
+static void usbRxArm() {
+  if (!usbOpened || usbRxReady) return;
+  if (!usbd_edpt_claim(usbRhport, usbEpOut)) return;
+  if (!usbd_edpt_xfer(usbRhport, usbEpOut, usbRxXfer, sizeof(usbRxXfer))) {
+    usbd_edpt_release(usbRhport, usbEpOut);
+  }
+}
+
+// Feed received bytes to the frame parser. Returns bytes consumed; stops
+// early once a frame is complete (the rest is kept for after the sketch
+// has read it).
+static uint32_t usbRxParse(const uint8_t *p, uint32_t n) {
+  uint32_t used = 0;
+  while (used < n && !usbRxReady) {
+    if (usbRxHave < sizeof(UsbFrameHeader)) {
+      usbRxFrame[usbRxHave++] = p[used++];
+      if (usbRxHave == 2 && (usbRxFrame[0] | (usbRxFrame[1] << 8)) != USB_FRAME_MAGIC) {
+        usbRxFrame[0] = usbRxFrame[1];            // slide by one byte to resync
+        usbRxHave = 1;
+        usbStats.rx_bad++;
+      }
+      if (usbRxHave == sizeof(UsbFrameHeader)) {
+        const UsbFrameHeader *h = (const UsbFrameHeader *)usbRxFrame;
+        if (h->len > USB_MAX_PAYLOAD) {
+          usbStats.rx_bad++;
+          usbRxHave = 0;
+          continue;
+        }
+        if (h->len == 0) {
+          usbRxDoneUs = time_us_64();
+          usbRxReady = true;
+        }
+      }
+      continue;
+    }
+    const UsbFrameHeader *h = (const UsbFrameHeader *)usbRxFrame;
+    uint32_t want = sizeof(UsbFrameHeader) + h->len - usbRxHave;
+    uint32_t take = (n - used < want) ? n - used : want;
+    memcpy(usbRxFrame + usbRxHave, p + used, take);
+    usbRxHave += take;
+    used += take;
+    if (usbRxHave == sizeof(UsbFrameHeader) + h->len) {
+      usbRxDoneUs = time_us_64();
+      usbRxReady = true;
+    }
+  }
+  return used;
+}
+
+// ============================================================================
+// Class driver
+// ============================================================================
+static void usbDrvInit() {}
+
+static void usbDrvReset(uint8_t rhport) {
+  (void)rhport;
+  usbOpened = false;
+  usbTxBusy = false;
+  usbTxHead = usbTxTail = 0;
+  usbRxHave = 0;
+  usbRxReady = false;
+  usbRxPendingLen = 0;
+}
+
+static uint16_t usbDrvOpen(uint8_t rhport, const tusb_desc_interface_t *itf, uint16_t max_len) {
+  if (itf->bInterfaceClass != TUSB_CLASS_VENDOR_SPECIFIC || itf->bInterfaceNumber != usbItf) return 0;
+
+  uint16_t len = sizeof(tusb_desc_interface_t) + 2 * sizeof(tusb_desc_endpoint_t);
+  if (max_len < len) return 0;
+
+  const uint8_t *ep = tu_desc_next(itf);
+  if (!usbd_open_edpt_pair(rhport, ep, 2, TUSB_XFER_BULK, &usbEpOut, &usbEpIn)) return 0;
+
+  usbRhport = rhport;
+  usbOpened = true;
+  usbRxArm();
+  return len;
+}
+
+static bool usbDrvControl(uint8_t rhport, uint8_t stage, const tusb_control_request_t *req) {
+  (void)rhport; (void)stage; (void)req;
+  return false;
+}
+
+static bool usbDrvXfer(uint8_t rhport, uint8_t ep_addr, xfer_result_t result, uint32_t n) {
+  (void)rhport;
+  if (ep_addr == usbEpIn) {
+    if (result == XFER_RESULT_SUCCESS) {
+      usbStats.tx_xfers++;
+      usbStats.tx_bytes += n;
+    }
+    usbTxTail = (usbTxTail + 1) % USB_TX_BUFS;
+    usbTxBusy = false;
+    usbTxKick();
+    return true;
+  }
+  if (ep_addr == usbEpOut) {
+    usbStats.rx_bytes += n;
+    uint32_t used = usbRxParse(usbRxXfer, n);
+    if (used < n) {                        // frame completed mid-transfer
+      usbRxPendingLen = n - used;
+      memcpy(usbRxPending, usbRxXfer + used, usbRxPendingLen);
+    }
+    usbRxArm();                            // no-op while a frame is waiting
+    return true;
+  }
+  return false;
+}
+
+static usbd_class_driver_t usbDriver;
+
+// TinyUSB asks the application for extra class drivers (weak in usbd.c)
+usbd_class_driver_t const *usbd_app_driver_get_cb(uint8_t *driver_count) {
+  *driver_count = 1;
+  return &usbDriver;
+}
+
+// ============================================================================
+// Interface descriptor (Adafruit TinyUSB composite device)
+// ============================================================================
+class UsbBulkInterface : public Adafruit_USBD_Interface {
+ public:
+  uint16_t getInterfaceDescriptor(uint8_t itfnum_deprecated, uint8_t *buf, uint16_t bufsize) override {
+    (void)itfnum_deprecated;
+    if (!buf) return TUD_VENDOR_DESC_LEN;          // length query
+
+    usbItf = TinyUSBDevice.allocInterface(1);
+    uint8_t ep_in  = TinyUSBDevice.allocEndpoint(TUSB_DIR_IN);
+    uint8_t ep_out = TinyUSBDevice.allocEndpoint(TUSB_DIR_OUT);
+    uint8_t desc[] = { TUD_VENDOR_DESCRIPTOR(usbItf, _strid, ep_out, ep_in, 64) };
+    if (bufsize < sizeof(desc)) return 0;
+    memcpy(buf, desc, sizeof(desc));
+    return sizeof(desc);
+  }
+};
+
+static UsbBulkInterface usbInterface;
+
+// Call before Serial.begin() so the interface is in the first enumeration
+static void usbBulkBegin() {
+  memset(&usbDriver, 0, sizeof(usbDriver));
+  usbDriver.init            = usbDrvInit;
+  usbDriver.reset           = usbDrvReset;
+  usbDriver.open            = usbDrvOpen;
+  usbDriver.control_xfer_cb = usbDrvControl;
+  usbDriver.xfer_cb         = usbDrvXfer;
+
+  usbInterface.setStringDescriptor("ADF5355 bulk");
+  TinyUSBDevice.addInterface(usbInterface);
+}
+
+static inline bool usbBulkConnected() {
+  return usbOpened && TinyUSBDevice.mounted();
+}
+
+// ============================================================================
+// Sketch side
+// ============================================================================
+
+// Queue the buffer being filled (if it has anything) and kick the endpoint.
+// A partial buffer is only queued once the pipe has gone idle, so small
+// frames written back to back still leave in big transfers.
+static void usbBulkFlush(bool force = false) {
+  uint8_t h = usbTxHead;
+  if (usbTxLen[h] == 0) return;
+  if (!force && usbTxLen[h] < USB_XFER_BYTES && (usbTxBusy || usbTxTail != h)) return;
+  uint8_t next = (h + 1) % USB_TX_BUFS;
+  if (next == usbTxTail) return;           // ring full, stays open for more
+  usbTxHead = next;
+  usbTxLen[next] = 0;
+  usbTxKick();
+}
+
+// Frames free in the ring, roughly (whole transfer buffers not yet queued)
+static inline uint8_t usbBulkFreeBufs() {
+  return (uint8_t)((usbTxTail + USB_TX_BUFS - usbTxHead - 1) % USB_TX_BUFS);
+}
+
+// Append one frame (header + up to two payload pieces). All or nothing:
+// false if the ring can't take the whole frame right now.
+static bool usbBulkSend(uint8_t type, const void *a, uint32_t alen,
+                        const void *b = nullptr, uint32_t blen = 0) {
+  if (!usbBulkConnected()) return false;
+
+  UsbFrameHeader h = { USB_FRAME_MAGIC, type, 0, usbTxSeq, alen + blen };
+  uint32_t total = sizeof(h) + alen + blen;
+
+  // room: rest of the fill buffer + free buffers behind it
+  uint32_t room = (USB_XFER_BYTES - usbTxLen[usbTxHead]) + (uint32_t)usbBulkFreeBufs() * USB_XFER_BYTES;
+  if (total > room) {
+    usbStats.tx_dropped++;
+    return false;
+  }
+
+  const uint8_t *parts[3] = { (const uint8_t *)&h, (const uint8_t *)a, (const uint8_t *)b };
+  uint32_t lens[3] = { sizeof(h), alen, blen };
+  for (int k = 0; k < 3; k++) {
+    const uint8_t *p = parts[k];
+    uint32_t n = lens[k];
+    while (n) {
+      uint8_t slot = usbTxHead;
+      uint32_t space = USB_XFER_BYTES - usbTxLen[slot];
+      uint32_t take = n < space ? n : space;
+      memcpy(usbTxBuf[slot] + usbTxLen[slot], p, take);
+      usbTxLen[slot] += take;
+      p += take;
+      n -= take;
+      if (usbTxLen[slot] == USB_XFER_BYTES) usbBulkFlush(true);
+    }
+  }
+  usbTxSeq++;
+  usbStats.tx_frames++;
+  return true;
+}
+
+// Complete frame from the host, if any. Valid until the next call.
+static bool usbBulkReceive(const UsbFrameHeader **hdr, const uint8_t **payload) {
+  static bool handedOut = false;
+
+  if (handedOut) {
+    // Previous frame is done with: start the next one from leftover bytes,
+    // then let the host send again
+    handedOut = false;
+    usbRxHave = 0;
+    usbRxReady = false;
+    if (usbRxPendingLen) {
+      uint32_t used = usbRxParse(usbRxPending, usbRxPendingLen);
+      memmove(usbRxPending, usbRxPending + used, usbRxPendingLen - used);
+      usbRxPendingLen -= used;
+    }
+    if (!usbRxReady && !usbRxPendingLen) usbRxArm();
+  }
+
+  if (!usbRxReady) return false;
+  *hdr = (const UsbFrameHeader *)usbRxFrame;
+  *payload = usbRxFrame + sizeof(UsbFrameHeader);
+  usbStats.rx_frames++;
+  handedOut = true;
+  return true;
+}
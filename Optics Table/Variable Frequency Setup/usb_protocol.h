@@ -0,0 +1,225 @@
+#pragma once
+#include <stdint.h>
+#include "crc16.h"
+
+// ============================================================================
+// Bulk transport framing (vendor-class USB interface)
+// ============================================================================
+//
+// Both directions are a plain byte stream of frames:
+//
+//   UsbFrameHeader (12 bytes) | payload (len bytes)
+//
+// USB bulk already has CRC + retries, so there's no checksum; seq lets the
+// receiver spot dropped frames (the device drops stream frames when the
+// host doesn't keep up, it never blocks acquisition). Frames may span or
+// share USB transfers -- both ends parse a stream, not packets.
+// Little-endian on both sides.
+//
+// No Arduino dependencies -- the host client includes this file too.
+
+static constexpr uint16_t USB_BULK_VID   = 0x2E8A;   // Raspberry Pi (arduino-pico default)
+static constexpr uint16_t USB_FRAME_MAGIC = 0xAD55;
+
+// One multi-packet transfer. Host IN requests use the same size so a short
+// device transfer completes the host request right away.
+static constexpr uint32_t USB_XFER_BYTES   = 4096;
+static constexpr uint32_t USB_MAX_PAYLOAD  = 65536;
+static constexpr uint32_t USB_TABLE_MAX    = USB_MAX_PAYLOAD / 8;
+static constexpr uint32_t USB_TABLE_SLOT_MAX = USB_TABLE_MAX / 2;   // live + standby
+
+enum UsbFrameType : uint8_t {
+  USB_T_PING         = 1,   // host -> dev, payload echoed back in a PONG
+  USB_T_PONG         = 2,
+  USB_T_TABLE        = 3,   // host -> dev, uint64 frequencies in Hz
+  USB_T_ACK          = 4,   // dev -> host, UsbAck
+  USB_T_STREAM_START = 5,   // host -> dev, UsbStreamStart
+  USB_T_STREAM_STOP  = 6,   // host -> dev, no payload; acked with stream stats
+  USB_T_SAMPLES      = 7,   // dev -> host, UsbSamplesHeader + uint16 data[ch][n]
+  USB_T_PATTERN      = 8,   // dev -> host, uint32 counter words (throughput test)
+  USB_T_TIME         = 9,   // host -> dev, UsbTimeRequest
+  USB_T_TIME_REPLY   = 10,  // dev -> host, UsbTimeReply
+  USB_T_TRACE_READ   = 11,  // host -> dev, no payload
+  USB_T_TRACE        = 12,  // dev -> host, UsbTraceHeader + UsbTraceEvent[count]
+  USB_T_AVERAGE      = 13,  // dev -> host, UsbAverageHeader + UsbAverageCell[count][channels]
+  USB_T_TABLE_STAGE  = 14,  // host -> dev, UsbTableStage + uint64 frequencies, stream keeps running
+  USB_T_TABLE_SWAP   = 15,  // host -> dev, UsbTableSwap
+  USB_T_TABLE_LIVE   = 16,  // dev -> host, UsbTableLive, sent when a staged table takes over
+};
+
+// When a staged table takes over from the live one
+enum UsbSwapWhen : uint8_t {
+  USB_SWAP_HOLD     = 0,    // not until a TABLE_SWAP says so (in a swap: disarm)
+  USB_SWAP_PASS_END = 1,    // after the last point of the current pass
+  USB_SWAP_NEXT_HOP = 2,    // at the next hop, mid-pass
+};
+
+enum UsbStreamMode : uint8_t {
+  USB_STREAM_SAMPLES = 0,   // acquisition blocks
+  USB_STREAM_PATTERN = 1,   // counter pattern as fast as the bus takes it
+  USB_STREAM_AVERAGE = 2,   // table run `passes` times, averaged on the device
+};
+
+#pragma pack(push, 1)
+struct UsbFrameHeader {
+  uint16_t magic;
+  uint8_t  type;
+  uint8_t  flags;           // reserved, 0
+  uint32_t seq;             // per direction, per frame
+  uint32_t len;             // payload bytes
+};
+
+struct UsbAck {
+  uint8_t  type;            // frame type being acknowledged
+  uint8_t  status;          // 0 = ok
+  uint16_t reserved;
+  uint32_t value;           // TABLE: points accepted, STREAM_STOP: frames sent,
+                            // STREAM_START: points in the live table
+  uint32_t value2;          // TABLE: points that failed to plan, STREAM_STOP: frames dropped,
+                            // STREAM_START: hop period in us
+  uint32_t elapsed_us;      // TABLE: device-side receive time
+};
+
+struct UsbStreamStart {
+  uint8_t  mode;            // UsbStreamMode
+  uint8_t  reserved[3];
+  // AVERAGE only (older hosts send just the first 4 bytes)
+  uint32_t passes;          // 1..65535
+  uint32_t snapshot_every;  // send the running average every N passes, 0 = final only
+  uint32_t settle_us;       // samples this soon after a hop are left out
+};
+
+struct UsbSamplesHeader {
+  uint32_t block_seq;       // RxBlock::seq, gaps = blocks dropped on the device
+  uint64_t t0_ns;
+  uint32_t sample_ns;
+  uint32_t hop;             // hop active at t0 (0xFFFFFFFF = none yet)
+  int64_t  hop_offset_ns;   // t0 - that hop's LE edge
+  uint8_t  channels;
+  uint8_t  reserved;
+  uint16_t per_channel;
+};
+
+// Clock correlation, NTP style: the host stamps t1 (its own clock, echoed
+// back), the device stamps t2 when the frame finished arriving and t3 just
+// before queueing the reply, the host stamps t4 on receipt.
+struct UsbTimeRequest {
+  uint32_t tag;
+  uint32_t reserved;
+  uint64_t host_tx_ns;      // t1
+};
+
+struct UsbTimeReply {
+  uint32_t tag;
+  uint32_t reserved;
+  uint64_t host_tx_ns;      // t1, echoed
+  uint64_t dev_rx_us;       // t2, device time_us_64()
+  uint64_t dev_tx_us;       // t3
+};
+
+// Device trace: events since the last TRACE_READ, oldest first, in the
+// device's own time_us_64() domain (the host rebases them).
+struct UsbTraceHeader {
+  uint64_t dev_now_us;
+  uint32_t count;
+  uint32_t dropped;         // overwritten before they were read, since boot
+};
+
+struct UsbTraceEvent {
+  uint64_t t_us;
+  uint32_t dur_us;          // 0 = instant
+  uint32_t arg;
+  uint8_t  track;           // UsbTraceTrack
+  uint8_t  kind;            // UsbTraceKind
+  uint16_t reserved;
+};
+// Double-buffered tables: the device holds a live table and a standby one.
+// A staged table is planned into standby while the live one keeps hopping,
+// checked against the CRC, and then swapped in on a hop boundary -- the
+// swap itself is an index flip, so no hop is late or missing around it.
+// The standby slot keeps the previous table, so a second swap goes back.
+struct UsbTableStage {
+  uint16_t table_id;        // echoed in UsbTableLive, 0 is the plain TABLE upload
+  uint16_t crc;             // crc16 over the frequency bytes
+  uint8_t  swap;            // UsbSwapWhen, armed only if every point planned
+  uint8_t  reserved[3];
+};
+
+struct UsbTableSwap {
+  uint16_t table_id;        // must be the one in standby
+  uint8_t  when;            // UsbSwapWhen
+  uint8_t  reserved;
+};
+
+struct UsbTableLive {
+  uint16_t table_id;
+  uint16_t reserved;
+  uint32_t points;
+  uint32_t first_hop;       // hop number of its first point (UsbSamplesHeader::hop)
+  uint32_t gap_us;          // previous hop to this one; the hop period = no dead time
+  uint64_t t_us;            // device time_us_64() of that hop
+};
+
+// Averaged sweep, in chunks of points (a snapshot or the final result is
+// as many frames as it takes). Each cell carries its own pass count, so a
+// snapshot sent while passes are still running is consistent per point.
+struct UsbAverageHeader {
+  uint32_t passes_done;     // complete passes when the frame was sent
+  uint32_t passes;          // requested
+  uint16_t points;          // table length
+  uint16_t first_point;
+  uint16_t count;           // points in this frame
+  uint8_t  channels;
+  uint8_t  flags;           // UsbAverageFlags
+};
+
+// Mean of the per-hop means, and their variance across passes (the spread
+// the average beats down by 1/n). ADC counts, Q8.
+struct UsbAverageCell {
+  uint32_t mean_q8;
+  uint32_t var_q8;          // counts^2, saturates
+  uint16_t n;               // passes that contributed to this point
+  uint16_t reserved;
+};
+#pragma pack(pop)
+
+static_assert(sizeof(UsbFrameHeader) == 12, "frame header layout");
+static_assert(sizeof(UsbAck) == 16, "ack layout");
+static_assert(sizeof(UsbSamplesHeader) == 32, "samples header layout");
+static_assert(sizeof(UsbTimeReply) == 32, "time reply layout");
+static_assert(sizeof(UsbTraceEvent) == 20, "trace event layout");
+static_assert(sizeof(UsbStreamStart) == 16, "stream start layout");
+static_assert(sizeof(UsbAverageHeader) == 16, "average header layout");
+static_assert(sizeof(UsbAverageCell) == 12, "average cell layout");
+static_assert(sizeof(UsbTableStage) == 8, "table stage layout");
+static_assert(sizeof(UsbTableLive) == 24, "table live layout");
+
+enum UsbAverageFlags : uint8_t {
+  USB_AVG_FINAL = 1,        // all passes done; the last frame of it ends the stream
+  USB_AVG_LAST  = 2,        // last chunk of this snapshot
+};
+
+enum UsbTraceTrack : uint8_t {
+  USB_TRACK_BOARD_A = 0,
+  USB_TRACK_BOARD_B = 1,
+  USB_TRACK_ACQ     = 2,
+  USB_TRACK_USB     = 3,
+};
+
+enum UsbTraceKind : uint8_t {
+  USB_EV_HOP        = 1,    // register writes for a hop, arg = hop number
+  USB_EV_TABLE      = 2,    // table planned, arg = points
+  USB_EV_ACQ_BLOCK  = 3,    // acquisition block span, arg = block seq
+  USB_EV_FRAME_DROP = 4,    // stream frame dropped (ring full), arg = frames sent so far
+  USB_EV_TIME       = 5,    // time request handled (t2..t3), arg = tag
+  USB_EV_STREAM     = 6,    // arg = 1 start, 0 stop
+  USB_EV_TABLE_SWAP = 7,    // staged table went live, arg = table id
+};
+
+enum UsbAckStatus : uint8_t {
+  USB_ACK_OK       = 0,
+  USB_ACK_TOO_BIG  = 1,
+  USB_ACK_BAD      = 2,
+  USB_ACK_PARTIAL  = 3,     // TABLE_STAGE: some points failed to plan; staged, not armed
+};
+
@@ -0,0 +1,203 @@
+#pragma once
+#include <stdint.h>
+#include <string.h>
+#include "adf5355_plan.h"
+
+// ============================================================================
+// Write combining for control commands
+// ============================================================================
+//
+// Frequency, output power and output-select changes tend to come in bunches
+// (a script setting up a phase sends all three back to back). Applied one
+// at a time, each is its own register burst, and every frequency change
+// pays an autocal + relock.
+//
+// Here each command only edits a pending state. The first change opens a
+// window of window_us; when it closes (or on combFlush) the pending state
+// is planned into one register image and only the words that differ from
+// what the chip already holds are written, R0 (with autocal) once and only
+// if the frequency words moved. window_us = 0 writes through right away.
+//
+// Output fields live in R6 next to the divider select:
+//   DB5:4  RFOUTA power (0 = -4, 1 = -1, 2 = +2, 3 = +5 dBm)
+//   DB6    RFOUTA enable
+//   DB10   RFOUTB power-down (1 = off)
+// RFOUTB has no power setting of its own.
+//
+// The counters compare against the same commands written through one by
+// one: a frequency change as its hop delta plus R0, a power or output
+// change as one R6 write.
+//
+// Nothing in here touches hardware. The including file provides the hooks.
+
+static void     combWrite(uint32_t word);
+static uint32_t combMicros();
+
+static constexpr uint32_t ADF_R6_PWR_SHIFT = 4;
+static constexpr uint32_t ADF_R6_PWR_MASK  = 3u << ADF_R6_PWR_SHIFT;
+static constexpr uint32_t ADF_R6_RFA_EN    = 1u << 6;
+static constexpr uint32_t ADF_R6_RFB_PD    = 1u << 10;
+
+struct RfState {
+  uint64_t freq_hz;
+  uint8_t  power;             // RFOUTA, 0..3
+  bool     out_a;
+  bool     out_b;
+};
+
+struct CombineStats {
+  uint32_t commands;          // accepted changes
+  uint32_t rejected;          // unplannable frequency, bad power level
+  uint32_t bursts;            // flushes that wrote something
+  uint32_t words;             // register words written
+  uint32_t words_naive;       // words the commands would have cost one by one
+  uint32_t recals;            // R0 writes with autocal
+  uint32_t recals_naive;
+  uint32_t max_batch;         // most commands merged into one burst
+};
+
+struct Combiner {
+  PlanConfig plan;
+  uint32_t baseR6, baseR1, baseR0;
+  uint32_t window_us;
+
+  RfState  live;
+  PllPlan  livePlan;
+  uint32_t liveWords[4];      // R6, R2, R1, R0 as the chip holds them
+
+  RfState  pending;
+  PllPlan  pendingPlan;
+  bool     dirty;
+  uint32_t openedUs;          // first change of this window
+  uint32_t batch;             // commands in this window
+
+  CombineStats stats;
+};
+
+// ============================================================================
+// Image
+// ============================================================================
+static inline uint32_t combPackR6(const Combiner &c, const RfState &s, const PllPlan &p) {
+  uint32_t w = packR6Div(c.baseR6, p) & ~(ADF_R6_PWR_MASK | ADF_R6_RFA_EN | ADF_R6_RFB_PD);
+  w |= (uint32_t)(s.power & 3) << ADF_R6_PWR_SHIFT;
+  if (s.out_a) w |= ADF_R6_RFA_EN;
+  if (!s.out_b) w |= ADF_R6_RFB_PD;
+  return w;
+}
+
+// Writes the words of `s` that differ from liveWords, R0 last. Returns the
+// number written.
+static uint8_t combApply(Combiner &c, const RfState &s, const PllPlan &p) {
+  uint32_t w[4] = {
+    combPackR6(c, s, p),
+    packR2(p),
+    packR1(c.baseR1, p),
+    packR0(c.baseR0, p),
+  };
+  // R0 latches the double-buffered R1/R2 and the divider: needed whenever
+  // the N divider or the divider select moved
+  bool retune = w[1] != c.liveWords[1] || w[2] != c.liveWords[2] || w[3] != c.liveWords[3] ||
+                p.out_div != c.livePlan.out_div;
+
+  uint8_t n = 0;
+  for (int i = 0; i < 3; i++) {
+    if (w[i] == c.liveWords[i]) continue;
+    combWrite(w[i]);
+    c.liveWords[i] = w[i];
+    n++;
+  }
+  if (retune) {
+    combWrite(w[3] | ADF_R0_AUTOCAL);
+    c.liveWords[3] = w[3];
+    c.stats.recals++;
+    n++;
+  }
+  c.live = s;
+  c.livePlan = p;
+  return n;
+}
+
+// ============================================================================
+// API
+// ============================================================================
+
+// Writes the full frequency/output image once, so liveWords match the chip.
+// False if `initial` doesn't plan.
+static bool combBegin(Combiner &c, const PlanConfig &plan, uint32_t baseR6, uint32_t baseR1,
+                      uint32_t baseR0, uint32_t window_us, const RfState &initial) {
+  memset(&c, 0, sizeof(c));
+  c.plan = plan;
+  c.baseR6 = baseR6;
+  c.baseR1 = baseR1;
+  c.baseR0 = baseR0;
+  c.window_us = window_us;
+
+  PllPlan p = planFrequencyInt(plan, initial.freq_hz);
+  if (!p.ok || initial.power > 3) return false;
+  memset(c.liveWords, 0xFF, sizeof(c.liveWords));    // matches nothing: all four go out
+  c.livePlan.out_div = 0;
+  combApply(c, initial, p);
+  c.pending = c.live;
+  c.pendingPlan = c.livePlan;
+  memset(&c.stats, 0, sizeof(c.stats));
+  return true;
+}
+
+static void combFlush(Combiner &c) {
+  if (!c.dirty) return;
+  c.dirty = false;
+  uint8_t n = combApply(c, c.pending, c.pendingPlan);
+  if (n) c.stats.bursts++;
+  c.stats.words += n;
+  if (c.batch > c.stats.max_batch) c.stats.max_batch = c.batch;
+  c.batch = 0;
+}
+
+// Call from the loop: closes the window once it has run out
+static void combPoll(Combiner &c) {
+  if (c.dirty && combMicros() - c.openedUs >= c.window_us) combFlush(c);
+}
+
+static void combTouched(Combiner &c) {
+  c.stats.commands++;
+  c.batch++;
+  if (!c.dirty) {
+    c.dirty = true;
+    c.openedUs = combMicros();
+  }
+  if (c.window_us == 0) combFlush(c);
+}
+
+static bool combSetFreq(Combiner &c, uint64_t hz) {
+  PllPlan p = planFrequencyInt(c.plan, hz);
+  if (!p.ok) {
+    c.stats.rejected++;
+    return false;
+  }
+  // On its own: the hop delta from wherever the last command left it
+  HopDelta d = packHopDelta(c.pendingPlan, p, c.baseR6, c.baseR1, c.baseR0, true);
+  c.stats.words_naive += d.n;
+  c.stats.recals_naive++;
+  c.pending.freq_hz = hz;
+  c.pendingPlan = p;
+  combTouched(c);
+  return true;
+}
+
+static bool combSetPower(Combiner &c, uint8_t power) {
+  if (power > 3) {
+    c.stats.rejected++;
+    return false;
+  }
+  c.stats.words_naive++;
+  c.pending.power = power;
+  combTouched(c);
+  return true;
+}
+
+static void combSetOutputs(Combiner &c, bool a, bool b) {
+  c.stats.words_naive++;
+  c.pending.out_a = a;
+  c.pending.out_b = b;
+  combTouched(c);
+}